@@ -11,12 +11,18 @@ define HELPTEXT
 #    enable features or override default values:
 #    - DF_CONFIG
 #    - DF_VERBOSE
+#    - DF_LOG_ENABLED
+#    - DF_TRACE_ENABLED
+#    - DF_METRICS_ENABLED
+#    - DF_STARTUP_PROFILE_ENABLED
+#    - DF_PIPE_TIMESTAMPS
 #    - DF_OPTIMIZATION
 #    - DF_GDB_SUPPORT
 #    - DF_INPUT_PIPE_PATH
 #    - DF_OUTPUT_PIPE_PATH
 #    - DF_DAEMON_PATH
 #    - DF_REQUIRED_PARENT_PATH
+#    - DF_REQUIRED_PARENT_DIGEST
 #    - DF_LOCK_FILE_PATH
 #    - DF_VERIFY_PATH_SECURITY
 #    - DF_VERIFY_PARENT_PATH_SECURITY
@@ -69,6 +75,42 @@ define HELPTEXT
 #      execution.  If enabled, DF_VERBOSE will be defined in the C preprocessor,
 #      and the DF_DBG_V macro function will print to stdout.
 #
+#   DF_LOG_ENABLED: (default: 0)
+#      If set to 1, DF_DBG and DF_PERROR output is kept in release builds.
+#      Debug builds always keep it. Output is written by a background thread,
+#      and the DF_LOG_LEVEL environment variable may be set to "off", "error",
+#      "debug", or "verbose" to choose which messages are written.
+#
+#   DF_TRACE_ENABLED: (default: 0)
+#      If set to 1, DF_TRACE tracepoints will record events into per-thread
+#      ring buffers. If the DF_TRACE_FILE environment variable is set, each
+#      process writes its events to "$DF_TRACE_FILE.<pid>.json" on exit, in a
+#      format that Perfetto and chrome://tracing can open. If set to 0,
+#      tracepoints are compiled out entirely.
+#
+#   DF_METRICS_ENABLED: (default: 0)
+#      If set to 1, framework counters, gauges, and histograms are kept and
+#      may be read in the Prometheus text format. If the DF_METRICS_SOCKET
+#      environment variable is set, each process serves its metrics on the
+#      Unix socket "$DF_METRICS_SOCKET.<program name>". If DF_METRICS_FILE is
+#      set, each process saves its metrics to
+#      "$DF_METRICS_FILE.<program name>.prom" every few seconds. If set to 0,
+#      metrics are compiled out entirely.
+#
+#   DF_STARTUP_PROFILE_ENABLED: (default: 0)
+#      If set to 1, the parent and daemon record when each startup phase
+#      finishes. If the DF_STARTUP_PROFILE environment variable is set, records
+#      are appended to the file at that path. Daemons only write their records
+#      after their security checks pass, and never profile when launched with
+#      setuid or file capabilities. If set to 0, profiling is compiled out
+#      entirely.
+#
+#   DF_PIPE_TIMESTAMPS: (default: 0)
+#      If set to 1, each message sent between daemon and parent through pipes
+#      starts with a CLOCK_MONOTONIC timestamp, and each pipe reader records
+#      the one-way latency of every message it receives. The daemon and parent
+#      must both be built with the same value.
+#
 ## Communication options:
 #   DF_INPUT_PIPE_PATH:
 #      If defined, the daemon will listen for messages from its parent 
@@ -82,14 +124,26 @@ define HELPTEXT
 #   DF_DAEMON_PATH:
 #      The path where the daemon process executable will be found after
 #      installation. If provided, the daemon will exit if it finds that its
-#      process is running any other executable path.
+#      process is running any other executable file. The file at this path is
+#      pinned when the daemon starts, so replacing it with a different file
+#      will also be detected.
 #
 #    DF_REQUIRED_PARENT_PATH:
 #      If defined, the daemon will find its parent process, check the path of
 #      the executable that the parent process is running, and automatically exit
-#      if the parent is running from any executable path other than
+#      if the parent is running any executable file other than the one found at
 #      DF_REQUIRED_PARENT_PATH.
 #
+#    DF_REQUIRED_PARENT_DIGEST:
+#      If defined as a 64 character hexadecimal SHA-256 digest, the daemon will
+#      hash the executable file its parent process is running, and
+#      automatically exit if the parent executable's digest doesn't match.
+#      If DF_LOCK_FILE_PATH is also defined and the daemon runs as root, the
+#      digest is cached in a root-owned file at DF_LOCK_FILE_PATH with
+#      ".digest" appended, along with the executable's device, inode, size,
+#      modification time, and status change time. Later daemon instances only
+#      hash the parent executable again after it changes.
+#
 #    DF_LOCK_FILE_PATH:
 #      If defined, the daemon will create and use a lock file at this path to
 #      ensure that only one daemon instance may run at one time. Providing a
@@ -99,12 +153,15 @@ define HELPTEXT
 #    DF_VERIFY_PATH_SECURITY: (default: 1)
 #      If set to 1, the daemon will check if it is running from a secured
 #      directory that only the root user/group may modify, and exit if the
-#      directory is insecure.
+#      directory is insecure. The directory and every parent directory up to
+#      the root directory must be owned by the root user and group, must not be
+#      writable by other users, and must not be symbolic links.
 #
 #    DF_VERIFY_PARENT_PATH_SECURITY: (default: 1)
 #      If set to 1, the daemon will check if its parent process is running from
 #      a secured directory that only the root user/group may modify, and exit if
-#      the directory is insecure.
+#      the directory is insecure. As with DF_VERIFY_PATH_SECURITY, every parent
+#      directory up to the root directory is checked as well.
 #
 #    DF_REQUIRE_RUNNING_PARENT: (default: 1)
 #      If set to 1, the daemon will periodically check if its parent process is
@@ -149,6 +206,7 @@ DF_DEFINE_FLAGS:=$(DF_DEFINE_FLAGS) \
                  $(call addStringDef,DF_OUTPUT_PIPE_PATH)\
                  $(call addStringDef,DF_LOCK_FILE_PATH) \
                  $(call addStringDef,DF_REQUIRED_PARENT_PATH) \
+                 $(call addStringDef,DF_REQUIRED_PARENT_DIGEST) \
                  $(call addDef,DF_VERIFY_PATH) \
                  $(call addDef,DF_VERIFY_PATH_SECURITY) \
                  $(call addDef,DF_VERIFY_PARENT_PATH_SECURITY) \
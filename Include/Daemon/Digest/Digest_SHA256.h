@@ -0,0 +1,85 @@
+/**
+ * @file  Digest_SHA256.h
+ *
+ * @brief  Calculates SHA-256 digests of data and executable files.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace DaemonFramework { namespace Digest {
+
+    // Size in bytes of a SHA-256 digest:
+    static const constexpr size_t sha256Size = 32;
+
+    // Holds a complete SHA-256 digest:
+    typedef std::array<unsigned char, sha256Size> SHA256Value;
+
+    /**
+     * @brief  Calculates the SHA-256 digest of a block of memory.
+     *
+     *  If the processor supports the x86 SHA extensions, they will be used to
+     * calculate the digest. Otherwise, a portable implementation will be used.
+     *
+     * @param data  A pointer to at least size bytes of data.
+     *
+     * @param size  The number of bytes to hash.
+     *
+     * @return      The SHA-256 digest of the data.
+     */
+    SHA256Value sha256(const unsigned char* data, const size_t size);
+
+    /**
+     * @brief  Calculates the SHA-256 digest of a block of memory without using
+     *         any processor extensions.
+     *
+     *  This always returns the same digest as sha256(). It allows the portable
+     * implementation to be tested on processors with the x86 SHA extensions.
+     *
+     * @param data  A pointer to at least size bytes of data.
+     *
+     * @param size  The number of bytes to hash.
+     *
+     * @return      The SHA-256 digest of the data.
+     */
+    SHA256Value portableSHA256(const unsigned char* data, const size_t size);
+
+    /**
+     * @brief  Calculates the SHA-256 digest of an open file's contents.
+     *
+     *  The file is memory-mapped while it is hashed. If a cache path is
+     * provided, the digest is saved there along with the file's device, inode,
+     * size, modification time, and status change time, so that later processes
+     * only hash the file again after it changes. Cached digests are only used
+     * if the cache file is owned by root and only writable by root, and are
+     * only saved when running as root.
+     *
+     * @param fileDescriptor  A file descriptor opened with read access.
+     *
+     * @param digest          The object where the file's digest will be
+     *                        saved.
+     *
+     * @param cachePath       The path of the file where the digest is cached,
+     *                        or nullptr to always hash the file.
+     *
+     * @return                Whether the file was read and hashed
+     *                        successfully. If the file changes while it is
+     *                        being hashed, this will return false.
+     */
+    bool fileSHA256(const int fileDescriptor, SHA256Value& digest,
+            const char* cachePath);
+
+    /**
+     * @brief  Reads a SHA-256 digest from a hexadecimal string.
+     *
+     * @param hexString  A string of exactly 64 hexadecimal characters, in
+     *                   either case.
+     *
+     * @param digest     The object where the parsed digest will be saved.
+     *
+     * @return           Whether the string held a valid digest.
+     */
+    bool parseSHA256(const char* hexString, SHA256Value& digest);
+
+} }
@@ -0,0 +1,189 @@
+/**
+ * @file  LoopCore.h
+ *
+ * @brief  Holds daemon loop state and actions shared by every PolicyLoop
+ *         configuration.
+ */
+
+#pragma once
+#include <cstddef>
+#include <atomic>
+
+#include "Arena.h"
+#include "ExitCode.h"
+#include "StartupProfile.h"
+
+namespace DaemonFramework
+{
+    class LoopCore;
+    template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+    class PolicyLoop;
+}
+
+/**
+ * @brief  Handles the parts of the daemon loop that don't depend on loop
+ *         policies.
+ *
+ *  LoopCore subscribes to termination signals, wakes waiting loop actions,
+ * holds the daemon's lock file, signals daemon readiness, and holds the arenas
+ * used for scratch memory while running loop iterations and handling parent
+ * messages. Keeping these in a single compiled class lets every PolicyLoop
+ * configuration share them, so loop templates only contain policy-specific
+ * code.
+ *
+ *  Only one LoopCore may exist at a time, as termination signals are handled
+ * process-wide. Creating another while one exists will trigger an immediate
+ * runtime error on construction in Debug builds, and will cause undefined
+ * behavior in Release builds.
+ */
+class DaemonFramework::LoopCore
+{
+public:
+    /**
+     * @brief  Releases the lock file if held, and closes the wake event.
+     */
+    virtual ~LoopCore();
+
+protected:
+    /**
+     * @brief  Subscribes to termination signals, and creates the event used
+     *         to wake waiting loop actions.
+     */
+    LoopCore();
+
+    /**
+     * @brief  Checks if runLoop() has been called already, and the loop is
+     *         currently running.
+     *
+     * @return  Whether the loop is running.
+     */
+    bool isLoopRunning() const;
+
+    /**
+     * @brief  Waits until a parent message is handled, a termination signal
+     *         is received, or the timeout period ends.
+     *
+     *  loopAction() implementations with no periodic work should call this
+     * instead of sleeping, so that idle daemons don't wake up needlessly. The
+     * loop's repeated security checks only run between loopAction() calls, so
+     * the timeout sets the longest delay before they run again.
+     *
+     * @param timeoutMS  The maximum number of milliseconds to wait.
+     *
+     * @return           Whether an event ended the wait before the timeout.
+     */
+    bool waitForEvents(const int timeoutMS);
+
+private:
+    template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+    friend class PolicyLoop;
+
+    /**
+     * @brief  Marks the loop as running.
+     *
+     * @return  False if the loop was already running.
+     */
+    bool startLoop();
+
+    /**
+     * @brief  Marks the loop as stopped after it ends early.
+     *
+     * @param exitCode  The reason the loop ended.
+     *
+     * @param reason    A description of why the loop ended, printed in debug
+     *                  output.
+     *
+     * @return          The exit code, converted to an integer.
+     */
+    int exitLoop(const ExitCode exitCode, const char* reason);
+
+    /**
+     * @brief  Marks the loop as stopped after loopAction() or initLoop()
+     *         returned a nonzero value.
+     *
+     * @param resultCode  The returned value.
+     *
+     * @return            The same result code.
+     */
+    int exitLoop(const int resultCode);
+
+    /**
+     * @brief  Checks if a termination signal was received.
+     */
+    static bool termSignalReceived()
+    {
+        return termSignal.load(std::memory_order_relaxed) > 0;
+    }
+
+    /**
+     * @brief  Checks if the parent launched the daemon on demand, clearing
+     *         the environment variable the parent used to mark it.
+     *
+     * @return  Whether the daemon was launched on demand.
+     */
+    static bool launchedOnDemand();
+
+    /**
+     * @brief  Opens and locks the lock file used to ensure only one daemon
+     *         instance runs, creating its directory if needed.
+     *
+     * @param lockPath  The path to the lock file.
+     *
+     * @return          Whether the lock was acquired. If a termination signal
+     *                  interrupted locking, this returns false.
+     */
+    bool lockInstance(const char* lockPath);
+
+    /**
+     * @brief  Tells the parent process that the daemon is ready to handle
+     *         requests, if the parent provided a readiness pipe.
+     */
+    void signalReady();
+
+    /**
+     * @brief  Counts a loopAction() call in framework metrics.
+     */
+    void countLoopAction();
+
+    /**
+     * @brief  Counts a received parent message in framework metrics.
+     *
+     * @param size  The message size in bytes.
+     */
+    void countParentMessage(const size_t size);
+
+    /**
+     * @brief  Wakes any loopAction() call waiting in waitForEvents().
+     *
+     *  This only makes async-signal-safe calls, so it may be used within the
+     * signal handler.
+     */
+    static void wakeLoop();
+
+    /**
+     * @brief  Sets termSignal when a termination signal is caught.
+     *
+     * @param signum  The received signal, which should only ever be SIGTERM.
+     */
+    static void flagTermSignal(int signum);
+
+    // Stores whether the daemon process should be terminated:
+    // -1: sigaction not yet called.
+    //  0: sigaction called, SIGTERM not received.
+    //  1: SIGTERM received.
+    static std::atomic_int termSignal;
+
+    // Records when DaemonLoop construction starts, if profiling startup, and
+    // holds records until security checks pass. This must be declared before
+    // all other members:
+    StartupProfile::Checkpoint constructionStarted
+            {"DaemonLoop construction started", true};
+    // Stores whether the loop is currently running:
+    std::atomic_bool loopRunning;
+    // File descriptor for the lock file used to ensure only one instance runs:
+    int lockFD = 0;
+    // Scratch memory for the main loop thread, reset after each iteration:
+    Arena loopArena;
+    // Scratch memory for the input pipe thread, reset after each message:
+    Arena messageArena;
+};
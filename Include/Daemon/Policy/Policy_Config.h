@@ -0,0 +1,84 @@
+/**
+ * @file  Policy_Config.h
+ *
+ * @brief  Defines the policies selected by DaemonFramework build
+ *         configuration macros, used by DaemonLoop.
+ */
+
+#pragma once
+#include "Policy_Transport.h"
+#include "Policy_Security.h"
+#include "Policy_Timeout.h"
+
+namespace DaemonFramework
+{
+    namespace Policy
+    {
+        struct ConfigTransport;
+        struct ConfigSecurity;
+#       if defined DF_TIMEOUT && DF_TIMEOUT > 0
+        typedef Timeout<DF_TIMEOUT> ConfigTimeout;
+#       else
+        typedef NoTimeout ConfigTimeout;
+#       endif
+    }
+}
+
+/**
+ * @brief  Uses the pipes set by DF_INPUT_PIPE_PATH and DF_OUTPUT_PIPE_PATH,
+ *         timestamped if DF_PIPE_TIMESTAMPS is enabled.
+ */
+struct DaemonFramework::Policy::ConfigTransport : public NoPipes
+{
+#   ifdef DF_INPUT_PIPE_PATH
+    static constexpr const char* inputPipePath() { return DF_INPUT_PIPE_PATH; }
+#   endif
+#   ifdef DF_OUTPUT_PIPE_PATH
+    static constexpr const char* outputPipePath()
+    {
+        return DF_OUTPUT_PIPE_PATH;
+    }
+#   endif
+#   if defined DF_PIPE_TIMESTAMPS && DF_PIPE_TIMESTAMPS
+    static constexpr bool pipeTimestamps = true;
+#   endif
+};
+
+/**
+ * @brief  Runs the security checks enabled by DaemonFramework build
+ *         configuration.
+ */
+struct DaemonFramework::Policy::ConfigSecurity : public NoSecurity
+{
+#   if defined DF_VERIFY_PATH && DF_VERIFY_PATH && defined DF_DAEMON_PATH
+    static constexpr const char* daemonPath() { return DF_DAEMON_PATH; }
+#   endif
+#   ifdef DF_REQUIRED_PARENT_PATH
+    static constexpr const char* parentPath()
+    {
+        return DF_REQUIRED_PARENT_PATH;
+    }
+#   endif
+#   ifdef DF_REQUIRED_PARENT_DIGEST
+    static constexpr const char* parentDigest()
+    {
+        return DF_REQUIRED_PARENT_DIGEST;
+    }
+#   endif
+#   ifdef DF_LOCK_FILE_PATH
+    static constexpr const char* lockFilePath() { return DF_LOCK_FILE_PATH; }
+    static constexpr const char* digestCachePath()
+    {
+        return DF_LOCK_FILE_PATH ".digest";
+    }
+#   endif
+#   if defined DF_VERIFY_PATH_SECURITY && DF_VERIFY_PATH_SECURITY
+    static constexpr bool verifyPathSecurity = true;
+#   endif
+#   if defined DF_VERIFY_PARENT_PATH_SECURITY && DF_VERIFY_PARENT_PATH_SECURITY
+    static constexpr bool verifyParentPathSecurity = true;
+#   endif
+#   if defined DF_REQUIRE_RUNNING_PARENT && DF_REQUIRE_RUNNING_PARENT
+    static constexpr bool requireRunningParent = true;
+#   endif
+};
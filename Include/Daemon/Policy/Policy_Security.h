@@ -0,0 +1,84 @@
+/**
+ * @file  Policy_Security.h
+ *
+ * @brief  Defines the default security policy used to select PolicyLoop
+ *         security checks at compile time.
+ */
+
+#pragma once
+
+namespace DaemonFramework
+{
+    namespace Policy
+    {
+        struct NoSecurity;
+    }
+}
+
+/**
+ * @brief  A security policy that runs no security checks.
+ *
+ *  Security policies choose which Process::Security checks a PolicyLoop runs.
+ * Each value is a compile-time constant, so disabled checks are removed by
+ * the compiler, and enabled checks may be inlined into the loop.
+ *
+ *  Custom policies should inherit from NoSecurity, and only redefine the
+ * values they change. Path and digest functions return nullptr to disable
+ * their checks. For example:
+ *
+ *     struct InstalledSecurity : public Policy::NoSecurity
+ *     {
+ *         static constexpr const char* daemonPath()
+ *         {
+ *             return "/usr/libexec/app/appDaemon";
+ *         }
+ *         static constexpr bool verifyPathSecurity = true;
+ *         static constexpr bool requireRunningParent = true;
+ *     };
+ */
+struct DaemonFramework::Policy::NoSecurity
+{
+    /**
+     * @brief  Gets the path where the daemon executable must be installed.
+     *
+     * @return  The daemon executable path, or nullptr if not checked.
+     */
+    static constexpr const char* daemonPath() { return nullptr; }
+
+    /**
+     * @brief  Gets the path of the executable the parent process must run.
+     *
+     * @return  The parent executable path, or nullptr if not checked.
+     */
+    static constexpr const char* parentPath() { return nullptr; }
+
+    /**
+     * @brief  Gets the SHA-256 digest the parent executable must have.
+     *
+     * @return  A 64 character hexadecimal digest, or nullptr if not checked.
+     */
+    static constexpr const char* parentDigest() { return nullptr; }
+
+    /**
+     * @brief  Gets the path of the file where the parent executable's digest
+     *         is cached between daemon processes.
+     *
+     * @return  The digest cache path, or nullptr if digests aren't cached.
+     */
+    static constexpr const char* digestCachePath() { return nullptr; }
+
+    /**
+     * @brief  Gets the path of the lock file used to ensure that only one
+     *         daemon instance runs at a time.
+     *
+     * @return  The lock file path, or nullptr if no lock file is used.
+     */
+    static constexpr const char* lockFilePath() { return nullptr; }
+
+    // Whether the daemon must run from a directory only root may modify:
+    static constexpr bool verifyPathSecurity = false;
+    // Whether the parent must run from a directory only root may modify:
+    static constexpr bool verifyParentPathSecurity = false;
+    // Whether the daemon exits once its parent process stops running:
+    static constexpr bool requireRunningParent = false;
+};
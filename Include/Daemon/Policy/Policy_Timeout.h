@@ -0,0 +1,77 @@
+/**
+ * @file  Policy_Timeout.h
+ *
+ * @brief  Defines timeout policies used to choose when a PolicyLoop stops at
+ *         compile time.
+ */
+
+#pragma once
+#include <chrono>
+
+namespace DaemonFramework
+{
+    namespace Policy
+    {
+        class NoTimeout;
+        template <int seconds> class Timeout;
+    }
+}
+
+/**
+ * @brief  A timeout policy that never ends the loop.
+ *
+ *  Timeout policies are created by the PolicyLoop. start() is called once
+ * just before the main loop starts, and expired() is checked before each
+ * loopAction() call.
+ */
+class DaemonFramework::Policy::NoTimeout
+{
+public:
+    /**
+     * @brief  Does nothing, as there is no timeout period to start.
+     */
+    void start() { }
+
+    /**
+     * @brief  Checks if the timeout period is over.
+     *
+     * @return  False, as the timeout period never ends.
+     */
+    constexpr bool expired() const { return false; }
+};
+
+/**
+ * @brief  A timeout policy that ends the loop after a fixed number of
+ *         seconds.
+ *
+ * @tparam seconds  The number of seconds the loop may run. This must be
+ *                  greater than zero.
+ */
+template <int seconds>
+class DaemonFramework::Policy::Timeout
+{
+    static_assert(seconds > 0, "Timeout periods must be at least one second.");
+public:
+    /**
+     * @brief  Starts the timeout period.
+     */
+    void start()
+    {
+        endTime = std::chrono::steady_clock::now()
+                + std::chrono::seconds(seconds);
+    }
+
+    /**
+     * @brief  Checks if the timeout period is over.
+     *
+     * @return  Whether the loop has run for at least the timeout period.
+     */
+    bool expired() const
+    {
+        return std::chrono::steady_clock::now() >= endTime;
+    }
+
+private:
+    // The time when the timeout period ends:
+    std::chrono::steady_clock::time_point endTime;
+};
@@ -0,0 +1,181 @@
+/**
+ * @file  Policy_Transport.h
+ *
+ * @brief  Defines the default transport policy, and the pipe holders used to
+ *         add only the pipes a PolicyLoop's transport uses.
+ */
+
+#pragma once
+#include "Pipe_Reader.h"
+#include "Pipe_Writer.h"
+#include "Pipe_Listener.h"
+#include <cstddef>
+
+namespace DaemonFramework
+{
+    namespace Policy
+    {
+        struct NoPipes;
+        template <class Transport,
+                bool used = (Transport::inputPipePath() != nullptr)>
+        class InputPipe;
+        template <class Transport,
+                bool used = (Transport::outputPipePath() != nullptr)>
+        class OutputPipe;
+    }
+}
+
+/**
+ * @brief  A transport policy that doesn't communicate with the parent.
+ *
+ *  Transport policies choose the named pipes a PolicyLoop uses to communicate
+ * with its parent process. Custom policies should inherit from NoPipes, and
+ * only redefine the values they change. Path functions return nullptr if the
+ * pipe isn't used. For example:
+ *
+ *     struct RequestPipes : public Policy::NoPipes
+ *     {
+ *         static constexpr const char* inputPipePath()
+ *         {
+ *             return "/run/app/requests";
+ *         }
+ *     };
+ */
+struct DaemonFramework::Policy::NoPipes
+{
+    /**
+     * @brief  Gets the path of the pipe used to receive parent messages.
+     *
+     * @return  The input pipe path, or nullptr if there is no input pipe.
+     */
+    static constexpr const char* inputPipePath() { return nullptr; }
+
+    /**
+     * @brief  Gets the path of the pipe used to send messages to the parent.
+     *
+     * @return  The output pipe path, or nullptr if there is no output pipe.
+     */
+    static constexpr const char* outputPipePath() { return nullptr; }
+
+    // Whether each pipe message starts with a Pipe::TimestampHeader. The
+    // parent must use the same setting:
+    static constexpr bool pipeTimestamps = false;
+};
+
+/**
+ * @brief  Holds the pipe used to receive parent messages, if the transport
+ *         policy uses one.
+ */
+template <class Transport, bool used>
+class DaemonFramework::Policy::InputPipe
+{
+public:
+    /**
+     * @brief  Creates the pipe reader without opening it.
+     *
+     * @param bufferSize  The size in bytes of the pipe's read buffer.
+     */
+    InputPipe(const size_t bufferSize) :
+    reader(Transport::inputPipePath(), bufferSize)
+    {
+        if (Transport::pipeTimestamps)
+        {
+            reader.setTimestamps(true);
+        }
+    }
+
+    /**
+     * @brief  Starts reading from the pipe.
+     *
+     * @param listener  The object that will receive all pipe messages.
+     */
+    void open(Pipe::Listener* listener) { reader.openPipe(listener); }
+
+    /**
+     * @brief  Checks if the parent closed the pipe.
+     */
+    bool isClosed() { return reader.isClosed(); }
+
+    /**
+     * @brief  Stops reading from the pipe.
+     */
+    void close() { reader.closePipe(); }
+
+    /**
+     * @brief  Gets the pipe reader.
+     */
+    const Pipe::Reader& getReader() const { return reader; }
+
+private:
+    Pipe::Reader reader;
+};
+
+/**
+ * @brief  Replaces the input pipe when the transport policy doesn't use one.
+ */
+template <class Transport>
+class DaemonFramework::Policy::InputPipe<Transport, false>
+{
+public:
+    InputPipe(const size_t bufferSize) { }
+    void open(Pipe::Listener* listener) { }
+    constexpr bool isClosed() const { return false; }
+    void close() { }
+};
+
+/**
+ * @brief  Holds the pipe used to send messages to the parent, if the
+ *         transport policy uses one.
+ */
+template <class Transport, bool used>
+class DaemonFramework::Policy::OutputPipe
+{
+public:
+    /**
+     * @brief  Creates the pipe writer, and starts opening it.
+     */
+    OutputPipe() : writer(Transport::outputPipePath(), true)
+    {
+        if (Transport::pipeTimestamps)
+        {
+            writer.setTimestamps(true);
+        }
+    }
+
+    /**
+     * @brief  Sends data through the pipe.
+     *
+     * @param data  A raw data array to send.
+     *
+     * @param size  The number of bytes to send.
+     *
+     * @return      Whether the data was sent correctly.
+     */
+    bool send(const unsigned char* data, const size_t size)
+    {
+        return writer.sendData(data, size);
+    }
+
+    /**
+     * @brief  Closes the pipe.
+     */
+    void close() { writer.closePipe(); }
+
+    /**
+     * @brief  Gets the pipe writer.
+     */
+    const Pipe::Writer& getWriter() const { return writer; }
+
+private:
+    Pipe::Writer writer;
+};
+
+/**
+ * @brief  Replaces the output pipe when the transport policy doesn't use one.
+ */
+template <class Transport>
+class DaemonFramework::Policy::OutputPipe<Transport, false>
+{
+public:
+    void close() { }
+};
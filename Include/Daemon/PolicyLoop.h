@@ -0,0 +1,440 @@
+/**
+ * @file  PolicyLoop.h
+ *
+ * @brief  A daemon main action loop configured through compile-time policy
+ *         classes.
+ */
+
+#pragma once
+#include <cstddef>
+
+#include "LoopCore.h"
+#include "Process_Security.h"
+#include "Policy_Transport.h"
+#include "Policy_Security.h"
+#include "Policy_Timeout.h"
+#include "Scratch.h"
+#include "Trace.h"
+#include "Debug.h"
+
+/**
+ * @brief  Handles the daemon's main behavior loop, using policies to choose
+ *         its pipes, security checks, and timeout period.
+ *
+ *  PolicyLoop behaves just like DaemonLoop, which is a PolicyLoop configured
+ * by build configuration macros. Choosing policies as template parameters
+ * instead lets one program build differently configured loops, such as
+ * tests that run a loop with each combination of options.
+ *
+ *  All policy values are compile-time constants. Checks a policy disables are
+ * removed by the compiler, and pipe objects are only added if the transport
+ * policy uses them. Functions that need a missing pipe, like messageParent()
+ * without an output pipe, fail to compile if called.
+ *
+ *  Only one PolicyLoop or DaemonLoop may exist at a time.
+ *
+ * @tparam Transport       A Policy::NoPipes subclass choosing the pipes used
+ *                         to communicate with the parent.
+ *
+ * @tparam SecurityPolicy  A Policy::NoSecurity subclass choosing the security
+ *                         checks the loop runs.
+ *
+ * @tparam TimeoutPolicy   Policy::NoTimeout, or a Policy::Timeout choosing how
+ *                         long the loop may run.
+ */
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+class DaemonFramework::PolicyLoop : public LoopCore, public Pipe::Listener
+{
+public:
+    /**
+     * @brief  Initializes the loop, opening the input pipe if used.
+     *
+     * @param inputBufferSize  The size of the buffer the loop should use when
+     *                         reading data sent from the parent application.
+     *                         If the transport has no input pipe, this value
+     *                         will be ignored.
+     */
+    PolicyLoop(const int inputBufferSize = 0);
+
+    /**
+     * @brief  Ensures all pipes are closed on destruction.
+     */
+    virtual ~PolicyLoop();
+
+    /**
+     * @brief  Starts the daemon's main action loop as long as the loop isn't
+     *         already running.
+     *
+     *  This loop repeatedly checks security conditions, then runs the
+     * loopAction() function. The loop runs continually until a security check
+     * fails, loopAction() returns a nonzero value, or the timeout policy ends
+     * the loop.
+     *
+     * @return  The code the daemon process should return when exiting. This
+     *          will either be a value defined in the ExitCode enum class, or a
+     *          custom value returned by the loopAction() function.
+     */
+    int runLoop();
+
+protected:
+    // Whether the transport policy uses an input or output pipe:
+    static constexpr bool usesInputPipe
+            = (Transport::inputPipePath() != nullptr);
+    static constexpr bool usesOutputPipe
+            = (Transport::outputPipePath() != nullptr);
+
+    /**
+     * @brief  Sends arbitrary data to the parent process through the daemon's
+     *         named output pipe.
+     *
+     *  This may only be called if the transport policy has an output pipe.
+     *
+     * @param messageData  A generic pointer to a block of memory that holds no
+     *                     less than messageSize bytes. The caller is
+     *                     responsible for ensuring that this data block is
+     *                     valid.
+     *
+     * @param messageSize  The number of bytes to send from the messageData
+     *                     pointer.
+     */
+    void messageParent(const unsigned char* messageData,
+            const size_t messageSize);
+
+    /**
+     * @brief  Gets the pipe used to send data to the parent, so that its
+     *         traffic and write time statistics may be read.
+     *
+     *  This may only be called if the transport policy has an output pipe.
+     *
+     * @return  The daemon's output pipe writer.
+     */
+    const Pipe::Writer& getOutputPipe() const;
+
+    /**
+     * @brief  Gets the pipe used to receive data from the parent, so that its
+     *         traffic and latency statistics may be read.
+     *
+     *  This may only be called if the transport policy has an input pipe.
+     *
+     * @return  The daemon's input pipe reader.
+     */
+    const Pipe::Reader& getInputPipe() const;
+
+private:
+    /**
+     * @brief  Performs any extra initialization required just before the main
+     *         daemon loop starts.
+     *
+     *  This function will only be called once, by the runLoop() function, after
+     * opening pipes and running standard security checks. If initLoop returns a
+     * nonzero value, the runLoop() function will cancel the daemon loop and
+     * return the same value.
+     *
+     * The default implementation immediately returns zero.
+     *
+     * @return  An exit code to return after cancelling the loop, or zero if the
+     *          loop may start.
+     */
+    virtual int initLoop() { return 0; }
+
+    /**
+     * @brief  An abstract function that should be implemented to handle the
+     *         daemon's primary action.
+     *
+     *  This function will be repeatedly called once the runLoop() function is
+     * called. Implementations of this function should avoid running for too
+     * long, to ensure that the daemon loop gets a chance to regularly follow up
+     * on security checks.
+     *
+     *  Each loop iteration, including its security checks and this call, runs
+     * within a Scratch::Scope. Scratch containers created here stop using
+     * heap memory once the loop reaches a steady state, but must not be kept
+     * after this call returns.
+     *
+     * @return  Zero if the loop should keep running, any other value to stop
+     *          the loop. A returned nonzero value will also be used as the
+     *          return value of the runLoop() function, so returned code
+     *          definitions should avoid conflicts with the ExitCode enum
+     *          class.
+     */
+    virtual int loopAction() = 0;
+
+    /**
+     * @brief  Handles data sent from the daemon's parent process. This function
+     *         will be called within the input pipe thread. Implementations
+     *         of this function are responsible for validating input, and
+     *         synchronizing any communications between the pipe thread and
+     *         the main daemon loop's thread.
+     *
+     *  By default, this function will do nothing. Override to add real input
+     * handling. This is never called if the transport has no input pipe.
+     *
+     *  Each call runs within a Scratch::Scope using an arena that is reset
+     * after the message is handled, so scratch containers created here must
+     * not be kept after this call returns.
+     *
+     * @param messageData  A pointer to the message data array sent by the
+     *                     parent.
+     *
+     * @param messageSize  The number of bytes available at the messageData
+     *                     pointer.
+     */
+    virtual void handleParentMessage(const unsigned char* messageData,
+            const size_t messageSize) { }
+
+    /**
+     * @brief  Passes data sent from the parent application to the
+     *         handleParentMessage() function.
+     *
+     * @param data  A raw message data pointer.
+     *
+     * @param size  The number of bytes available at that data pointer.
+     */
+    virtual void processData(const unsigned char* data, const size_t size)
+            final override;
+
+    /**
+     * @brief  Runs each initial security check the security policy enables.
+     *
+     * @param exitCode  Set to the code the daemon should return if a check
+     *                  fails.
+     *
+     * @return          A description of the failed check, or nullptr if all
+     *                  checks passed.
+     */
+    const char* checkSecurity(ExitCode& exitCode);
+
+    // Whether the loop should end when the parent closes the input pipe:
+    bool exitOnInputClosed = false;
+    // Performs daemon process security checks:
+    Process::Security securityMonitor;
+    // Receives data from the parent application, if the transport uses it:
+    Policy::InputPipe<Transport> inputPipe;
+    // Sends data to the parent application, if the transport uses it:
+    Policy::OutputPipe<Transport> outputPipe;
+    // Ends the loop once its timeout period is over:
+    TimeoutPolicy timeout;
+};
+
+
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+constexpr bool DaemonFramework::PolicyLoop
+<Transport, SecurityPolicy, TimeoutPolicy>::usesInputPipe;
+
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+constexpr bool DaemonFramework::PolicyLoop
+<Transport, SecurityPolicy, TimeoutPolicy>::usesOutputPipe;
+
+
+// Initializes the loop, opening the input pipe if used.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+DaemonFramework::PolicyLoop<Transport, SecurityPolicy, TimeoutPolicy>
+::PolicyLoop(const int inputBufferSize) :
+securityMonitor(SecurityPolicy::daemonPath(), SecurityPolicy::parentPath(),
+        SecurityPolicy::parentDigest(), SecurityPolicy::digestCachePath()),
+inputPipe(inputBufferSize)
+{
+    inputPipe.open(this);
+    StartupProfile::record("DaemonLoop constructed");
+}
+
+
+// Ensures all pipes are closed on destruction.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+DaemonFramework::PolicyLoop<Transport, SecurityPolicy, TimeoutPolicy>
+::~PolicyLoop()
+{
+    inputPipe.close();
+    outputPipe.close();
+}
+
+
+// Starts the daemon's main action loop as long as the loop isn't already
+// running.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+int DaemonFramework::PolicyLoop<Transport, SecurityPolicy, TimeoutPolicy>
+::runLoop()
+{
+    if (! startLoop())
+    {
+        return static_cast<int>(ExitCode::daemonAlreadyRunning);
+    }
+
+    // Check for SIGTERM between all significant actions:
+    if (termSignalReceived())
+    {
+        return exitLoop(ExitCode::success, "SIGTERM received.");
+    }
+    exitOnInputClosed = launchedOnDemand() && usesInputPipe;
+
+    ExitCode securityCode = ExitCode::success;
+    const char* securityFailure = checkSecurity(securityCode);
+    if (securityFailure != nullptr)
+    {
+        return exitLoop(securityCode, securityFailure);
+    }
+    StartupProfile::releaseRecords();
+
+    // Check for SIGTERM again before running initLoop():
+    if (termSignalReceived())
+    {
+        return exitLoop(ExitCode::success, "SIGTERM received.");
+    }
+
+    int resultCode;
+    {
+        DF_TRACE("DaemonLoop::initLoop");
+        resultCode = initLoop();
+    }
+    StartupProfile::record("initLoop finished");
+    if (resultCode == 0)
+    {
+        signalReady();
+    }
+
+    timeout.start();
+    while (resultCode == 0)
+    {
+        Scratch::Scope iterationScope(loopArena);
+        if (termSignalReceived())
+        {
+            return exitLoop(ExitCode::success, "SIGTERM received.");
+        }
+        if (usesInputPipe && exitOnInputClosed && inputPipe.isClosed())
+        {
+            return exitLoop(ExitCode::success,
+                    "parent closed the input pipe.");
+        }
+        if (SecurityPolicy::requireRunningParent
+                && ! securityMonitor.parentProcessRunning())
+        {
+            return exitLoop(ExitCode::daemonParentEnded, "parent stopped.");
+        }
+        if (timeout.expired())
+        {
+            return exitLoop(ExitCode::success,
+                    "reached the end of the timeout period.");
+        }
+        DF_TRACE("DaemonLoop::loopAction");
+        countLoopAction();
+        resultCode = loopAction();
+    }
+    return exitLoop(resultCode);
+}
+
+
+// Runs each initial security check the security policy enables.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+const char* DaemonFramework::PolicyLoop
+<Transport, SecurityPolicy, TimeoutPolicy>::checkSecurity(ExitCode& exitCode)
+{
+    if (SecurityPolicy::lockFilePath() != nullptr)
+    {
+        if (! lockInstance(SecurityPolicy::lockFilePath()))
+        {
+            exitCode = termSignalReceived() ? ExitCode::success
+                    : ExitCode::daemonAlreadyRunning;
+            return "unable to lock the daemon lock file.";
+        }
+    }
+    if (SecurityPolicy::daemonPath() != nullptr)
+    {
+        if (! securityMonitor.validDaemonPath())
+        {
+            exitCode = ExitCode::badDaemonPath;
+            return "invalid daemon executable path.";
+        }
+        StartupProfile::record("daemon path checked");
+    }
+    if (SecurityPolicy::parentPath() != nullptr)
+    {
+        if (! securityMonitor.validParentPath())
+        {
+            exitCode = ExitCode::badParentPath;
+            return "invalid parent executable path.";
+        }
+        StartupProfile::record("parent path checked");
+    }
+    if (SecurityPolicy::parentDigest() != nullptr)
+    {
+        if (! securityMonitor.validParentDigest())
+        {
+            exitCode = ExitCode::badParentDigest;
+            return "invalid parent executable digest.";
+        }
+        StartupProfile::record("parent digest checked");
+    }
+    if (SecurityPolicy::verifyPathSecurity)
+    {
+        if (! securityMonitor.daemonPathSecured())
+        {
+            exitCode = ExitCode::insecureDaemonDir;
+            return "daemon executable is in an unsecured directory.";
+        }
+        StartupProfile::record("daemon directory checked");
+    }
+    if (SecurityPolicy::verifyParentPathSecurity)
+    {
+        if (! securityMonitor.parentPathSecured())
+        {
+            exitCode = ExitCode::insecureParentDir;
+            return "parent executable is in an unsecured directory.";
+        }
+        StartupProfile::record("parent directory checked");
+    }
+    return nullptr;
+}
+
+
+// Sends arbitrary data to the parent process through the daemon's named output
+// pipe.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+void DaemonFramework::PolicyLoop<Transport, SecurityPolicy, TimeoutPolicy>
+::messageParent(const unsigned char* messageData, const size_t messageSize)
+{
+    static_assert(usesOutputPipe,
+            "messageParent() requires a transport with an output pipe.");
+    DF_TRACE("DaemonLoop::messageParent");
+    if (! outputPipe.send(messageData, messageSize))
+    {
+        DF_DBG("DaemonFramework::DaemonLoop::" << __func__
+                << ": Failed to send message of size " << messageSize
+                << " to parent process.");
+    }
+}
+
+
+// Gets the pipe used to send data to the parent.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+const DaemonFramework::Pipe::Writer& DaemonFramework::PolicyLoop
+<Transport, SecurityPolicy, TimeoutPolicy>::getOutputPipe() const
+{
+    static_assert(usesOutputPipe,
+            "getOutputPipe() requires a transport with an output pipe.");
+    return outputPipe.getWriter();
+}
+
+
+// Gets the pipe used to receive data from the parent.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+const DaemonFramework::Pipe::Reader& DaemonFramework::PolicyLoop
+<Transport, SecurityPolicy, TimeoutPolicy>::getInputPipe() const
+{
+    static_assert(usesInputPipe,
+            "getInputPipe() requires a transport with an input pipe.");
+    return inputPipe.getReader();
+}
+
+
+// Passes data sent from the parent application to the handleParentMessage()
+// function.
+template <class Transport, class SecurityPolicy, class TimeoutPolicy>
+void DaemonFramework::PolicyLoop<Transport, SecurityPolicy, TimeoutPolicy>
+::processData(const unsigned char* data, const size_t size)
+{
+    DF_TRACE("DaemonLoop::handleParentMessage");
+    countParentMessage(size);
+    Scratch::Scope messageScope(messageArena);
+    handleParentMessage(data, size);
+    wakeLoop();
+}
@@ -15,6 +15,14 @@ namespace DaemonFramework
     {
         class Data;
         enum class State;
+
+        /**
+         * @brief  Gets the list of all process IDs.
+         *
+         * @return  A vector containing every process ID listed in the /proc
+         *          directory.
+         */
+        std::vector<int> getAllPIDs();
     }
 }
 
@@ -105,11 +113,17 @@ public:
 
 private:
     /**
-     * @brief  Create process data directly from the process stat file object.
+     * @brief  Reads process data from a process stat file.
+     *
+     *  This only updates the process ID, parent ID, state, and start time.
+     * Temporary data is held in scratch memory, so this doesn't allocate heap
+     * memory while a Scratch::Scope is active.
+     *
+     * @param processId  The system process ID used to look up the process.
      *
-     * @param statFile  The path to a /proc/<pid>/stat file.
+     * @return           Whether the stat file was read and parsed.
      */
-    Data(const std::string statFile);
+    bool readStatFile(const int processId);
 
     // Process ID number:
     int processId = -1;
@@ -7,7 +7,11 @@
 
 #pragma once
 #include "Process_Data.h"
+#include "File_Identity.h"
 #include <string>
+#include <map>
+#include <utility>
+#include <sys/types.h>
 
 namespace DaemonFramework
 {
@@ -24,8 +28,10 @@ namespace DaemonFramework
  *  Process::Security only checks if the process follows security rules.
  * Actually handling rule violations must be done elsewhere.
  *
- *  Any of these rules may be disabled in build configuration. If disabled, the
- * function that checks the rule will be removed.
+ *  Expected executable paths and the expected parent digest are provided on
+ * construction, so several differently configured Security objects may be
+ * used in one program. The default constructor reads them from build
+ * configuration. Checks with no expected value configured always fail.
  *
  *  Application process security:
  *
@@ -46,40 +52,89 @@ namespace DaemonFramework
  *  if it detects that the parent process has closed, it should immediately
  *  exit.
  *
+ *  Directory security checks cover every directory between the root
+ * directory and the executable. Each directory is opened relative to its
+ * checked parent, so the checked directories can't be swapped out between
+ * checks.
+ *
+ *  Executable path checks compare files, not path strings. On construction,
+ * Process::Security pins the expected executables and both process
+ * directories with O_PATH file descriptors, recording the identity(device,
+ * inode, size, and modification time) of each expected executable. Each check
+ * then only needs to stat the /proc/<pid>/exe link of the checked process.
+ * This also detects cases where the executable at the expected path was
+ * replaced after the checked process was launched.
  */
 class DaemonFramework::Process::Security
 {
 public:
     /**
-     * @brief  Loads process data on construction.
+     * @brief  Loads process data and pins expected executable files set in
+     *         build configuration on construction.
+     *
+     *  DF_DAEMON_PATH is only used if DF_VERIFY_PATH is enabled. If
+     * DF_LOCK_FILE_PATH is set, the parent digest is cached at that path with
+     * ".digest" appended. Unset values are treated as nullptr.
      */
     Security();
 
-    ~Security() { }
+    /**
+     * @brief  Loads process data and pins expected executable files on
+     *         construction.
+     *
+     * @param daemonPath       The path where the daemon executable must be
+     *                         installed, or nullptr if not checked.
+     *
+     * @param parentPath       The path of the executable the parent process
+     *                         must run, or nullptr if not checked.
+     *
+     * @param parentDigest     The expected SHA-256 digest of the parent
+     *                         executable as a hexadecimal string, or nullptr
+     *                         if not checked.
+     *
+     * @param digestCachePath  The path of the file where the parent
+     *                         executable's digest is cached between daemon
+     *                         processes, or nullptr to hash it every time.
+     */
+    Security(const char* daemonPath, const char* parentPath,
+            const char* parentDigest, const char* digestCachePath);
+
+    /**
+     * @brief  Closes all pinned file descriptors on destruction.
+     */
+    ~Security();
+
+    // Security objects own file descriptors, and may not be copied:
+    Security(const Security& toCopy) = delete;
+    Security& operator=(const Security& toCopy) = delete;
 
-#   ifdef DF_VERIFY_PATH
     /**
      * @brief  Checks if the daemon executable is running from the expected
      *         path.
      *
-     * @return   Whether the daemon is running from the correct executable path,
-     *           as set at compile time.
+     * @return   Whether the daemon is running from the expected executable
+     *           path.
      */
     bool validDaemonPath();
-#   endif
 
-#   ifdef DF_REQUIRED_PARENT_PATH
     /**
      * @brief  Checks if the daemon was launched by an executable at the
      *         expected path.
      *
-     * @return  Whether the daemon's parent process is running from the correct
-     *          executable path, as set at compile time.
+     * @return  Whether the daemon's parent process is running from the
+     *          expected executable path.
      */
     bool validParentPath();
-#   endif
 
-#   ifdef DF_VERIFY_PATH_SECURITY
+    /**
+     * @brief  Checks if the daemon's parent process is running an executable
+     *         with the expected contents.
+     *
+     * @return  Whether the SHA-256 digest of the parent process executable
+     *          matches the expected digest.
+     */
+    bool validParentDigest();
+
     /**
      * @brief  Checks if the daemon's directory is secure.
      *
@@ -87,9 +142,7 @@ public:
      *          be modified by root.
      */
     bool daemonPathSecured();
-#   endif
 
-#   ifdef DF_VERIFY_PARENT_PATH_SECURITY
     /**
      * @brief  Checks if the parent application's directory is secure.
      *
@@ -97,43 +150,94 @@ public:
      *          by root.
      */
     bool parentPathSecured();
-#   endif
 
-#   ifdef DF_REQUIRE_RUNNING_PARENT
     /**
      * @brief  Checks if this application's parent process is still running.
      *
      * @return  Whether the parent process is running.
      */
     bool parentProcessRunning();
-#   endif
 
 private:
     /**
-     * @brief  Checks if a specific process is running from a specific expected
-     *         path within a secure directory.
+     * @brief  Checks if a specific process is running a specific expected
+     *         executable file.
+     *
+     * @param process     Data describing the process to check.
      *
-     * @param process  Data describing the process to check.
+     * @param processDir  An open file descriptor for the process's /proc/<pid>
+     *                    directory.
      *
-     * @param path     A path to an executable the process should be running.
+     * @param expected    The identity of the executable file the process
+     *                    should be running.
      *
-     * @return         Whether the process is running from the expected path.
+     * @return            Whether the process is running the expected
+     *                    executable.
      */
-    bool processSecured
-    (const Process::Data& process, const std::string& path) const;
+    bool processSecured(const Process::Data& process, const int processDir,
+            const File::Identity& expected) const;
 
     /**
-     * @brief  Checks if a given directory is secure.
+     * @brief  Checks if a directory and all of its parent directories are
+     *         secure.
      *
-     * @param dirPath  The absolute path to a directory.
+     *  The path is resolved one component at a time from the root directory,
+     * opening each directory relative to its already checked parent without
+     * following symbolic links. Secured directories are cached by device and
+     * inode, and stay open so that their inode numbers can't be reused. Later
+     * checks of a directory that was already secured only need to open it
+     * once.
      *
-     * @return         Whether the given directory can only be modified with
-     *                 root permissions.
+     * @param dirPath  The canonical absolute path to a directory.
+     *
+     * @return         Whether the directory and each of its parents can only
+     *                 be modified with root permissions.
      */
-    bool directorySecured(const std::string& dirPath) const;
+    bool directorySecured(const std::string& dirPath);
+
+    /**
+     * @brief  Opens a directory relative to a secured parent directory, checks
+     *         if it is secure, and caches its file descriptor if it is.
+     *
+     * @param parentDir  An open file descriptor for the directory's secured
+     *                   parent, ignored if name is an absolute path.
+     *
+     * @param name       The name of the directory within its parent.
+     *
+     * @param dirPath    The full path of the directory, used in debug
+     *                   messages.
+     *
+     * @return           An O_PATH file descriptor for the secured directory,
+     *                   or -1 if the directory is missing or insecure.
+     */
+    int openSecuredDir(const int parentDir, const std::string& name,
+            const std::string& dirPath);
 
     // The daemon's process data:
     Process::Data daemonProcess;
     // The parent process data:
     Process::Data parentProcess;
+
+    // O_PATH file descriptors for the daemon and parent /proc/<pid>
+    // directories:
+    int daemonProcessDir = -1;
+    int parentProcessDir = -1;
+
+    // Identifies a directory by device and inode:
+    typedef std::pair<dev_t, ino_t> DirKey;
+    // O_PATH file descriptors of secured directories, indexed by directory:
+    std::map<DirKey, int> securedDirs;
+
+    // O_PATH file descriptor and identity of the expected daemon executable:
+    int daemonExecutable = -1;
+    File::Identity daemonIdentity;
+
+    // O_PATH file descriptor and identity of the expected parent executable:
+    int parentExecutable = -1;
+    File::Identity parentIdentity;
+
+    // The expected parent executable digest, or nullptr if not checked:
+    const char* parentDigest = nullptr;
+    // Where the parent executable digest is cached, or nullptr if not cached:
+    const char* digestCachePath = nullptr;
 };
@@ -10,15 +10,75 @@
 #include "Pipe_Reader.h"
 #include "Pipe_Listener.h"
 #include "Pipe_Writer.h"
+#include "EventLoop.h"
+#include "RestartPolicy.h"
 #include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <vector>
 #include <string>
 
 namespace DaemonFramework { class DaemonControl; }
 
+/**
+ * @brief  Launches a daemon process, communicates with it, and tracks when it
+ *         exits.
+ *
+ *  While the daemon runs, DaemonControl watches a process file descriptor
+ * for the daemon on an EventLoop, collecting the daemon's exit status as soon
+ * as it exits. Data from the daemon's output pipe is also read on the
+ * EventLoop, so the Pipe::Listener receives it on the EventLoop's thread. Both
+ * daemon pipes are opened without blocking through the EventLoop, so no
+ * threads are created to wait for the daemon to open its ends of the pipes.
+ * Daemon status queries only read the cached status, and never need to make
+ * system calls.
+ *
+ *  By default, each DaemonControl runs its own EventLoop on a new thread.
+ * Applications may instead provide a shared EventLoop, either running on its
+ * own thread or driven by the application's main loop using
+ * EventLoop::getFD() and EventLoop::processEvents().
+ *
+ *  Daemons signal their parent once they have passed all security checks,
+ * started their input pipe reader, and finished initializing their loop. To
+ * keep a daemon on warm standby, start it before it is needed, and use
+ * isDaemonReady(), waitUntilReady(), or setReadyCallback() to find out when
+ * it can respond to messages without any startup delay.
+ *
+ *  Daemons that are only needed occasionally may instead be launched on
+ * demand. After launchOnDemand() is called, the daemon starts the first time
+ * messageParent() is used, and messages sent while it starts are held until
+ * it is ready. If an idle timeout is set, the input pipe is closed once no
+ * messages have been sent for that long. The daemon's DaemonLoop then handles
+ * any data remaining in the pipe and exits, and the next message launches the
+ * daemon again. This requires a daemon built with this version of
+ * DaemonLoop.
+ *
+ *  If a RestartPolicy is set, daemons that exit unexpectedly are launched
+ * again after a backoff delay. Messages sent while the daemon restarts are
+ * held until it is ready, up to the message queue limit. Daemons started
+ * with startDaemon() receive messages as soon as they open their input pipe,
+ * whether or not they ever signal that they are ready.
+ */
 class DaemonFramework::DaemonControl
 {
 public:
+    /**
+     * @brief  Function type called after the daemon exits, with the daemon's
+     *         exit code.
+     */
+    typedef std::function<void(const int exitCode)> ExitCallback;
+
+    /**
+     * @brief  Function type called after the daemon signals that it is ready.
+     */
+    typedef std::function<void()> ReadyCallback;
+
     /**
      * @brief  Configures the controller for its specific daemon on
      *         construction.
@@ -33,13 +93,29 @@ public:
      *
      * @param bufferSize      The amount of memory in bytes to reserve for any 
      *                        messages sent by the daemon.
+     *
+     * @param eventLoop       An optional EventLoop used to detect when the
+     *                        daemon exits and read its messages. If
+     *                        null, the DaemonControl will create and run
+     *                        its own EventLoop when needed. The EventLoop
+     *                        must remain valid until the DaemonControl is
+     *                        destroyed.
      */
     DaemonControl(const std::string daemonPath,
             const std::string pipeToDaemon = "",
             const std::string pipeFromDaemon = "",
-            const size_t bufferSize = 0); 
+            const size_t bufferSize = 0,
+            EventLoop* eventLoop = nullptr); 
+
+    /**
+     * @brief  Stops watching for daemon exit events, and closes the daemon
+     *         process file descriptor on destruction.
+     */
+    virtual ~DaemonControl();
 
-    virtual ~DaemonControl() { }
+    // DaemonControl objects own file descriptors, and may not be copied:
+    DaemonControl(const DaemonControl& toCopy) = delete;
+    DaemonControl& operator=(const DaemonControl& toCopy) = delete;
 
     /**
      * @brief  If the Daemon isn't already running, this launches the daemon
@@ -58,13 +134,180 @@ public:
     /**
      * @brief  If the Daemon is running, this stops the process and closes the
      *         input pipe.
+     *
+     *  The daemon is sent SIGTERM, and given until the termination timeout
+     * passes to exit. Messages still waiting for the daemon to become ready
+     * are discarded, and any scheduled restart is cancelled. If on-demand
+     * launch is enabled, messages sent while the daemon stops will launch it
+     * again. If it is still running after that, it is sent SIGKILL.
+     * This returns as soon as the daemon exits. If requestStop() was already
+     * called, SIGTERM is not sent again, and the timeout period started when
+     * requestStop() was called. If another thread is creating the daemon
+     * process, this waits for it to be created and stops it too.
      */
     void stopDaemon();
 
+    /**
+     * @brief  Asks the daemon to stop without waiting for it to exit.
+     *
+     *  This sends SIGTERM to the daemon process, and starts the termination
+     * timeout period. Launches that haven't created the daemon process yet
+     * are cancelled, and a daemon process being created while this is called
+     * is sent SIGTERM as soon as it exists. Call stopDaemon() later to wait
+     * for the daemon to exit and finish cleanup. Requesting stops from
+     * several DaemonControl objects before stopping any of them lets their
+     * daemons shut down in parallel.
+     */
+    void requestStop();
+
+    /**
+     * @brief  Stops several daemons in parallel.
+     *
+     * @param daemons  The DaemonControl objects managing each daemon to stop.
+     *                 Null pointers are ignored.
+     */
+    static void stopDaemons(const std::vector<DaemonControl*>& daemons);
+
+    /**
+     * @brief  Methods used to create the daemon process.
+     */
+    enum class LaunchMethod
+    {
+        // Copy the parent process with fork() before running the daemon:
+        fork,
+        // Create the process with clone(CLONE_VM | CLONE_VFORK), sharing the
+        // parent's memory until the daemon runs. This avoids copying the
+        // parent's page tables, which is much faster for large parent
+        // processes:
+        vfork
+    };
+
+    /**
+     * @brief  Selects how new daemon processes are created.
+     *
+     * @param method  The method used by all future startDaemon() calls. By
+     *                default, LaunchMethod::fork is used.
+     */
+    void setLaunchMethod(const LaunchMethod method);
+
+    /**
+     * @brief  Launches the daemon the next time a message is sent to it,
+     *         instead of launching it immediately.
+     *
+     *  This requires a daemon input pipe. Don't call startDaemon() directly
+     * after enabling on-demand launch.
+     *
+     * @param args      An array of strings that will be passed to the daemon
+     *                  as launch arguments each time it is launched.
+     *
+     * @param listener  The object that will handle incoming data if the
+     *                  daemon's output pipe is enabled.
+     */
+    void launchOnDemand(const std::vector<std::string> args,
+            Pipe::Listener* listener = nullptr);
+
+    /**
+     * @brief  Sets how long a daemon launched on demand may go without
+     *         receiving messages before it is shut down.
+     *
+     * @param timeoutMS  The idle timeout period in milliseconds, or zero to
+     *                   keep the daemon running until it is stopped. By
+     *                   default, there is no idle timeout.
+     */
+    void setIdleTimeout(const int timeoutMS);
+
+    /**
+     * @brief  Sets the rules used to restart the daemon after it exits
+     *         unexpectedly.
+     *
+     *  Exits caused by stopDaemon(), requestStop(), or on-demand idle
+     * shutdown never cause restarts. By default, daemons are not restarted.
+     *
+     * @param policy  The restart rules to copy.
+     */
+    void setRestartPolicy(const RestartPolicy& policy);
+
+    /**
+     * @brief  Stops restarting the daemon automatically, cancelling any
+     *         scheduled restart.
+     */
+    void disableRestarts();
+
+    /**
+     * @brief  Checks if automatic restarts stopped because the daemon failed
+     *         too many times within the restart policy's crash loop window.
+     *
+     *  Calling startDaemon() clears the daemon's failure history.
+     *
+     * @return  Whether a crash loop was detected.
+     */
+    bool crashLoopDetected();
+
+    /**
+     * @brief  Sets the maximum number of messages held while the daemon
+     *         restarts, or while an on-demand daemon starts or stops.
+     *
+     * @param limit  The message limit. Messages sent while the queue is full
+     *               are discarded, and messageParent() returns false.
+     */
+    void setMessageQueueLimit(const size_t limit);
+
+    /**
+     * @brief  Sets how long to wait for the daemon to handle SIGTERM before
+     *         killing it with SIGKILL.
+     *
+     * @param timeoutMS  The termination timeout period in milliseconds.
+     */
+    void setTerminationTimeout(const int timeoutMS);
+
+    /**
+     * @brief  Checks if the daemon has signalled that it is ready to handle
+     *         requests.
+     *
+     * @return  Whether the running daemon finished its security checks and
+     *          initialization.
+     */
+    bool isDaemonReady() const;
+
+    /**
+     * @brief  Waits until the daemon signals that it is ready, exits, or the
+     *         timeout period ends.
+     *
+     * @param timeoutMS  The maximum number of milliseconds to wait, or a
+     *                   negative value to wait until the daemon is ready or
+     *                   exits.
+     *
+     * @return           Whether the daemon is ready.
+     */
+    bool waitUntilReady(const int timeoutMS = -1);
+
+    /**
+     * @brief  Sets a function to call when the daemon signals that it is
+     *         ready.
+     *
+     *  Like the exit callback, this runs on whichever thread receives the
+     * readiness signal.
+     *
+     * @param callback  The function to call after the daemon becomes ready,
+     *                  or an empty function to remove the current callback.
+     */
+    void setReadyCallback(const ReadyCallback callback);
+
+    /**
+     * @brief  Sets a function to call whenever the daemon exits.
+     *
+     *  The callback runs on whichever thread detects the exit. This will
+     * usually be the thread processing the controller's EventLoop events.
+     *
+     * @param callback  The function to call after the daemon exits, or an
+     *                  empty function to remove the current callback.
+     */
+    void setExitCallback(const ExitCallback callback);
+
     /**
      * @brief  Checks if the daemon is running.
      *
-     * @return  Whether the daemon thread is still active.
+     * @return  Whether the daemon process is still active.
      */
     bool isDaemonRunning();
 
@@ -72,6 +315,12 @@ public:
      * @brief  Sends arbitrary data to the daemon using the daemon's named
      *         input pipe, if one exists.
      *
+     *  If the daemon is restarting, or if an on-demand daemon is starting or
+     * stopping, the message is copied and sent once the daemon is ready. If
+     * on-demand launch is enabled and the daemon isn't running, this also
+     * launches the daemon. Otherwise, this waits for the daemon to open its
+     * input pipe, then sends the message.
+     *
      * @param messageData  A generic pointer to a block of memory that holds no
      *                     less than messageSize bytes. The caller is
      *                     responsible for ensuring that this data block is
@@ -79,8 +328,13 @@ public:
      *
      * @param messageSize  The number of bytes to send from the messageData
      *                     pointer.
+     *
+     * @return             Whether the message was sent or held. This is false
+     *                     if sending failed, the daemon has no input pipe, or
+     *                     the message was discarded because the held message
+     *                     queue was full.
      */
-    void messageParent(const unsigned char* messageData,
+    bool messageParent(const unsigned char* messageData,
             const size_t messageSize);
 
     /**
@@ -106,6 +360,22 @@ public:
      */
     int waitToExit();
 
+    /**
+     * @brief  Gets the pipe used to receive data from the daemon, so that its
+     *         traffic and latency statistics may be read.
+     *
+     * @return  The controller's pipe reader.
+     */
+    const Pipe::Reader& getPipeReader() const;
+
+    /**
+     * @brief  Gets the pipe used to send data to the daemon, so that its
+     *         traffic and write time statistics may be read.
+     *
+     * @return  The controller's pipe writer.
+     */
+    const Pipe::Writer& getPipeWriter() const;
+
 protected:
     /**
      * @brief  Creates the pipe file used to send messages to the daemon if it
@@ -142,11 +412,278 @@ protected:
     virtual void createDaemonOutputPipe(const std::string& pipePath);
 
 private:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief  Waits until the daemon process exits or a deadline passes.
+     *
+     * @param deadline  The time when this should stop waiting.
+     *
+     * @return          Whether the daemon process is no longer running.
+     */
+    bool waitForExit(const Clock::time_point deadline);
+
+    /**
+     * @brief  Collects the daemon process's exit status if it has exited,
+     *         saves its exit code, and runs the exit callback.
+     *
+     * @param wait  Whether to wait for the daemon to exit if it is still
+     *              running.
+     *
+     * @return      Whether the daemon is no longer running.
+     */
+    bool collectExit(const bool wait);
+
+    /**
+     * @brief  Reads the daemon's readiness signal if available, and runs the
+     *         ready callback if the daemon is ready.
+     *
+     * @return  Whether the readiness signal or end-of-file was read.
+     */
+    bool collectReady();
+
+    /**
+     * @brief  Launches the daemon process and opens daemon communication pipes
+     *         if needed.
+     *
+     * @param args      Launch arguments to pass to the daemon.
+     *
+     * @param listener  The object that will handle incoming data if the
+     *                  daemon's output pipe is enabled.
+     *
+     * @return          Whether a new daemon process was created. The process
+     *                  may have already exited when this returns.
+     */
+    bool launchDaemon(std::vector<std::string> args,
+            Pipe::Listener* listener);
+
+    /**
+     * @brief  Launches the daemon using the saved launch arguments, handling
+     *         launch failures and daemons that can't signal when they are
+     *         ready.
+     *
+     * @param holdMessages  Whether messages should be held until the daemon
+     *                      signals that it is ready. If false, messages are
+     *                      sent as soon as the daemon opens its input pipe.
+     */
+    void relaunchDaemon(const bool holdMessages);
+
+    /**
+     * @brief  Holds a message until the daemon is ready, unless the message
+     *         queue is full. The launchMutex must be locked when calling this.
+     *
+     * @param messageData  The message data to copy.
+     *
+     * @param messageSize  The number of bytes to copy.
+     *
+     * @return             Whether the message was added to the queue.
+     */
+    bool holdMessage(const unsigned char* messageData,
+            const size_t messageSize);
+
+    /**
+     * @brief  Sends all messages held while the daemon was starting, and
+     *         starts the idle timeout period if launching on demand.
+     *
+     *  Messages are sent without holding the launch lock. Messages held while
+     * flushing are sent before the daemon is marked as running, so they can't
+     * be overtaken by newer messages.
+     */
+    void flushPendingMessages();
+
+    /**
+     * @brief  Sends a message to a running daemon without holding the launch
+     *         lock, so that a stalled daemon can't block the event thread.
+     *
+     * @param lock         A lock held on the launch mutex, which is released
+     *                     while sending and held again before returning.
+     *
+     * @param messageData  The message bytes.
+     *
+     * @param messageSize  The message size in bytes.
+     *
+     * @return             Whether the message was sent.
+     */
+    bool sendUnlocked(std::unique_lock<std::mutex>& lock,
+            const unsigned char* messageData, const size_t messageSize);
+
+    /**
+     * @brief  Updates the launch state after the daemon exits, restarting or
+     *         relaunching the daemon if necessary.
+     *
+     * @param crashed  Whether the daemon was killed by a signal.
+     */
+    void handleLaunchExit(const bool crashed);
+
+    /**
+     * @brief  Checks if the restart policy allows restarting the daemon after
+     *         an unexpected exit, and records the failure for crash loop
+     *         detection. The launchMutex must be locked when calling this.
+     *
+     * @param crashed  Whether the daemon was killed by a signal.
+     *
+     * @return         Whether the daemon should be restarted.
+     */
+    bool shouldRestart(const bool crashed);
+
+    /**
+     * @brief  Restarts the daemon if a restart is scheduled, or closes the
+     *         daemon's input pipe if an on-demand daemon has been idle for the
+     *         idle timeout period.
+     */
+    void handleLaunchTimer();
+
+    /**
+     * @brief  Starts or stops the timer used for restart delays and idle
+     *         timeouts.
+     *
+     * @param timeoutMS  The number of milliseconds until the timer expires, or
+     *                   zero to stop the timer.
+     */
+    void setLaunchTimer(const int timeoutMS);
+
+    /**
+     * @brief  Ensures the EventLoop used to watch the daemon exists and is
+     *         running, creating one if necessary.
+     *
+     * @return  Whether an EventLoop is available.
+     */
+    bool initEventLoop();
+
+    /**
+     * @brief  Starts watching the daemon's process file descriptor for exit
+     *         events, creating an EventLoop if necessary.
+     */
+    void watchExit();
+
+    /**
+     * @brief  Starts watching the readiness pipe for the daemon's readiness
+     *         signal.
+     */
+    void watchReady();
+
+    /**
+     * @brief  Stops watching the readiness pipe, and closes it.
+     */
+    void closeReadyFD();
+
+    /**
+     * @brief  Stops watching for daemon exit events, and closes the daemon
+     *         process file descriptor.
+     */
+    void closeProcessFD();
+
+    /**
+     * @brief  Sends SIGTERM to the daemon and starts the termination timeout
+     *         period, unless this was already done for the running daemon.
+     */
+    void terminateDaemon();
+
+    /**
+     * @brief  Sends a signal to the daemon process.
+     *
+     * @param signal  The signal number to send.
+     */
+    void signalDaemon(const int signal);
+
     // Daemon executable path:
     const std::string daemonPath;
 
-    // ID of the daemon's process:
-    pid_t daemonProcess = 0;
+    // ID of the daemon's process, or zero if it isn't running:
+    std::atomic<pid_t> daemonProcess;
+
+    // Process file descriptor that becomes readable when the daemon exits, or
+    // -1 if the daemon hasn't started or pidfds aren't supported:
+    std::atomic_int daemonProcessFD;
+
+    // Detects when the daemon exits:
+    EventLoop* exitEventLoop;
+    std::unique_ptr<EventLoop> ownedEventLoop;
+    // Whether daemonProcessFD is registered with exitEventLoop:
+    std::atomic_bool exitWatched;
+
+    // Function to call when the daemon exits:
+    ExitCallback exitCallback;
+
+    // Read end of the pipe the daemon uses to signal that it is ready, or -1
+    // if the daemon hasn't started:
+    std::atomic_int readyFD;
+    // Whether readyFD is registered with exitEventLoop:
+    std::atomic_bool readyWatched;
+    // Whether the readiness signal hasn't been read yet:
+    std::atomic_bool readyPending;
+    // Whether the running daemon signalled that it is ready:
+    std::atomic_bool daemonReady;
+    // Function to call when the daemon becomes ready:
+    ReadyCallback readyCallback;
+    // Prevents simultaneous attempts to read the readiness signal:
+    std::mutex readyMutex;
+
+    // Prevents simultaneous attempts to collect the daemon's exit status:
+    std::mutex processMutex;
+
+    // How new daemon processes are created:
+    LaunchMethod launchMethod = LaunchMethod::fork;
+
+    // Milliseconds to wait after SIGTERM before killing the daemon:
+    int terminationTimeoutMS;
+
+    // Whether SIGTERM was sent to the running daemon:
+    std::atomic_bool stopRequested;
+
+    // The time when the running daemon will be killed if it hasn't exited:
+    Clock::time_point stopDeadline;
+
+    /**
+     * @brief  Stages of the daemon's lifetime.
+     */
+    enum class LaunchState
+    {
+        stopped,   // The daemon isn't running.
+        starting,  // The daemon is launching, and messages are being held.
+        running,   // The daemon is ready, and messages are sent immediately.
+        stopping,  // The daemon was asked to exit, and messages are held.
+        restarting // A restart is scheduled, and messages are held.
+    };
+    LaunchState launchState = LaunchState::stopped;
+    // Whether a thread is creating a new daemon process:
+    bool launchInProgress = false;
+    // Number of messages being sent without holding the launch lock. The idle
+    // timeout doesn't close the input pipe while any are in progress:
+    unsigned int sendsInProgress = 0;
+    // Whether a thread is sending held messages:
+    bool flushInProgress = false;
+    // Whether the daemon launches when messages are sent to it:
+    bool onDemand = false;
+    // Launch arguments and output pipe listener used for relaunches:
+    std::vector<std::string> launchArgs;
+    Pipe::Listener* launchListener = nullptr;
+    // Messages waiting for the daemon to become ready:
+    std::vector<std::vector<unsigned char>> pendingMessages;
+    // Maximum number of messages to hold:
+    size_t messageQueueLimit;
+    // Milliseconds without messages before an on-demand daemon is stopped,
+    // or zero if it shouldn't be stopped when idle:
+    int idleTimeoutMS = 0;
+    // Timer file descriptor that becomes readable when a restart delay or
+    // idle timeout period might have ended, or -1 if not created:
+    int launchTimerFD = -1;
+    // The last time a message was sent to the daemon:
+    Clock::time_point lastMessageTime;
+    // Rules for restarting the daemon, or null if it shouldn't restart:
+    std::unique_ptr<RestartPolicy> restartPolicy;
+    // Number of restarts since the daemon last became ready:
+    unsigned int restartAttempt = 0;
+    // Times of recent failures, used to detect crash loops:
+    std::deque<Clock::time_point> failureTimes;
+    // Whether restarts stopped after detecting a crash loop:
+    bool crashLoop = false;
+    // Generates restart delay jitter:
+    std::minstd_rand randomGenerator;
+    // Prevents simultaneous access to all launch state:
+    std::mutex launchMutex;
+    // Notified when a thread finishes creating a new daemon process:
+    std::condition_variable launchFinished;
 
     // Reads data sent by the daemon:
     const std::string outPipePath;
@@ -159,5 +696,5 @@ private:
     const bool writerEnabled;
 
     // Exit code returned by the completed process:
-    int exitCode = 0;
+    std::atomic_int exitCode;
 };
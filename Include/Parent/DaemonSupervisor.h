@@ -0,0 +1,136 @@
+/**
+ * @file  DaemonSupervisor.h
+ *
+ * @brief  Manages a group of daemons from a single parent application, sharing
+ *         one EventLoop between all of them.
+ */
+
+#pragma once
+#include "DaemonControl.h"
+#include "EventLoop.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DaemonFramework { class DaemonSupervisor; }
+
+/**
+ * @brief  Owns a set of DaemonControl objects, and starts and stops their
+ *         daemons together.
+ *
+ *  All supervised daemons share one EventLoop thread for exit events,
+ * readiness signals, output pipe reads, and idle timers, instead of each
+ * DaemonControl running its own. Starting and stopping daemons as a group
+ * launches or signals all of them before waiting on any, so the total time
+ * depends on the slowest daemon instead of the number of daemons.
+ */
+class DaemonFramework::DaemonSupervisor
+{
+public:
+    /**
+     * @brief  Creates the shared EventLoop and starts its thread.
+     */
+    DaemonSupervisor();
+
+    /**
+     * @brief  Stops all running daemons on destruction.
+     */
+    virtual ~DaemonSupervisor();
+
+    // DaemonSupervisor objects own their DaemonControls, and may not be
+    // copied:
+    DaemonSupervisor(const DaemonSupervisor& toCopy) = delete;
+    DaemonSupervisor& operator=(const DaemonSupervisor& toCopy) = delete;
+
+    /**
+     * @brief  Creates a DaemonControl for a new supervised daemon.
+     *
+     * @param daemonPath      The path to the daemon executable.
+     *
+     * @param args            Launch arguments passed to the daemon whenever
+     *                        startAll() launches it.
+     *
+     * @param listener        The object that will handle data sent by the
+     *                        daemon, if the daemon's output pipe is enabled.
+     *
+     * @param pipeToDaemon    An optional path to a named pipe that the daemon
+     *                        will scan for messages from the supervisor.
+     *
+     * @param pipeFromDaemon  An optional path to a named pipe that the daemon
+     *                        will use to send messages to the supervisor.
+     *
+     * @param bufferSize      The amount of memory in bytes to reserve for any
+     *                        messages sent by the daemon.
+     *
+     * @return                The new daemon's DaemonControl, which remains
+     *                        valid until the DaemonSupervisor is destroyed.
+     */
+    DaemonControl& addDaemon(const std::string daemonPath,
+            const std::vector<std::string> args = {},
+            Pipe::Listener* listener = nullptr,
+            const std::string pipeToDaemon = "",
+            const std::string pipeFromDaemon = "",
+            const size_t bufferSize = 0);
+
+    /**
+     * @brief  Launches every supervised daemon that isn't already running,
+     *         without waiting for any of them to become ready.
+     */
+    void startAll();
+
+    /**
+     * @brief  Waits until every running daemon is ready, or the timeout period
+     *         ends.
+     *
+     * @param timeoutMS  The maximum number of milliseconds to wait for all
+     *                   daemons, or a negative value to wait until every
+     *                   daemon is ready or has exited.
+     *
+     * @return           Whether all supervised daemons are running and ready.
+     */
+    bool waitUntilAllReady(const int timeoutMS = -1);
+
+    /**
+     * @brief  Stops all running daemons in parallel.
+     */
+    void stopAll();
+
+    /**
+     * @brief  Gets the number of supervised daemons.
+     *
+     * @return  The number of daemons added with addDaemon().
+     */
+    size_t getDaemonCount() const;
+
+    /**
+     * @brief  Gets one of the supervised daemons' DaemonControl objects.
+     *
+     * @param index  The index of the daemon, in the order they were added.
+     *
+     * @return       The daemon's DaemonControl.
+     */
+    DaemonControl& getDaemon(const size_t index);
+
+    /**
+     * @brief  Gets the EventLoop shared by all supervised daemons.
+     *
+     * @return  The shared EventLoop, which may also be used to watch other
+     *          file descriptors.
+     */
+    EventLoop& getEventLoop();
+
+private:
+    // The EventLoop shared by all supervised daemons:
+    EventLoop eventLoop;
+
+    /**
+     * @brief  Holds a supervised daemon and its launch options.
+     */
+    struct Daemon
+    {
+        std::unique_ptr<DaemonControl> control;
+        std::vector<std::string> args;
+        Pipe::Listener* listener;
+    };
+    std::vector<Daemon> daemons;
+};
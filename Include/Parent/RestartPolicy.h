@@ -0,0 +1,157 @@
+/**
+ * @file  RestartPolicy.h
+ *
+ * @brief  Decides when and how quickly a DaemonControl should relaunch a
+ *         daemon that exited unexpectedly.
+ */
+
+#pragma once
+#include "ExitCode.h"
+#include <map>
+
+namespace DaemonFramework { class RestartPolicy; }
+
+/**
+ * @brief  Holds the rules a DaemonControl uses to restart its daemon.
+ *
+ *  Each exit code, and exits caused by signals, may be mapped to either
+ * restarting or stopping the daemon. By default, the daemon is restarted after
+ * crashing, after its parent check fails, or after returning any exit code not
+ * defined by ExitCode. It is not restarted after exiting successfully, failing
+ * a security check, finding another daemon instance running, or failing to
+ * launch.
+ *
+ *  Restarts are delayed using jittered exponential backoff. If the daemon
+ * fails too many times within the crash loop window, automatic restarts stop
+ * until the daemon is started again manually.
+ */
+class DaemonFramework::RestartPolicy
+{
+public:
+    /**
+     * @brief  Actions to take after the daemon exits.
+     */
+    enum class Action
+    {
+        stop,   // Leave the daemon stopped.
+        restart // Launch the daemon again after the restart delay.
+    };
+
+    /**
+     * @brief  Creates a policy using the default rules.
+     */
+    RestartPolicy();
+
+    /**
+     * @brief  Sets the action to take when the daemon returns an exit code.
+     *
+     * @param exitCode  The daemon's exit code.
+     *
+     * @param action    The action to take.
+     */
+    void setExitAction(const int exitCode, const Action action);
+    void setExitAction(const ExitCode exitCode, const Action action);
+
+    /**
+     * @brief  Sets the action to take after the daemon is killed by a signal.
+     *
+     * @param action  The action to take.
+     */
+    void setCrashAction(const Action action);
+
+    /**
+     * @brief  Sets the action to take for any exit code without its own rule.
+     *
+     * @param action  The action to take.
+     */
+    void setDefaultAction(const Action action);
+
+    /**
+     * @brief  Gets the action to take after the daemon exits.
+     *
+     * @param exitCode  The daemon's exit code.
+     *
+     * @param crashed   Whether the daemon was killed by a signal.
+     *
+     * @return          The action that should be taken.
+     */
+    Action getAction(const int exitCode, const bool crashed) const;
+
+    /**
+     * @brief  Sets how restart delays grow after repeated failures.
+     *
+     * @param initialDelayMS  Milliseconds to wait before the first restart.
+     *
+     * @param maxDelayMS      The largest allowed restart delay.
+     *
+     * @param multiplier      The factor applied to the delay after each
+     *                        consecutive failure.
+     */
+    void setBackoff(const int initialDelayMS, const int maxDelayMS,
+            const double multiplier = 2.0);
+
+    /**
+     * @brief  Sets how much restart delays are randomly varied, so that
+     *         daemons that failed together don't all restart together.
+     *
+     * @param jitterFraction  The largest fraction of the delay that may be
+     *                        added or subtracted, between 0 and 1.
+     */
+    void setJitter(const double jitterFraction);
+
+    /**
+     * @brief  Gets how long to wait before restarting the daemon.
+     *
+     * @param attempt      The number of restarts since the daemon last became
+     *                     ready, starting from zero.
+     *
+     * @param randomValue  A random value between zero and one, used to apply
+     *                     jitter.
+     *
+     * @return             The restart delay in milliseconds.
+     */
+    int getRestartDelay(const unsigned int attempt,
+            const double randomValue) const;
+
+    /**
+     * @brief  Sets how many failures within a period of time count as a crash
+     *         loop, stopping automatic restarts.
+     *
+     * @param maxFailures  The number of failures that stops restarts, or zero
+     *                     to never detect crash loops.
+     *
+     * @param windowMS     The length of the period in milliseconds.
+     */
+    void setCrashLoopLimit(const unsigned int maxFailures, const int windowMS);
+
+    /**
+     * @brief  Gets the number of failures that stops automatic restarts.
+     *
+     * @return  The failure limit, or zero if crash loops aren't detected.
+     */
+    unsigned int getCrashLoopFailures() const;
+
+    /**
+     * @brief  Gets the period in which failures count towards the crash loop
+     *         limit.
+     *
+     * @return  The crash loop window in milliseconds.
+     */
+    int getCrashLoopWindow() const;
+
+private:
+    // Actions for specific exit codes:
+    std::map<int, Action> exitActions;
+    // Action for exit codes without their own rule:
+    Action defaultAction = Action::restart;
+    // Action after the daemon is killed by a signal:
+    Action crashAction = Action::restart;
+    // Exponential backoff settings:
+    int initialDelayMS;
+    int maxDelayMS;
+    double multiplier;
+    double jitterFraction;
+    // Crash loop detection settings:
+    unsigned int maxFailures;
+    int windowMS;
+};
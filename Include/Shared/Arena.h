@@ -0,0 +1,250 @@
+/**
+ * @file  Arena.h
+ *
+ * @brief  Provides a monotonic memory arena for short-lived scratch memory.
+ */
+
+#pragma once
+#include <cstddef>
+
+// Only C++17 code may use std::pmr. This is checked separately in each
+// translation unit, as the framework and the application using it may be
+// compiled with different language versions:
+#if __cplusplus >= 201703L && defined __has_include
+#   if __has_include(<memory_resource>)
+#       include <memory_resource>
+#       define DF_STD_PMR 1
+#   endif
+#endif
+
+namespace DaemonFramework
+{
+    class MemoryResource;
+    class Arena;
+#   ifdef DF_STD_PMR
+    class PmrResource;
+#   endif
+}
+
+/**
+ * @brief  An abstract source of memory, matching the interface of C++17's
+ *         std::pmr::memory_resource.
+ *
+ *  Function names follow the standard library, so code written against
+ * either type works with both. C++17 code may wrap any MemoryResource in a
+ * PmrResource to use it with standard library pmr containers.
+ */
+class DaemonFramework::MemoryResource
+{
+public:
+    virtual ~MemoryResource() { }
+
+    /**
+     * @brief  Allocates a block of memory.
+     *
+     * @param bytes      The number of bytes to allocate.
+     *
+     * @param alignment  The required alignment of the block.
+     *
+     * @return           The allocated memory.
+     */
+    void* allocate(const size_t bytes,
+            const size_t alignment = alignof(std::max_align_t))
+    {
+        return do_allocate(bytes, alignment);
+    }
+
+    /**
+     * @brief  Releases a block of memory returned by allocate().
+     *
+     * @param memory     The memory to release.
+     *
+     * @param bytes      The size used to allocate the memory.
+     *
+     * @param alignment  The alignment used to allocate the memory.
+     */
+    void deallocate(void* memory, const size_t bytes,
+            const size_t alignment = alignof(std::max_align_t))
+    {
+        do_deallocate(memory, bytes, alignment);
+    }
+
+    /**
+     * @brief  Checks if memory allocated by this resource may be released by
+     *         another resource, and the reverse.
+     *
+     * @param other  Another memory resource.
+     *
+     * @return       Whether the resources are interchangeable.
+     */
+    bool is_equal(const MemoryResource& other) const noexcept
+    {
+        return do_is_equal(other);
+    }
+
+private:
+    virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+    virtual void do_deallocate(void* memory, size_t bytes,
+            size_t alignment) = 0;
+    virtual bool do_is_equal(const MemoryResource& other) const noexcept = 0;
+};
+
+/**
+ * @brief  Allocates memory by advancing through a buffer, releasing all of it
+ *         at once when reset.
+ *
+ *  Like std::pmr::monotonic_buffer_resource, deallocating memory does nothing,
+ * and allocation only moves a pointer forward. When the buffer runs out, the
+ * arena allocates another block from the heap. On reset, an arena that needed
+ * extra blocks replaces them all with one block large enough for everything
+ * allocated since the last reset. Work that allocates about the same amount
+ * each time it runs between resets soon stops allocating heap memory
+ * entirely.
+ *
+ *  Arenas are not thread-safe. Each should only be used by one thread at a
+ * time.
+ */
+class DaemonFramework::Arena : public MemoryResource
+{
+public:
+    // Default initial arena size in bytes:
+    static const constexpr size_t defaultSize = 4096;
+
+    /**
+     * @brief  Allocates the arena's initial buffer.
+     *
+     * @param initialSize  The initial buffer size in bytes.
+     */
+    Arena(const size_t initialSize = defaultSize);
+
+    /**
+     * @brief  Frees all memory held by the arena.
+     */
+    virtual ~Arena();
+
+    // Arenas own their memory blocks, and may not be copied:
+    Arena(const Arena& toCopy) = delete;
+    Arena& operator=(const Arena& toCopy) = delete;
+
+    /**
+     * @brief  Releases all memory allocated since the last reset, so that it
+     *         may be allocated again.
+     *
+     *  All objects using memory from the arena must be destroyed before it
+     * is reset.
+     */
+    void reset();
+
+    /**
+     * @brief  Gets the number of bytes allocated since the last reset,
+     *         including alignment padding.
+     */
+    size_t getUsed() const;
+
+    /**
+     * @brief  Gets the number of bytes the arena may allocate before it
+     *         needs another heap block.
+     */
+    size_t getCapacity() const;
+
+    /**
+     * @brief  Gets the number of memory blocks the arena has allocated from
+     *         the heap since it was created, including its initial block.
+     */
+    size_t getBlockAllocations() const;
+
+private:
+    /**
+     * @brief  Allocates memory from the current block, adding a block if
+     *         it doesn't have enough space left.
+     */
+    virtual void* do_allocate(size_t bytes, size_t alignment) override;
+
+    /**
+     * @brief  Does nothing, as arena memory is only released on reset.
+     */
+    virtual void do_deallocate(void* memory, size_t bytes,
+            size_t alignment) override;
+
+    /**
+     * @brief  Checks if another memory resource is this arena.
+     */
+    virtual bool do_is_equal(const MemoryResource& other) const noexcept
+            override;
+
+    /**
+     * @brief  Allocates a new block from the heap and makes it the current
+     *         block.
+     *
+     * @param size  The minimum number of usable bytes in the block.
+     */
+    void addBlock(const size_t size);
+
+    /**
+     * @brief  Frees all blocks held by the arena.
+     */
+    void freeBlocks();
+
+    // A heap-allocated block of arena memory, followed by its usable bytes:
+    struct Block
+    {
+        // The previously allocated block, or nullptr for the first block:
+        Block* previous;
+        // Number of usable bytes in the block:
+        size_t size;
+        // Number of bytes allocated from the block since the last reset:
+        size_t used;
+    };
+
+    // The block currently used for allocation:
+    Block* currentBlock = nullptr;
+    // Number of bytes used in blocks before the current block:
+    size_t previousBlocksUsed = 0;
+    // Number of heap blocks allocated since construction:
+    size_t blockAllocations = 0;
+};
+
+#ifdef DF_STD_PMR
+/**
+ * @brief  Lets C++17 code use a MemoryResource as a std::pmr::memory_resource.
+ *
+ *  This is only defined in code compiled as C++17 or later, and is entirely
+ * defined in this header, so it works even if the framework itself was
+ * compiled with an older language version.
+ */
+class DaemonFramework::PmrResource : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @brief  Wraps a memory resource.
+     *
+     * @param resource  The resource that will provide all memory. It must
+     *                  outlive the PmrResource.
+     */
+    PmrResource(MemoryResource* resource) : resource(resource) { }
+
+private:
+    virtual void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return resource->allocate(bytes, alignment);
+    }
+
+    virtual void do_deallocate(void* memory, size_t bytes, size_t alignment)
+            override
+    {
+        resource->deallocate(memory, bytes, alignment);
+    }
+
+    virtual bool do_is_equal(const std::pmr::memory_resource& other) const
+            noexcept override
+    {
+        const PmrResource* otherWrapper
+                = dynamic_cast<const PmrResource*>(&other);
+        return otherWrapper != nullptr
+                && resource->is_equal(*otherWrapper->resource);
+    }
+
+    // The wrapped resource:
+    MemoryResource* resource;
+};
+#endif
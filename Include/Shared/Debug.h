@@ -2,16 +2,23 @@
  * @file  Debug.h
  *
  * @brief  Provides debugging macros that are removed in release builds.
+ *
+ *  Debug output is written asynchronously through Log.h. It is enabled in
+ * debug builds, and in release builds with DF_LOG_ENABLED set. Assertions are
+ * only checked in debug builds.
  */
 
 // Use different colors for the parent, daemon, and others.
 #define PROC_COLOR_CODED 1
 
 #pragma once
-#ifdef DF_DEBUG
-#   include <iostream>
-#   include <cassert>
-#   include <cstdio>
+#if defined DF_DEBUG || (defined DF_LOG_ENABLED && DF_LOG_ENABLED)
+#   define DF_LOGGING 1
+#endif
+
+#ifdef DF_LOGGING
+#   include "Log.h"
+#   include <cerrno>
 #   ifdef PROC_COLOR_CODED
 #       if DF_IS_DAEMON
 #           define PROC_COLOR "\033[31mD: " <<
@@ -22,31 +29,68 @@
 #           define PROC_COLOR "\033[37m?: " <<
 #       endif
 #       define PROC_RESET "\033[0m" <<
-#   else  
+#   else
 #       define PROC_COLOR
 #       define PROC_RESET
 #   endif
 
+// Queues a line of output at a specific log level, if that level is enabled
+// and the call site has not exceeded its rate limit. The value of errno is
+// saved as dfSavedErrno before anything else runs, and restored afterwards:
+#   define DF_LOG(level, toPrint) \
+        do \
+        { \
+            const int dfSavedErrno = errno; \
+            static DaemonFramework::Log::CallSite dfLogSite; \
+            if (DaemonFramework::Log::isEnabled(level) \
+                    && dfLogSite.allowLine()) \
+            { \
+                DaemonFramework::Log::beginLine() \
+                        << PROC_COLOR toPrint << PROC_RESET ""; \
+                DaemonFramework::Log::endLine(); \
+            } \
+            errno = dfSavedErrno; \
+        } while (false);
+
 // Prints a line of debug output:
-#   define DF_DBG(toPrint) std::cout << PROC_COLOR toPrint << PROC_RESET "\n";
+#   define DF_DBG(toPrint) \
+        DF_LOG(DaemonFramework::Log::Level::debug, toPrint)
 
 // Prints a line of verbose debug output:
 #   ifdef DF_VERBOSE
-#       define DF_DBG_V(toPrint) DF_DBG(toPrint)
+#       define DF_DBG_V(toPrint) \
+            DF_LOG(DaemonFramework::Log::Level::verbose, toPrint)
 #   else
 #       define DF_DBG_V(toPrint)
 #   endif
 
 // Prints a C-style error message:
-#   define DF_PERROR(toPrint) perror(toPrint);
+#   define DF_PERROR(toPrint) \
+        DF_LOG(DaemonFramework::Log::Level::error, toPrint << ": " \
+                << DaemonFramework::Log::ErrorText{dfSavedErrno})
 
-// Terminates the program if a test condition is not met:
-#   define DF_ASSERT(condition) assert(condition);
-
-// Redefine debug macros as empty statements outside of debug builds:
+// Redefine output macros as empty statements when logging is disabled:
 #else
 #   define DF_DBG(toPrint)
 #   define DF_DBG_V(toPrint)
 #   define DF_PERROR(toPrint)
+#endif
+
+#ifdef DF_DEBUG
+#   include <cassert>
+// Terminates the program if a test condition is not met, after writing all
+// queued output:
+#   define DF_ASSERT(condition) \
+        do \
+        { \
+            if (! (condition)) \
+            { \
+                DaemonFramework::Log::flush(); \
+                assert(condition); \
+            } \
+        } while (false);
+
+// Remove assertions outside of debug builds:
+#else
 #   define DF_ASSERT(condition)
 #endif
@@ -0,0 +1,176 @@
+/**
+ * @file  EventLoop.h
+ *
+ * @brief  Waits for events on a set of file descriptors, and passes each event
+ *         to a handler function.
+ */
+
+#pragma once
+#include <pthread.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DaemonFramework { class EventLoop; }
+
+/**
+ * @brief  Runs event handler functions when registered file descriptors become
+ *         ready.
+ *
+ *  An EventLoop may either run on its own thread, or be driven by another
+ * event loop. To integrate an EventLoop into an application's own poll, select,
+ * or epoll loop, watch the file descriptor returned by getFD() for input, and
+ * call processEvents() whenever it becomes readable.
+ *
+ *  Handlers run on whichever thread calls processEvents(). File descriptors
+ * may be added or removed from any thread, including from within handlers.
+ * Once removeFD() returns, the removed handler is not running and will not
+ * run again.
+ */
+class DaemonFramework::EventLoop
+{
+public:
+    /**
+     * @brief  Function type used to handle file descriptor events.
+     *
+     *  Handler functions receive the set of epoll event flags that were
+     * triggered.
+     */
+    typedef std::function<void(const uint32_t events)> Handler;
+
+    /**
+     * @brief  Creates the epoll instance used to wait for events.
+     */
+    EventLoop();
+
+    /**
+     * @brief  Stops the event thread if running, and closes the epoll
+     *         instance.
+     */
+    ~EventLoop();
+
+    // EventLoop objects own file descriptors, and may not be copied:
+    EventLoop(const EventLoop& toCopy) = delete;
+    EventLoop& operator=(const EventLoop& toCopy) = delete;
+
+    /**
+     * @brief  Checks if the loop was created successfully.
+     *
+     * @return  Whether the epoll instance and wakeup event were both created.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief  Starts watching a file descriptor for events.
+     *
+     * @param fileDescriptor  An open file descriptor. If it is already
+     *                        registered, its events and handler will be
+     *                        replaced.
+     *
+     * @param events          The epoll event flags to watch for.
+     *
+     * @param handler         The function to run when events occur.
+     *
+     * @return                Whether the file descriptor was registered.
+     */
+    bool addFD(const int fileDescriptor, const uint32_t events,
+            const Handler handler);
+
+    /**
+     * @brief  Stops watching a file descriptor for events.
+     *
+     *  If the file descriptor's handler is running on another thread, this
+     * waits for it to finish.
+     *
+     * @param fileDescriptor  A file descriptor previously passed to addFD().
+     *
+     * @return                Whether the file descriptor was registered.
+     */
+    bool removeFD(const int fileDescriptor);
+
+    /**
+     * @brief  Waits for events, and runs the handlers of all file descriptors
+     *         that are ready.
+     *
+     * @param timeoutMS  Maximum time in milliseconds to wait for events, zero
+     *                   to return immediately, or -1 to wait indefinitely.
+     *
+     * @return           The number of events handled, or -1 if waiting failed.
+     */
+    int processEvents(const int timeoutMS = 0);
+
+    /**
+     * @brief  Gets a file descriptor that becomes readable whenever events are
+     *         ready to process.
+     *
+     * @return  The loop's epoll file descriptor.
+     */
+    int getFD() const;
+
+    /**
+     * @brief  Starts processing events on a new thread, if not already
+     *         running.
+     *
+     *  If a stopped event thread is still finishing its last handler, this
+     * waits for it to exit before starting the new thread. The stopped thread
+     * can't restart itself, so calling this from its handlers returns false.
+     *
+     * @return  Whether the event thread is running.
+     */
+    bool startThread();
+
+    /**
+     * @brief  Stops the event thread and waits for it to exit, if running.
+     *
+     *  When called from within a handler on the event thread, this returns
+     * immediately, and the thread exits after the handler returns.
+     */
+    void stopThread();
+
+    /**
+     * @brief  Checks if events are being processed on the loop's own thread.
+     *
+     * @return  Whether the event thread is running.
+     */
+    bool isThreadRunning() const;
+
+    /**
+     * @brief  Wakes up the event thread or any processEvents() call that is
+     *         currently waiting for events.
+     */
+    void wakeUp();
+
+private:
+    /**
+     * @brief  Processes events until the event thread is stopped.
+     *
+     * @param eventLoop  A pointer to the EventLoop that will run the thread.
+     *
+     * @return           An ignored null value.
+     */
+    static void* threadAction(void* eventLoop);
+
+    // The epoll instance:
+    int epollFD = -1;
+    // Event file descriptor used to wake up waiting threads:
+    int wakeFD = -1;
+    // Registered event handlers, indexed by file descriptor:
+    std::map<int, std::shared_ptr<Handler>> handlers;
+    // Prevents simultaneous access to the handler map:
+    std::mutex handlerMutex;
+    // Held while running handlers, so that removed handlers can finish first:
+    std::recursive_mutex dispatchMutex;
+    // Protects the event thread ID:
+    std::mutex threadMutex;
+    // Signals that the event thread exited:
+    std::condition_variable threadExited;
+    // The ID of the thread that is processing events, or zero if no event
+    // thread exists:
+    pthread_t threadID = 0;
+    // Whether the event thread should keep running:
+    std::atomic_bool threadRunning;
+};
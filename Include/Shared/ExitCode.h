@@ -27,5 +27,7 @@ enum class DaemonFramework::ExitCode
     // Unable to clean up open file descriptors before running the daemon:
     fdCleanupFailed = 7,
     // Unable to run the daemon executable:
-    daemonExecFailed = 8
+    daemonExecFailed = 8,
+    // The parent executable's contents don't match the expected digest:
+    badParentDigest = 9
 };
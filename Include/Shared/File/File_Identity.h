@@ -0,0 +1,104 @@
+/**
+ * @file  File_Identity.h
+ *
+ * @brief  Identifies a specific version of a specific file.
+ */
+
+#pragma once
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+namespace DaemonFramework { namespace File { class Identity; } }
+
+/**
+ * @brief  Stores the device, inode, size, and modification time of a file.
+ *
+ *  Two Identity objects are equal only if they were read from the same file,
+ * and that file was not modified between reads. Unlike file paths, file
+ * identities can't be redirected by replacing or renaming files.
+ */
+class DaemonFramework::File::Identity
+{
+public:
+    /**
+     * @brief  Creates an invalid identity that matches no file.
+     */
+    Identity();
+
+    /**
+     * @brief  Reads a file identity from file stat data.
+     *
+     * @param fileStats  Data returned by any stat function call.
+     */
+    Identity(const struct stat& fileStats);
+
+    ~Identity() { }
+
+    /**
+     * @brief  Checks if this object describes an actual file.
+     *
+     * @return  Whether the Identity was created from file stat data.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief  Checks if this object describes the same file as another
+     *         Identity, regardless of whether either file version changed.
+     *
+     * @param rhs  Another Identity object.
+     *
+     * @return     Whether both objects share the same device and inode.
+     */
+    bool sameFile(const Identity& rhs) const;
+
+    /**
+     * @brief  Checks if two objects describe the same version of the same
+     *         file.
+     *
+     * @param rhs  Another Identity object.
+     *
+     * @return     Whether both objects are valid, and all identity values
+     *             match.
+     */
+    bool operator==(const Identity& rhs) const;
+
+    /**
+     * @brief  Checks if two objects describe different files or file
+     *         versions.
+     *
+     * @param rhs  Another Identity object.
+     *
+     * @return     Whether the objects are not equal.
+     */
+    bool operator!=(const Identity& rhs) const;
+
+    /**
+     * @brief  Defines an arbitrary strict ordering for Identity objects, so
+     *         that they may be used as keys in sorted containers.
+     *
+     * @param rhs  Another Identity object.
+     *
+     * @return     Whether this object should be ordered before rhs.
+     */
+    bool operator<(const Identity& rhs) const;
+
+    /**
+     * @brief  Gets the size of the identified file.
+     *
+     * @return  The file size in bytes, or zero if this object is invalid.
+     */
+    off_t getSize() const;
+
+private:
+    // The ID of the device holding the file:
+    dev_t device = 0;
+    // The file's inode number on that device:
+    ino_t inode = 0;
+    // The size of the file in bytes:
+    off_t size = 0;
+    // The last time the file's contents were modified:
+    struct timespec modTime = {0, 0};
+    // Whether the identity was read from an actual file:
+    bool valid = false;
+};
@@ -0,0 +1,102 @@
+/**
+ * @file  HdrHistogram.h
+ *
+ * @brief  Records the distribution of integer values with a fixed relative
+ *         precision over a wide range.
+ *
+ *  Like an HDR histogram, values are grouped into ranges between powers of
+ * two, and each range is split into subBucketCount equal buckets. Recorded
+ * values are kept within about 3% of their true value, from zero up to
+ * 2^maxValueBits. Larger values are recorded in the last bucket.
+ *
+ *  Values may be recorded and queried from any thread without locking.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace DaemonFramework { class HdrHistogram; }
+
+class DaemonFramework::HdrHistogram
+{
+public:
+    // Each power of two range is split into 2^subBucketBits buckets:
+    static const constexpr unsigned int subBucketBits = 5;
+    static const constexpr size_t subBucketCount = 1 << subBucketBits;
+
+    // Values below 2^maxValueBits are recorded with full precision:
+    static const constexpr unsigned int maxValueBits = 40;
+
+    // Total number of buckets:
+    static const constexpr size_t bucketCount
+            = subBucketCount * (maxValueBits - subBucketBits + 1);
+
+    HdrHistogram();
+
+    /**
+     * @brief  Records a single value.
+     */
+    void record(const uint64_t value);
+
+    /**
+     * @brief  Removes all recorded values.
+     *
+     *  Values recorded while resetting may be partially removed.
+     */
+    void reset();
+
+    /**
+     * @brief  Gets the number of recorded values.
+     */
+    uint64_t getCount() const;
+
+    /**
+     * @brief  Gets the smallest recorded value, or zero if no values were
+     *         recorded.
+     */
+    uint64_t getMin() const;
+
+    /**
+     * @brief  Gets the largest recorded value.
+     */
+    uint64_t getMax() const;
+
+    /**
+     * @brief  Gets the mean of all recorded values.
+     */
+    double getMean() const;
+
+    /**
+     * @brief  Gets the value at a specific percentile.
+     *
+     * @param percentile  A percentile between 0 and 100.
+     *
+     * @return            The highest value in the bucket holding the
+     *                    percentile, limited to the largest recorded value, or
+     *                    zero if no values were recorded.
+     */
+    uint64_t getValueAtPercentile(const double percentile) const;
+
+private:
+    /**
+     * @brief  Gets the index of the bucket holding a value.
+     */
+    static size_t getBucketIndex(const uint64_t value);
+
+    /**
+     * @brief  Gets the highest value held by a bucket.
+     */
+    static uint64_t getBucketMaxValue(const size_t index);
+
+    // Number of values recorded in each bucket:
+    std::atomic<uint64_t> counts[bucketCount];
+    // Number of values recorded:
+    std::atomic<uint64_t> totalCount;
+    // Sum of all recorded values:
+    std::atomic<uint64_t> valueSum;
+    // The smallest and largest recorded values:
+    std::atomic<uint64_t> minValue;
+    std::atomic<uint64_t> maxValue;
+};
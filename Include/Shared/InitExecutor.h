@@ -0,0 +1,109 @@
+/**
+ * @file  InitExecutor.h
+ *
+ * @brief  Runs asynchronous initialization tasks on a shared pool of threads.
+ */
+
+#pragma once
+#include <pthread.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace DaemonFramework { class InitExecutor; }
+
+/**
+ * @brief  A process-wide pool of threads used to run ThreadedInit actions.
+ *
+ *  Initialization tasks may block while waiting for other processes, so
+ * tasks only wait for other tasks to finish when the pool is full. If no
+ * pooled thread is idle when a task is submitted, a new thread is added to the
+ * pool unless it already holds maxThreads threads, in which case the task is
+ * queued until a thread finishes its current task. Threads left idle for
+ * longer than the idle timeout exit, so a burst of tasks doesn't leave
+ * unused threads running for the rest of the process.
+ *
+ *  Pooled threads are not copied into child processes, so the executor must
+ * not be used in a forked child that has not called exec.
+ */
+class DaemonFramework::InitExecutor
+{
+public:
+    /**
+     * @brief  Function type used for initialization tasks.
+     */
+    typedef std::function<void()> Task;
+
+    /**
+     * @brief  The maximum number of threads the pool may hold at once.
+     */
+    static constexpr unsigned int maxThreads = 16;
+
+    /**
+     * @brief  Gets the executor shared by all ThreadedInit objects.
+     *
+     * @return  The process-wide executor.
+     */
+    static InitExecutor& getInstance();
+
+    // The shared executor may not be copied:
+    InitExecutor(const InitExecutor& toCopy) = delete;
+    InitExecutor& operator=(const InitExecutor& toCopy) = delete;
+
+    /**
+     * @brief  Runs a task on a pooled thread, adding a thread to the pool if
+     *         all threads are busy and the pool isn't full.
+     *
+     * @param task      The task to run.
+     *
+     * @param onFinish  An optional function to run on the same thread after
+     *                  the task, once the thread is available for new tasks.
+     *                  Signalling that the task is done from this function lets
+     *                  the next task reuse the same thread.
+     *
+     * @return          Whether the task will run. This only fails if a new
+     *                  thread was needed and couldn't be created.
+     */
+    bool run(const Task task, const Task onFinish = Task());
+
+    /**
+     * @brief  Gets the number of threads in the pool.
+     *
+     * @return  The number of threads that have been created and haven't
+     *          exited.
+     */
+    unsigned int getThreadCount();
+
+    /**
+     * @brief  Gets the number of pooled threads that are waiting for tasks.
+     *
+     * @return  The number of idle threads.
+     */
+    unsigned int getIdleThreadCount();
+
+private:
+    InitExecutor() { }
+
+    /**
+     * @brief  Runs tasks as they are submitted, exiting once the thread has
+     *         been idle for too long.
+     *
+     * @param executor  A pointer to the InitExecutor that owns the thread.
+     *
+     * @return          An ignored null value.
+     */
+    static void* threadAction(void* executor);
+
+    // Tasks waiting for a thread, each paired with its finishing function:
+    std::deque<std::pair<Task, Task>> tasks;
+    // The number of threads in the pool:
+    unsigned int threadCount = 0;
+    // The number of threads waiting for tasks or finishing their last task:
+    unsigned int idleThreads = 0;
+    // Protects the task queue and thread counts:
+    std::mutex taskMutex;
+    // Wakes idle threads when tasks are added:
+    std::condition_variable taskCondition;
+};
@@ -7,11 +7,16 @@
 
 #pragma once
 #include <pthread.h>
+#include <atomic>
 #include <vector>
 #include <mutex>
 #include <string>
 
-namespace DaemonFramework { class InputReader; }
+namespace DaemonFramework
+{
+    class InputReader;
+    class EventLoop;
+}
 
 class DaemonFramework::InputReader
 {
@@ -32,16 +37,28 @@ public:
      * @brief  Opens the input file and starts the input read loop if not
      *         already reading.
      *
-     * @return  Whether the InputReader successfully started reading input, or
-     *          was already reading input.
+     * @param eventLoop  An optional EventLoop that will read input whenever
+     *                   the file becomes readable. If null, the InputReader
+     *                   reads input on its own thread.
+     *
+     * @return           Whether the InputReader successfully started reading
+     *                   input, or was already reading input.
      */
-    bool startReading();
+    bool startReading(EventLoop* eventLoop = nullptr);
 
     /**
      * @brief  Ensures that the InputReader is not reading input.
      */
     void stopReading();
 
+    /**
+     * @brief  Stops reading, waits for the reader thread to exit, and prepares
+     *         to open the input file again.
+     *
+     *  If called from within the reader thread, this only stops reading.
+     */
+    void resetReader();
+
     /**
      * @brief  Gets the path used to open the input file.
      *
@@ -76,6 +93,17 @@ private:
      */
     void readLoop();
 
+    /**
+     * @brief  Reads and processes available input, closing the input file if
+     *         reading fails. The readerMutex must be locked when calling this.
+     */
+    void readInput();
+
+    /**
+     * @brief  Handles input events when reading through an EventLoop.
+     */
+    void handleInputEvent();
+
     /**
      * @brief  Opens the input file, handling errors and using appropriate 
      *         file reading options.
@@ -131,10 +159,17 @@ private:
 
     // The file path:
     std::string path;
-    // The ID of the thread that is/was running the read loop:
+    // The ID of the thread that is/was running the read loop, or that is
+    // handling an input event:
     pthread_t threadID = 0;
+    // The EventLoop used to read input, if not reading on a separate thread:
+    EventLoop* eventLoop = nullptr;
+    // The file descriptor registered with the EventLoop, or -1 if none:
+    std::atomic_int watchedFile;
     // File descriptor for the input file:
     int inputFile = 0;
+    // Event file used to wake the reader thread when reading stops:
+    int wakeFD = -1;
     // Current reader state:
     State currentState = State::initializing;
     // Prevents simultaneous access to the input event file:
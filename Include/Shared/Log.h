@@ -0,0 +1,151 @@
+/**
+ * @file  Log.h
+ *
+ * @brief  Writes debug output asynchronously, so that logging threads never
+ *         wait on the output file.
+ *
+ *  Each thread formats log lines into its own preallocated line buffer, then
+ * copies each finished line into a fixed-size lock-free queue. A background
+ * writer thread takes lines from the queue and writes them to the output file.
+ * Threads adding lines never block, and only make a system call when they need
+ * to wake an idle writer thread. If the queue is full, new lines are dropped,
+ * and the writer reports how many were lost.
+ *
+ *  Lines are only formatted if their level is enabled. The initial level is
+ * read from the envVar environment variable, and may be changed at any time
+ * with setLevel(). Each call site is also limited to siteLinesPerSecond lines
+ * each second, so that messages repeated in a busy loop cannot flood the
+ * output.
+ *
+ *  Lines are normally written within a few milliseconds. flush() writes all
+ * queued lines immediately, and is called automatically when the process
+ * exits.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace DaemonFramework
+{
+    namespace Log
+    {
+        // Environment variable that may set the initial log level:
+        static const constexpr char* envVar = "DF_LOG_LEVEL";
+
+        // Maximum size in bytes of a single log line, including its newline.
+        // Longer lines are truncated:
+        static const constexpr size_t maxLineSize = 256;
+
+        // Number of lines the queue can hold, which must be a power of two:
+        static const constexpr size_t queueLines = 1024;
+
+        // Maximum number of lines a single call site may write each second:
+        static const constexpr unsigned int siteLinesPerSecond = 100;
+
+        /**
+         * @brief  Log levels, in order of increasing detail. Lines are written
+         *         if their level is less than or equal to the current level.
+         */
+        enum class Level : int
+        {
+            // No lines are written:
+            off = 0,
+            // Error descriptions written by DF_PERROR:
+            error = 1,
+            // Normal debug output written by DF_DBG:
+            debug = 2,
+            // Verbose debug output written by DF_DBG_V:
+            verbose = 3
+        };
+
+        /**
+         * @brief  Gets the current log level.
+         *
+         *  If setLevel() has not been called, this is set by the envVar
+         * environment variable, which may hold "off", "error", "debug", or
+         * "verbose". If the variable is unset or invalid, the level is verbose
+         * in builds with DF_VERBOSE defined, and debug in other builds.
+         */
+        Level getLevel();
+
+        /**
+         * @brief  Sets the current log level.
+         */
+        void setLevel(const Level level);
+
+        /**
+         * @brief  Checks if lines at a particular log level will be written.
+         */
+        bool isEnabled(const Level level);
+
+        /**
+         * @brief  Sets the file descriptor where log lines are written.
+         *
+         *  Lines are written to standard output unless this is called. Queued
+         * lines are flushed to the previous output before it is replaced.
+         */
+        void setOutput(const int fileDescriptor);
+
+        /**
+         * @brief  Gets the calling thread's line stream, cleared and ready to
+         *         format a new line.
+         *
+         *  Formatting text into the stream never allocates memory. Each
+         * beginLine() call must be followed by an endLine() call on the same
+         * thread. If a line is begun while formatting another line on the
+         * same thread, the inner line is discarded.
+         */
+        std::ostream& beginLine();
+
+        /**
+         * @brief  Queues the line formatted since the last beginLine() call.
+         */
+        void endLine();
+
+        /**
+         * @brief  Immediately writes all queued lines, waiting until they
+         *         have been written.
+         */
+        void flush();
+
+        /**
+         * @brief  Limits how often a single log statement may write lines.
+         */
+        class CallSite
+        {
+        public:
+            /**
+             * @brief  Checks whether the call site may write another line.
+             *
+             *  If lines were suppressed during an earlier second, this also
+             * queues a line reporting how many were suppressed.
+             *
+             * @return  Whether fewer than siteLinesPerSecond lines were
+             *          allowed during the current second.
+             */
+            bool allowLine();
+
+        private:
+            // The second when the current counting period started:
+            std::atomic<uint32_t> periodSecond{0};
+            // Number of lines allowed or suppressed this period:
+            std::atomic<uint32_t> periodLines{0};
+            // Number of lines suppressed and not yet reported:
+            std::atomic<uint32_t> suppressedLines{0};
+        };
+
+        /**
+         * @brief  Formats an error number's description when written to a
+         *         stream, without using any shared buffers.
+         */
+        struct ErrorText
+        {
+            const int errorNum;
+        };
+
+        std::ostream& operator<<(std::ostream& stream, const ErrorText& error);
+    }
+}
@@ -0,0 +1,307 @@
+/**
+ * @file  Metrics.h
+ *
+ * @brief  Provides runtime metric macros that are removed unless
+ *         DF_METRICS_ENABLED is set.
+ *
+ *  When DF_METRICS_ENABLED is set, counters and histograms keep a separate set
+ * of values for each thread, so updating them takes no locks and no atomic
+ * read-modify-write operations. Values from all threads are added together
+ * when metrics are read. Gauges hold a single shared value.
+ *
+ *  Metrics::getText() formats all metrics in the Prometheus text exposition
+ * format. When a process updates its first metric, it also starts serving
+ * metrics if either environment variable is set:
+ *  - socketEnvVar: Metrics are written to each client that connects to the
+ *    Unix socket at "<variable value>.<program name>". Clients sending an HTTP
+ *    GET request receive an HTTP response.
+ *  - fileEnvVar: Metrics are saved to "<variable value>.<program name>.prom"
+ *    every fileUpdateSeconds seconds, and when the process exits.
+ * Both variables are read with secure_getenv, so processes launched with
+ * setuid or file capabilities never serve or save metrics.
+ *
+ *  Metric names, help text, and labels must be string literals, or other
+ * strings that remain valid until the process exits.
+ */
+
+#pragma once
+#if defined DF_METRICS_ENABLED && DF_METRICS_ENABLED
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace DaemonFramework
+{
+    namespace Metrics
+    {
+        // Environment variable holding the path prefix of the metrics socket:
+        static const constexpr char* socketEnvVar = "DF_METRICS_SOCKET";
+
+        // Environment variable holding the path prefix of the metrics file:
+        static const constexpr char* fileEnvVar = "DF_METRICS_FILE";
+
+        // Seconds between metrics file updates:
+        static const constexpr int fileUpdateSeconds = 5;
+
+        // Maximum number of counter and histogram values, shared by all
+        // metrics. Each counter uses one value, and each histogram uses one
+        // value for each bucket plus two more:
+        static const constexpr size_t maxValues = 256;
+
+        /**
+         * @brief  Holds the name and registration of a single metric.
+         */
+        class Metric
+        {
+        public:
+            /**
+             * @brief  Types of metric, named as in the exposition format.
+             */
+            enum class Type
+            {
+                counter,
+                gauge,
+                histogram
+            };
+
+            /**
+             * @brief  Registers the metric, reserving its per-thread values.
+             *
+             * @param type        The metric type.
+             *
+             * @param name        The metric family name.
+             *
+             * @param help        A short description of the metric.
+             *
+             * @param labels      Optional label text to write between the
+             *                    metric's braces, e.g. "check=\"path\"".
+             *
+             * @param valueCount  The number of per-thread values used.
+             */
+            Metric(const Type type, const char* name, const char* help,
+                    const char* labels, const size_t valueCount);
+
+            /**
+             * @brief  Unregisters the metric.
+             */
+            ~Metric();
+
+            /**
+             * @brief  Appends the metric's current value in the exposition
+             *         format, without the family's HELP and TYPE lines. This
+             *         must only be called while metrics are being read.
+             */
+            void appendText(std::string& text) const;
+
+            const Type type;
+            const char* const name;
+            const char* const help;
+            const char* const labels;
+
+        protected:
+            /**
+             * @brief  Adds to one of the calling thread's values.
+             */
+            void addValue(const size_t offset, const uint64_t amount);
+
+            /**
+             * @brief  Gets the sum of one value from all threads.
+             */
+            uint64_t sumValue(const size_t offset) const;
+
+            /**
+             * @brief  Appends a single sample line.
+             *
+             * @param text         The text to append to.
+             *
+             * @param suffix       A suffix to add to the family name.
+             *
+             * @param extraLabel   An optional label to add after the metric's
+             *                     own labels.
+             *
+             * @param value        The sample value.
+             */
+            void appendSample(std::string& text, const char* suffix,
+                    const std::string& extraLabel, const double value) const;
+
+        private:
+            // Index of the first reserved value, or maxValues if values could
+            // not be reserved:
+            size_t valueIndex;
+        };
+
+        /**
+         * @brief  A value that only increases.
+         */
+        class Counter : public Metric
+        {
+        public:
+            Counter(const char* name, const char* help,
+                    const char* labels = nullptr) :
+                Metric(Type::counter, name, help, labels, 1) { }
+
+            void add(const uint64_t amount = 1)
+            {
+                addValue(0, amount);
+            }
+
+            void appendValues(std::string& text) const;
+        };
+
+        /**
+         * @brief  A single value that may increase or decrease.
+         */
+        class Gauge : public Metric
+        {
+        public:
+            Gauge(const char* name, const char* help,
+                    const char* labels = nullptr) :
+                Metric(Type::gauge, name, help, labels, 0) { }
+
+            void set(const int64_t newValue)
+            {
+                value.store(newValue, std::memory_order_relaxed);
+            }
+
+            void add(const int64_t amount)
+            {
+                value.fetch_add(amount, std::memory_order_relaxed);
+            }
+
+            void appendValues(std::string& text) const;
+
+        private:
+            std::atomic<int64_t> value{0};
+        };
+
+        /**
+         * @brief  Counts observed values within a set of exponentially
+         *         increasing buckets.
+         *
+         *  Bucket upper bounds start at firstBound and are multiplied by four
+         * for each following bucket. Observed values are integers, which are
+         * multiplied by unitScale when written, so that durations measured in
+         * nanoseconds may be written in seconds.
+         */
+        class Histogram : public Metric
+        {
+        public:
+            Histogram(const char* name, const char* help,
+                    const uint64_t firstBound, const size_t bucketCount,
+                    const double unitScale = 1.0,
+                    const char* labels = nullptr) :
+                Metric(Type::histogram, name, help, labels, bucketCount + 2),
+                firstBound(firstBound), bucketCount(bucketCount),
+                unitScale(unitScale) { }
+
+            void observe(const uint64_t value)
+            {
+                size_t bucket = 0;
+                for (uint64_t bound = firstBound;
+                        bucket < bucketCount && value > bound; bound *= 4)
+                {
+                    bucket++;
+                }
+                addValue(bucket, 1);
+                addValue(bucketCount + 1, value);
+            }
+
+            void appendValues(std::string& text) const;
+
+        private:
+            const uint64_t firstBound;
+            const size_t bucketCount;
+            const double unitScale;
+        };
+
+        /**
+         * @brief  Observes the nanoseconds between its construction and its
+         *         destruction in a histogram.
+         */
+        class Timer
+        {
+        public:
+            /**
+             * @brief  Starts timing.
+             *
+             * @param histogram    The histogram where the time is observed.
+             *
+             * @param slowCounter  An optional counter to increment if the time
+             *                     is at least slowNS nanoseconds.
+             *
+             * @param slowNS       The minimum time counted by slowCounter.
+             */
+            Timer(Histogram& histogram, Counter* slowCounter = nullptr,
+                    const uint64_t slowNS = 0);
+
+            ~Timer();
+
+        private:
+            Histogram& histogram;
+            Counter* const slowCounter;
+            const uint64_t slowNS;
+            const uint64_t startNS;
+        };
+
+        /**
+         * @brief  Formats all registered metrics in the Prometheus text
+         *         exposition format.
+         */
+        std::string getText();
+
+        /**
+         * @brief  Saves all metrics to a file, replacing it atomically.
+         *
+         *  Metrics are written to a newly created temporary file next to the
+         * path, which is then renamed to replace it.
+         *
+         * @param path  The path where metrics will be written.
+         *
+         * @return      Whether the file was written.
+         */
+        bool writeFile(const char* path);
+    }
+}
+
+#   define DF_METRICS_JOIN_NAME(prefix, line) prefix##line
+#   define DF_METRICS_TIMER_NAME(line) \
+        DF_METRICS_JOIN_NAME(dfMetricsTimer, line)
+
+// Defines a counter variable, given the variable and Counter arguments:
+#   define DF_METRIC_COUNTER(variable, ...) \
+        static DaemonFramework::Metrics::Counter variable(__VA_ARGS__)
+
+// Defines a gauge variable, given the variable and Gauge arguments:
+#   define DF_METRIC_GAUGE(variable, ...) \
+        static DaemonFramework::Metrics::Gauge variable(__VA_ARGS__)
+
+// Defines a histogram variable, given the variable and Histogram arguments:
+#   define DF_METRIC_HISTOGRAM(variable, ...) \
+        static DaemonFramework::Metrics::Histogram variable(__VA_ARGS__)
+
+// Adds to a counter or gauge:
+#   define DF_METRIC_ADD(variable, amount) variable.add(amount)
+
+// Sets a gauge value:
+#   define DF_METRIC_SET(variable, value) variable.set(value)
+
+// Observes a value in a histogram:
+#   define DF_METRIC_OBSERVE(variable, value) variable.observe(value)
+
+// Observes the nanoseconds spent in the rest of the enclosing scope, given the
+// histogram variable and any other Timer arguments:
+#   define DF_METRIC_TIME(...) \
+        DaemonFramework::Metrics::Timer \
+                DF_METRICS_TIMER_NAME(__LINE__)(__VA_ARGS__)
+
+// Define metric macros as empty statements when metrics are disabled:
+#else
+#   define DF_METRIC_COUNTER(variable, ...)
+#   define DF_METRIC_GAUGE(variable, ...)
+#   define DF_METRIC_HISTOGRAM(variable, ...)
+#   define DF_METRIC_ADD(variable, amount)
+#   define DF_METRIC_SET(variable, value)
+#   define DF_METRIC_OBSERVE(variable, value)
+#   define DF_METRIC_TIME(...)
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file  OnDemand.h
+ *
+ * @brief  Defines how a daemon learns that it was launched on demand.
+ *
+ *  When DaemonControl launches a daemon on demand, it sets an environment
+ * variable telling the daemon to exit once the parent closes the daemon's
+ * input pipe. The parent closes the pipe after the daemon has been idle for
+ * its idle timeout period, and the daemon finishes handling all data already
+ * written to the pipe before it reads end-of-file and exits.
+ */
+
+#pragma once
+
+namespace DaemonFramework
+{
+    namespace OnDemand
+    {
+        // Environment variable set when the daemon was launched on demand:
+        static const constexpr char* envVar = "DF_ON_DEMAND";
+    }
+}
@@ -7,7 +7,11 @@
 #pragma once
 #include "InputReader.h"
 #include "ThreadedInit.h"
+#include "HdrHistogram.h"
+#include "Pipe_Traffic.h"
+#include <atomic>
 #include <cstddef>
+#include <future>
 #include <string>
 
 namespace DaemonFramework
@@ -40,15 +44,79 @@ public:
     /**
      * @brief  Asynchronously opens the pipe for reading.
      *
-     * @param listener  The object that will handle data read from the pipe.
+     *  The pipe is opened without blocking, and data is read once a writer
+     * opens the pipe and sends it. Without an EventLoop, the pipe is opened on
+     * a pooled init thread, and read on its own thread. With an EventLoop, the
+     * pipe is opened immediately and read on the EventLoop.
+     *
+     * @param listener   The object that will handle data read from the pipe.
+     *
+     * @param eventLoop  An optional EventLoop that will read pipe data and
+     *                   pass it to the listener. If null, the pipe is read on
+     *                   its own thread.
+     *
+     * @return           A handle that completes once the pipe is open, or
+     *                   once opening fails or is cancelled.
      */
-    void openPipe(Listener* listener);
+    std::shared_future<bool> openPipe(Listener* listener,
+            EventLoop* eventLoop = nullptr);
 
     /**
      * @brief  Stops the pipe reading thread and closes the pipe.
+     *
+     *  Once closed, the pipe may be opened again with openPipe().
      */
     void closePipe();
 
+    /**
+     * @brief  Checks if the pipe was opened and then closed, either because
+     *         all writers closed the pipe or because reading failed.
+     *
+     * @return  Whether the reader stopped after opening the pipe.
+     */
+    bool isClosed();
+
+    /**
+     * @brief  Sets whether each message read from the pipe starts with a
+     *         TimestampHeader.
+     *
+     *  This must match the setting used by the pipe's Writer, and should be
+     * set before the pipe is opened. With timestamps, the time between sending
+     * and receiving each message is recorded, and only message data is passed
+     * to the Listener.
+     *
+     * @param useTimestamps  Whether messages are timestamped.
+     */
+    void setTimestamps(const bool useTimestamps);
+
+    /**
+     * @brief  Gets the number of messages and bytes received since the reader
+     *         was created.
+     *
+     *  Without timestamps, message boundaries are unknown, so each read is
+     * counted as a single message.
+     *
+     * @return  The reader's traffic counts.
+     */
+    Traffic getTraffic() const;
+
+    /**
+     * @brief  Gets the distribution of read() sizes in bytes.
+     *
+     * @return  A histogram of all read sizes.
+     */
+    const HdrHistogram& getReadSizes() const;
+
+    /**
+     * @brief  Gets the distribution of nanoseconds between sending and
+     *         receiving each message.
+     *
+     *  Latencies are only recorded when timestamps are enabled.
+     *
+     * @return  A histogram of one-way message latencies.
+     */
+    const HdrHistogram& getLatencies() const;
+
 private:
     /**
      * @brief  Called by the asynchronous init thread to open the pipe file for
@@ -78,6 +146,15 @@ private:
      */
     virtual void processInput(const int inputBytes) override;
 
+    /**
+     * @brief  Splits timestamped pipe data into headers and message data,
+     *         recording message latency and passing message data to the
+     *         Listener.
+     *
+     * @param inputBytes  The number of bytes read into the buffer.
+     */
+    void processTimestamped(const size_t inputBytes);
+
     /**
      * @brief  Gets the maximum size in bytes available within the object's 
      *         pipe buffer.
@@ -97,8 +174,28 @@ private:
 
     // The object that will handle received data:
     Listener* listener = nullptr;
+    // The EventLoop used to read pipe data, or null to use a reader thread:
+    EventLoop* eventLoop = nullptr;
     // The maximum number of bytes to read from the pipe at one time:
     const size_t bufSize = 0;
     // The buffer where pipe data will be stored:
     unsigned char* buffer = nullptr;
+
+    // Whether each message starts with a TimestampHeader:
+    bool timestamps = false;
+    // The header of the current timestamped message:
+    TimestampHeader header;
+    // Number of header bytes received for the current message:
+    size_t headerBytes = 0;
+    // Number of data bytes not yet received for the current message:
+    uint64_t messageBytesLeft = 0;
+
+    // monotonicNS() time when the reader was created:
+    const uint64_t createdNS;
+    // Number of messages and message bytes received:
+    std::atomic<uint64_t> messageCount;
+    std::atomic<uint64_t> byteCount;
+    // Distributions of read sizes and message latencies:
+    HdrHistogram readSizes;
+    HdrHistogram latencies;
 };
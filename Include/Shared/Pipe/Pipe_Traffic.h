@@ -0,0 +1,74 @@
+/**
+ * @file  Pipe_Traffic.h
+ *
+ * @brief  Defines pipe traffic statistics, and the header sent before each
+ *         timestamped pipe message.
+ */
+
+#pragma once
+#include <cstdint>
+#include <time.h>
+
+namespace DaemonFramework
+{
+    namespace Pipe
+    {
+        /**
+         * @brief  Gets the time used to timestamp pipe messages.
+         *
+         *  CLOCK_MONOTONIC is shared by all processes on the same host, so
+         * timestamps from the writing process may be compared with the time
+         * in the reading process.
+         *
+         * @return  The CLOCK_MONOTONIC time in nanoseconds.
+         */
+        inline uint64_t monotonicNS()
+        {
+            struct timespec currentTime;
+            clock_gettime(CLOCK_MONOTONIC, &currentTime);
+            return (uint64_t) currentTime.tv_sec * 1000000000ULL
+                    + (uint64_t) currentTime.tv_nsec;
+        }
+
+        /**
+         * @brief  Sent before each message when a pipe uses timestamps.
+         */
+        struct TimestampHeader
+        {
+            // monotonicNS() time when the message was sent:
+            uint64_t sendNS;
+            // Size in bytes of the message that follows:
+            uint64_t size;
+        };
+
+        /**
+         * @brief  Counts messages and bytes passed through a pipe.
+         */
+        struct Traffic
+        {
+            // Number of messages passed through the pipe:
+            uint64_t messages = 0;
+            // Number of message bytes passed through the pipe, not including
+            // timestamp headers:
+            uint64_t bytes = 0;
+            // Nanoseconds since the pipe reader or writer was created:
+            uint64_t elapsedNS = 0;
+
+            /**
+             * @brief  Gets the average number of messages per second.
+             */
+            double messagesPerSecond() const
+            {
+                return (elapsedNS == 0) ? 0.0 : messages * 1e9 / elapsedNS;
+            }
+
+            /**
+             * @brief  Gets the average number of bytes per second.
+             */
+            double bytesPerSecond() const
+            {
+                return (elapsedNS == 0) ? 0.0 : bytes * 1e9 / elapsedNS;
+            }
+        };
+    }
+}
@@ -6,10 +6,18 @@
 
 #pragma once
 #include "ThreadedInit.h"
+#include "HdrHistogram.h"
+#include "Pipe_Traffic.h"
+#include <atomic>
+#include <future>
 #include <string>
 #include <mutex>
 
-namespace DaemonFramework { namespace Pipe { class Writer; } }
+namespace DaemonFramework
+{
+    class EventLoop;
+    namespace Pipe { class Writer; }
+}
 
 class DaemonFramework::Pipe::Writer : public ThreadedInit
 {
@@ -43,17 +51,53 @@ public:
     /**
      * @brief  Asynchronously opens the pipe file for writing.
      *
-     * This does nothing if the pipe has already been opened.
+     *  This does nothing if the pipe has already been opened. The pipe is
+     * opened without blocking, and opening is retried until a reader opens the
+     * pipe. Without an EventLoop, retries run on a pooled init thread. With an
+     * EventLoop, retries run on the EventLoop, and no thread is used.
+     *
+     * @param eventLoop  An optional EventLoop used to finish opening the pipe
+     *                   without a thread.
+     *
+     * @return           A handle that completes once the pipe is open, or
+     *                   once opening fails or is cancelled.
      */
-    void openPipe();
+    std::shared_future<bool> openPipe(EventLoop* eventLoop = nullptr);
 
     /**
      * @brief  Closes the pipe file.
      *
-     *  Any sendData() calls after the pipe file is closed will be ignored.
+     *  Any sendData() calls after the pipe file is closed will be ignored
+     * until the pipe is opened again with openPipe().
      */
     void closePipe();
 
+    /**
+     * @brief  Sets whether each message sent through the pipe starts with a
+     *         TimestampHeader.
+     *
+     *  The pipe's Reader must use the same setting.
+     *
+     * @param useTimestamps  Whether messages are timestamped.
+     */
+    void setTimestamps(const bool useTimestamps);
+
+    /**
+     * @brief  Gets the number of messages and bytes sent since the writer was
+     *         created.
+     *
+     * @return  The writer's traffic counts.
+     */
+    Traffic getTraffic() const;
+
+    /**
+     * @brief  Gets the distribution of nanoseconds spent blocked in each
+     *         pipe write.
+     *
+     * @return  A histogram of write durations.
+     */
+    const HdrHistogram& getWriteTimes() const;
+
 private:
     /**
      * @brief  Opens the pipe in preparation for writing data.
@@ -62,10 +106,82 @@ private:
      */
     virtual bool threadedInitAction() override;
 
+    /**
+     * @brief  Results of opening the pipe without blocking.
+     */
+    enum class OpenStatus
+    {
+        opened,   // The pipe is open.
+        noReader, // No reader has opened the pipe yet.
+        failed    // Opening the pipe failed.
+    };
+
+    /**
+     * @brief  Opens the pipe file if a reader has opened the pipe, without
+     *         blocking. The pipe lock must be held when calling this.
+     *
+     * @return  Whether the pipe is now open, is waiting for a reader, or
+     *          failed to open.
+     */
+    OpenStatus openWithoutBlocking();
+
+    /**
+     * @brief  Tries to open the pipe without blocking.
+     *
+     * @return  Whether opening the pipe finished, either because the pipe is
+     *          now open or because opening failed. This returns false if no
+     *          reader has opened the pipe yet.
+     */
+    bool tryOpen();
+
+    /**
+     * @brief  Schedules the next tryOpen() call on the EventLoop.
+     *
+     * @return  Whether the retry was scheduled.
+     */
+    bool scheduleRetry();
+
+    /**
+     * @brief  Cancels any scheduled tryOpen() call, and closes the retry
+     *         timer.
+     */
+    void cancelRetry();
+
+    /**
+     * @brief  Waits for the pipe to open when opening through an EventLoop,
+     *         retrying on the calling thread so that this also works on the
+     *         EventLoop's own thread.
+     *
+     * @param timeoutMS  Maximum time in milliseconds to wait.
+     *
+     * @return           Whether opening the pipe finished within the timeout.
+     */
+    bool waitForOpen(const int timeoutMS);
+
     // Named pipe file descriptor:
     int pipeFile = 0;
     // Pipe file path:
     const std::string pipePath = nullptr; 
     // Protects the pipe from concurrent access:
     std::mutex lock;
+    // The EventLoop used to retry opening the pipe, if not using a thread:
+    EventLoop* eventLoop = nullptr;
+    // Timer used to schedule open retries on the EventLoop:
+    int retryTimerFD = -1;
+    // Whether open retries may still be scheduled:
+    bool retrying = false;
+    // Milliseconds to wait before the next open retry:
+    int retryDelayMS = 0;
+    // Protects the retry timer:
+    std::mutex retryMutex;
+
+    // Whether each message starts with a TimestampHeader:
+    bool timestamps = false;
+    // monotonicNS() time when the writer was created:
+    const uint64_t createdNS;
+    // Number of messages and message bytes sent:
+    std::atomic<uint64_t> messageCount;
+    std::atomic<uint64_t> byteCount;
+    // Distribution of time spent in each write:
+    HdrHistogram writeTimes;
 };
@@ -0,0 +1,31 @@
+/**
+ * @file  ReadySignal.h
+ *
+ * @brief  Defines how a daemon tells its parent that it is ready to handle
+ *         requests.
+ *
+ *  When DaemonControl launches a daemon, it passes the write end of an
+ * anonymous pipe to the daemon as a specific file descriptor, and sets an
+ * environment variable holding that file descriptor number. Once the daemon
+ * has passed its security checks, started its input pipe reader, and finished
+ * initializing its loop, it writes a single byte to the pipe and closes it.
+ * If the daemon exits before becoming ready, the parent reads end-of-file
+ * instead.
+ */
+
+#pragma once
+
+namespace DaemonFramework
+{
+    namespace ReadySignal
+    {
+        // Environment variable holding the readiness file descriptor number:
+        static const constexpr char* envVar = "DF_READY_FD";
+
+        // The file descriptor number used for the readiness pipe:
+        static const constexpr int fileDescriptor = 3;
+
+        // The byte value written once the daemon is ready:
+        static const constexpr unsigned char readyByte = 1;
+    }
+}
@@ -0,0 +1,171 @@
+/**
+ * @file  Scratch.h
+ *
+ * @brief  Provides per-thread scratch memory for temporary strings and
+ *         containers.
+ *
+ *  While a Scratch::Scope is active, Scratch::String, Scratch::Vector, and
+ * any other container using Scratch::Allocator take their memory from the
+ * scope's Arena instead of the heap. The daemon loop activates a scope around
+ * each loop iteration, and around each handled parent message, so temporary
+ * data built while handling them stops allocating heap memory once the
+ * arena has grown large enough.
+ *
+ *  Scratch memory is released when its scope ends, so scratch containers
+ * must never outlive the loop iteration or message they were created in.
+ * Outside of any scope, scratch containers use the heap.
+ */
+
+#pragma once
+#include "Arena.h"
+#include <string>
+#include <vector>
+
+namespace DaemonFramework
+{
+    namespace Scratch
+    {
+        class Scope;
+        template <class T> class Allocator;
+
+        // A string using scratch memory:
+        typedef std::basic_string<char, std::char_traits<char>,
+                Allocator<char>> String;
+
+        // A vector using scratch memory:
+        template <class T> using Vector = std::vector<T, Allocator<T>>;
+
+        /**
+         * @brief  Gets the memory resource used for scratch memory on the
+         *         calling thread.
+         *
+         * @return  The arena of the thread's innermost active Scope, or a
+         *          resource using the heap if no Scope is active.
+         */
+        MemoryResource* getResource();
+
+        /**
+         * @brief  Gets a memory resource that allocates directly from the
+         *         heap.
+         */
+        MemoryResource* heapResource();
+    }
+}
+
+/**
+ * @brief  Uses an arena for the calling thread's scratch memory until the
+ *         Scope is destroyed, then resets the arena.
+ *
+ *  Scopes may be nested, as long as each nested scope uses a different arena.
+ * Each scope restores the thread's previous scratch resource on destruction.
+ */
+class DaemonFramework::Scratch::Scope
+{
+public:
+    /**
+     * @brief  Starts using an arena for scratch memory.
+     *
+     * @param arena  The arena to use. It will be reset once the Scope is
+     *               destroyed.
+     */
+    Scope(Arena& arena);
+
+    /**
+     * @brief  Resets the arena, and restores the previous scratch resource.
+     */
+    ~Scope();
+
+    Scope(const Scope& toCopy) = delete;
+    Scope& operator=(const Scope& toCopy) = delete;
+
+private:
+    // The arena used for scratch memory:
+    Arena& arena;
+    // The scratch resource used before the scope started:
+    MemoryResource* previousResource;
+};
+
+/**
+ * @brief  A standard library allocator that takes memory from a
+ *         MemoryResource, like std::pmr::polymorphic_allocator.
+ *
+ *  Default-constructed allocators use the calling thread's current scratch
+ * resource.
+ *
+ * @tparam T  The allocated value type.
+ */
+template <class T>
+class DaemonFramework::Scratch::Allocator
+{
+public:
+    typedef T value_type;
+
+    /**
+     * @brief  Creates an allocator using the current scratch resource.
+     */
+    Allocator() : resource(Scratch::getResource()) { }
+
+    /**
+     * @brief  Creates an allocator using a specific memory resource.
+     *
+     * @param resource  The resource that will provide all memory.
+     */
+    Allocator(MemoryResource* resource) : resource(resource) { }
+
+    /**
+     * @brief  Creates an allocator sharing another allocator's resource.
+     */
+    template <class U>
+    Allocator(const Allocator<U>& other) : resource(other.getResource()) { }
+
+    /**
+     * @brief  Allocates memory for an array of values.
+     *
+     * @param count  The number of values to allocate.
+     */
+    T* allocate(const size_t count)
+    {
+        return static_cast<T*>(resource->allocate(count * sizeof(T),
+                alignof(T)));
+    }
+
+    /**
+     * @brief  Releases memory returned by allocate().
+     *
+     * @param memory  The allocated memory.
+     *
+     * @param count   The number of values allocated.
+     */
+    void deallocate(T* memory, const size_t count)
+    {
+        resource->deallocate(memory, count * sizeof(T), alignof(T));
+    }
+
+    /**
+     * @brief  Gets the resource providing the allocator's memory.
+     */
+    MemoryResource* getResource() const { return resource; }
+
+private:
+    MemoryResource* resource;
+};
+
+namespace DaemonFramework
+{
+    namespace Scratch
+    {
+        // Allocators are equal if either may release memory from the other:
+        template <class T, class U>
+        bool operator==(const Allocator<T>& first, const Allocator<U>& second)
+        {
+            return first.getResource() == second.getResource()
+                    || first.getResource()->is_equal(*second.getResource());
+        }
+
+        template <class T, class U>
+        bool operator!=(const Allocator<T>& first, const Allocator<U>& second)
+        {
+            return ! (first == second);
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file  StartupProfile.h
+ *
+ * @brief  Records when each phase of daemon startup finishes, so that startup
+ *         latency can be broken down by phase.
+ *
+ *  Profiling is only compiled in when DF_STARTUP_PROFILE_ENABLED is set.
+ * Profiling is then enabled when the envVar environment variable holds the
+ * path to a profile file. Daemons inherit the variable from their parent, so
+ * the parent and daemon processes both append to the same file. Variables are
+ * read with secure_getenv, so privileged daemons launched with setuid or file
+ * capabilities never profile. Each line holds
+ * the time in nanoseconds, the process ID, the phase name, and an optional
+ * detail string, separated by spaces. Times are read from CLOCK_MONOTONIC,
+ * which is shared by all processes, so times recorded by the parent and the
+ * daemon may be compared directly.
+ *
+ *  The new daemon process can't safely write files or allocate memory before
+ * it executes the daemon, so DaemonControl passes the times recorded in that
+ * process to the daemon through the childStartVar and execVar environment
+ * variables. DaemonLoop records those times once the daemon starts.
+ *
+ *  Daemons hold their records in memory until their security checks pass, so
+ * a daemon executed by anything but its expected parent never opens the
+ * profile file.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace DaemonFramework
+{
+    namespace StartupProfile
+    {
+        // Environment variable holding the profile file path:
+        static const constexpr char* envVar = "DF_STARTUP_PROFILE";
+
+        // Environment variable holding the time when the new daemon process
+        // started running:
+        static const constexpr char* childStartVar = "DF_STARTUP_CHILD_NS";
+
+        // Environment variable holding the time when the new daemon process
+        // started executing the daemon:
+        static const constexpr char* execVar = "DF_STARTUP_EXEC_NS";
+
+        // Maximum number of digits needed to print a time value:
+        static const constexpr size_t maxTimeDigits = 20;
+
+        /**
+         * @brief  Gets the current time used for all profile records.
+         *
+         *  This is async-signal-safe.
+         *
+         * @return  The CLOCK_MONOTONIC time in nanoseconds.
+         */
+        uint64_t now();
+
+#   if defined DF_STARTUP_PROFILE_ENABLED && DF_STARTUP_PROFILE_ENABLED
+        /**
+         * @brief  Checks if startup profiling is enabled.
+         *
+         * @return  Whether profiling is compiled in, and envVar held a
+         *          profile path that could be opened when this was first
+         *          called.
+         */
+        bool isEnabled();
+
+        /**
+         * @brief  Records that a startup phase finished, if profiling is
+         *         enabled.
+         *
+         * @param phase   The name of the finished phase.
+         *
+         * @param detail  An optional string used to tell apart phases with the
+         *                same name.
+         *
+         * @param timeNS  The time the phase finished, or zero to use the
+         *                current time.
+         */
+        void record(const char* phase, const char* detail = nullptr,
+                const uint64_t timeNS = 0);
+
+        /**
+         * @brief  Records the times passed to a daemon through childStartVar
+         *         and execVar, and removes those variables from the
+         *         environment.
+         */
+        void recordLaunchTimes();
+
+        /**
+         * @brief  Holds all later records in memory without opening the
+         *         profile file, until releaseRecords() is called.
+         */
+        void holdRecords();
+
+        /**
+         * @brief  Writes all held records to the profile file, and stops
+         *         holding new records.
+         */
+        void releaseRecords();
+#   else
+        // Startup profiling is compiled out, so records are ignored:
+        inline bool isEnabled() { return false; }
+        inline void record(const char*, const char* = nullptr,
+                const uint64_t = 0) { }
+        inline void recordLaunchTimes() { }
+        inline void holdRecords() { }
+        inline void releaseRecords() { }
+#   endif
+
+        /**
+         * @brief  Prints a time value as a decimal number without a null
+         *         terminator.
+         *
+         *  This is async-signal-safe.
+         *
+         * @param buffer  A buffer with room for at least maxTimeDigits
+         *                characters.
+         *
+         * @param timeNS  The time value to print.
+         *
+         * @return        The number of characters printed.
+         */
+        size_t printTime(char* buffer, uint64_t timeNS);
+
+        /**
+         * @brief  Records a phase on construction, so that class member
+         *         declarations can mark when other members start to be
+         *         constructed.
+         */
+        class Checkpoint
+        {
+        public:
+            /**
+             * @brief  Records the phase.
+             *
+             * @param phase  The name of the finished phase.
+             *
+             * @param hold   Whether to start holding records before this
+             *               one is recorded.
+             */
+            Checkpoint(const char* phase, const bool hold = false)
+            {
+                if (hold)
+                {
+                    holdRecords();
+                }
+                record(phase);
+            }
+        };
+    }
+}
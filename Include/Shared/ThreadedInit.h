@@ -1,27 +1,41 @@
 /**
  * @file  ThreadedInit.h
  *
- * @brief  Abstract basis for classes that perform an initialization step within
- *         a new thread.
+ * @brief  Abstract basis for classes that perform an initialization step on a
+ *         shared init thread.
  */
 
 #pragma once
 #include <pthread.h>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <future>
 
 namespace DaemonFramework
 {
     class ThreadedInit;
 }
 
+/**
+ * @brief  Runs an initialization action asynchronously on one of the
+ *         InitExecutor's pooled threads.
+ *
+ *  Initialization is cancelled cooperatively: cancelInit() sets a stop flag
+ * and waits for the action to return, so actions that may wait for a long
+ * time should wait using waitForCancel() and return early once it returns
+ * true.
+ */
 class DaemonFramework::ThreadedInit
 {
 public:
     ThreadedInit() { }
 
     /**
-     * @brief  Stops the init thread if it is still running on destruction.
+     * @brief  Cancels initialization if it is still running on destruction.
+     *
+     *  Inheriting classes must cancel initialization in their own destructors,
+     * as threadedInitAction() can't run once they are destroyed.
      */
     virtual ~ThreadedInit();
 
@@ -35,19 +49,20 @@ public:
     /**
      * @brief  Return whether initialization has finished.
      *
-     * @return  Whether the initialization thread has finished running.
+     * @return  Whether the initialization action has finished running.
      */
     bool finishedInit();
 
     /**
      * @brief  Return whether initialization was successful.
      *
-     * @return  Whether the thread finished, and threadedInit returned true.
+     * @return  Whether the action finished, and threadedInitAction returned
+     *          true.
      */
     bool successfulInit();
 
     /**
-     * @brief  Wait for the thread to finish initializing.
+     * @brief  Wait for initialization to finish.
      *
      *  If called without first calling startInitThread(), this will immediately
      * exit, returning false.
@@ -55,23 +70,93 @@ public:
      * @param timeout  Maximum time in seconds to wait, or any value less than 
      *                 one to wait indefinitely.
      *
-     * @return         True if the init thread finished successfully, false
-     *                 otherwise.
+     * @return         True if initialization finished, false otherwise.
      */
     bool waitForInit(const int timeout = -1);
 
+    /**
+     * @brief  Wait for initialization to finish until a deadline passes.
+     *
+     *  If called without first calling startInitThread(), this will immediately
+     * exit, returning false.
+     *
+     * @param deadline  The time when waiting will stop.
+     *
+     * @return          True if initialization finished before the deadline,
+     *                  false otherwise.
+     */
+    bool waitForInitUntil(const std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief  Gets a handle that completes when initialization finishes.
+     *
+     *  If initialization is cancelled or reset before finishing, the handle
+     * completes with a false result.
+     *
+     * @return  A future holding whether initialization succeeded, or an
+     *          invalid future if initialization hasn't started.
+     */
+    std::shared_future<bool> getInitResult();
+
 protected:
     /**
-     * @brief  If not already initialized or initializing, start the
-     *         initialization thread and run the initialization function.
+     * @brief  If not already initialized or initializing, run the
+     *         initialization function on a pooled init thread.
      */
     void startInitThread();
 
     /**
-     * @brief  If still initializing, force the initialization thread to stop.
+     * @brief  If not already initialized or initializing, marks
+     *         initialization as started without starting a new thread.
+     *
+     *  Classes that initialize through an EventLoop instead of a thread use
+     * this along with finishInit().
+     *
+     * @return  Whether initialization was started by this call.
+     */
+    bool beginInit();
+
+    /**
+     * @brief  Records the result of initialization started with beginInit(),
+     *         and wakes all threads waiting for initialization to finish.
+     *
+     * @param succeeded  Whether initialization succeeded.
+     */
+    void finishInit(const bool succeeded);
+
+    /**
+     * @brief  If still initializing, asks the initialization action to stop
+     *         and waits for it to return.
+     *
+     *  If called from within the initialization action, this only asks the
+     * action to stop.
      */
     void cancelInit();
 
+    /**
+     * @brief  Cancels initialization if running, and clears all
+     *         initialization state so that startInitThread() may run again.
+     */
+    void resetInit();
+
+    /**
+     * @brief  Checks if initialization was cancelled.
+     *
+     * @return  Whether cancelInit() was called since initialization started.
+     */
+    bool initCancelled();
+
+    /**
+     * @brief  Waits until initialization is cancelled or a timeout period
+     *         ends. Initialization actions use this to wait without blocking
+     *         cancellation.
+     *
+     * @param timeoutMS  Maximum time in milliseconds to wait.
+     *
+     * @return           Whether initialization was cancelled.
+     */
+    bool waitForCancel(const int timeoutMS);
+
 private:
     /**
      * @brief  The main threaded initialization routine, to be implemented by
@@ -82,14 +167,30 @@ private:
     virtual bool threadedInitAction() = 0;
 
     /**
-     * @brief  The main callback function that will run on the new thread.
-     *
-     * @param threadInit  The ThreadedInit object that will be initialized on
-     *                    the thread.
+     * @brief  Runs the initialization action on a pooled init thread.
+     */
+    void runInitAction();
+
+    /**
+     * @brief  Saves the initialization action's result once its pooled thread
+     *         is ready for new tasks, and wakes all threads waiting for
+     *         initialization to finish.
+     */
+    void finishInitAction();
+
+    /**
+     * @brief  Creates a new initialization result handle. The initMutex must
+     *         be locked when calling this.
+     */
+    void resetInitResult();
+
+    /**
+     * @brief  Saves the initialization result, and completes the result
+     *         handle. The initMutex must be locked when calling this.
      *
-     * @return            Nullptr, as the return value is not needed.
+     * @param succeeded  Whether initialization succeeded.
      */
-    static void* threadAction(void* threadInit);
+    void setInitResult(const bool succeeded);
 
     // Control access to thread state data:
     std::mutex initMutex;
@@ -98,5 +199,16 @@ private:
     bool initStarted = false;
     bool initFinished = false;
     bool initSucceeded = false;
+    // Whether the initialization action is queued or running:
+    bool initRunning = false;
+    // The value returned by the last initialization action:
+    bool actionResult = false;
+    // Whether the initialization action was asked to stop:
+    bool cancelRequested = false;
+    // The ID of the thread running the initialization action, if any:
     pthread_t initThreadID = 0;
+    // Completes the initialization result handle:
+    std::promise<bool> initPromise;
+    // The handle returned by getInitResult():
+    std::shared_future<bool> initResult;
 };
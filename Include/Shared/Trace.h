@@ -0,0 +1,171 @@
+/**
+ * @file  Trace.h
+ *
+ * @brief  Provides tracepoint macros that are removed unless DF_TRACE_ENABLED
+ *         is set.
+ *
+ *  When DF_TRACE_ENABLED is set, each tracepoint writes a fixed-size record
+ * into a ring buffer owned by the calling thread. Writing a record takes no
+ * locks and makes no system calls, so tracepoints may stay enabled in
+ * production builds. Once a thread's buffer is full, its oldest records are
+ * replaced.
+ *
+ *  Trace::dump() saves all buffered records as a Chrome trace event JSON file,
+ * which may be opened in Perfetto or chrome://tracing. If the envVar
+ * environment variable is set when a process records its first trace event,
+ * records are also dumped to "<envVar value>.<process ID>.json" when that
+ * process exits. The variable is read with secure_getenv, so processes
+ * launched with setuid or file capabilities never dump records on exit.
+ *
+ *  Trace names must be string literals, or other strings that remain valid
+ * until the process exits, as records only save name pointers.
+ */
+
+#pragma once
+#if defined DF_TRACE_ENABLED && DF_TRACE_ENABLED
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+
+namespace DaemonFramework
+{
+    namespace Trace
+    {
+        // Environment variable holding the path prefix used to dump trace
+        // records when the process exits:
+        static const constexpr char* envVar = "DF_TRACE_FILE";
+
+        // Number of records kept in each thread's buffer, which must be a
+        // power of two:
+        static const constexpr size_t bufferRecords = 8192;
+
+        /**
+         * @brief  Types of recorded trace events.
+         */
+        enum class EventType : uint32_t
+        {
+            // A period of time spent within a traced scope:
+            duration,
+            // A single point in time, with an associated value:
+            instant,
+            // A new value of a counter:
+            counter
+        };
+
+        /**
+         * @brief  A single recorded trace event.
+         */
+        struct Record
+        {
+            // The event name:
+            const char* name;
+            // CLOCK_MONOTONIC time in nanoseconds when the event started:
+            uint64_t startNS;
+            // Nanoseconds the event lasted, used by duration events:
+            uint64_t durationNS;
+            // The value saved with instant and counter events:
+            int64_t value;
+            // The type of event recorded:
+            EventType type;
+        };
+
+        /**
+         * @brief  Gets the current time used for all trace records.
+         *
+         * @return  The CLOCK_MONOTONIC time in nanoseconds.
+         */
+        inline uint64_t now()
+        {
+            struct timespec currentTime;
+            clock_gettime(CLOCK_MONOTONIC, &currentTime);
+            return (uint64_t) currentTime.tv_sec * 1000000000ULL
+                    + (uint64_t) currentTime.tv_nsec;
+        }
+
+        /**
+         * @brief  Adds a record to the calling thread's trace buffer.
+         *
+         * @param name        The event name.
+         *
+         * @param type        The type of event to record.
+         *
+         * @param startNS     The time when the event started.
+         *
+         * @param durationNS  Nanoseconds the event lasted.
+         *
+         * @param value       A value to save with the event.
+         */
+        void addRecord(const char* name, const EventType type,
+                const uint64_t startNS, const uint64_t durationNS = 0,
+                const int64_t value = 0);
+
+        /**
+         * @brief  Saves all buffered records from all threads as a Chrome
+         *         trace event JSON file.
+         *
+         *  Records may be dumped while other threads are adding records.
+         * Records overwritten while they were being copied are left out. Once
+         * a thread's buffer is full, its oldest record is also left out, as
+         * the thread may be replacing it.
+         * Buffers of threads that have exited are kept, so their records are
+         * included in later dumps. Records are written to a newly created
+         * temporary file next to the path, which is then renamed to replace
+         * it.
+         *
+         * @param path  The path where the trace file will be written.
+         *
+         * @return      Whether the trace file was written.
+         */
+        bool dump(const char* path);
+
+        /**
+         * @brief  Records the time spent between its construction and its
+         *         destruction as a duration event.
+         */
+        class Scope
+        {
+        public:
+            Scope(const char* name) : name(name), startNS(now()) { }
+
+            ~Scope()
+            {
+                addRecord(name, EventType::duration, startNS,
+                        now() - startNS);
+            }
+
+        private:
+            const char* name;
+            const uint64_t startNS;
+        };
+    }
+}
+
+#   define DF_TRACE_JOIN_NAME(prefix, line) prefix##line
+#   define DF_TRACE_SCOPE_NAME(line) DF_TRACE_JOIN_NAME(dfTraceScope, line)
+
+// Records time spent in the rest of the enclosing scope:
+#   define DF_TRACE(name) \
+        DaemonFramework::Trace::Scope DF_TRACE_SCOPE_NAME(__LINE__)(name)
+
+// Records a single point in time with an associated value:
+#   define DF_TRACE_EVENT(name, value) \
+        DaemonFramework::Trace::addRecord(name, \
+                DaemonFramework::Trace::EventType::instant, \
+                DaemonFramework::Trace::now(), 0, value)
+
+// Records a new value of a counter:
+#   define DF_TRACE_COUNTER(name, value) \
+        DaemonFramework::Trace::addRecord(name, \
+                DaemonFramework::Trace::EventType::counter, \
+                DaemonFramework::Trace::now(), 0, value)
+
+// Saves all buffered trace records to a file:
+#   define DF_TRACE_DUMP(path) DaemonFramework::Trace::dump(path)
+
+// Define tracing macros as empty statements when tracing is disabled:
+#else
+#   define DF_TRACE(name)
+#   define DF_TRACE_EVENT(name, value)
+#   define DF_TRACE_COUNTER(name, value)
+#   define DF_TRACE_DUMP(path)
+#endif
@@ -13,6 +13,11 @@ define HELPTEXT
 #    enable features or override default values:
 #    - DF_CONFIG       : set Debug or Release mode
 #    - DF_VERBOSE      : enable or disable verbose output
+#    - DF_LOG_ENABLED  : enable or disable release build debug output
+#    - DF_TRACE_ENABLED: enable or disable tracepoints
+#    - DF_METRICS_ENABLED: enable or disable runtime metrics
+#    - DF_STARTUP_PROFILE_ENABLED: enable or disable startup profiling
+#    - DF_PIPE_TIMESTAMPS: enable or disable pipe message timestamps
 #    - DF_OPTIMIZATION : enable or disable optimization
 #    - DF_GDB_SUPPORT  : enable or disable gdb support
 # 
@@ -53,6 +58,42 @@ define HELPTEXT
 #      execution.  If enabled, DF_VERBOSE will be defined in the C preprocessor,
 #      and the DF_DBG_V macro function will print to stdout.
 #
+#   DF_LOG_ENABLED: (default: 0)
+#      If set to 1, DF_DBG and DF_PERROR output is kept in release builds.
+#      Debug builds always keep it. Output is written by a background thread,
+#      and the DF_LOG_LEVEL environment variable may be set to "off", "error",
+#      "debug", or "verbose" to choose which messages are written.
+#
+#   DF_TRACE_ENABLED: (default: 0)
+#      If set to 1, DF_TRACE tracepoints will record events into per-thread
+#      ring buffers. If the DF_TRACE_FILE environment variable is set, each
+#      process writes its events to "$DF_TRACE_FILE.<pid>.json" on exit, in a
+#      format that Perfetto and chrome://tracing can open. If set to 0,
+#      tracepoints are compiled out entirely.
+#
+#   DF_METRICS_ENABLED: (default: 0)
+#      If set to 1, framework counters, gauges, and histograms are kept and
+#      may be read in the Prometheus text format. If the DF_METRICS_SOCKET
+#      environment variable is set, each process serves its metrics on the
+#      Unix socket "$DF_METRICS_SOCKET.<program name>". If DF_METRICS_FILE is
+#      set, each process saves its metrics to
+#      "$DF_METRICS_FILE.<program name>.prom" every few seconds. If set to 0,
+#      metrics are compiled out entirely.
+#
+#   DF_STARTUP_PROFILE_ENABLED: (default: 0)
+#      If set to 1, the parent and daemon record when each startup phase
+#      finishes. If the DF_STARTUP_PROFILE environment variable is set, records
+#      are appended to the file at that path. Daemons only write their records
+#      after their security checks pass, and never profile when launched with
+#      setuid or file capabilities. If set to 0, profiling is compiled out
+#      entirely.
+#
+#   DF_PIPE_TIMESTAMPS: (default: 0)
+#      If set to 1, each message sent between daemon and parent through pipes
+#      starts with a CLOCK_MONOTONIC timestamp, and each pipe reader records
+#      the one-way latency of every message it receives. The daemon and parent
+#      must both be built with the same value.
+#
 #   DF_CPP_VERSION:
 #      Sets the version of C++ used to compile the daemon parent files. Versions
 #      before C++14 are untested and not recommended.
@@ -8,6 +8,21 @@ DF_CONFIG?=Release
 DF_VERBOSE?=0
 V_AT:=$(shell if [ $(DF_VERBOSE) != 1 ]; then echo '@'; fi)
 
+# enable or disable debug output in release builds:
+DF_LOG_ENABLED?=0
+
+# enable or disable tracepoints:
+DF_TRACE_ENABLED?=0
+
+# enable or disable runtime metrics:
+DF_METRICS_ENABLED?=0
+
+# enable or disable startup profiling:
+DF_STARTUP_PROFILE_ENABLED?=0
+
+# enable or disable timestamps on daemon pipe messages:
+DF_PIPE_TIMESTAMPS?=0
+
 # Select specific build architectures:
 DF_TARGET_ARCH?=-march=native
 
@@ -62,7 +77,11 @@ addStringDef=$(shell if [ ! -z $($(1)) ] && [ $($(1)) != 0 ]; then \
 # directories and their subdirectories.
 recursiveInclude=$(shell find $(1) -type d -printf ' "-I%p"')
 
-DF_DEFINE_FLAGS:=$(call addDef,DF_VERBOSE)
+DF_DEFINE_FLAGS:=$(call addDef,DF_VERBOSE) $(call addDef,DF_LOG_ENABLED) \
+                 $(call addDef,DF_TRACE_ENABLED) \
+                 $(call addDef,DF_METRICS_ENABLED) \
+                 $(call addDef,DF_STARTUP_PROFILE_ENABLED) \
+                 $(call addDef,DF_PIPE_TIMESTAMPS)
 
 DF_INCLUDE_FLAGS :=$(call recursiveInclude,$(DF_ROOT_DIR)/Include/Shared)
 
@@ -0,0 +1,608 @@
+#include "Digest_SHA256.h"
+#include "File_Identity.h"
+#include "Debug.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define DF_SHA256_X86 1
+#   include <cpuid.h>
+#   include <immintrin.h>
+#endif
+
+#ifdef DF_LOGGING
+// Print the application and namespace name before all info/error messages:
+static const constexpr char* messagePrefix = "DaemonFramework::Digest::";
+#endif
+
+// Size in bytes of each block of data processed by SHA-256:
+static const constexpr size_t blockSize = 64;
+
+// SHA-256 round constants:
+alignas(16) static const uint32_t roundConstants[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// SHA-256 initial hash state:
+static const uint32_t initialState[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Processes a series of complete 64-byte blocks, updating the hash state:
+typedef void (*BlockFunction)
+(uint32_t state[8], const unsigned char* data, size_t blockCount);
+
+
+// Rotates a 32-bit value right by a number of bits:
+static inline uint32_t rotateRight(const uint32_t value, const int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+
+/**
+ * @brief  Processes SHA-256 blocks without using any processor extensions.
+ *
+ * @param state       The current hash state.
+ *
+ * @param data        The start of the data to process.
+ *
+ * @param blockCount  The number of 64-byte blocks to process.
+ */
+static void processBlocksPortable
+(uint32_t state[8], const unsigned char* data, size_t blockCount)
+{
+    uint32_t schedule[64];
+    for (; blockCount > 0; blockCount--, data += blockSize)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            schedule[i] = ((uint32_t) data[i * 4] << 24)
+                    | ((uint32_t) data[i * 4 + 1] << 16)
+                    | ((uint32_t) data[i * 4 + 2] << 8)
+                    | ((uint32_t) data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            const uint32_t s0 = rotateRight(schedule[i - 15], 7)
+                    ^ rotateRight(schedule[i - 15], 18)
+                    ^ (schedule[i - 15] >> 3);
+            const uint32_t s1 = rotateRight(schedule[i - 2], 17)
+                    ^ rotateRight(schedule[i - 2], 19)
+                    ^ (schedule[i - 2] >> 10);
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+                e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++)
+        {
+            const uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11)
+                    ^ rotateRight(e, 25);
+            const uint32_t choice = (e & f) ^ (~e & g);
+            const uint32_t temp1 = h + s1 + choice + roundConstants[i]
+                    + schedule[i];
+            const uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13)
+                    ^ rotateRight(a, 22);
+            const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            const uint32_t temp2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+
+#ifdef DF_SHA256_X86
+/**
+ * @brief  Processes SHA-256 blocks using the x86 SHA extensions.
+ *
+ * @param state       The current hash state.
+ *
+ * @param data        The start of the data to process.
+ *
+ * @param blockCount  The number of 64-byte blocks to process.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void processBlocksSHANI
+(uint32_t state[8], const unsigned char* data, size_t blockCount)
+{
+    // Reverses the byte order of each 32-bit word:
+    const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+            0x0405060700010203ULL);
+
+    // Rearrange the state into the ABEF/CDGH order used by sha256rnds2:
+    __m128i temp = _mm_loadu_si128((const __m128i*) &state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i*) &state[4]);
+    temp = _mm_shuffle_epi32(temp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(temp, state1, 8);
+    state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+    for (; blockCount > 0; blockCount--, data += blockSize)
+    {
+        const __m128i savedState0 = state0;
+        const __m128i savedState1 = state1;
+        // The last four message schedule vectors:
+        __m128i messages[4];
+        for (int group = 0; group < 16; group++)
+        {
+            __m128i message;
+            if (group < 4)
+            {
+                message = _mm_shuffle_epi8(_mm_loadu_si128(
+                        (const __m128i*) (data + group * 16)), byteSwapMask);
+            }
+            else
+            {
+                const __m128i& oldest = messages[group % 4];
+                const __m128i& older  = messages[(group + 1) % 4];
+                const __m128i& newer  = messages[(group + 2) % 4];
+                const __m128i& newest = messages[(group + 3) % 4];
+                message = _mm_sha256msg1_epu32(oldest, older);
+                message = _mm_add_epi32(message,
+                        _mm_alignr_epi8(newest, newer, 4));
+                message = _mm_sha256msg2_epu32(message, newest);
+            }
+            messages[group % 4] = message;
+            __m128i roundInput = _mm_add_epi32(message, _mm_load_si128(
+                    (const __m128i*) &roundConstants[group * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, roundInput);
+            roundInput = _mm_shuffle_epi32(roundInput, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, roundInput);
+        }
+        state0 = _mm_add_epi32(state0, savedState0);
+        state1 = _mm_add_epi32(state1, savedState1);
+    }
+
+    // Restore the standard state order:
+    temp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(temp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, temp, 8);
+    _mm_storeu_si128((__m128i*) &state[0], state0);
+    _mm_storeu_si128((__m128i*) &state[4], state1);
+}
+
+
+/**
+ * @brief  Checks if the processor supports all extensions used by
+ *         processBlocksSHANI.
+ *
+ * @return  Whether the SHA, SSE4.1, and SSSE3 extensions are all available.
+ */
+static bool shaExtensionsSupported()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (! __get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    const bool hasSSSE3 = (ecx & bit_SSSE3) != 0;
+    const bool hasSSE41 = (ecx & bit_SSE4_1) != 0;
+    if (! __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    const bool hasSHA = (ebx & bit_SHA) != 0;
+    return hasSSSE3 && hasSSE41 && hasSHA;
+}
+#endif
+
+
+/**
+ * @brief  Selects the fastest block processing function supported by the
+ *         processor.
+ *
+ * @return  The selected block processing function.
+ */
+static BlockFunction selectBlockFunction()
+{
+#   ifdef DF_SHA256_X86
+    if (shaExtensionsSupported())
+    {
+        DF_DBG_V(messagePrefix << __func__
+                << ": Using x86 SHA extensions for SHA-256.");
+        return processBlocksSHANI;
+    }
+#   endif
+    DF_DBG_V(messagePrefix << __func__ << ": Using portable SHA-256.");
+    return processBlocksPortable;
+}
+
+
+/**
+ * @brief  Calculates the SHA-256 digest of a block of memory using a specific
+ *         block processing function.
+ *
+ * @param processBlocks  The function used to process each complete block.
+ *
+ * @param data           A pointer to at least size bytes of data.
+ *
+ * @param size           The number of bytes to hash.
+ *
+ * @return               The SHA-256 digest of the data.
+ */
+static DaemonFramework::Digest::SHA256Value digestData
+(const BlockFunction processBlocks, const unsigned char* data,
+        const size_t size)
+{
+    uint32_t state[8];
+    std::memcpy(state, initialState, sizeof(state));
+
+    const size_t fullBlocks = size / blockSize;
+    if (fullBlocks > 0)
+    {
+        processBlocks(state, data, fullBlocks);
+    }
+
+    // Copy remaining data, then append padding and the message bit length:
+    unsigned char finalBlocks[blockSize * 2] = {0};
+    const size_t remainder = size % blockSize;
+    if (remainder > 0)
+    {
+        std::memcpy(finalBlocks, data + fullBlocks * blockSize, remainder);
+    }
+    finalBlocks[remainder] = 0x80;
+    const size_t finalBlockCount = (remainder + 9 > blockSize) ? 2 : 1;
+    const uint64_t bitLength = (uint64_t) size * 8;
+    unsigned char* lengthBytes = finalBlocks + finalBlockCount * blockSize - 8;
+    for (int i = 0; i < 8; i++)
+    {
+        lengthBytes[i] = (unsigned char) (bitLength >> (56 - i * 8));
+    }
+    processBlocks(state, finalBlocks, finalBlockCount);
+
+    DaemonFramework::Digest::SHA256Value digest;
+    for (int i = 0; i < 8; i++)
+    {
+        digest[i * 4]     = (unsigned char) (state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char) (state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char) (state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char) state[i];
+    }
+    return digest;
+}
+
+
+// Calculates the SHA-256 digest of a block of memory.
+DaemonFramework::Digest::SHA256Value DaemonFramework::Digest::sha256
+(const unsigned char* data, const size_t size)
+{
+    static const BlockFunction processBlocks = selectBlockFunction();
+    return digestData(processBlocks, data, size);
+}
+
+
+// Calculates the SHA-256 digest of a block of memory without using any
+// processor extensions.
+DaemonFramework::Digest::SHA256Value DaemonFramework::Digest::portableSHA256
+(const unsigned char* data, const size_t size)
+{
+    return digestData(processBlocksPortable, data, size);
+}
+
+
+// Marks the start of each digest cache file, and its format version:
+static const constexpr char* cacheFileTag = "DFSHA256";
+
+/**
+ * @brief  Holds a cached file digest, along with the file status data that
+ *         must still match for the digest to be reused.
+ *
+ *  The status change time is recorded along with the file identity, because
+ * unlike the modification time, unprivileged users can't set it to an earlier
+ * value after changing a file.
+ */
+struct CacheRecord
+{
+    char tag[8];
+    uint64_t device;
+    uint64_t inode;
+    int64_t size;
+    int64_t modSeconds;
+    int64_t modNanoseconds;
+    int64_t changeSeconds;
+    int64_t changeNanoseconds;
+    unsigned char digest[DaemonFramework::Digest::sha256Size];
+};
+
+// Number of bytes at the start of each CacheRecord that describe the file:
+static const constexpr size_t cacheRecordFileSize
+        = offsetof(CacheRecord, digest);
+
+
+/**
+ * @brief  Creates a digest cache record for a file.
+ *
+ * @param fileStats  Status data read from the file.
+ *
+ * @param digest     The file's digest.
+ *
+ * @return           The new cache record.
+ */
+static CacheRecord createCacheRecord
+(const struct stat& fileStats,
+        const DaemonFramework::Digest::SHA256Value& digest)
+{
+    CacheRecord record;
+    std::memset(&record, 0, sizeof(record));
+    std::memcpy(record.tag, cacheFileTag, sizeof(record.tag));
+    record.device = fileStats.st_dev;
+    record.inode = fileStats.st_ino;
+    record.size = fileStats.st_size;
+    record.modSeconds = fileStats.st_mtim.tv_sec;
+    record.modNanoseconds = fileStats.st_mtim.tv_nsec;
+    record.changeSeconds = fileStats.st_ctim.tv_sec;
+    record.changeNanoseconds = fileStats.st_ctim.tv_nsec;
+    std::memcpy(record.digest, digest.data(), sizeof(record.digest));
+    return record;
+}
+
+
+/**
+ * @brief  Reads a file's digest from a digest cache file.
+ *
+ *  The cache file is only trusted if it is a regular file with a single link,
+ * owned by root, and not writable by any other user or group.
+ *
+ * @param cachePath  The path of the digest cache file.
+ *
+ * @param fileStats  Status data read from the hashed file.
+ *
+ * @param digest     The object where the cached digest will be saved.
+ *
+ * @return           Whether a trusted digest was found for the file.
+ */
+static bool readCachedDigest
+(const char* cachePath, const struct stat& fileStats,
+        DaemonFramework::Digest::SHA256Value& digest)
+{
+    int cacheFile = -1;
+    do
+    {
+        errno = 0;
+        cacheFile = open(cachePath, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    while (cacheFile == -1 && errno == EINTR);
+    if (cacheFile == -1)
+    {
+        return false;
+    }
+    struct stat cacheStats;
+    if (fstat(cacheFile, &cacheStats) == -1 || ! S_ISREG(cacheStats.st_mode)
+            || cacheStats.st_nlink != 1 || cacheStats.st_uid != 0
+            || (cacheStats.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Ignoring digest cache \""
+                << cachePath << "\", as it isn't only writable by root.");
+        close(cacheFile);
+        return false;
+    }
+    CacheRecord cached;
+    ssize_t bytesRead;
+    do
+    {
+        errno = 0;
+        bytesRead = pread(cacheFile, &cached, sizeof(cached), 0);
+    }
+    while (bytesRead == -1 && errno == EINTR);
+    close(cacheFile);
+    const CacheRecord current = createCacheRecord(fileStats,
+            DaemonFramework::Digest::SHA256Value());
+    if (bytesRead != (ssize_t) sizeof(cached)
+            || std::memcmp(&cached, &current, cacheRecordFileSize) != 0)
+    {
+        return false;
+    }
+    std::memcpy(digest.data(), cached.digest, sizeof(cached.digest));
+    return true;
+}
+
+
+/**
+ * @brief  Saves a file's digest to a digest cache file, replacing any earlier
+ *         cached digest.
+ *
+ *  Digests are only saved when running as root, as cache files owned by any
+ * other user are never trusted.
+ *
+ * @param cachePath  The path of the digest cache file.
+ *
+ * @param fileStats  Status data read from the hashed file.
+ *
+ * @param digest     The file's digest.
+ */
+static void saveCachedDigest
+(const char* cachePath, const struct stat& fileStats,
+        const DaemonFramework::Digest::SHA256Value& digest)
+{
+    if (geteuid() != 0)
+    {
+        return;
+    }
+    const std::string tempPath = std::string(cachePath) + "."
+            + std::to_string(getpid());
+    int tempFile = -1;
+    do
+    {
+        errno = 0;
+        tempFile = open(tempPath.c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                S_IRUSR | S_IWUSR);
+    }
+    while (tempFile == -1 && errno == EINTR);
+    if (tempFile == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Unable to create \""
+                << tempPath << "\".");
+        DF_PERROR(messagePrefix);
+        return;
+    }
+    const CacheRecord record = createCacheRecord(fileStats, digest);
+    ssize_t bytesWritten;
+    do
+    {
+        errno = 0;
+        bytesWritten = write(tempFile, &record, sizeof(record));
+    }
+    while (bytesWritten == -1 && errno == EINTR);
+    close(tempFile);
+    if (bytesWritten != (ssize_t) sizeof(record)
+            || rename(tempPath.c_str(), cachePath) == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Unable to save digest cache \""
+                << cachePath << "\".");
+        DF_PERROR(messagePrefix);
+        unlink(tempPath.c_str());
+    }
+}
+
+
+// Calculates the SHA-256 digest of an open file's contents.
+bool DaemonFramework::Digest::fileSHA256
+(const int fileDescriptor, SHA256Value& digest, const char* cachePath)
+{
+    struct stat fileStats;
+    errno = 0;
+    if (fstat(fileDescriptor, &fileStats) == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Unable to read file data.");
+        DF_PERROR(messagePrefix);
+        return false;
+    }
+    if (! S_ISREG(fileStats.st_mode))
+    {
+        DF_DBG(messagePrefix << __func__ << ": File is not a regular file.");
+        return false;
+    }
+    if (cachePath != nullptr && readCachedDigest(cachePath, fileStats, digest))
+    {
+        DF_DBG_V(messagePrefix << __func__ << ": Using cached digest.");
+        return true;
+    }
+    const File::Identity identity(fileStats);
+
+    const size_t fileSize = (size_t) fileStats.st_size;
+    SHA256Value fileDigest;
+    if (fileSize == 0)
+    {
+        fileDigest = sha256(nullptr, 0);
+    }
+    else
+    {
+        errno = 0;
+        void* fileData = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE,
+                fileDescriptor, 0);
+        if (fileData == MAP_FAILED)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Unable to map file data.");
+            DF_PERROR(messagePrefix);
+            return false;
+        }
+        madvise(fileData, fileSize, MADV_SEQUENTIAL);
+        fileDigest = sha256((const unsigned char*) fileData, fileSize);
+        munmap(fileData, fileSize);
+    }
+
+    // Don't trust or cache the digest if the file changed while it was read:
+    struct stat hashedStats;
+    if (fstat(fileDescriptor, &hashedStats) == -1
+            || File::Identity(hashedStats) != identity)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": File changed while it was being hashed.");
+        return false;
+    }
+    if (cachePath != nullptr)
+    {
+        const CacheRecord before = createCacheRecord(fileStats, fileDigest);
+        const CacheRecord after = createCacheRecord(hashedStats, fileDigest);
+        if (std::memcmp(&before, &after, cacheRecordFileSize) == 0)
+        {
+            saveCachedDigest(cachePath, hashedStats, fileDigest);
+        }
+    }
+    digest = fileDigest;
+    return true;
+}
+
+
+// Reads a SHA-256 digest from a hexadecimal string.
+bool DaemonFramework::Digest::parseSHA256
+(const char* hexString, SHA256Value& digest)
+{
+    if (hexString == nullptr || std::strlen(hexString) != sha256Size * 2)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < sha256Size * 2; i++)
+    {
+        const char hexChar = hexString[i];
+        unsigned char value;
+        if (hexChar >= '0' && hexChar <= '9')
+        {
+            value = hexChar - '0';
+        }
+        else if (hexChar >= 'a' && hexChar <= 'f')
+        {
+            value = hexChar - 'a' + 10;
+        }
+        else if (hexChar >= 'A' && hexChar <= 'F')
+        {
+            value = hexChar - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        if ((i % 2) == 0)
+        {
+            digest[i / 2] = value << 4;
+        }
+        else
+        {
+            digest[i / 2] |= value;
+        }
+    }
+    return true;
+}
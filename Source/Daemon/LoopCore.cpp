@@ -0,0 +1,349 @@
+#include "LoopCore.h"
+#include "ReadySignal.h"
+#include "OnDemand.h"
+#include "File_Utils.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Debug.h"
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef DF_LOGGING
+// Print the application and class name before all info/error messages:
+static const constexpr char* messagePrefix = "DaemonFramework::DaemonLoop::";
+#endif
+
+DF_METRIC_COUNTER(loopActions, "df_daemon_loop_actions_total",
+        "Calls to the daemon's loop action.");
+DF_METRIC_COUNTER(parentMessages, "df_daemon_parent_messages_total",
+        "Messages received from the parent process.");
+DF_METRIC_COUNTER(parentMessageBytes, "df_daemon_parent_message_bytes_total",
+        "Bytes received from the parent process.");
+
+
+std::atomic_int DaemonFramework::LoopCore::termSignal(-1);
+
+// Event file used to wake loopAction() calls waiting in waitForEvents(), or -1
+// if not yet created. This is static so that the signal handler can use it:
+static std::atomic_int loopWakeFD(-1);
+
+// Stores whether a LoopCore currently exists:
+static std::atomic_bool coreExists(false);
+
+
+// Wakes any loopAction() call waiting in waitForEvents().
+void DaemonFramework::LoopCore::wakeLoop()
+{
+    const int wakeFD = loopWakeFD;
+    if (wakeFD != -1)
+    {
+        const uint64_t wakeCount = 1;
+        const int savedErrno = errno;
+        if (write(wakeFD, &wakeCount, sizeof(wakeCount)) == -1) { }
+        errno = savedErrno;
+    }
+}
+
+
+// Sets termSignal when a termination signal is caught:
+void DaemonFramework::LoopCore::flagTermSignal(int signum)
+{
+    DF_ASSERT(signum == SIGTERM);
+    DF_DBG(messagePrefix << __func__ << ": Received SIGTERM");
+    termSignal = 1;
+    wakeLoop();
+}
+
+
+// Subscribes to termination signals, and creates the event used to wake
+// waiting loop actions.
+DaemonFramework::LoopCore::LoopCore() : loopRunning(false)
+{
+    StartupProfile::recordLaunchTimes();
+    // Verify that only one loop exists:
+    if (coreExists.exchange(true))
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Created more than one DaemonLoop!");
+        DF_ASSERT(false);
+    }
+
+    loopWakeFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (loopWakeFD == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to create wake event:");
+        DF_PERROR(messagePrefix);
+    }
+
+    // Set up handler for SIGTERM signals the first time a loop is created:
+    if (termSignal.exchange(0) == -1)
+    {
+        struct sigaction action = {};
+        action.sa_handler = flagTermSignal;
+        sigaction(SIGTERM, &action, NULL);
+    }
+}
+
+
+// Releases the lock file if held, and closes the wake event.
+DaemonFramework::LoopCore::~LoopCore()
+{
+    const int wakeFD = loopWakeFD.exchange(-1);
+    if (wakeFD != -1)
+    {
+        close(wakeFD);
+    }
+    if (lockFD != 0)
+    {
+        DF_DBG_V(messagePrefix << __func__ << ": Unlocking lock file:");
+        errno = 0;
+        if (flock(lockFD, LOCK_UN | LOCK_NB) == -1)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Error unlocking lock file:");
+            DF_PERROR(messagePrefix);
+        }
+        DF_DBG_V(messagePrefix << __func__ << ": Closing lock file:");
+        while (close(lockFD) == -1)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Error closing lock file:");
+            DF_PERROR(messagePrefix);
+            if (errno != EINTR)
+            {
+                break;
+            }
+        }
+        lockFD = 0;
+        DF_DBG_V(messagePrefix << __func__ << ": DaemonLoop destroyed.");
+    }
+    coreExists = false;
+}
+
+
+// Checks if runLoop() has been called already, and the loop is currently
+// running.
+bool DaemonFramework::LoopCore::isLoopRunning() const
+{
+    return loopRunning;
+}
+
+
+// Waits until a parent message is handled, a termination signal is received,
+// or the timeout period ends.
+bool DaemonFramework::LoopCore::waitForEvents(const int timeoutMS)
+{
+    DF_TRACE("DaemonLoop::waitForEvents");
+    struct pollfd wakeFile = {};
+    wakeFile.fd = loopWakeFD;
+    wakeFile.events = POLLIN;
+    if (wakeFile.fd == -1)
+    {
+        poll(nullptr, 0, timeoutMS);
+        return false;
+    }
+    if (poll(&wakeFile, 1, timeoutMS) <= 0)
+    {
+        return false;
+    }
+    uint64_t wakeCount;
+    if (read(wakeFile.fd, &wakeCount, sizeof(wakeCount)) == -1)
+    {
+        return false;
+    }
+    return true;
+}
+
+
+// Marks the loop as running.
+bool DaemonFramework::LoopCore::startLoop()
+{
+    return ! loopRunning.exchange(true);
+}
+
+
+// Marks the loop as stopped after it ends early.
+int DaemonFramework::LoopCore::exitLoop
+(const ExitCode exitCode, const char* reason)
+{
+    DF_DBG(messagePrefix << "runLoop: Exiting, " << reason);
+    loopRunning = false;
+    return static_cast<int>(exitCode);
+}
+
+
+// Marks the loop as stopped after loopAction() or initLoop() returned a
+// nonzero value.
+int DaemonFramework::LoopCore::exitLoop(const int resultCode)
+{
+    DF_DBG(messagePrefix << "runLoop: Exiting loop with code " << resultCode);
+    loopRunning = false;
+    return resultCode;
+}
+
+
+// Checks if the parent launched the daemon on demand, clearing the
+// environment variable the parent used to mark it.
+bool DaemonFramework::LoopCore::launchedOnDemand()
+{
+    if (getenv(OnDemand::envVar) == nullptr)
+    {
+        return false;
+    }
+    unsetenv(OnDemand::envVar);
+    return true;
+}
+
+
+// Opens and locks the lock file used to ensure only one daemon instance runs,
+// creating its directory if needed.
+bool DaemonFramework::LoopCore::lockInstance(const char* lockPath)
+{
+    DF_ASSERT(lockFD == 0);
+    do
+    {
+        errno = 0;
+        lockFD = open(lockPath, O_CREAT|O_RDWR|O_NONBLOCK, S_IRUSR|S_IWUSR);
+        if (lockFD != -1)
+        {
+            break; // opening file worked, no more steps required.
+        }
+        if (errno == EINTR)
+        {
+            if (termSignalReceived())
+            {
+                DF_DBG(messagePrefix << __func__
+                        << ": Lock open interrupted by SIGTERM, exiting.");
+                lockFD = 0;
+                return false;
+            }
+            DF_DBG_V(messagePrefix << __func__
+                    << ": opening lock interrupted, trying again:");
+            continue;
+        }
+        if (errno == ENOENT)
+        {
+            // One or more of the lock's parent directories may need to be
+            // created, try and do that.
+            const std::string lockDirPath
+                    = File::Utils::parentDir(std::string(lockPath));
+            if (lockDirPath.empty())
+            {
+                DF_DBG(messagePrefix << __func__
+                        << ": Unable to open lock, lock path \""  << lockPath
+                        << "\" is probably invalid.");
+                DF_ASSERT(false);
+                lockFD = 0;
+                return false;
+            }
+            if (File::Utils::createDir(lockDirPath))
+            {
+                DF_DBG_V(messagePrefix << __func__ << ": lock directory \""
+                        << lockDirPath << "\" created, trying again:");
+                continue;
+            }
+            DF_DBG(messagePrefix << __func__
+                    << ": Failed to create lock directory \"" << lockDirPath
+                    << "\", exiting.");
+            lockFD = 0;
+            return false;
+        }
+        DF_DBG(messagePrefix << __func__
+                << ": Exiting, unable to open lock file:")
+        DF_PERROR("DaemonLoop: Lock opening error");
+        lockFD = 0;
+        return false;
+    }
+    while (lockFD == -1);
+    StartupProfile::record("lock file opened");
+
+    const int lockResult = flock(lockFD, LOCK_EX|LOCK_NB);
+    if (lockResult == -1)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Exiting, lock file \"" << lockPath
+                << "\" is already locked:")
+        DF_PERROR("DaemonLoop: Locking error");
+        while(close(lockFD) == -1)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Error closing lock file:");
+            DF_PERROR("DaemonLoop: Lock closing error");
+            if (errno != EINTR)
+            {
+                break;
+            }
+        }
+        lockFD = 0;
+        return false;
+    }
+    StartupProfile::record("lock acquired");
+    return true;
+}
+
+
+// Tells the parent process that the daemon is ready to handle requests, if the
+// parent provided a readiness pipe.
+void DaemonFramework::LoopCore::signalReady()
+{
+    using namespace ReadySignal;
+    const char* readyVar = getenv(envVar);
+    if (readyVar == nullptr)
+    {
+        return;
+    }
+    const bool expectedFD = (strtol(readyVar, nullptr, 10) == fileDescriptor);
+    unsetenv(envVar);
+    struct stat readyStat;
+    if (! expectedFD || fstat(fileDescriptor, &readyStat) == -1
+            || ! S_ISFIFO(readyStat.st_mode))
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Ignoring invalid readiness pipe.");
+        return;
+    }
+    // Readiness means security checks and initLoop() succeeded. The input
+    // pipe reader was started on construction, and opens its end without
+    // waiting for a writer, so it may still be opening. The parent's writer
+    // waits for that before sending, so no message sent after this is lost.
+    DF_DBG_V(messagePrefix << __func__ << ": Signalling that the daemon is "
+            << "ready.");
+    ssize_t writeSize;
+    do
+    {
+        errno = 0;
+        writeSize = write(fileDescriptor, &readyByte, 1);
+    }
+    while (writeSize == -1 && errno == EINTR);
+    if (writeSize != 1)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Failed to write readiness signal:");
+        DF_PERROR(messagePrefix);
+    }
+    else
+    {
+        StartupProfile::record("ready signal sent");
+    }
+    close(fileDescriptor);
+}
+
+
+// Counts a loopAction() call in framework metrics.
+void DaemonFramework::LoopCore::countLoopAction()
+{
+    DF_METRIC_ADD(loopActions, 1);
+}
+
+
+// Counts a received parent message in framework metrics.
+void DaemonFramework::LoopCore::countParentMessage(const size_t size)
+{
+    DF_METRIC_ADD(parentMessages, 1);
+    DF_METRIC_ADD(parentMessageBytes, size);
+}
@@ -1,32 +1,62 @@
 #include "Process_Data.h"
 #include "Process_State.h"
 #include "../Debug.h"
+#include "Trace.h"
+#include "Scratch.h"
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
+#include <errno.h>
 #include <algorithm>
-#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <cassert>
 
+#ifdef DF_LOGGING
+// Print the namespace name before all info/error messages:
+static const constexpr char* messagePrefix = "DaemonFramework::Process::";
+#endif
+
 // Indices of process data members within the process stat file:
 static const constexpr int idIndex        = 0;
 static const constexpr int stateIndex     = 2;
 static const constexpr int parentIdIndex  = 3;
 static const constexpr int startTimeIndex = 21;
 
-// Process stat file name before the pid directory:
-static const std::string pathPre = "/proc/";
-// Process stat file name after the pid directory:
-static const std::string pathPost = "/stat";
+// Size of buffers holding paths within a /proc/<pid> directory:
+static const constexpr size_t procPathSize = 64;
+
+
+// Reads the executable path from the link within a process directory,
+// returning the path length, or -1 if the link couldn't be read.
+static ssize_t readExecutablePath(const int processId, char (&path)[PATH_MAX])
+{
+    char linkPath[procPathSize];
+    snprintf(linkPath, sizeof(linkPath), "/proc/%d/exe", processId);
+    const ssize_t length = readlink(linkPath, path, sizeof(path) - 1);
+    path[(length == -1) ? 0 : length] = '\0';
+    return length;
+}
 
 
 // Reads process data from the system.
-DaemonFramework::Process::Data::Data(const int processId) :
-Data(pathPre + std::to_string(processId) + pathPost)
+DaemonFramework::Process::Data::Data(const int processId)
 {
+    if (! readStatFile(processId))
+    {
+        lastState = State::invalid;
+        return;
+    }
     // The parsed ID should always match the constructor ID if valid:
-    DF_ASSERT(!isValid() || this->processId == processId);
+    DF_ASSERT(this->processId == processId);
+    char path[PATH_MAX];
+    if (readExecutablePath(processId, path) != -1)
+    {
+        executablePath = path;
+    }
 }
 
 
@@ -46,46 +76,60 @@ public:
 } processComparator;
 
 
-// Gets data for all direct child processes of the process this Data object
-// represents.
-std::vector<DaemonFramework::Process::Data>
-DaemonFramework::Process::Data::getChildProcesses()
+// Gets the list of all process IDs.
+std::vector<int> DaemonFramework::Process::getAllPIDs()
 {
-    using std::vector;
-    using std::string;
-    string processPath("/proc");
-    DIR* processDir = opendir(processPath.c_str());
-    struct dirent* dirEntry;
-    vector<string> childDirs;
-    while ((dirEntry = readdir(processDir)) != nullptr)
+    DF_TRACE("Process::getAllPIDs");
+    std::vector<int> pIDs;
+    DIR* procDir = nullptr;
+    struct dirent* dirEntry = nullptr;
+    errno = 0;
+    if ((procDir = opendir("/proc")) != nullptr)
     {
-        if (dirEntry->d_type == DT_DIR)
+        while ((dirEntry = readdir(procDir)) != nullptr)
+        {
+            if (dirEntry->d_type != DT_DIR)
+            {
+                continue;
+            }
+            std::string dirName(dirEntry->d_name);
+            if (dirName.find_first_not_of("0123456789") == std::string::npos
+                    && dirName.size() > 0)
+            {
+                pIDs.push_back(std::stoi(dirName));
+            }
+        }
+        if (errno != 0)
         {
-            childDirs.push_back(dirEntry->d_name);
+            DF_DBG(messagePrefix << __func__ << ": Error scanning /proc:");
+            DF_PERROR(messagePrefix);
         }
+        closedir(procDir);
     }
-    closedir(processDir);
-    processDir = nullptr;
+    else
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to scan /proc.");
+        DF_PERROR(messagePrefix);
+    }
+    DF_DBG_V(messagePrefix << __func__ << ": Found " << pIDs.size()
+            << " process IDs.");
+    return pIDs;
+}
 
-    vector<Data> childProcs;
-    for (const string& dir : childDirs)
+
+// Gets data for all direct child processes of the process this Data object
+// represents.
+std::vector<DaemonFramework::Process::Data>
+DaemonFramework::Process::Data::getChildProcesses()
+{
+    DF_TRACE("Process::Data::getChildProcesses");
+    std::vector<Data> childProcs;
+    for (const int childID : getAllPIDs())
     {
-        int childID;
-        try
-        {
-            childID = std::stoi(dir.substr(processPath.size() + 1));
-        }
-        catch (const std::invalid_argument e)
+        Data processData(childID);
+        if (processData.parentId == processId)
         {
-            childID = 0;
-        }
-        if (childID > 0)
-        {
-            Data processData(childID);
-            if (processData.parentId == processId)
-            {
-                childProcs.push_back(processData);
-            }
+            childProcs.push_back(processData);
         }
     }
     std::sort(childProcs.begin(), childProcs.end(), processComparator);
@@ -97,12 +141,12 @@ DaemonFramework::Process::Data::getChildProcesses()
 // process is using its saved process ID.
 void DaemonFramework::Process::Data::update()
 {
-    Data updatedData(processId);
-    if (updatedData.executablePath == executablePath)
-    {
-        *this = updatedData;
-    }
-    else
+    DF_TRACE("Process::Data::update");
+    // Compare the executable path in place, so unchanged processes are
+    // updated without copying it:
+    char path[PATH_MAX];
+    readExecutablePath(processId, path);
+    if (executablePath != path || ! readStatFile(processId))
     {
         *this = Data();
     }
@@ -152,69 +196,74 @@ unsigned long DaemonFramework::Process::Data::getStartTime() const
 }
 
 
-// Create process data directly from the process stat file object.
-DaemonFramework::Process::Data::Data(const std::string statFile)
+// Reads process data from a process stat file.
+bool DaemonFramework::Process::Data::readStatFile(const int processId)
 {
-    std::ifstream fileStream;
-    fileStream.open(statFile);
-    if (fileStream.is_open())
+    char statPath[procPathSize];
+    snprintf(statPath, sizeof(statPath), "/proc/%d/stat", processId);
+    const int statFile = open(statPath, O_RDONLY | O_CLOEXEC);
+    if (statFile == -1)
     {
-        // Parse process info from stat file strings:
-        std::vector<std::string> statItems;
-        std::string statItem;
-        // Use to combine multiple words surrounded with parentheses:
-        std::string wordBuffer;
-        while (fileStream >> statItem)
-        {
-            if (! wordBuffer.empty())
-            {
-                wordBuffer += " ";
-                wordBuffer += statItem;
-                if (wordBuffer.back() == ')')
-                {
-                    statItems.push_back(wordBuffer);
-                    wordBuffer.clear();
-                }
-            }
-            else if (statItem.front() == '(' && statItem.back() != ')')
-            {
-                wordBuffer = statItem;
-            }
-            else
-            {
-                statItems.push_back(statItem);
-            }
-        }
-        fileStream.close();
+        return false;
+    }
+    Scratch::String statText;
+    char buffer[512];
+    ssize_t bytesRead;
+    while ((bytesRead = read(statFile, buffer, sizeof(buffer))) > 0)
+    {
+        statText.append(buffer, bytesRead);
+    }
+    close(statFile);
 
-        try
-        {
-            processId = std::stoi(statItems[idIndex]);
-            parentId = std::stoi(statItems[parentIdIndex]);
-            startTime = std::stoul(statItems[startTimeIndex]);
-        }
-        catch (const std::invalid_argument& e)
-        {
-            DF_DBG("Process parsing error: " << e.what());
-            DF_DBG("ProcessId: " << statItems[idIndex]);
-            DF_DBG("ParentId: " << statItems[parentIdIndex]);
-            DF_DBG("startTime: " << statItems[startTimeIndex]);
-        }
-        lastState = readStateChar(statItems[stateIndex][0]);
-
-        // Read executable path from the link within the process directory:
-        std::string exePath("/proc/");
-        exePath += statItems[idIndex] + "/exe";
-        char buffer[PATH_MAX];
-        ssize_t length = readlink(exePath.c_str(), buffer, sizeof(buffer) - 1);
-        if (length != -1)
-        {
-            buffer[length] = '\0';
-            executablePath = buffer;
-        }
+    // Split stat items on spaces, keeping the parenthesized executable name
+    // as one item even if it contains spaces or parentheses:
+    Scratch::Vector<Scratch::String> statItems;
+    const size_t nameStart = statText.find('(');
+    const size_t nameEnd = statText.rfind(')');
+    if (nameStart == 0 || nameStart == Scratch::String::npos
+            || nameEnd == Scratch::String::npos
+            || nameEnd < nameStart)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Invalid stat file "
+                << statPath);
+        return false;
     }
-    else
+    statItems.emplace_back(statText, 0, nameStart - 1);
+    statItems.emplace_back(statText, nameStart, nameEnd + 1 - nameStart);
+    size_t itemStart = statText.find_first_not_of(" \n", nameEnd + 1);
+    while (itemStart != Scratch::String::npos)
     {
-        lastState = State::invalid;
+        const size_t itemEnd = statText.find_first_of(" \n", itemStart);
+        statItems.emplace_back(statText, itemStart, itemEnd - itemStart);
+        itemStart = statText.find_first_not_of(" \n", itemEnd);
+    }
+    if (statItems.size() <= startTimeIndex)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Missing stat items in "
+                << statPath);
+        return false;
+    }
+
+    // Empty items would otherwise parse as zero:
+    char* parseEnd = nullptr;
+    const char* item = statItems[idIndex].c_str();
+    const int parsedId = strtol(item, &parseEnd, 10);
+    bool parsed = (parseEnd != item && *parseEnd == '\0');
+    item = statItems[parentIdIndex].c_str();
+    const int parsedParentId = strtol(item, &parseEnd, 10);
+    parsed = parsed && (parseEnd != item && *parseEnd == '\0');
+    item = statItems[startTimeIndex].c_str();
+    const unsigned long parsedStartTime = strtoul(item, &parseEnd, 10);
+    parsed = parsed && (parseEnd != item && *parseEnd == '\0');
+    if (! parsed)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Process parsing error in "
+                << statPath);
+        return false;
     }
+    this->processId = parsedId;
+    parentId = parsedParentId;
+    startTime = parsedStartTime;
+    lastState = readStateChar(statItems[stateIndex][0]);
+    return true;
 }
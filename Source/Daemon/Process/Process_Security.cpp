@@ -1,59 +1,47 @@
 #include "Process_Security.h"
 #include "Process_State.h"
 #include "../Debug.h"
-#include <dirent.h>
+#include "Trace.h"
+#include "Metrics.h"
+#include "Digest_SHA256.h"
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 // Print the application and class name before all info/error messages:
 static const constexpr char* messagePrefix 
         = "DaemonFramework::Process::Security::";
 #endif
 
-/**
- * @brief  Gets the list of all process IDs.
- *
- * @return  A vector containing every process ID listed in the /proc directory.
- */
-static std::vector<int> getAllPIDs()
-{
-    std::vector<int> pIDs;
-    DIR* procDir = nullptr;
-    struct dirent* dirEntry = nullptr;
-    errno = 0;
-    if ((procDir = opendir("/proc")) != nullptr)
-    {
-        while ((dirEntry = readdir(procDir)) != nullptr)
-        {
-            if (dirEntry->d_type != DT_DIR)
-            {
-                continue;
-            }
-            std::string dirName(dirEntry->d_name);
-            if (dirName.find_first_not_of("0123456789") == std::string::npos
-                    && dirName.size() > 0)
-            {
-                pIDs.push_back(std::stoi(dirName));
-            }
-        }
-        if (errno != 0)
-        {
-            DF_DBG(messagePrefix << __func__ << ": Error scanning /proc:");
-            DF_PERROR(messagePrefix);
-        }
-        closedir(procDir);
-    }
-    else
-    {
-        DF_DBG(messagePrefix << __func__ << ": Failed to scan /proc.");
-        DF_PERROR(messagePrefix);
-    }
-    DF_DBG_V(messagePrefix << __func__ << ": Found " << pIDs.size()
-            << " process IDs.");
-    return pIDs;
-}
+// Expected values set in build configuration, or nullptr if unset:
+#if defined DF_VERIFY_PATH && DF_VERIFY_PATH && defined DF_DAEMON_PATH
+static const constexpr char* configDaemonPath = DF_DAEMON_PATH;
+#else
+static const constexpr char* configDaemonPath = nullptr;
+#endif
+#ifdef DF_REQUIRED_PARENT_PATH
+static const constexpr char* configParentPath = DF_REQUIRED_PARENT_PATH;
+#else
+static const constexpr char* configParentPath = nullptr;
+#endif
+#ifdef DF_REQUIRED_PARENT_DIGEST
+static const constexpr char* configParentDigest = DF_REQUIRED_PARENT_DIGEST;
+#else
+static const constexpr char* configParentDigest = nullptr;
+#endif
+#ifdef DF_LOCK_FILE_PATH
+static const constexpr char* configDigestCachePath
+        = DF_LOCK_FILE_PATH ".digest";
+#else
+static const constexpr char* configDigestCachePath = nullptr;
+#endif
+
+// Arguments shared by each security check's duration histogram, before the
+// check's label:
+#define CHECK_HISTOGRAM_ARGS "df_security_check_duration_seconds", \
+        "Time spent in each daemon security check.", 1000, 10, 1e-9
 
 /**
  * @brief  Given a file path, return the path to that file's directory.
@@ -76,63 +64,237 @@ static std::string getDirectoryPath(const std::string& filePath)
 }
 
 
-// Loads process data on construction.
-DaemonFramework::Process::Security::Security()
+/**
+ * @brief  Opens an O_PATH file descriptor that pins a file without granting
+ *         any access to its contents.
+ *
+ * @param path   The path to the file that should be opened.
+ *
+ * @param flags  Additional flags to pass to open().
+ *
+ * @return       The new file descriptor, or -1 if the file couldn't be opened.
+ */
+static int pinFile(const std::string& path, const int flags = 0)
+{
+    int fileDescriptor = -1;
+    do
+    {
+        errno = 0;
+        fileDescriptor = open(path.c_str(), O_PATH | O_CLOEXEC | flags);
+    }
+    while (fileDescriptor == -1 && errno == EINTR);
+    if (fileDescriptor == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to open \"" << path
+                << "\".");
+        DF_PERROR(messagePrefix);
+    }
+    return fileDescriptor;
+}
+
+
+/**
+ * @brief  Reads the identity of a pinned file.
+ *
+ * @param fileDescriptor  A file descriptor returned by pinFile().
+ *
+ * @return                The file's identity, or an invalid identity if the
+ *                        file descriptor is invalid.
+ */
+static DaemonFramework::File::Identity readIdentity(const int fileDescriptor)
+{
+    struct stat fileStats;
+    if (fileDescriptor == -1 || fstat(fileDescriptor, &fileStats) == -1)
+    {
+        return DaemonFramework::File::Identity();
+    }
+    return DaemonFramework::File::Identity(fileStats);
+}
+
+
+/**
+ * @brief  Closes a pinned file descriptor if it is open.
+ *
+ * @param fileDescriptor  A file descriptor returned by pinFile(). This will be
+ *                        set to -1 after it is closed.
+ */
+static void unpinFile(int& fileDescriptor)
 {
-    daemonProcess = Data(getpid());
+    if (fileDescriptor != -1)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+}
+
+
+// Loads process data and pins expected executable files set in build
+// configuration on construction.
+DaemonFramework::Process::Security::Security() :
+Security(configDaemonPath, configParentPath, configParentDigest,
+        configDigestCachePath) { }
+
+
+// Loads process data and pins expected executable files on construction.
+DaemonFramework::Process::Security::Security(const char* daemonPath,
+        const char* parentPath, const char* parentDigest,
+        const char* digestCachePath) :
+parentDigest(parentDigest),
+digestCachePath(digestCachePath)
+{
+    const pid_t daemonID = getpid();
+    daemonProcessDir = pinFile("/proc/" + std::to_string(daemonID),
+            O_DIRECTORY);
+    daemonProcess = Data(daemonID);
     if (daemonProcess.isValid())
     {
-        parentProcess = Data(daemonProcess.getParentId());
+        const int parentID = daemonProcess.getParentId();
+        parentProcessDir = pinFile("/proc/" + std::to_string(parentID),
+                O_DIRECTORY);
+        parentProcess = Data(parentID);
+    }
+    if (daemonPath != nullptr)
+    {
+        daemonExecutable = pinFile(daemonPath);
+        daemonIdentity = readIdentity(daemonExecutable);
+    }
+    if (parentPath != nullptr)
+    {
+        parentExecutable = pinFile(parentPath);
+        parentIdentity = readIdentity(parentExecutable);
+    }
+}
+
+
+// Closes all pinned file descriptors on destruction.
+DaemonFramework::Process::Security::~Security()
+{
+    unpinFile(daemonProcessDir);
+    unpinFile(parentProcessDir);
+    for (std::pair<const DirKey, int>& securedDir : securedDirs)
+    {
+        unpinFile(securedDir.second);
     }
+    unpinFile(daemonExecutable);
+    unpinFile(parentExecutable);
 }
 
 
-#ifdef DF_VERIFY_PATH
 // Checks if the daemon executable is running from the expected path.
 bool DaemonFramework::Process::Security::validDaemonPath()
 {
-    const std::string installPath(DF_DAEMON_PATH);
-    return processSecured(daemonProcess, installPath);
+    DF_TRACE("Process::Security::validDaemonPath");
+    DF_METRIC_HISTOGRAM(checkDurations, CHECK_HISTOGRAM_ARGS,
+            "check=\"daemon_path\"");
+    DF_METRIC_TIME(checkDurations);
+    return processSecured(daemonProcess, daemonProcessDir, daemonIdentity);
 }
-#endif
 
 
-#ifdef DF_REQUIRED_PARENT_PATH
 // Checks if the daemon was launched by an executable at the expected path.
 bool DaemonFramework::Process::Security::validParentPath()
 {
-    const std::string parentPath(DF_REQUIRED_PARENT_PATH);
-    return processSecured(parentProcess, parentPath);
+    DF_TRACE("Process::Security::validParentPath");
+    DF_METRIC_HISTOGRAM(checkDurations, CHECK_HISTOGRAM_ARGS,
+            "check=\"parent_path\"");
+    DF_METRIC_TIME(checkDurations);
+    return processSecured(parentProcess, parentProcessDir, parentIdentity);
+}
+
+
+// Checks if the daemon's parent process is running an executable with the
+// expected contents.
+bool DaemonFramework::Process::Security::validParentDigest()
+{
+    DF_TRACE("Process::Security::validParentDigest");
+    DF_METRIC_HISTOGRAM(checkDurations, CHECK_HISTOGRAM_ARGS,
+            "check=\"parent_digest\"");
+    DF_METRIC_TIME(checkDurations);
+    Digest::SHA256Value expectedDigest;
+    if (parentDigest == nullptr)
+    {
+        DF_DBG(messagePrefix << __func__ << ": No expected digest was set.");
+        return false;
+    }
+    if (! Digest::parseSHA256(parentDigest, expectedDigest))
+    {
+        DF_DBG(messagePrefix << __func__ << ": Invalid expected digest \""
+                << parentDigest << "\".");
+        return false;
+    }
+    if (! parentProcess.isValid() || parentProcessDir == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Parent process is not valid.");
+        return false;
+    }
+    int executable = -1;
+    do
+    {
+        errno = 0;
+        executable = openat(parentProcessDir, "exe", O_RDONLY | O_CLOEXEC);
+    }
+    while (executable == -1 && errno == EINTR);
+    if (executable == -1)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Unable to open parent executable.");
+        DF_PERROR(messagePrefix);
+        return false;
+    }
+    Digest::SHA256Value executableDigest;
+    const bool hashed = Digest::fileSHA256(executable, executableDigest,
+            digestCachePath);
+    close(executable);
+    if (! hashed)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Unable to hash parent executable.");
+        return false;
+    }
+    if (executableDigest != expectedDigest)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Parent executable \""
+                << parentProcess.getExecutablePath()
+                << "\" does not match the expected digest.");
+        return false;
+    }
+    return true;
 }
-#endif
 
 
-#ifdef DF_VERIFY_PATH_SECURITY
 // Checks if the daemon's directory is secure.
 bool DaemonFramework::Process::Security::daemonPathSecured()
 {
+    DF_TRACE("Process::Security::daemonPathSecured");
+    DF_METRIC_HISTOGRAM(checkDurations, CHECK_HISTOGRAM_ARGS,
+            "check=\"daemon_directory\"");
+    DF_METRIC_TIME(checkDurations);
     const std::string installPath(daemonProcess.getExecutablePath());
     const std::string installDir(getDirectoryPath(installPath));
     return directorySecured(installDir);
 }
-#endif
 
 
-#ifdef DF_VERIFY_PARENT_PATH_SECURITY
 // Checks if the parent application's directory is secure.
 bool DaemonFramework::Process::Security::parentPathSecured()
 {
+    DF_TRACE("Process::Security::parentPathSecured");
+    DF_METRIC_HISTOGRAM(checkDurations, CHECK_HISTOGRAM_ARGS,
+            "check=\"parent_directory\"");
+    DF_METRIC_TIME(checkDurations);
     const std::string parentPath(parentProcess.getExecutablePath());
     const std::string parentDir(getDirectoryPath(parentPath));
     return directorySecured(parentDir);
 }
-#endif
 
 
-#ifdef DF_REQUIRE_RUNNING_PARENT
 // Checks if this application's parent process is still running.
 bool DaemonFramework::Process::Security::parentProcessRunning()
 {
+    DF_TRACE("Process::Security::parentProcessRunning");
+    DF_METRIC_HISTOGRAM(checkDurations, CHECK_HISTOGRAM_ARGS,
+            "check=\"parent_running\"");
+    DF_METRIC_TIME(checkDurations);
     parentProcess.update();
     const State processState = parentProcess.getLastState();
     return processState != State::stopped 
@@ -140,24 +302,38 @@ bool DaemonFramework::Process::Security::parentProcessRunning()
             && processState != State::dead
             && processState != State::invalid;
 }
-#endif
 
 
-// Checks if a specific process is running from a specific expected path within
-// a secure directory.
+// Checks if a specific process is running a specific expected executable file.
 bool DaemonFramework::Process::Security::processSecured
-(const Process::Data& process, const std::string& path) const
+(const Process::Data& process, const int processDir,
+        const File::Identity& expected) const
 {
-    if (! process.isValid())
+    if (! process.isValid() || processDir == -1)
     {
         DF_DBG(messagePrefix << __func__ << ": Process is not valid.");
         return false;
     }
+    if (! expected.isValid())
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Expected executable could not be found.");
+        return false;
+    }
 
-    if (path != process.getExecutablePath())
+    struct stat executableStats;
+    errno = 0;
+    if (fstatat(processDir, "exe", &executableStats, 0) == -1)
     {
         DF_DBG(messagePrefix << __func__
-                << ": Process running from invalid executable path \""
+                << ": Unable to read process executable.");
+        DF_PERROR(messagePrefix);
+        return false;
+    }
+    if (File::Identity(executableStats) != expected)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Process running from invalid executable \""
                 << process.getExecutablePath() << "\".");
         return false;
     }
@@ -165,58 +341,153 @@ bool DaemonFramework::Process::Security::processSecured
 }
 
 
-// Checks if a given directory is secure.
+// Checks if a directory and all of its parent directories are secure.
 bool DaemonFramework::Process::Security::directorySecured
-(const std::string& dirPath) const
+(const std::string& dirPath)
 {
-    struct stat dirStats;
-    errno = 0;
-    if (lstat(dirPath.c_str(), &dirStats) == -1)
+    if (dirPath.empty() || dirPath[0] != '/')
+    {
+        DF_DBG(messagePrefix << __func__ << ": Invalid directory path \""
+                << dirPath << "\".");
+        return false;
+    }
+    // Directories already secured with all of their parents are recognized by
+    // inode, so a renamed or replaced path can't reuse an earlier result:
+    int dirFD;
+    do
+    {
+        errno = 0;
+        dirFD = open(dirPath.c_str(),
+                O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    while (dirFD == -1 && errno == EINTR);
+    if (dirFD != -1)
+    {
+        struct stat dirStats;
+        const bool cached = fstat(dirFD, &dirStats) == 0
+                && securedDirs.count(DirKey(dirStats.st_dev, dirStats.st_ino))
+                > 0;
+        close(dirFD);
+        if (cached)
+        {
+            return true;
+        }
+    }
+    std::string securedPath("/");
+    int parentDir = openSecuredDir(-1, "/", securedPath);
+    if (parentDir == -1)
+    {
+        return false;
+    }
+    size_t pathIndex = 0;
+    // Open and check each remaining path component relative to its parent:
+    while (pathIndex < dirPath.size())
+    {
+        const size_t nameStart = dirPath.find_first_not_of('/', pathIndex);
+        if (nameStart == std::string::npos)
+        {
+            break;
+        }
+        size_t nameEnd = dirPath.find('/', nameStart);
+        if (nameEnd == std::string::npos)
+        {
+            nameEnd = dirPath.size();
+        }
+        const std::string name = dirPath.substr(nameStart,
+                nameEnd - nameStart);
+        pathIndex = nameEnd;
+        if (name == "." || name == "..")
+        {
+            DF_DBG(messagePrefix << __func__ << ": Path \"" << dirPath
+                    << "\" is not in canonical form.");
+            return false;
+        }
+        if (securedPath.back() != '/')
+        {
+            securedPath += '/';
+        }
+        securedPath += name;
+        parentDir = openSecuredDir(parentDir, name, securedPath);
+        if (parentDir == -1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Opens a directory relative to a secured parent directory, checks if it is
+// secure, and caches its file descriptor if it is.
+int DaemonFramework::Process::Security::openSecuredDir
+(const int parentDir, const std::string& name, const std::string& dirPath)
+{
+    int dirFD = -1;
+    do
+    {
+        errno = 0;
+        dirFD = openat(parentDir, name.c_str(),
+                O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    while (dirFD == -1 && errno == EINTR);
+    if (dirFD == -1)
     {
         switch (errno)
         {
             case EACCES:
                 DF_DBG(messagePrefix << __func__
                         << ": Failed to search path, security is uncertain.");
-                return false;
+                return -1;
             case EIO:
                 DF_DBG(messagePrefix << __func__
                         << ": Failed to read from file system.");
-                return false;
+                return -1;
             case ELOOP:
-                DF_DBG(messagePrefix << __func__
-                        << ": Encountered a symbolic link loop in the path.");
-                return false;
+                DF_DBG(messagePrefix << __func__ << ": Path \"" << dirPath
+                        << "\" is a symbolic link.");
+                return -1;
             case ENAMETOOLONG:
             case ENOENT:
             case ENOTDIR:
-            case EOVERFLOW:
-                DF_DBG(messagePrefix << __func__ 
-                        << ": Invalid directory path.");
-                return false;
+                DF_DBG(messagePrefix << __func__ << ": Path \"" << dirPath
+                        << "\" was not a directory.");
+                return -1;
             default:
-                DF_DBG(messagePrefix << __func__ << ": Unexpected error type " 
+                DF_DBG(messagePrefix << __func__ << ": Unexpected error type "
                         << errno);
-                return false;
+                return -1;
         }
     }
-    if (! S_ISDIR(dirStats.st_mode))
+    struct stat dirStats;
+    if (fstat(dirFD, &dirStats) == -1)
     {
-        DF_DBG(messagePrefix << __func__ << ": Path \"" << dirPath
-                << "\" was not a directory.");
-        return false;
+        DF_DBG(messagePrefix << __func__ << ": Failed to read \"" << dirPath
+                << "\".");
+        DF_PERROR(messagePrefix);
+        close(dirFD);
+        return -1;
+    }
+    const DirKey dirKey(dirStats.st_dev, dirStats.st_ino);
+    std::map<DirKey, int>::const_iterator cached = securedDirs.find(dirKey);
+    if (cached != securedDirs.end())
+    {
+        close(dirFD);
+        return cached->second;
     }
     if (dirStats.st_uid != 0 || dirStats.st_gid != 0)
     {
-        DF_DBG(messagePrefix << __func__ << ": Directory \"" << dirPath 
+        DF_DBG(messagePrefix << __func__ << ": Directory \"" << dirPath
                 << "\" is not exclusively owned by root.");
-        return false;
+        close(dirFD);
+        return -1;
     }
     if ((dirStats.st_mode & S_IWOTH) != 0)
     {
         DF_DBG(messagePrefix << __func__ << ": Write permissions for \""
                 << dirPath << "\" are not restricted to root.");
-        return false;
+        close(dirFD);
+        return -1;
     }
-    return true;
+    securedDirs[dirKey] = dirFD;
+    return dirFD;
 }
@@ -13,9 +13,16 @@ DF_OBJECTS_DAEMON_PROCESS := \
   $(DF_DAEMON_PROCESS_OBJ)Data.o \
   $(DF_DAEMON_PROCESS_OBJ)Security.o \
 
+DF_DAEMON_DIGEST_DIR = $(DF_DAEMON_DIR)/Digest
+DF_DAEMON_DIGEST_PREFIX = $(DF_DAEMON_PREFIX)Digest_
+DF_DAEMON_DIGEST_OBJ = $(DF_DAEMON_OBJ)Digest_
+DF_OBJECTS_DAEMON_DIGEST := \
+  $(DF_DAEMON_DIGEST_OBJ)SHA256.o
+
 DF_OBJECTS_DAEMON := \
-  $(DF_DAEMON_OBJ)DaemonLoop.o \
-  $(DF_OBJECTS_DAEMON_PROCESS)
+  $(DF_DAEMON_OBJ)LoopCore.o \
+  $(DF_OBJECTS_DAEMON_PROCESS) \
+  $(DF_OBJECTS_DAEMON_DIGEST)
 
 $(DF_DAEMON_PROCESS_OBJ)State.o: \
 	$(DF_DAEMON_PROCESS_DIR)/Process_State.cpp
@@ -23,5 +30,7 @@ $(DF_DAEMON_PROCESS_OBJ)Data.o: \
 	$(DF_DAEMON_PROCESS_DIR)/Process_Data.cpp
 $(DF_DAEMON_PROCESS_OBJ)Security.o: \
 	$(DF_DAEMON_PROCESS_DIR)/Process_Security.cpp
-$(DF_DAEMON_OBJ)DaemonLoop.o: \
-	$(DF_DAEMON_DIR)/DaemonLoop.cpp
+$(DF_DAEMON_DIGEST_OBJ)SHA256.o: \
+	$(DF_DAEMON_DIGEST_DIR)/Digest_SHA256.cpp
+$(DF_DAEMON_OBJ)LoopCore.o: \
+	$(DF_DAEMON_DIR)/LoopCore.cpp
@@ -1,26 +1,67 @@
 #include "DaemonControl.h"
 #include "Pipe.h"
 #include "ExitCode.h"
+#include "ReadySignal.h"
+#include "OnDemand.h"
+#include "RestartPolicy.h"
+#include "StartupProfile.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include "Debug.h"
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
+#include <sys/epoll.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <sched.h>
 #include <stdio.h>
-#include <dirent.h>
+#include <algorithm>
+#include <new>
 #include <string>
 #include <sstream>
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 // Print the application and class name before all info/error messages:
 static const constexpr char* messagePrefix
     = "DaemonFramework::DaemonControl::";
 #endif
 
-// Seconds to wait before assuming the daemon process is not going to handle
-// a SIGTERM signal and needs to be killed:
-static const constexpr int daemonTermTimeout = 2;
+// Default milliseconds to wait before assuming the daemon process is not going
+// to handle a SIGTERM signal and needs to be killed:
+static const constexpr int defaultTermTimeoutMS = 2000;
+
+// Milliseconds between process checks when pidfds aren't supported:
+static const constexpr int exitPollMS = 10;
+
+// Default maximum number of messages held while the daemon starts:
+static const constexpr size_t defaultMessageQueueLimit = 256;
+
+DF_METRIC_COUNTER(daemonLaunches, "df_daemon_launches_total",
+        "Daemon processes created.");
+DF_METRIC_COUNTER(daemonRestarts, "df_daemon_restarts_total",
+        "Daemon restarts scheduled after unexpected exits.");
+DF_METRIC_COUNTER(daemonExits, "df_daemon_exits_total",
+        "Daemon process exits.", "crashed=\"false\"");
+DF_METRIC_COUNTER(daemonCrashes, "df_daemon_exits_total",
+        "Daemon process exits.", "crashed=\"true\"");
+DF_METRIC_GAUGE(daemonRunning, "df_daemon_running",
+        "Whether a daemon process is running.");
+DF_METRIC_COUNTER(messagesHeld, "df_daemon_messages_held_total",
+        "Messages held until the daemon was ready.");
+DF_METRIC_COUNTER(messagesDiscarded, "df_daemon_messages_discarded_total",
+        "Messages discarded because the held message queue was full.");
+
+// Stack size in bytes used by daemon processes launched with clone():
+static const constexpr size_t launchStackSize = 64 * 1024;
+
+#ifndef CLOSE_RANGE_CLOEXEC
+// close_range() flag value, if not defined by system headers:
+#   define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
 
 
 // Configures the controller for its specific daemon on construction.
@@ -28,87 +69,393 @@ DaemonFramework::DaemonControl::DaemonControl(
         const std::string daemonPath,
         const std::string pipeToDaemon,
         const std::string pipeFromDaemon,
-        const size_t bufferSize) :
+        const size_t bufferSize,
+        EventLoop* eventLoop) :
     daemonPath(daemonPath),
+    daemonProcess(0),
+    daemonProcessFD(-1),
+    exitEventLoop(eventLoop),
+    exitWatched(false),
+    readyFD(-1),
+    readyWatched(false),
+    readyPending(false),
+    daemonReady(false),
+    stopRequested(false),
+    exitCode(0),
     pipeWriter(pipeToDaemon.c_str()),
     writerEnabled(! pipeToDaemon.empty()),
     inPipePath(pipeToDaemon),
     pipeReader(pipeFromDaemon.c_str(), bufferSize),
     readerEnabled(! pipeFromDaemon.empty()),
-    outPipePath(pipeFromDaemon)
+    outPipePath(pipeFromDaemon),
+    terminationTimeoutMS(defaultTermTimeoutMS),
+    messageQueueLimit(defaultMessageQueueLimit),
+    randomGenerator(std::random_device()())
+{
+#   if defined DF_PIPE_TIMESTAMPS && DF_PIPE_TIMESTAMPS
+    pipeWriter.setTimestamps(true);
+    pipeReader.setTimestamps(true);
+#   endif
+}
+
+
+// Stops watching for daemon exit events, and closes the daemon process file
+// descriptor on destruction.
+DaemonFramework::DaemonControl::~DaemonControl()
 {
+    closeProcessFD();
+    closeReadyFD();
+    if (launchTimerFD != -1)
+    {
+        exitEventLoop->removeFD(launchTimerFD);
+        close(launchTimerFD);
+        launchTimerFD = -1;
+    }
 }
 
 
 /**
- * @brief  Closes all open file descriptors except for stdin/stout/stderr.
+ * @brief  Opens a file descriptor that becomes readable when a child process
+ *         exits.
  *
- *  This should only be called within the daemon process, before executing the
- * daemon. This ensures that the parent application's open files aren't 
- * unnecessarily shared with the daemon. If any errors occur, the process will
- * exit, returning ErrorCode::fdCleanupFailed.
+ * @param processID  The ID of a running child process.
+ *
+ * @return           The new process file descriptor, or -1 if the system does
+ *                   not support process file descriptors.
  */
-static void cleanupFileTable()
+static int openProcessFD(const pid_t processID)
 {
-    using DaemonFramework::ExitCode;
-    pid_t processID = getpid();
-    const std::string fdPath = std::string("/proc/")
-            + std::to_string((int) processID) + "/fd";
-    DF_DBG_V(messagePrefix << __func__ 
-            << ": Finding and closing leaked file descriptors listed in \""
-            << fdPath << "\"");
+#   ifdef SYS_pidfd_open
     errno = 0;
-    int fdDirFD = open(fdPath.c_str(), O_RDONLY | O_DIRECTORY);
-    if (fdDirFD == -1)
+    const int processFD = (int) syscall(SYS_pidfd_open, processID, 0);
+    if (processFD == -1)
     {
         DF_DBG(messagePrefix << __func__
-                << ": Failed to open process file descriptor directory.");
+                << ": Unable to open process file descriptor:");
         DF_PERROR(messagePrefix);
-        exit((int) ExitCode::fdCleanupFailed);
     }
-    DIR* fdDir = fdopendir(fdDirFD);
-    if (fdDir == nullptr)
+    else
     {
-        DF_DBG(messagePrefix << __func__ << ": Failed to open process file"
-                << " descriptor directory stream.");
-#       ifdef DF_DEBUG
-        DF_PERROR(messagePrefix);
-#       endif
-        exit((int) ExitCode::fdCleanupFailed);
+        // pidfds are created with close-on-exec already set.
+        return processFD;
     }
-    struct dirent* fdFileInfo;
-#   ifdef DF_DEBUG
-    int filesClosed = 0;
 #   endif
-    while ((fdFileInfo = readdir(fdDir)) != nullptr)
+    return -1;
+}
+
+
+/**
+ * @brief  Directory entry format returned by the getdents64 system call.
+ */
+struct ProcessFDEntry
+{
+    ino64_t inode;
+    off64_t offset;
+    unsigned short size;
+    unsigned char type;
+    char name[];
+};
+
+
+/**
+ * @brief  Closes every file descriptor listed in /proc/self/fd, starting from
+ *         a minimum file descriptor number.
+ *
+ *  This is the fallback used when close_range() isn't available. Directory
+ * entries are read directly with getdents64 into a stack buffer, so that no
+ * memory is allocated within the forked process.
+ *
+ * @param firstFD  The lowest file descriptor number that should be closed.
+ *
+ * @return         Whether all listed file descriptors were closed.
+ */
+static bool closeListedFiles(const int firstFD)
+{
+    int fdDirFD;
+    do
     {
-        int fd = strtol(fdFileInfo->d_name, nullptr, 10);
-        if (fd > 2 && fd != fdDirFD)
+        errno = 0;
+        fdDirFD = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    while (fdDirFD == -1 && errno == EINTR);
+    if (fdDirFD == -1)
+    {
+        return false;
+    }
+    alignas(ProcessFDEntry) char entryBuffer[4096];
+    long bytesRead;
+    while ((bytesRead = syscall(SYS_getdents64, fdDirFD, entryBuffer,
+                    sizeof(entryBuffer))) > 0)
+    {
+        for (long offset = 0; offset < bytesRead;)
         {
-            errno = 0;
-            int result = 0;
-            do
+            const ProcessFDEntry* entry
+                    = reinterpret_cast<ProcessFDEntry*>(entryBuffer + offset);
+            offset += entry->size;
+            int fd = 0;
+            const char* nameChar = entry->name;
+            if (*nameChar < '0' || *nameChar > '9')
             {
-                result = close(fd);
+                continue; // Skip "." and ".."
             }
-            while (errno == EINTR);
-            if (result == -1 && errno != EBADF)
+            for (; *nameChar >= '0' && *nameChar <= '9'; nameChar++)
             {
-                DF_DBG(messagePrefix << __func__ 
-                        << ": Failed to close open file descriptor " << fd);
-#               ifdef DF_DEBUG
-                DF_PERROR(messagePrefix);
-#               endif
-                exit((int) ExitCode::fdCleanupFailed);
+                fd = (fd * 10) + (*nameChar - '0');
+            }
+            if (fd >= firstFD && fd != fdDirFD && close(fd) == -1
+                    && errno != EBADF
+                    && errno != EINTR)
+            {
+                close(fdDirFD);
+                return false;
+            }
+        }
+    }
+    close(fdDirFD);
+    return bytesRead == 0;
+}
+
+
+/**
+ * @brief  Ensures that all open file descriptors except for stdin/stdout/stderr
+ *         and the readiness pipe won't be shared with the daemon.
+ *
+ *  This should only be called within the daemon process, before executing the
+ * daemon. This ensures that the parent application's open files aren't
+ * unnecessarily shared with the daemon. Where supported, a single close_range()
+ * call marks every file descriptor as close-on-exec. Otherwise, open file
+ * descriptors are found and closed one at a time. Only async-signal-safe
+ * functions are used, as the parent process may have other threads running.
+ * If any errors occur, the process will exit, returning
+ * ErrorCode::fdCleanupFailed.
+ *
+ * @param firstFD  The lowest file descriptor number that should not be
+ *                 shared.
+ */
+static void cleanupFileTable(const int firstFD)
+{
+    using DaemonFramework::ExitCode;
+#   ifdef SYS_close_range
+    if (syscall(SYS_close_range, firstFD, ~0U, CLOSE_RANGE_CLOEXEC) == 0)
+    {
+        return;
+    }
+#   endif
+    if (! closeListedFiles(firstFD))
+    {
+        _exit((int) ExitCode::fdCleanupFailed);
+    }
+}
+
+
+/**
+ * @brief  Holds everything the new daemon process needs to execute the daemon,
+ *         prepared before the process is created.
+ */
+struct LaunchData
+{
+    // The daemon executable path:
+    const char* execPath = nullptr;
+    // Null-terminated daemon launch arguments:
+    char* const* execArgs = nullptr;
+    // Null-terminated daemon environment variables:
+    char* const* execEnv = nullptr;
+    // Write end of the readiness pipe, or -1 if not used:
+    int readyFD = -1;
+    // The signal mask to restore before executing the daemon, or null to
+    // leave signal handling unchanged:
+    const sigset_t* signalMask = nullptr;
+    // Whether startup times should be passed to the daemon:
+    bool profileStartup = false;
+};
+
+
+/**
+ * @brief  Copies an environment variable definition holding a time value into
+ *         a buffer.
+ *
+ * @param buffer  A buffer with room for the variable name, the time, and two
+ *                extra characters.
+ *
+ * @param name    The environment variable name.
+ *
+ * @param timeNS  The time value to save.
+ *
+ * @return        The buffer, holding a null-terminated "name=time" string.
+ */
+static char* printTimeVar(char* buffer, const char* name,
+        const uint64_t timeNS)
+{
+    using namespace DaemonFramework::StartupProfile;
+    size_t length = 0;
+    while (name[length] != '\0')
+    {
+        buffer[length] = name[length];
+        length++;
+    }
+    buffer[length++] = '=';
+    length += printTime(buffer + length, timeNS);
+    buffer[length] = '\0';
+    return buffer;
+}
+
+
+/**
+ * @brief  Executes the daemon with extra environment variables holding the
+ *         times when the new daemon process started, and when it finished
+ *         cleaning up its file table.
+ *
+ *  The extended environment is built on the new process's stack, so this may
+ * run in a process that shares memory with the parent.
+ *
+ * @param launch        The LaunchData prepared by the parent.
+ *
+ * @param childStartNS  The time when the new process started running.
+ */
+static void execProfiled(const LaunchData* launch, const uint64_t childStartNS)
+{
+    using namespace DaemonFramework::StartupProfile;
+    const uint64_t execNS = now();
+    size_t envCount = 0;
+    while (launch->execEnv[envCount] != nullptr)
+    {
+        envCount++;
+    }
+    const char* environment[envCount + 3];
+    for (size_t i = 0; i < envCount; i++)
+    {
+        environment[i] = launch->execEnv[i];
+    }
+    char childStartString[64];
+    char execString[64];
+    environment[envCount] = printTimeVar(childStartString, childStartVar,
+            childStartNS);
+    environment[envCount + 1] = printTimeVar(execString, execVar, execNS);
+    environment[envCount + 2] = nullptr;
+    execve(launch->execPath, launch->execArgs, (char* const*) environment);
+}
+
+
+/**
+ * @brief  Runs within the new daemon process, cleaning up its file table and
+ *         executing the daemon.
+ *
+ *  When launched with clone(CLONE_VM), this shares memory with the suspended
+ * parent process, so it must only make async-signal-safe calls and must not
+ * modify any memory outside of its own stack.
+ *
+ * @param launchData  A pointer to the LaunchData prepared by the parent.
+ *
+ * @return            This never returns. If executing the daemon fails, the
+ *                    process exits with ExitCode::daemonExecFailed.
+ */
+static int runDaemon(void* launchData)
+{
+    using DaemonFramework::ExitCode;
+    const LaunchData* launch = static_cast<const LaunchData*>(launchData);
+    const uint64_t childStartNS = launch->profileStartup
+            ? DaemonFramework::StartupProfile::now() : 0;
+    if (launch->signalMask != nullptr)
+    {
+        // Parent signal handlers must not run in shared memory, so reset them
+        // before unblocking signals:
+        struct sigaction defaultAction = {};
+        defaultAction.sa_handler = SIG_DFL;
+        for (int signal = 1; signal < NSIG; signal++)
+        {
+            struct sigaction currentAction;
+            if (sigaction(signal, nullptr, &currentAction) == 0
+                    && currentAction.sa_handler != SIG_IGN
+                    && currentAction.sa_handler != SIG_DFL)
+            {
+                sigaction(signal, &defaultAction, nullptr);
             }
-#           ifdef DF_DEBUG
-            filesClosed++;
-#           endif
         }
+        sigprocmask(SIG_SETMASK, launch->signalMask, nullptr);
+    }
+    int firstUnsharedFD = 3;
+    if (launch->readyFD != -1)
+    {
+        using namespace DaemonFramework::ReadySignal;
+        // Move the readiness pipe to its expected number, and keep it open
+        // after executing the daemon:
+        const int moveResult = (launch->readyFD == fileDescriptor)
+                ? fcntl(fileDescriptor, F_SETFD, 0)
+                : dup2(launch->readyFD, fileDescriptor);
+        if (moveResult == -1)
+        {
+            _exit(static_cast<int>(ExitCode::fdCleanupFailed));
+        }
+        firstUnsharedFD = fileDescriptor + 1;
+    }
+    cleanupFileTable(firstUnsharedFD);
+    if (launch->profileStartup)
+    {
+        execProfiled(launch, childStartNS);
+    }
+    else
+    {
+        execve(launch->execPath, launch->execArgs, launch->execEnv);
+    }
+    _exit(static_cast<int>(ExitCode::daemonExecFailed));
+}
+
+
+/**
+ * @brief  Launches the daemon in a process created with fork().
+ *
+ * @param launchData  The prepared daemon path and arguments.
+ *
+ * @return            The new process ID, or -1 if the process couldn't be
+ *                    created.
+ */
+static pid_t forkDaemon(LaunchData& launchData)
+{
+    const pid_t processID = fork();
+    if (processID == 0) // If runnning the new process:
+    {
+        runDaemon(&launchData);
+    }
+    return processID;
+}
+
+
+/**
+ * @brief  Launches the daemon in a process created with
+ *         clone(CLONE_VM | CLONE_VFORK).
+ *
+ *  The new process shares the parent's memory instead of copying its page
+ * tables, and the calling thread is suspended until the daemon is executed.
+ * All signals are blocked while the new process shares memory with the
+ * parent.
+ *
+ * @param launchData  The prepared daemon path and arguments.
+ *
+ * @return            The new process ID, or -1 if the process couldn't be
+ *                    created.
+ */
+static pid_t cloneDaemon(LaunchData& launchData)
+{
+    std::unique_ptr<char[]> childStack(new (std::nothrow)
+            char[launchStackSize]);
+    if (! childStack)
+    {
+        errno = ENOMEM;
+        return -1;
     }
-    closedir(fdDir);
-    DF_DBG(messagePrefix << __func__ << ": Closed " << filesClosed
-            << " unnecessary open file descriptors.");
+    // Stacks grow down on all supported architectures:
+    void* stackTop = childStack.get() + launchStackSize;
+    sigset_t allSignals, savedMask;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_SETMASK, &allSignals, &savedMask);
+    launchData.signalMask = &savedMask;
+    const pid_t processID = clone(runDaemon, stackTop,
+            CLONE_VM | CLONE_VFORK | SIGCHLD, &launchData);
+    const int cloneError = errno;
+    pthread_sigmask(SIG_SETMASK, &savedMask, nullptr);
+    launchData.signalMask = nullptr;
+    errno = cloneError;
+    return processID;
 }
 
 
@@ -117,6 +464,32 @@ static void cleanupFileTable()
 void DaemonFramework::DaemonControl::startDaemon
 (std::vector<std::string> args, Pipe::Listener* listener)
 {
+    if (daemonProcess != 0)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Aborting, daemon process is already running.");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(launchMutex);
+        launchArgs = args;
+        launchListener = listener;
+        failureTimes.clear();
+        restartAttempt = 0;
+        crashLoop = false;
+        setLaunchTimer(0);
+        launchState = LaunchState::starting;
+    }
+    relaunchDaemon(false);
+}
+
+
+// Launches the daemon process and opens daemon communication pipes if needed.
+bool DaemonFramework::DaemonControl::launchDaemon
+(std::vector<std::string> args, Pipe::Listener* listener)
+{
+    DF_TRACE("DaemonControl::launchDaemon");
+    StartupProfile::record("launch started");
     if (readerEnabled)
     {
         // Ensure the daemon output pipe exists:
@@ -137,49 +510,129 @@ void DaemonFramework::DaemonControl::startDaemon
     {
         DF_DBG(messagePrefix << __func__
                 << ": Aborting, daemon process is already running.");
-        return;
+        return false;
     }
+    // Pipes left open by a daemon that already exited are closed before
+    // opening them again:
     if (writerEnabled)
     {
         DF_DBG_V(messagePrefix << __func__ << ": Opening daemon input pipe:");
-        pipeWriter.openPipe();
+        pipeWriter.closePipe();
+        pipeWriter.openPipe(initEventLoop() ? exitEventLoop : nullptr);
     }
     if (readerEnabled && listener != nullptr)
     {
         DF_DBG_V(messagePrefix << __func__ << ": Opening daemon output pipe:");
-        pipeReader.openPipe(listener);
+        pipeReader.closePipe();
+        pipeReader.openPipe(listener,
+                initEventLoop() ? exitEventLoop : nullptr);
     }
 
-    daemonProcess = fork();
-    if (daemonProcess == 0) // If runnning the new process:
+    // Prepare launch arguments before forking, so the new process doesn't need
+    // to allocate any memory:
+    std::vector<const char*> cStrings;
+    for (std::string& arg : args)
+    {
+        cStrings.push_back(arg.c_str());
+    }
+    cStrings.push_back(nullptr);
+    DF_DBG_V(messagePrefix << __func__ << ": Launching \"" << daemonPath
+            << "\" with " << args.size() << " arguments.");
+    // Pass the readiness pipe's file descriptor number and on-demand launch
+    // state through the daemon's environment:
+    const std::string readyEnvVar = std::string(ReadySignal::envVar) + '=';
+    const std::string readyEnvValue = readyEnvVar
+            + std::to_string(ReadySignal::fileDescriptor);
+    const std::string demandEnvVar = std::string(OnDemand::envVar) + '=';
+    const std::string demandEnvValue = demandEnvVar + '1';
+    std::vector<const char*> envStrings;
+    for (char** envVar = environ; envVar != nullptr && *envVar != nullptr;
+            envVar++)
     {
-        DF_DBG_V(messagePrefix << __func__ << ": Daemon process started.");
-        cleanupFileTable();
-        DF_DBG_V(messagePrefix << __func__ << ": Launching \"" << daemonPath
-                << "\"");
-        std::vector<const char*> cStrings;
-        for (std::string& arg : args)
+        if (readyEnvVar.compare(0, readyEnvVar.size(), *envVar, 0,
+                    readyEnvVar.size()) != 0
+                && demandEnvVar.compare(0, demandEnvVar.size(), *envVar, 0,
+                    demandEnvVar.size()) != 0)
         {
-            cStrings.push_back(arg.c_str());
+            envStrings.push_back(*envVar);
         }
-        cStrings.push_back(nullptr);
-        DF_DBG_V(messagePrefix << __func__ << ": Converted args to "
-                << cStrings.size() << " char pointers.");
-        errno = 0;
-        int result = execv(daemonPath.c_str(), (char* const*) cStrings.data());
-        if (result == -1)
+    }
+    {
+        std::lock_guard<std::mutex> lock(launchMutex);
+        if (onDemand)
         {
-            DF_DBG(messagePrefix << __func__ << ": Failed to launch daemon.");
-            DF_PERROR(messagePrefix);
-            exit(static_cast<int>(ExitCode::daemonExecFailed));
+            envStrings.push_back(demandEnvValue.c_str());
         }
-        else
+    }
+    closeReadyFD();
+    int readyPipe[2] = { -1, -1 };
+    errno = 0;
+    if (pipe2(readyPipe, O_CLOEXEC) == -1)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Failed to create readiness pipe:");
+        DF_PERROR(messagePrefix);
+    }
+    else
+    {
+        fcntl(readyPipe[0], F_SETFL, O_NONBLOCK);
+        envStrings.push_back(readyEnvValue.c_str());
+    }
+    envStrings.push_back(nullptr);
+    LaunchData launchData;
+    launchData.execPath = daemonPath.c_str();
+    launchData.execArgs = (char* const*) cStrings.data();
+    launchData.execEnv = (char* const*) envStrings.data();
+    launchData.readyFD = readyPipe[1];
+    launchData.profileStartup = StartupProfile::isEnabled();
+
+    StartupProfile::record("launch prepared");
+    const pid_t processID = (launchMethod == LaunchMethod::vfork)
+            ? cloneDaemon(launchData) : forkDaemon(launchData);
+    if (readyPipe[1] != -1)
+    {
+        close(readyPipe[1]);
+    }
+    if (processID == -1)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Failed to create daemon process.");
+        DF_PERROR(messagePrefix);
+        if (readyPipe[0] != -1)
+        {
+            close(readyPipe[0]);
+        }
+        return false;
+    }
+    else
+    {
+        StartupProfile::record("daemon process created");
+        DF_METRIC_ADD(daemonLaunches, 1);
+        DF_METRIC_SET(daemonRunning, 1);
+        closeProcessFD();
+        const int processFD = openProcessFD(processID);
         {
-            DF_DBG(messagePrefix << __func__ << ": Daemon exited with code "
-                    << result << ", ending daemon process.");
-            exit(result);
+            std::lock_guard<std::mutex> lock(launchMutex);
+            stopRequested = false;
+            daemonProcessFD = processFD;
+            daemonProcess = processID;
+            {
+                std::lock_guard<std::mutex> readyLock(readyMutex);
+                readyFD = readyPipe[0];
+                readyPending = (readyPipe[0] != -1);
+            }
+            daemonReady = false;
+            if (launchState != LaunchState::starting)
+            {
+                // A stop was requested while launching, before the new
+                // process could be signalled:
+                terminateDaemon();
+            }
         }
+        watchExit();
+        watchReady();
     }
+    return true;
 }
 
 
@@ -187,24 +640,35 @@ void DaemonFramework::DaemonControl::startDaemon
 // pipe.
 void DaemonFramework::DaemonControl::stopDaemon()
 {
+    DF_TRACE("DaemonControl::stopDaemon");
+    requestStop();
+    {
+        // A daemon process being created now is sent SIGTERM as soon as it
+        // exists, so wait for that before checking if the daemon is running.
+        // The wait is limited in case this runs on a thread the launch
+        // needs:
+        std::unique_lock<std::mutex> lock(launchMutex);
+        launchFinished.wait_for(lock,
+                std::chrono::milliseconds(terminationTimeoutMS),
+                [this]() { return ! launchInProgress; });
+    }
     if (daemonProcess != 0)
     {
-        DF_DBG_V(messagePrefix << __func__ << ": Terminating daemon process "
-                << (int) daemonProcess);
-        kill(daemonProcess, SIGTERM);
-        sleep(daemonTermTimeout);
-        if (isDaemonRunning()) // SIGTERM ignored, take more aggressive measures
+        if (! waitForExit(stopDeadline))
         {
-            DF_DBG_V(messagePrefix << __func__ 
+            // SIGTERM ignored, take more aggressive measures
+            DF_DBG_V(messagePrefix << __func__
                     << ": Daemon process ignored SIGTERM, sending SIGKILL.");
-            kill(daemonProcess, SIGKILL);
-            int daemonStatus;
-            waitpid(daemonProcess, &daemonStatus, 0);
-            exitCode = WEXITSTATUS(daemonStatus);
-            daemonProcess = 0;
+            signalDaemon(SIGKILL);
+            collectExit(true);
             DF_DBG(messagePrefix << __func__
                     << ": Daemon process exited with code " << exitCode);
         }
+        if (daemonProcess != 0)
+        {
+            // Relaunched on demand, and using newly opened pipes:
+            return;
+        }
         if (readerEnabled)
         {
             DF_DBG_V(messagePrefix << __func__ << ": Closing PipeReader:");
@@ -219,114 +683,880 @@ void DaemonFramework::DaemonControl::stopDaemon()
 }
 
 
-// Checks if the daemon is running.
-bool DaemonFramework::DaemonControl::isDaemonRunning()
+// Asks the daemon to stop without waiting for it to exit.
+void DaemonFramework::DaemonControl::requestStop()
 {
-    if (daemonProcess == 0)
-    {
-        return false;
-    }
-    int daemonStatus;
-    errno = 0;
-    pid_t waitResult = waitpid(daemonProcess, &daemonStatus, WNOHANG);
-    if (waitResult == -1)
     {
-        DF_DBG(messagePrefix << __func__ << ": Error checking status:\n");
-        DF_PERROR(messagePrefix);
-        daemonProcess = 0;
-        return false;
+        std::lock_guard<std::mutex> lock(launchMutex);
+        if (launchState == LaunchState::restarting)
+        {
+            DF_DBG_V(messagePrefix << __func__
+                    << ": Cancelling scheduled restart.");
+            launchState = LaunchState::stopped;
+        }
+        else if (launchState == LaunchState::starting
+                || launchState == LaunchState::running)
+        {
+            // Launches that haven't started creating a process are cancelled.
+            // A launch creating one now terminates it once it exists:
+            launchState = (daemonProcess == 0 && ! launchInProgress)
+                    ? LaunchState::stopped : LaunchState::stopping;
+        }
+        pendingMessages.clear();
+        setLaunchTimer(0);
     }
-    if (waitResult == 0) // Daemon is still running 
+    terminateDaemon();
+}
+
+
+// Stops several daemons in parallel.
+void DaemonFramework::DaemonControl::stopDaemons
+(const std::vector<DaemonControl*>& daemons)
+{
+    for (DaemonControl* daemon : daemons)
     {
-        DF_DBG_V(messagePrefix << __func__ << ": Daemon " << daemonProcess
-                << " is still running, errno=" << errno);
-        return true;
+        if (daemon != nullptr)
+        {
+            daemon->requestStop();
+        }
     }
-    if (waitResult == daemonProcess) // Process finished
+    for (DaemonControl* daemon : daemons)
     {
-        daemonProcess = 0;
-        exitCode = WEXITSTATUS(daemonStatus);
-        return false;
+        if (daemon != nullptr)
+        {
+            daemon->stopDaemon();
+        }
     }
-    // Result should always be one of the options above
-    DF_DBG(messagePrefix << __func__ << ": Invalid wait result "
-            << (int) waitResult);
-    DF_ASSERT(false);
-    return false;
 }
 
-// Sends arbitrary data to the daemon using the daemon's named input pipe, if
-// one exists.
-void DaemonFramework::DaemonControl::messageParent
-(const unsigned char* messageData, const size_t messageSize)
+
+// Selects how new daemon processes are created.
+void DaemonFramework::DaemonControl::setLaunchMethod
+(const LaunchMethod method)
 {
-    if (writerEnabled)
-    {
-        pipeWriter.sendData(messageData, messageSize);
-    }
+    launchMethod = method;
 }
 
-// Gets the ID of the daemon process if running.
-pid_t DaemonFramework::DaemonControl::getDaemonProcessID()
+
+// Launches the daemon the next time a message is sent to it, instead of
+// launching it immediately.
+void DaemonFramework::DaemonControl::launchOnDemand
+(const std::vector<std::string> args, Pipe::Listener* listener)
 {
-    if (isDaemonRunning())
+    if (! writerEnabled)
     {
-        return daemonProcess;
+        DF_DBG(messagePrefix << __func__
+                << ": On-demand launch requires a daemon input pipe.");
+        return;
     }
-    return 0;
+    std::lock_guard<std::mutex> lock(launchMutex);
+    launchArgs = args;
+    launchListener = listener;
+    onDemand = true;
 }
 
 
-// Gets the exit code returned by the daemon process after it finished.
-int DaemonFramework::DaemonControl::getExitCode()
+// Sets how long a daemon launched on demand may go without receiving messages
+// before it is shut down.
+void DaemonFramework::DaemonControl::setIdleTimeout(const int timeoutMS)
 {
-    if (isDaemonRunning())
+    std::lock_guard<std::mutex> lock(launchMutex);
+    idleTimeoutMS = (timeoutMS > 0) ? timeoutMS : 0;
+    if (onDemand && launchState == LaunchState::running)
     {
-        DF_DBG(messagePrefix << __func__ << ": Daemon is still running!");
-        DF_ASSERT(false);
-        return 0;
+        lastMessageTime = Clock::now();
+        setLaunchTimer(idleTimeoutMS);
     }
-    return exitCode;
 }
 
 
-// Waits until the daemon process terminates and gets the process exit code.
-int DaemonFramework::DaemonControl::waitToExit()
+// Sets the rules used to restart the daemon after it exits unexpectedly.
+void DaemonFramework::DaemonControl::setRestartPolicy
+(const RestartPolicy& policy)
 {
-    DF_DBG_V(messagePrefix << __func__ << ": Checking if daemon process "
-            << (int) daemonProcess << " has already exited:");
-    while (isDaemonRunning())
+    std::lock_guard<std::mutex> lock(launchMutex);
+    restartPolicy.reset(new RestartPolicy(policy));
+}
+
+
+// Stops restarting the daemon automatically.
+void DaemonFramework::DaemonControl::disableRestarts()
+{
+    std::lock_guard<std::mutex> lock(launchMutex);
+    restartPolicy.reset();
+    if (launchState == LaunchState::restarting)
     {
-        int daemonStatus;
-        errno = 0;
-        if(waitpid(daemonProcess, &daemonStatus, 0) == -1)
-        {
-            DF_DBG(messagePrefix << __func__ << ": waitpid error:");
-            DF_PERROR(messagePrefix);
-        }
-        if (WIFEXITED(daemonStatus))
-        {
-            daemonProcess = 0;
-            exitCode = WEXITSTATUS(daemonStatus);
-            break;
-        }
-        else if (WIFSIGNALED(daemonStatus))
-        {
-            DF_DBG(messagePrefix << __func__ << ": killed by signal "
-                    << WTERMSIG(daemonStatus));
-        }
-        else if (WIFSTOPPED(daemonStatus))
-        {
-            DF_DBG(messagePrefix << __func__ << ": stopped by signal "
-                    << WSTOPSIG(daemonStatus));
-        }
+        setLaunchTimer(0);
+        pendingMessages.clear();
+        launchState = LaunchState::stopped;
+    }
+}
+
+
+// Checks if automatic restarts stopped because the daemon failed too many
+// times within the restart policy's crash loop window.
+bool DaemonFramework::DaemonControl::crashLoopDetected()
+{
+    std::lock_guard<std::mutex> lock(launchMutex);
+    return crashLoop;
+}
+
+
+// Sets the maximum number of messages held while the daemon starts or
+// restarts.
+void DaemonFramework::DaemonControl::setMessageQueueLimit(const size_t limit)
+{
+    std::lock_guard<std::mutex> lock(launchMutex);
+    messageQueueLimit = limit;
+}
+
+
+// Sets how long to wait for the daemon to handle SIGTERM before killing it
+// with SIGKILL.
+void DaemonFramework::DaemonControl::setTerminationTimeout
+(const int timeoutMS)
+{
+    terminationTimeoutMS = (timeoutMS > 0) ? timeoutMS : 0;
+}
+
+
+// Checks if the daemon has signalled that it is ready to handle requests.
+bool DaemonFramework::DaemonControl::isDaemonReady() const
+{
+    return daemonReady;
+}
+
+
+// Waits until the daemon signals that it is ready, exits, or the timeout
+// period ends.
+bool DaemonFramework::DaemonControl::waitUntilReady(const int timeoutMS)
+{
+    using namespace std::chrono;
+    const Clock::time_point deadline = Clock::now()
+            + milliseconds((timeoutMS > 0) ? timeoutMS : 0);
+    while (readyPending)
+    {
+        int waitMS = -1;
+        if (timeoutMS >= 0)
+        {
+            waitMS = (int) duration_cast<milliseconds>(
+                    deadline - Clock::now()).count();
+            if (waitMS <= 0)
+            {
+                break;
+            }
+        }
+        struct pollfd readyPoll = { readyFD, POLLIN, 0 };
+        errno = 0;
+        if (poll(&readyPoll, 1, waitMS) == -1 && errno != EINTR)
+        {
+            DF_DBG(messagePrefix << __func__ << ": poll error:");
+            DF_PERROR(messagePrefix);
+            break;
+        }
+        collectReady();
+    }
+    return daemonReady;
+}
+
+
+// Sets a function to call when the daemon signals that it is ready.
+void DaemonFramework::DaemonControl::setReadyCallback
+(const ReadyCallback callback)
+{
+    std::lock_guard<std::mutex> lock(readyMutex);
+    readyCallback = callback;
+}
+
+
+// Sets a function to call whenever the daemon exits.
+void DaemonFramework::DaemonControl::setExitCallback
+(const ExitCallback callback)
+{
+    std::lock_guard<std::mutex> lock(processMutex);
+    exitCallback = callback;
+}
+
+
+// Checks if the daemon is running.
+bool DaemonFramework::DaemonControl::isDaemonRunning()
+{
+    if (daemonProcess == 0)
+    {
+        return false;
+    }
+    if (! exitWatched)
+    {
+        // Exit events aren't available, so check the process directly:
+        return ! collectExit(false);
+    }
+    return true;
+}
+
+// Sends arbitrary data to the daemon using the daemon's named input pipe, if
+// one exists.
+bool DaemonFramework::DaemonControl::messageParent
+(const unsigned char* messageData, const size_t messageSize)
+{
+    if (! writerEnabled)
+    {
+        return false;
+    }
+    DF_TRACE("DaemonControl::messageParent");
+    std::unique_lock<std::mutex> lock(launchMutex);
+    switch (launchState)
+    {
+        case LaunchState::running:
+            return sendUnlocked(lock, messageData, messageSize);
+        case LaunchState::stopped:
+        case LaunchState::stopping:
+            if (! onDemand)
+            {
+                // Send directly, waiting for the daemon to open its pipe:
+                lock.unlock();
+                return pipeWriter.sendData(messageData, messageSize);
+            }
+            if (launchState == LaunchState::stopping)
+            {
+                // Send once the daemon is relaunched and ready:
+                return holdMessage(messageData, messageSize);
+            }
+            if (! holdMessage(messageData, messageSize))
+            {
+                return false;
+            }
+            launchState = LaunchState::starting;
+            lock.unlock();
+            relaunchDaemon(true);
+            return true;
+        case LaunchState::starting:
+        case LaunchState::restarting:
+            // Send once the daemon is ready:
+            return holdMessage(messageData, messageSize);
+    }
+    return false;
+}
+
+// Gets the ID of the daemon process if running.
+pid_t DaemonFramework::DaemonControl::getDaemonProcessID()
+{
+    isDaemonRunning();
+    return daemonProcess;
+}
+
+
+// Gets the exit code returned by the daemon process after it finished.
+int DaemonFramework::DaemonControl::getExitCode()
+{
+    if (isDaemonRunning())
+    {
+        DF_DBG(messagePrefix << __func__ << ": Daemon is still running!");
+        DF_ASSERT(false);
+        return 0;
     }
-    DF_DBG_V(messagePrefix << __func__ << ": Daemon exited with code "
-            << exitCode);
     return exitCode;
 }
 
 
+// Waits until the daemon process terminates and gets the process exit code.
+int DaemonFramework::DaemonControl::waitToExit()
+{
+    DF_DBG_V(messagePrefix << __func__ << ": Checking if daemon process "
+            << (int) daemonProcess << " has already exited:");
+    while (isDaemonRunning())
+    {
+        if (daemonProcessFD == -1)
+        {
+            collectExit(true);
+            continue;
+        }
+        struct pollfd exitPoll = { daemonProcessFD, POLLIN, 0 };
+        errno = 0;
+        if (poll(&exitPoll, 1, -1) == -1 && errno != EINTR)
+        {
+            DF_DBG(messagePrefix << __func__ << ": poll error:");
+            DF_PERROR(messagePrefix);
+            collectExit(true);
+        }
+        else
+        {
+            collectExit(false);
+        }
+    }
+    DF_DBG_V(messagePrefix << __func__ << ": Daemon exited with code "
+            << exitCode);
+    return exitCode;
+}
+
+
+// Gets the pipe used to receive data from the daemon.
+const DaemonFramework::Pipe::Reader&
+DaemonFramework::DaemonControl::getPipeReader() const
+{
+    return pipeReader;
+}
+
+
+// Gets the pipe used to send data to the daemon.
+const DaemonFramework::Pipe::Writer&
+DaemonFramework::DaemonControl::getPipeWriter() const
+{
+    return pipeWriter;
+}
+
+
+// Waits until the daemon process exits or a deadline passes.
+bool DaemonFramework::DaemonControl::waitForExit
+(const Clock::time_point deadline)
+{
+    using namespace std::chrono;
+    while (isDaemonRunning())
+    {
+        const int remainingMS = (int) duration_cast<milliseconds>(
+                deadline - Clock::now()).count();
+        if (remainingMS <= 0)
+        {
+            return false;
+        }
+        if (daemonProcessFD != -1)
+        {
+            struct pollfd exitPoll = { daemonProcessFD, POLLIN, 0 };
+            errno = 0;
+            const int pollResult = poll(&exitPoll, 1, remainingMS);
+            if (pollResult == -1 && errno != EINTR)
+            {
+                DF_DBG(messagePrefix << __func__ << ": poll error:");
+                DF_PERROR(messagePrefix);
+                return collectExit(false);
+            }
+            if (pollResult > 0)
+            {
+                collectExit(false);
+            }
+        }
+        else
+        {
+            usleep(1000 * std::min(remainingMS, exitPollMS));
+        }
+    }
+    return true;
+}
+
+
+// Collects the daemon process's exit status if it has exited, saves its exit
+// code, and runs the exit callback.
+bool DaemonFramework::DaemonControl::collectExit(const bool wait)
+{
+    ExitCallback callback;
+    int processFD;
+    bool crashed = false;
+    {
+        std::lock_guard<std::mutex> lock(processMutex);
+        const pid_t processID = daemonProcess;
+        if (processID == 0)
+        {
+            return true;
+        }
+        int daemonStatus = 0;
+        pid_t waitResult;
+        do
+        {
+            errno = 0;
+            waitResult = waitpid(processID, &daemonStatus, wait ? 0 : WNOHANG);
+        }
+        while (waitResult == -1 && errno == EINTR);
+        if (waitResult == 0) // Daemon is still running
+        {
+            return false;
+        }
+        if (waitResult == -1)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Error checking status:");
+            DF_PERROR(messagePrefix);
+            daemonStatus = 0;
+        }
+        else if (WIFSIGNALED(daemonStatus))
+        {
+            DF_DBG(messagePrefix << __func__ << ": Daemon killed by signal "
+                    << WTERMSIG(daemonStatus));
+            crashed = true;
+        }
+        exitCode = WEXITSTATUS(daemonStatus);
+        stopRequested = false;
+        daemonReady = false;
+        daemonProcess = 0;
+        DF_METRIC_SET(daemonRunning, 0);
+        DF_METRIC_ADD((crashed ? daemonCrashes : daemonExits), 1);
+        callback = exitCallback;
+        processFD = daemonProcessFD;
+    }
+    if (exitWatched.exchange(false))
+    {
+        exitEventLoop->removeFD(processFD);
+    }
+    if (callback)
+    {
+        callback(exitCode);
+    }
+    handleLaunchExit(crashed);
+    return true;
+}
+
+
+// Launches the daemon using the saved launch arguments, handling launch
+// failures and daemons that can't signal when they are ready.
+void DaemonFramework::DaemonControl::relaunchDaemon(const bool holdMessages)
+{
+    std::vector<std::string> args;
+    Pipe::Listener* listener;
+    {
+        std::lock_guard<std::mutex> lock(launchMutex);
+        // The launch lock was released after scheduling this launch, so check
+        // that it wasn't cancelled by a stop request, or already started on
+        // another thread:
+        if (launchState != LaunchState::starting || launchInProgress)
+        {
+            return;
+        }
+        launchInProgress = true;
+        args = launchArgs;
+        listener = launchListener;
+    }
+    const bool launched = launchDaemon(args, listener);
+    {
+        std::lock_guard<std::mutex> lock(launchMutex);
+        launchInProgress = false;
+        launchFinished.notify_all();
+        // The daemon may exit before launchDaemon returns, so only a failed
+        // launch should be handled here:
+        if (! launched)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Launch failed, discarding "
+                    << pendingMessages.size() << " messages.");
+            pendingMessages.clear();
+            launchState = LaunchState::stopped;
+            return;
+        }
+    }
+    if (! holdMessages || readyFD == -1)
+    {
+        // Send messages as soon as the daemon opens its input pipe, either
+        // because no readiness signal is coming, or because this launch
+        // doesn't wait for it:
+        flushPendingMessages();
+    }
+}
+
+
+// Holds a message until the daemon is ready, unless the message queue is
+// full.
+bool DaemonFramework::DaemonControl::holdMessage
+(const unsigned char* messageData, const size_t messageSize)
+{
+    if (pendingMessages.size() >= messageQueueLimit)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Message queue full, discarding "
+                << messageSize << " byte message.");
+        DF_METRIC_ADD(messagesDiscarded, 1);
+        return false;
+    }
+    pendingMessages.emplace_back(messageData, messageData + messageSize);
+    DF_METRIC_ADD(messagesHeld, 1);
+    return true;
+}
+
+
+// Sends all messages held while the daemon was starting, and starts the idle
+// timeout period if launching on demand.
+void DaemonFramework::DaemonControl::flushPendingMessages()
+{
+    std::unique_lock<std::mutex> lock(launchMutex);
+    // Another thread that is already flushing will also send any messages
+    // held since it started:
+    if (launchState != LaunchState::starting || flushInProgress)
+    {
+        return;
+    }
+    flushInProgress = true;
+    size_t failedMessages = 0;
+    while (! pendingMessages.empty() && launchState == LaunchState::starting)
+    {
+        std::vector<std::vector<unsigned char>> messages;
+        messages.swap(pendingMessages);
+        DF_DBG_V(messagePrefix << __func__ << ": Sending " << messages.size()
+                << " held messages.");
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            if (launchState != LaunchState::starting)
+            {
+                DF_DBG(messagePrefix << __func__ << ": Daemon stopping, "
+                        << "discarding " << (messages.size() - i)
+                        << " held messages.");
+                break;
+            }
+            if (! sendUnlocked(lock, messages[i].data(), messages[i].size()))
+            {
+                failedMessages++;
+            }
+        }
+    }
+    flushInProgress = false;
+    if (failedMessages > 0)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to send "
+                << failedMessages << " held messages.");
+        DF_METRIC_ADD(messagesDiscarded, failedMessages);
+    }
+    // A stop request may have arrived while sending:
+    if (launchState != LaunchState::starting)
+    {
+        return;
+    }
+    launchState = LaunchState::running;
+    restartAttempt = 0;
+    lastMessageTime = Clock::now();
+    if (onDemand)
+    {
+        setLaunchTimer(idleTimeoutMS);
+    }
+}
+
+
+// Sends a message to a running daemon without holding the launch lock, so that
+// a stalled daemon can't block the event thread.
+bool DaemonFramework::DaemonControl::sendUnlocked
+(std::unique_lock<std::mutex>& lock, const unsigned char* messageData,
+        const size_t messageSize)
+{
+    sendsInProgress++;
+    lastMessageTime = Clock::now();
+    lock.unlock();
+    const bool sent = pipeWriter.sendData(messageData, messageSize);
+    lock.lock();
+    sendsInProgress--;
+    lastMessageTime = Clock::now();
+    return sent;
+}
+
+
+// Updates the launch state after the daemon exits, restarting or relaunching
+// the daemon if necessary.
+void DaemonFramework::DaemonControl::handleLaunchExit(const bool crashed)
+{
+    bool relaunch = false;
+    {
+        std::lock_guard<std::mutex> lock(launchMutex);
+        setLaunchTimer(0);
+        const LaunchState exitState = launchState;
+        launchState = LaunchState::stopped;
+        if (exitState == LaunchState::stopping)
+        {
+            // Stopped intentionally, so only launch again for messages sent
+            // while stopping:
+            relaunch = onDemand && ! pendingMessages.empty();
+        }
+        else if ((exitState == LaunchState::starting
+                    || exitState == LaunchState::running)
+                && shouldRestart(crashed))
+        {
+            std::uniform_real_distribution<double> distribution(0.0, 1.0);
+            const int delayMS = restartPolicy->getRestartDelay(
+                    restartAttempt++, distribution(randomGenerator));
+            DF_DBG(messagePrefix << __func__ << ": Restarting daemon in "
+                    << delayMS << "ms.");
+            launchState = LaunchState::restarting;
+            DF_METRIC_ADD(daemonRestarts, 1);
+            setLaunchTimer(std::max(delayMS, 1));
+            return;
+        }
+        if (relaunch)
+        {
+            launchState = LaunchState::starting;
+        }
+        else if (! pendingMessages.empty())
+        {
+            DF_DBG(messagePrefix << __func__ << ": Daemon exited, discarding "
+                    << pendingMessages.size() << " messages.");
+            pendingMessages.clear();
+        }
+    }
+    if (relaunch)
+    {
+        relaunchDaemon(true);
+    }
+}
+
+
+// Checks if the restart policy allows restarting the daemon after an
+// unexpected exit, and records the failure for crash loop detection.
+bool DaemonFramework::DaemonControl::shouldRestart(const bool crashed)
+{
+    if (! restartPolicy || restartPolicy->getAction(exitCode, crashed)
+            != RestartPolicy::Action::restart)
+    {
+        return false;
+    }
+    const unsigned int maxFailures = restartPolicy->getCrashLoopFailures();
+    if (maxFailures == 0)
+    {
+        return true;
+    }
+    const Clock::time_point now = Clock::now();
+    const Clock::duration window = std::chrono::milliseconds(
+            restartPolicy->getCrashLoopWindow());
+    failureTimes.push_back(now);
+    while (now - failureTimes.front() > window)
+    {
+        failureTimes.pop_front();
+    }
+    if (failureTimes.size() >= maxFailures)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Daemon failed "
+                << failureTimes.size() << " times, stopping restarts.");
+        crashLoop = true;
+        return false;
+    }
+    return true;
+}
+
+
+// Restarts the daemon if a restart is scheduled, or closes the daemon's input
+// pipe if an on-demand daemon has been idle for the idle timeout period.
+void DaemonFramework::DaemonControl::handleLaunchTimer()
+{
+    uint64_t expirations;
+    if (read(launchTimerFD, &expirations, sizeof(expirations)) == -1)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(launchMutex);
+    if (launchState == LaunchState::restarting)
+    {
+        launchState = LaunchState::starting;
+        lock.unlock();
+        relaunchDaemon(true);
+        return;
+    }
+    if (! onDemand || launchState != LaunchState::running
+            || idleTimeoutMS == 0)
+    {
+        return;
+    }
+    if (sendsInProgress > 0)
+    {
+        // Check again once the messages being sent are finished, instead of
+        // closing the pipe while they are written:
+        setLaunchTimer(idleTimeoutMS);
+        return;
+    }
+    using namespace std::chrono;
+    const int idleMS = (int) duration_cast<milliseconds>(
+            Clock::now() - lastMessageTime).count();
+    if (idleMS < idleTimeoutMS)
+    {
+        setLaunchTimer(idleTimeoutMS - idleMS);
+        return;
+    }
+    DF_DBG_V(messagePrefix << __func__ << ": Daemon idle for " << idleMS
+            << "ms, closing its input pipe.");
+    launchState = LaunchState::stopping;
+    pipeWriter.closePipe();
+}
+
+
+// Starts or stops the timer used for restart delays and idle timeouts.
+void DaemonFramework::DaemonControl::setLaunchTimer(const int timeoutMS)
+{
+    if (launchTimerFD == -1)
+    {
+        if (timeoutMS == 0 || ! initEventLoop())
+        {
+            return;
+        }
+        launchTimerFD = timerfd_create(CLOCK_MONOTONIC,
+                TFD_NONBLOCK | TFD_CLOEXEC);
+        if (launchTimerFD == -1)
+        {
+            DF_DBG(messagePrefix << __func__ << ": Failed to create timer:");
+            DF_PERROR(messagePrefix);
+            return;
+        }
+        exitEventLoop->addFD(launchTimerFD, EPOLLIN,
+                [this](const uint32_t events) { handleLaunchTimer(); });
+    }
+    struct itimerspec timerValue = {};
+    timerValue.it_value.tv_sec = timeoutMS / 1000;
+    timerValue.it_value.tv_nsec = (timeoutMS % 1000) * 1000000L;
+    timerfd_settime(launchTimerFD, 0, &timerValue, nullptr);
+}
+
+
+// Reads the daemon's readiness signal if available, and runs the ready
+// callback if the daemon is ready.
+bool DaemonFramework::DaemonControl::collectReady()
+{
+    ReadyCallback callback;
+    int processReadyFD;
+    {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        if (! readyPending)
+        {
+            return true;
+        }
+        unsigned char readySignal = 0;
+        ssize_t readSize;
+        do
+        {
+            errno = 0;
+            readSize = read(readyFD, &readySignal, 1);
+        }
+        while (readSize == -1 && errno == EINTR);
+        if (readSize == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return false;
+        }
+        daemonReady = (readSize == 1
+                && readySignal == ReadySignal::readyByte);
+        readyPending = false;
+        DF_DBG_V(messagePrefix << __func__ << ": Daemon " << (daemonReady
+                    ? "is ready." : "exited before becoming ready."));
+        if (daemonReady)
+        {
+            StartupProfile::record("ready signal received");
+            callback = readyCallback;
+        }
+        processReadyFD = readyFD;
+    }
+    if (readyWatched.exchange(false))
+    {
+        exitEventLoop->removeFD(processReadyFD);
+    }
+    if (daemonReady)
+    {
+        flushPendingMessages();
+    }
+    if (callback)
+    {
+        callback();
+    }
+    return true;
+}
+
+
+// Ensures the EventLoop used to watch the daemon exists and is running,
+// creating one if necessary.
+bool DaemonFramework::DaemonControl::initEventLoop()
+{
+    if (exitEventLoop == nullptr)
+    {
+        ownedEventLoop.reset(new EventLoop);
+        if (! ownedEventLoop->startThread())
+        {
+            DF_DBG(messagePrefix << __func__
+                    << ": Failed to start daemon event thread.");
+            ownedEventLoop.reset();
+            return false;
+        }
+        exitEventLoop = ownedEventLoop.get();
+    }
+    return true;
+}
+
+
+// Starts watching the daemon's process file descriptor for exit events,
+// creating an EventLoop if necessary.
+void DaemonFramework::DaemonControl::watchExit()
+{
+    if (daemonProcessFD == -1 || ! initEventLoop())
+    {
+        return;
+    }
+    exitWatched = exitEventLoop->addFD(daemonProcessFD, EPOLLIN,
+            [this](const uint32_t events) { collectExit(false); });
+}
+
+
+// Starts watching the readiness pipe for the daemon's readiness signal.
+void DaemonFramework::DaemonControl::watchReady()
+{
+    if (readyFD == -1 || ! initEventLoop())
+    {
+        return;
+    }
+    readyWatched = exitEventLoop->addFD(readyFD, EPOLLIN,
+            [this](const uint32_t events) { collectReady(); });
+}
+
+
+// Stops watching the readiness pipe, and closes it.
+void DaemonFramework::DaemonControl::closeReadyFD()
+{
+    if (readyWatched.exchange(false))
+    {
+        exitEventLoop->removeFD(readyFD);
+    }
+    std::lock_guard<std::mutex> lock(readyMutex);
+    if (readyFD != -1)
+    {
+        close(readyFD);
+        readyFD = -1;
+    }
+    readyPending = false;
+}
+
+
+// Stops watching for daemon exit events, and closes the daemon process file
+// descriptor.
+void DaemonFramework::DaemonControl::closeProcessFD()
+{
+    if (exitWatched.exchange(false))
+    {
+        exitEventLoop->removeFD(daemonProcessFD);
+    }
+    const int processFD = daemonProcessFD.exchange(-1);
+    if (processFD != -1)
+    {
+        close(processFD);
+    }
+}
+
+
+// Sends SIGTERM to the daemon and starts the termination timeout period, unless
+// this was already done for the running daemon.
+void DaemonFramework::DaemonControl::terminateDaemon()
+{
+    if (daemonProcess != 0 && ! stopRequested.exchange(true))
+    {
+        DF_DBG_V(messagePrefix << __func__ << ": Terminating daemon process "
+                << (int) daemonProcess);
+        stopDeadline = Clock::now()
+                + std::chrono::milliseconds(terminationTimeoutMS);
+        signalDaemon(SIGTERM);
+    }
+}
+
+
+// Sends a signal to the daemon process.
+void DaemonFramework::DaemonControl::signalDaemon(const int signal)
+{
+#   ifdef SYS_pidfd_send_signal
+    const int processFD = daemonProcessFD;
+    if (processFD != -1)
+    {
+        // Signalling through the pidfd can't reach a different process if the
+        // daemon was already collected and its ID was reused.
+        syscall(SYS_pidfd_send_signal, processFD, signal, nullptr, 0);
+        return;
+    }
+#   endif
+    const pid_t processID = daemonProcess;
+    if (processID != 0)
+    {
+        kill(processID, signal);
+    }
+}
+
+
 // Creates the pipe file used to send messages to the daemon if it doesn't
 // already exist.
 void DaemonFramework::DaemonControl::createDaemonInputPipe
@@ -0,0 +1,120 @@
+#include "DaemonSupervisor.h"
+#include "Debug.h"
+#include <chrono>
+
+#ifdef DF_LOGGING
+// Print the application and class name before all info/error messages:
+static const constexpr char* messagePrefix
+    = "DaemonFramework::DaemonSupervisor::";
+#endif
+
+
+// Creates the shared EventLoop and starts its thread.
+DaemonFramework::DaemonSupervisor::DaemonSupervisor()
+{
+    if (! eventLoop.startThread())
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Failed to start shared event thread.");
+    }
+}
+
+
+// Stops all running daemons on destruction.
+DaemonFramework::DaemonSupervisor::~DaemonSupervisor()
+{
+    stopAll();
+    // Destroy all DaemonControls while the EventLoop they use still exists:
+    daemons.clear();
+}
+
+
+// Creates a DaemonControl for a new supervised daemon.
+DaemonFramework::DaemonControl& DaemonFramework::DaemonSupervisor::addDaemon
+(const std::string daemonPath, const std::vector<std::string> args,
+        Pipe::Listener* listener, const std::string pipeToDaemon,
+        const std::string pipeFromDaemon, const size_t bufferSize)
+{
+    Daemon daemon;
+    daemon.control.reset(new DaemonControl(daemonPath, pipeToDaemon,
+                pipeFromDaemon, bufferSize, &eventLoop));
+    daemon.args = args;
+    daemon.listener = listener;
+    daemons.push_back(std::move(daemon));
+    return *daemons.back().control;
+}
+
+
+// Launches every supervised daemon that isn't already running, without
+// waiting for any of them to become ready.
+void DaemonFramework::DaemonSupervisor::startAll()
+{
+    DF_DBG_V(messagePrefix << __func__ << ": Starting " << daemons.size()
+            << " daemons.");
+    for (Daemon& daemon : daemons)
+    {
+        if (! daemon.control->isDaemonRunning())
+        {
+            daemon.control->startDaemon(daemon.args, daemon.listener);
+        }
+    }
+}
+
+
+// Waits until every running daemon is ready, or the timeout period ends.
+bool DaemonFramework::DaemonSupervisor::waitUntilAllReady(const int timeoutMS)
+{
+    using namespace std::chrono;
+    const steady_clock::time_point deadline = steady_clock::now()
+            + milliseconds((timeoutMS > 0) ? timeoutMS : 0);
+    bool allReady = true;
+    for (Daemon& daemon : daemons)
+    {
+        int waitMS = -1;
+        if (timeoutMS >= 0)
+        {
+            waitMS = (int) duration_cast<milliseconds>(
+                    deadline - steady_clock::now()).count();
+            waitMS = (waitMS > 0) ? waitMS : 0;
+        }
+        if (! daemon.control->waitUntilReady(waitMS))
+        {
+            allReady = false;
+        }
+    }
+    return allReady;
+}
+
+
+// Stops all running daemons in parallel.
+void DaemonFramework::DaemonSupervisor::stopAll()
+{
+    std::vector<DaemonControl*> controls;
+    for (Daemon& daemon : daemons)
+    {
+        controls.push_back(daemon.control.get());
+    }
+    DaemonControl::stopDaemons(controls);
+}
+
+
+// Gets the number of supervised daemons.
+size_t DaemonFramework::DaemonSupervisor::getDaemonCount() const
+{
+    return daemons.size();
+}
+
+
+// Gets one of the supervised daemons' DaemonControl objects.
+DaemonFramework::DaemonControl& DaemonFramework::DaemonSupervisor::getDaemon
+(const size_t index)
+{
+    return *daemons.at(index).control;
+}
+
+
+// Gets the EventLoop shared by all supervised daemons.
+DaemonFramework::EventLoop& DaemonFramework::DaemonSupervisor::getEventLoop()
+{
+    return eventLoop;
+}
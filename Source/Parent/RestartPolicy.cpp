@@ -0,0 +1,147 @@
+#include "RestartPolicy.h"
+#include <algorithm>
+#include <cmath>
+
+// Default milliseconds to wait before the first restart:
+static const constexpr int defaultInitialDelayMS = 100;
+
+// Default maximum restart delay in milliseconds:
+static const constexpr int defaultMaxDelayMS = 30000;
+
+// Default factor applied to the restart delay after each failure:
+static const constexpr double defaultMultiplier = 2.0;
+
+// Default fraction of each delay that may be randomly added or subtracted:
+static const constexpr double defaultJitter = 0.2;
+
+// Default number of failures within the crash loop window that stops
+// restarts:
+static const constexpr unsigned int defaultMaxFailures = 5;
+
+// Default crash loop window in milliseconds:
+static const constexpr int defaultWindowMS = 60000;
+
+
+// Creates a policy using the default rules.
+DaemonFramework::RestartPolicy::RestartPolicy() :
+    initialDelayMS(defaultInitialDelayMS),
+    maxDelayMS(defaultMaxDelayMS),
+    multiplier(defaultMultiplier),
+    jitterFraction(defaultJitter),
+    maxFailures(defaultMaxFailures),
+    windowMS(defaultWindowMS)
+{
+    // Exits that restarting can't fix:
+    const ExitCode stopCodes[] =
+    {
+        ExitCode::success,
+        ExitCode::badDaemonPath,
+        ExitCode::badParentPath,
+        ExitCode::insecureDaemonDir,
+        ExitCode::insecureParentDir,
+        ExitCode::daemonAlreadyRunning,
+        ExitCode::daemonExecFailed,
+        ExitCode::badParentDigest
+    };
+    for (const ExitCode exitCode : stopCodes)
+    {
+        setExitAction(exitCode, Action::stop);
+    }
+}
+
+
+// Sets the action to take when the daemon returns an exit code.
+void DaemonFramework::RestartPolicy::setExitAction
+(const int exitCode, const Action action)
+{
+    exitActions[exitCode] = action;
+}
+
+void DaemonFramework::RestartPolicy::setExitAction
+(const ExitCode exitCode, const Action action)
+{
+    setExitAction(static_cast<int>(exitCode), action);
+}
+
+
+// Sets the action to take after the daemon is killed by a signal.
+void DaemonFramework::RestartPolicy::setCrashAction(const Action action)
+{
+    crashAction = action;
+}
+
+
+// Sets the action to take for any exit code without its own rule.
+void DaemonFramework::RestartPolicy::setDefaultAction(const Action action)
+{
+    defaultAction = action;
+}
+
+
+// Gets the action to take after the daemon exits.
+DaemonFramework::RestartPolicy::Action
+DaemonFramework::RestartPolicy::getAction
+(const int exitCode, const bool crashed) const
+{
+    if (crashed)
+    {
+        return crashAction;
+    }
+    const std::map<int, Action>::const_iterator actionIter
+            = exitActions.find(exitCode);
+    return (actionIter == exitActions.end()) ? defaultAction
+            : actionIter->second;
+}
+
+
+// Sets how restart delays grow after repeated failures.
+void DaemonFramework::RestartPolicy::setBackoff
+(const int initialDelayMS, const int maxDelayMS, const double multiplier)
+{
+    this->initialDelayMS = std::max(initialDelayMS, 0);
+    this->maxDelayMS = std::max(maxDelayMS, this->initialDelayMS);
+    this->multiplier = std::max(multiplier, 1.0);
+}
+
+
+// Sets how much restart delays are randomly varied.
+void DaemonFramework::RestartPolicy::setJitter(const double jitterFraction)
+{
+    this->jitterFraction = std::min(std::max(jitterFraction, 0.0), 1.0);
+}
+
+
+// Gets how long to wait before restarting the daemon.
+int DaemonFramework::RestartPolicy::getRestartDelay
+(const unsigned int attempt, const double randomValue) const
+{
+    double delay = initialDelayMS * std::pow(multiplier, attempt);
+    delay = std::min(delay, (double) maxDelayMS);
+    // Scale randomValue from [0, 1] to [-jitterFraction, jitterFraction]:
+    delay *= 1.0 + jitterFraction * (2.0 * randomValue - 1.0);
+    return (int) std::lround(std::min(std::max(delay, 0.0),
+                (double) maxDelayMS));
+}
+
+
+// Sets how many failures within a period of time count as a crash loop.
+void DaemonFramework::RestartPolicy::setCrashLoopLimit
+(const unsigned int maxFailures, const int windowMS)
+{
+    this->maxFailures = maxFailures;
+    this->windowMS = std::max(windowMS, 0);
+}
+
+
+// Gets the number of failures that stops automatic restarts.
+unsigned int DaemonFramework::RestartPolicy::getCrashLoopFailures() const
+{
+    return maxFailures;
+}
+
+
+// Gets the period in which failures count towards the crash loop limit.
+int DaemonFramework::RestartPolicy::getCrashLoopWindow() const
+{
+    return windowMS;
+}
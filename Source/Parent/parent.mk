@@ -11,7 +11,13 @@ $(DAEMON_PREFIX)DF_PARENT_OBJ = \
         $($(DAEMON_PREFIX)DF_OBJDIR)/$($(DAEMON_PREFIX)DF_PARENT_PREFIX)
 
 $(DAEMON_PREFIX)DF_OBJECTS_PARENT := \
-        $($(DAEMON_PREFIX)DF_PARENT_OBJ)DaemonControl.o
+        $($(DAEMON_PREFIX)DF_PARENT_OBJ)DaemonControl.o \
+        $($(DAEMON_PREFIX)DF_PARENT_OBJ)DaemonSupervisor.o \
+        $($(DAEMON_PREFIX)DF_PARENT_OBJ)RestartPolicy.o
 
 $($(DAEMON_PREFIX)DF_PARENT_OBJ)DaemonControl.o: \
         $(DF_PARENT_DIR)/DaemonControl.cpp
+$($(DAEMON_PREFIX)DF_PARENT_OBJ)DaemonSupervisor.o: \
+        $(DF_PARENT_DIR)/DaemonSupervisor.cpp
+$($(DAEMON_PREFIX)DF_PARENT_OBJ)RestartPolicy.o: \
+        $(DF_PARENT_DIR)/RestartPolicy.cpp
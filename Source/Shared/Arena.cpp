@@ -0,0 +1,131 @@
+#include "Arena.h"
+#include <cstdint>
+#include <new>
+
+// Offset from the start of a block to its first usable byte, keeping usable
+// memory aligned like any other heap allocation:
+static const constexpr size_t blockHeaderSize
+        = (sizeof(void*) + 2 * sizeof(size_t) + alignof(std::max_align_t) - 1)
+        / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+
+// Allocates the arena's initial buffer.
+DaemonFramework::Arena::Arena(const size_t initialSize)
+{
+    addBlock(initialSize);
+}
+
+
+// Frees all memory held by the arena.
+DaemonFramework::Arena::~Arena()
+{
+    freeBlocks();
+}
+
+
+// Releases all memory allocated since the last reset, so that it may be
+// allocated again.
+void DaemonFramework::Arena::reset()
+{
+    if (currentBlock->previous != nullptr)
+    {
+        // Replace all blocks with one that fits everything allocated since the
+        // last reset, so the same work won't need extra blocks next time:
+        const size_t totalSize = previousBlocksUsed + currentBlock->size;
+        freeBlocks();
+        addBlock(totalSize);
+    }
+    currentBlock->used = 0;
+    previousBlocksUsed = 0;
+}
+
+
+// Gets the number of bytes allocated since the last reset.
+size_t DaemonFramework::Arena::getUsed() const
+{
+    return previousBlocksUsed + currentBlock->used;
+}
+
+
+// Gets the number of bytes the arena may allocate before it needs another heap
+// block.
+size_t DaemonFramework::Arena::getCapacity() const
+{
+    return currentBlock->size - currentBlock->used;
+}
+
+
+// Gets the number of memory blocks the arena has allocated from the heap.
+size_t DaemonFramework::Arena::getBlockAllocations() const
+{
+    return blockAllocations;
+}
+
+
+// Allocates memory from the current block, adding a block if it doesn't have
+// enough space left.
+void* DaemonFramework::Arena::do_allocate(size_t bytes, size_t alignment)
+{
+    unsigned char* blockStart = reinterpret_cast<unsigned char*>(currentBlock)
+            + blockHeaderSize;
+    uintptr_t nextAddress = reinterpret_cast<uintptr_t>(blockStart)
+            + currentBlock->used;
+    uintptr_t alignedAddress = (nextAddress + alignment - 1)
+            & ~(uintptr_t) (alignment - 1);
+    if (alignedAddress + bytes
+            > reinterpret_cast<uintptr_t>(blockStart) + currentBlock->size)
+    {
+        const size_t doubledSize = currentBlock->size * 2;
+        const size_t requiredSize = bytes + alignment;
+        addBlock((doubledSize > requiredSize) ? doubledSize : requiredSize);
+        blockStart = reinterpret_cast<unsigned char*>(currentBlock)
+                + blockHeaderSize;
+        nextAddress = reinterpret_cast<uintptr_t>(blockStart);
+        alignedAddress = (nextAddress + alignment - 1)
+                & ~(uintptr_t) (alignment - 1);
+    }
+    currentBlock->used = alignedAddress + bytes
+            - reinterpret_cast<uintptr_t>(blockStart);
+    return reinterpret_cast<void*>(alignedAddress);
+}
+
+
+// Does nothing, as arena memory is only released on reset.
+void DaemonFramework::Arena::do_deallocate(void*, size_t, size_t) { }
+
+
+// Checks if another memory resource is this arena.
+bool DaemonFramework::Arena::do_is_equal(const MemoryResource& other) const
+noexcept
+{
+    return this == &other;
+}
+
+
+// Allocates a new block from the heap and makes it the current block.
+void DaemonFramework::Arena::addBlock(const size_t size)
+{
+    Block* newBlock = static_cast<Block*>(
+            ::operator new(blockHeaderSize + size));
+    newBlock->previous = currentBlock;
+    newBlock->size = size;
+    newBlock->used = 0;
+    if (currentBlock != nullptr)
+    {
+        previousBlocksUsed += currentBlock->used;
+    }
+    currentBlock = newBlock;
+    blockAllocations++;
+}
+
+
+// Frees all blocks held by the arena.
+void DaemonFramework::Arena::freeBlocks()
+{
+    while (currentBlock != nullptr)
+    {
+        Block* previous = currentBlock->previous;
+        ::operator delete(currentBlock);
+        currentBlock = previous;
+    }
+}
@@ -0,0 +1,279 @@
+#include "EventLoop.h"
+#include "Debug.h"
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#ifdef DF_LOGGING
+// Print the application and class name before all info/error messages:
+static const constexpr char* messagePrefix = "DaemonFramework::EventLoop::";
+#endif
+
+// Maximum number of events to handle for each epoll_wait call:
+static const constexpr int maxEvents = 16;
+
+
+// Creates the epoll instance used to wait for events.
+DaemonFramework::EventLoop::EventLoop() : threadRunning(false)
+{
+    errno = 0;
+    epollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFD == -1)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Failed to create epoll instance:");
+        DF_PERROR(messagePrefix);
+        return;
+    }
+    wakeFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFD == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to create wakeup event:");
+        DF_PERROR(messagePrefix);
+        return;
+    }
+    struct epoll_event wakeEvent = {};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = wakeFD;
+    if (epoll_ctl(epollFD, EPOLL_CTL_ADD, wakeFD, &wakeEvent) == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to watch wakeup event:");
+        DF_PERROR(messagePrefix);
+        close(wakeFD);
+        wakeFD = -1;
+    }
+}
+
+
+// Stops the event thread if running, and closes the epoll instance.
+DaemonFramework::EventLoop::~EventLoop()
+{
+    stopThread();
+    if (wakeFD != -1)
+    {
+        close(wakeFD);
+    }
+    if (epollFD != -1)
+    {
+        close(epollFD);
+    }
+}
+
+
+// Checks if the loop was created successfully.
+bool DaemonFramework::EventLoop::isValid() const
+{
+    return epollFD != -1 && wakeFD != -1;
+}
+
+
+// Starts watching a file descriptor for events.
+bool DaemonFramework::EventLoop::addFD
+(const int fileDescriptor, const uint32_t events, const Handler handler)
+{
+    if (! isValid() || fileDescriptor < 0 || fileDescriptor == wakeFD)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Can't watch file descriptor "
+                << fileDescriptor);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(handlerMutex);
+    struct epoll_event fdEvent = {};
+    fdEvent.events = events;
+    fdEvent.data.fd = fileDescriptor;
+    const bool replacing = handlers.count(fileDescriptor) > 0;
+    errno = 0;
+    if (epoll_ctl(epollFD, replacing ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                fileDescriptor, &fdEvent) == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to watch file descriptor "
+                << fileDescriptor << ":");
+        DF_PERROR(messagePrefix);
+        return false;
+    }
+    handlers[fileDescriptor] = std::make_shared<Handler>(handler);
+    return true;
+}
+
+
+// Stops watching a file descriptor for events.
+bool DaemonFramework::EventLoop::removeFD(const int fileDescriptor)
+{
+    std::lock_guard<std::recursive_mutex> dispatchLock(dispatchMutex);
+    std::lock_guard<std::mutex> lock(handlerMutex);
+    if (handlers.erase(fileDescriptor) == 0)
+    {
+        return false;
+    }
+    if (epoll_ctl(epollFD, EPOLL_CTL_DEL, fileDescriptor, nullptr) == -1
+            && errno != EBADF)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Failed to remove file descriptor " << fileDescriptor
+                << ":");
+        DF_PERROR(messagePrefix);
+    }
+    return true;
+}
+
+
+// Waits for events, and runs the handlers of all file descriptors that are
+// ready.
+int DaemonFramework::EventLoop::processEvents(const int timeoutMS)
+{
+    if (! isValid())
+    {
+        return -1;
+    }
+    struct epoll_event events[maxEvents];
+    errno = 0;
+    const int eventCount = epoll_wait(epollFD, events, maxEvents, timeoutMS);
+    if (eventCount == -1)
+    {
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+        DF_DBG(messagePrefix << __func__ << ": Failed to wait for events:");
+        DF_PERROR(messagePrefix);
+        return -1;
+    }
+    int eventsHandled = 0;
+    std::lock_guard<std::recursive_mutex> dispatchLock(dispatchMutex);
+    for (int i = 0; i < eventCount; i++)
+    {
+        const int fileDescriptor = events[i].data.fd;
+        if (fileDescriptor == wakeFD)
+        {
+            eventfd_t wakeCount;
+            eventfd_read(wakeFD, &wakeCount);
+            continue;
+        }
+        std::shared_ptr<Handler> handler;
+        {
+            std::lock_guard<std::mutex> lock(handlerMutex);
+            std::map<int, std::shared_ptr<Handler>>::iterator handlerIter
+                    = handlers.find(fileDescriptor);
+            if (handlerIter == handlers.end())
+            {
+                // Removed by an earlier handler:
+                continue;
+            }
+            handler = handlerIter->second;
+        }
+        (*handler)(events[i].events);
+        eventsHandled++;
+    }
+    return eventsHandled;
+}
+
+
+// Gets a file descriptor that becomes readable whenever events are ready to
+// process.
+int DaemonFramework::EventLoop::getFD() const
+{
+    return epollFD;
+}
+
+
+// Starts processing events on a new thread, if not already running.
+bool DaemonFramework::EventLoop::startThread()
+{
+    if (! isValid())
+    {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(threadMutex);
+    // Don't start a second thread while a stopped thread is still exiting:
+    while (threadID != 0)
+    {
+        if (threadRunning)
+        {
+            return true;
+        }
+        if (pthread_equal(pthread_self(), threadID))
+        {
+            DF_DBG(messagePrefix << __func__
+                    << ": Can't restart the event thread while it stops.");
+            return false;
+        }
+        threadExited.wait(lock);
+    }
+    threadRunning = true;
+    pthread_t newThread;
+    const int threadError = pthread_create(&newThread, nullptr, threadAction,
+            this);
+    if (threadError != 0)
+    {
+        DF_DBG(messagePrefix << __func__
+                << ": Couldn't create new event thread.");
+        threadRunning = false;
+        return false;
+    }
+    // The thread signals threadExited when it exits, so it is never joined:
+    pthread_detach(newThread);
+    threadID = newThread;
+    return true;
+}
+
+
+// Stops the event thread and waits for it to exit, if running.
+void DaemonFramework::EventLoop::stopThread()
+{
+    std::unique_lock<std::mutex> lock(threadMutex);
+    if (threadID == 0)
+    {
+        return;
+    }
+    threadRunning = false;
+    wakeUp();
+    if (pthread_equal(pthread_self(), threadID))
+    {
+        // The thread will exit after the current handler returns.
+        return;
+    }
+    threadExited.wait(lock, [this]() { return threadID == 0; });
+}
+
+
+// Checks if events are being processed on the loop's own thread.
+bool DaemonFramework::EventLoop::isThreadRunning() const
+{
+    return threadRunning;
+}
+
+
+// Wakes up the event thread or any processEvents() call that is currently
+// waiting for events.
+void DaemonFramework::EventLoop::wakeUp()
+{
+    if (wakeFD != -1)
+    {
+        eventfd_write(wakeFD, 1);
+    }
+}
+
+
+// Processes events until the event thread is stopped.
+void* DaemonFramework::EventLoop::threadAction(void* eventLoop)
+{
+    EventLoop* loop = static_cast<EventLoop*>(eventLoop);
+    DF_DBG_V(messagePrefix << __func__ << ": Event thread running.");
+    while (loop->threadRunning)
+    {
+        if (loop->processEvents(-1) == -1)
+        {
+            DF_DBG(messagePrefix << __func__
+                    << ": Stopping event thread after error.");
+            loop->threadRunning = false;
+        }
+    }
+    DF_DBG_V(messagePrefix << __func__ << ": Event thread exiting.");
+    // The loop may be destroyed as soon as the lock is released, so it must
+    // not be used after this:
+    std::lock_guard<std::mutex> lock(loop->threadMutex);
+    loop->threadID = 0;
+    loop->threadExited.notify_all();
+    return nullptr;
+}
@@ -0,0 +1,64 @@
+#include "File_Identity.h"
+#include <tuple>
+
+
+// Creates an invalid identity that matches no file.
+DaemonFramework::File::Identity::Identity() { }
+
+
+// Reads a file identity from file stat data.
+DaemonFramework::File::Identity::Identity(const struct stat& fileStats) :
+device(fileStats.st_dev),
+inode(fileStats.st_ino),
+size(fileStats.st_size),
+modTime(fileStats.st_mtim),
+valid(true) { }
+
+
+// Checks if this object describes an actual file.
+bool DaemonFramework::File::Identity::isValid() const
+{
+    return valid;
+}
+
+
+// Checks if this object describes the same file as another Identity,
+// regardless of whether either file version changed.
+bool DaemonFramework::File::Identity::sameFile(const Identity& rhs) const
+{
+    return valid && rhs.valid && device == rhs.device && inode == rhs.inode;
+}
+
+
+// Checks if two objects describe the same version of the same file.
+bool DaemonFramework::File::Identity::operator==(const Identity& rhs) const
+{
+    return sameFile(rhs)
+            && size == rhs.size
+            && modTime.tv_sec == rhs.modTime.tv_sec
+            && modTime.tv_nsec == rhs.modTime.tv_nsec;
+}
+
+
+// Checks if two objects describe different files or file versions.
+bool DaemonFramework::File::Identity::operator!=(const Identity& rhs) const
+{
+    return ! (*this == rhs);
+}
+
+
+// Defines an arbitrary strict ordering for Identity objects.
+bool DaemonFramework::File::Identity::operator<(const Identity& rhs) const
+{
+    return std::tie(valid, device, inode, size, modTime.tv_sec,
+                    modTime.tv_nsec)
+            < std::tie(rhs.valid, rhs.device, rhs.inode, rhs.size,
+                       rhs.modTime.tv_sec, rhs.modTime.tv_nsec);
+}
+
+
+// Gets the size of the identified file.
+off_t DaemonFramework::File::Identity::getSize() const
+{
+    return size;
+}
@@ -1,7 +1,7 @@
 #include "File_Utils.h"
 #include "Debug.h"
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 static const constexpr char* messagePrefix = "DaemonFramework::File::Utils::";
 #endif
 
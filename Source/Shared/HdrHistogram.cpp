@@ -0,0 +1,132 @@
+#include "HdrHistogram.h"
+#include <limits>
+
+
+// Creates an empty histogram.
+DaemonFramework::HdrHistogram::HdrHistogram()
+{
+    reset();
+}
+
+
+// Records a single value.
+void DaemonFramework::HdrHistogram::record(const uint64_t value)
+{
+    counts[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    valueSum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t currentMin = minValue.load(std::memory_order_relaxed);
+    while (value < currentMin && ! minValue.compare_exchange_weak(currentMin,
+                value, std::memory_order_relaxed)) { }
+    uint64_t currentMax = maxValue.load(std::memory_order_relaxed);
+    while (value > currentMax && ! maxValue.compare_exchange_weak(currentMax,
+                value, std::memory_order_relaxed)) { }
+}
+
+
+// Removes all recorded values.
+void DaemonFramework::HdrHistogram::reset()
+{
+    for (std::atomic<uint64_t>& count : counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+    totalCount.store(0, std::memory_order_relaxed);
+    valueSum.store(0, std::memory_order_relaxed);
+    minValue.store(std::numeric_limits<uint64_t>::max(),
+            std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+
+// Gets the number of recorded values.
+uint64_t DaemonFramework::HdrHistogram::getCount() const
+{
+    return totalCount.load(std::memory_order_relaxed);
+}
+
+
+// Gets the smallest recorded value.
+uint64_t DaemonFramework::HdrHistogram::getMin() const
+{
+    const uint64_t value = minValue.load(std::memory_order_relaxed);
+    return (value == std::numeric_limits<uint64_t>::max()) ? 0 : value;
+}
+
+
+// Gets the largest recorded value.
+uint64_t DaemonFramework::HdrHistogram::getMax() const
+{
+    return maxValue.load(std::memory_order_relaxed);
+}
+
+
+// Gets the mean of all recorded values.
+double DaemonFramework::HdrHistogram::getMean() const
+{
+    const uint64_t count = getCount();
+    return (count == 0) ? 0.0
+            : (double) valueSum.load(std::memory_order_relaxed) / count;
+}
+
+
+// Gets the value at a specific percentile.
+uint64_t DaemonFramework::HdrHistogram::getValueAtPercentile
+(const double percentile) const
+{
+    const uint64_t count = getCount();
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint64_t targetCount = (uint64_t) ((percentile / 100.0) * count + 0.5);
+    targetCount = (targetCount == 0) ? 1 : targetCount;
+    uint64_t countedValues = 0;
+    for (size_t i = 0; i < bucketCount; i++)
+    {
+        countedValues += counts[i].load(std::memory_order_relaxed);
+        if (countedValues >= targetCount)
+        {
+            if (i == bucketCount - 1)
+            {
+                return getMax();
+            }
+            const uint64_t bucketMax = getBucketMaxValue(i);
+            return (bucketMax < getMax()) ? bucketMax : getMax();
+        }
+    }
+    return getMax();
+}
+
+
+// Gets the index of the bucket holding a value.
+size_t DaemonFramework::HdrHistogram::getBucketIndex(const uint64_t value)
+{
+    if (value < subBucketCount)
+    {
+        return (size_t) value;
+    }
+    const unsigned int highestBit = 63 - __builtin_clzll(value);
+    if (highestBit >= maxValueBits)
+    {
+        return bucketCount - 1;
+    }
+    // Values within [2^highestBit, 2^(highestBit + 1)) share one range, split
+    // into buckets using the bits below the highest bit:
+    const unsigned int shift = highestBit - subBucketBits;
+    const size_t subBucket = (size_t) (value >> shift) - subBucketCount;
+    return subBucketCount * (shift + 1) + subBucket;
+}
+
+
+// Gets the highest value held by a bucket.
+uint64_t DaemonFramework::HdrHistogram::getBucketMaxValue(const size_t index)
+{
+    if (index < subBucketCount)
+    {
+        return index;
+    }
+    const unsigned int shift = (unsigned int) (index / subBucketCount) - 1;
+    const uint64_t subBucket = (index % subBucketCount) + subBucketCount;
+    return ((subBucket + 1) << shift) - 1;
+}
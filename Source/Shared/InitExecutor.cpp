@@ -0,0 +1,110 @@
+#include "InitExecutor.h"
+#include "Debug.h"
+#include <chrono>
+
+#ifdef DF_LOGGING
+// Print the application and class name before all info/error messages:
+static const constexpr char* messagePrefix
+    = "DaemonFramework::InitExecutor::";
+#endif
+
+// Seconds a pooled thread may wait without receiving a task before it exits:
+static const constexpr int idleTimeout = 10;
+
+constexpr unsigned int DaemonFramework::InitExecutor::maxThreads;
+
+
+// Gets the executor shared by all ThreadedInit objects.
+DaemonFramework::InitExecutor& DaemonFramework::InitExecutor::getInstance()
+{
+    // Never destroyed, so ThreadedInit objects destroyed during static
+    // destruction may still use it:
+    static InitExecutor* executor = new InitExecutor;
+    return *executor;
+}
+
+
+// Runs a task on a pooled thread, adding a thread to the pool if all threads
+// are busy and the pool isn't full.
+bool DaemonFramework::InitExecutor::run
+(const Task task, const Task onFinish)
+{
+    std::unique_lock<std::mutex> lock(taskMutex);
+    if (tasks.size() >= idleThreads && threadCount < maxThreads)
+    {
+        pthread_t threadID;
+        const int threadError = pthread_create(&threadID, nullptr,
+                threadAction, this);
+        if (threadError != 0)
+        {
+            DF_DBG(messagePrefix << __func__
+                    << ": Couldn't create new init thread.");
+            return false;
+        }
+        pthread_detach(threadID);
+        threadCount++;
+        DF_DBG_V(messagePrefix << __func__ << ": Added init thread "
+                << threadCount << " to the pool.");
+    }
+    else if (tasks.size() >= idleThreads)
+    {
+        DF_DBG_V(messagePrefix << __func__ << ": All " << threadCount
+                << " init threads are busy, queueing task.");
+    }
+    tasks.emplace_back(task, onFinish);
+    lock.unlock();
+    taskCondition.notify_one();
+    return true;
+}
+
+
+// Gets the number of threads in the pool.
+unsigned int DaemonFramework::InitExecutor::getThreadCount()
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    return threadCount;
+}
+
+
+// Gets the number of pooled threads that are waiting for tasks.
+unsigned int DaemonFramework::InitExecutor::getIdleThreadCount()
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    return (idleThreads > tasks.size()) ? (idleThreads - tasks.size()) : 0;
+}
+
+
+// Runs tasks as they are submitted, exiting once the thread has been idle for
+// too long.
+void* DaemonFramework::InitExecutor::threadAction(void* executor)
+{
+    InitExecutor* pool = static_cast<InitExecutor*>(executor);
+    std::unique_lock<std::mutex> lock(pool->taskMutex);
+    pool->idleThreads++;
+    while (true)
+    {
+        if (! pool->taskCondition.wait_for(lock,
+                std::chrono::seconds(idleTimeout),
+                [pool]() { return ! pool->tasks.empty(); }))
+        {
+            pool->idleThreads--;
+            pool->threadCount--;
+            DF_DBG_V(messagePrefix << __func__ << ": Idle init thread exited, "
+                    << pool->threadCount << " threads remain.");
+            return nullptr;
+        }
+        const std::pair<Task, Task> task = pool->tasks.front();
+        pool->tasks.pop_front();
+        pool->idleThreads--;
+        lock.unlock();
+        task.first();
+        lock.lock();
+        pool->idleThreads++;
+        if (task.second)
+        {
+            lock.unlock();
+            task.second();
+            lock.lock();
+        }
+    }
+}
@@ -1,32 +1,48 @@
 #include "InputReader.h"
+#include "EventLoop.h"
+#include "StartupProfile.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include "Debug.h"
 #include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
 #include <signal.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 // Print the application and class name before all info/error messages:
 static const constexpr char* messagePrefix = "DaemonFramework: InputReader::";
 #endif
 
-// Milliseconds to wait on file input before pausing to see if the thread should
-// stop:
-static const constexpr int readTimeoutMS = 100;
+DF_METRIC_COUNTER(readCount, "df_input_reads_total",
+        "Successful reads from input files.");
+DF_METRIC_COUNTER(bytesRead, "df_input_read_bytes_total",
+        "Bytes read from input files.");
+DF_METRIC_HISTOGRAM(readSizes, "df_input_read_size_bytes",
+        "Sizes of successful input file reads.", 16, 8);
 
 
 // Saves the file path and prepares to read the input file.
-DaemonFramework::InputReader::InputReader(const char* path) : path(path) { }
+DaemonFramework::InputReader::InputReader(const char* path) :
+    path(path), watchedFile(-1) { }
 
 
 // Stops reading and closes the input file.
 DaemonFramework::InputReader::~InputReader()
 {
     stopReading();
+    if (wakeFD != -1)
+    {
+        close(wakeFD);
+        wakeFD = -1;
+    }
 }
 
 
 // Opens the input file and starts the input read loop if not already reading.
-bool DaemonFramework::InputReader::startReading()
+bool DaemonFramework::InputReader::startReading(EventLoop* eventLoop)
 {
     {
         std::lock_guard<std::mutex> lock(readerMutex);
@@ -57,10 +73,43 @@ bool DaemonFramework::InputReader::startReading()
         {
             DF_DBG_V(messagePrefix << __func__ << ": Opened input file at \""
                     << path << "\"");
+            StartupProfile::record("input file opened", path.c_str());
         }
         currentState = State::opened;
+        if (eventLoop != nullptr)
+        {
+            this->eventLoop = eventLoop;
+            currentState = State::reading;
+            const int fileDescriptor = inputFile;
+            if (eventLoop->addFD(fileDescriptor, EPOLLIN,
+                    [this](const uint32_t events) { handleInputEvent(); }))
+            {
+                watchedFile = fileDescriptor;
+                return true;
+            }
+            DF_DBG(messagePrefix << __func__
+                    << ": Couldn't read input through the EventLoop.");
+            this->eventLoop = nullptr;
+            closeInputFile();
+            currentState = State::failed;
+            return false;
+        }
     }
 
+    if (wakeFD == -1)
+    {
+        wakeFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakeFD == -1)
+        {
+            std::lock_guard<std::mutex> lock(readerMutex);
+            DF_DBG(messagePrefix << __func__
+                    << ": Couldn't create reader wake event:");
+            DF_PERROR(messagePrefix);
+            closeInputFile();
+            currentState = State::failed;
+            return false;
+        }
+    }
     int threadError = pthread_create(&threadID, nullptr, threadAction,
             (void *) this);
     if (threadError != 0)
@@ -79,6 +128,13 @@ bool DaemonFramework::InputReader::startReading()
 // Ensures that the InputReader is not reading input.
 void DaemonFramework::InputReader::stopReading()
 {
+    // If reading through an EventLoop, stop watching the file first, waiting
+    // for any input event that is being handled on another thread to finish:
+    const int fileDescriptor = watchedFile.exchange(-1);
+    if (fileDescriptor != -1)
+    {
+        eventLoop->removeFD(fileDescriptor);
+    }
     // If on the reader thread, just make sure the event file is closed, and the
     // loop will terminate before it would try the next read call.
     if (pthread_equal(pthread_self(), threadID))
@@ -93,6 +149,17 @@ void DaemonFramework::InputReader::stopReading()
     }
     DF_DBG_V(messagePrefix << __func__ << ": closing reader for file \""
             << getPath() << "\".");
+    // Wake the reader thread, so it stops waiting for input:
+    if (wakeFD != -1)
+    {
+        const uint64_t wakeCount = 1;
+        if (write(wakeFD, &wakeCount, sizeof(wakeCount)) == -1)
+        {
+            DF_DBG(messagePrefix << __func__
+                    << ": Failed to wake reader thread:");
+            DF_PERROR(messagePrefix);
+        }
+    }
     std::lock_guard<std::mutex> lock(readerMutex);
     if (currentState != State::closed && currentState != State::failed)
     {
@@ -109,6 +176,35 @@ void DaemonFramework::InputReader::stopReading()
 }
 
 
+// Stops reading, waits for the reader thread to exit, and prepares to open the
+// input file again.
+void DaemonFramework::InputReader::resetReader()
+{
+    if (pthread_equal(pthread_self(), threadID))
+    {
+        stopReading();
+        return;
+    }
+    stopReading();
+    if (threadID != 0)
+    {
+        pthread_join(threadID, nullptr);
+        threadID = 0;
+    }
+    // Clear the wake event, so that a new reader thread won't stop early:
+    uint64_t wakeCount;
+    if (wakeFD != -1 && read(wakeFD, &wakeCount, sizeof(wakeCount)) == -1
+            && errno != EAGAIN)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to clear wake event:");
+        DF_PERROR(messagePrefix);
+    }
+    std::lock_guard<std::mutex> lock(readerMutex);
+    eventLoop = nullptr;
+    currentState = State::initializing;
+}
+
+
 // Gets the path used to open the input file.
 const std::string& DaemonFramework::InputReader::getPath() const
 {
@@ -126,46 +222,99 @@ DaemonFramework::InputReader::State DaemonFramework::InputReader::getState()
 // Continually waits for and processes input events.
 void DaemonFramework::InputReader::readLoop()
 {
-    while (inputFile != 0) 
+    struct pollfd waitFiles[2] = {};
+    waitFiles[1].fd = wakeFD;
+    waitFiles[1].events = POLLIN;
+    while (true)
     {
-        std::lock_guard<std::mutex> lock(readerMutex);
-        currentState = State::reading;
-        if (inputFile != 0)
         {
-            // Use select to wait for file input until the timeout period ends:
-            fd_set readSet;
-            fd_set emptyWriteSet, emptyExceptSet;
-            FD_ZERO(&readSet);
-            FD_ZERO(&emptyWriteSet);
-            FD_ZERO(&emptyExceptSet);
-            FD_SET(inputFile, &readSet);
-            struct timeval timeout;
-            timeout.tv_sec = 0;
-            timeout.tv_usec = readTimeoutMS;
-            if (select(inputFile + 1, &readSet, &emptyWriteSet, &emptyExceptSet,
-                        &timeout) == 1)
+            std::lock_guard<std::mutex> lock(readerMutex);
+            if (inputFile == 0)
+            {
+                return;
+            }
+            currentState = State::reading;
+            waitFiles[0].fd = inputFile;
+            waitFiles[0].events = POLLIN;
+        }
+        // Wait without the lock, so stopReading() can close the file. Only
+        // input or a stopReading() call will wake the thread:
+        if (poll(waitFiles, 2, -1) == -1)
+        {
+            if (errno == EINTR)
             {
-                currentState = State::processing;
-                errno = 0;
-                ssize_t readSize = read(inputFile, getBuffer(),
-                        getBufferSize());
-                if (errno != 0 || readSize == 0)
-                {
-                    DF_DBG(messagePrefix << __func__ <<
-                            ": Input reading failed, " << readSize
-                            << " bytes apparently read.");
-                    DF_PERROR(messagePrefix);
-                    closeInputFile();
-                    DF_DBG(messagePrefix << __func__  << ": Closed file \"" 
-                            << getPath() << "\".");
-                    currentState = State::closed;
-                }
-                else
-                {
-                    processInput(readSize);
-                }
+                continue;
             }
+            DF_DBG(messagePrefix << __func__ << ": Waiting for input failed:");
+            DF_PERROR(messagePrefix);
+            return;
+        }
+        if (waitFiles[1].revents != 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(readerMutex);
+        if (inputFile != 0 && waitFiles[0].revents != 0)
+        {
+            readInput();
+        }
+    }
+}
+
+
+// Reads and processes available input, closing the input file if reading
+// fails.
+void DaemonFramework::InputReader::readInput()
+{
+    DF_TRACE("InputReader::readInput");
+    currentState = State::processing;
+    errno = 0;
+    ssize_t readSize = read(inputFile, getBuffer(), getBufferSize());
+    if (readSize == -1 && (errno == EAGAIN || errno == EINTR))
+    {
+        // Non-blocking input file with no data ready yet:
+        return;
+    }
+    if (errno != 0 || readSize == 0)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Input reading failed, "
+                << readSize << " bytes apparently read.");
+        DF_PERROR(messagePrefix);
+        const int fileDescriptor = watchedFile.exchange(-1);
+        if (fileDescriptor != -1)
+        {
+            eventLoop->removeFD(fileDescriptor);
         }
+        closeInputFile();
+        DF_DBG(messagePrefix << __func__  << ": Closed file \"" 
+                << getPath() << "\".");
+        currentState = State::closed;
+    }
+    else
+    {
+        DF_METRIC_ADD(readCount, 1);
+        DF_METRIC_ADD(bytesRead, readSize);
+        DF_METRIC_OBSERVE(readSizes, readSize);
+        processInput(readSize);
+    }
+}
+
+
+// Handles input events when reading through an EventLoop.
+void DaemonFramework::InputReader::handleInputEvent()
+{
+    std::lock_guard<std::mutex> lock(readerMutex);
+    if (inputFile == 0)
+    {
+        return;
+    }
+    // Let stopReading() recognize calls made while processing input:
+    threadID = pthread_self();
+    readInput();
+    threadID = 0;
+    if (currentState == State::processing)
+    {
+        currentState = State::reading;
     }
 }
 
@@ -0,0 +1,523 @@
+#include "Debug.h"
+#ifdef DF_LOGGING
+#include "Log.h"
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert((DaemonFramework::Log::queueLines
+            & (DaemonFramework::Log::queueLines - 1)) == 0,
+        "Log queue size must be a power of two.");
+
+// Size in bytes of the buffer used to combine queued lines into larger writes:
+static const constexpr size_t writeBufferSize = 8192;
+
+namespace
+{
+    /**
+     * @brief  A stream buffer that formats text into a fixed-size array,
+     *         discarding any text that does not fit.
+     */
+    class LineBuffer : public std::streambuf
+    {
+    public:
+        LineBuffer()
+        {
+            clear();
+        }
+
+        /**
+         * @brief  Discards all buffered text.
+         */
+        void clear()
+        {
+            // Always keep space to add a newline:
+            setp(text, text + sizeof(text) - 1);
+        }
+
+        /**
+         * @brief  Ends the buffered line with a newline.
+         *
+         * @return  The size in bytes of the finished line.
+         */
+        size_t finishLine()
+        {
+            *pptr() = '\n';
+            return (size_t) (pptr() - pbase()) + 1;
+        }
+
+        /**
+         * @brief  Gets the buffered text.
+         */
+        const char* getText() const
+        {
+            return text;
+        }
+
+    protected:
+        // Discards characters once the buffer is full:
+        int_type overflow(int_type character) override
+        {
+            return traits_type::not_eof(character);
+        }
+
+    private:
+        char text[DaemonFramework::Log::maxLineSize];
+    };
+
+    /**
+     * @brief  Holds the stream each thread uses to format log lines.
+     */
+    struct LineStream
+    {
+        LineBuffer buffer;
+        std::ostream stream{&buffer};
+        // Absorbs lines begun while another line is being formatted:
+        LineBuffer discardBuffer;
+        std::ostream discardStream{&discardBuffer};
+        // Number of lines currently being formatted:
+        unsigned int depth = 0;
+    };
+
+    /**
+     * @brief  A queued log line.
+     */
+    struct Slot
+    {
+        // Equals the slot's queue position when the slot is free, and the
+        // position plus one when it holds a line waiting to be written:
+        std::atomic<size_t> sequence;
+        // The size of the line in bytes:
+        size_t size;
+        // The line's text:
+        char text[DaemonFramework::Log::maxLineSize];
+    };
+
+    /**
+     * @brief  Holds the line queue and the writer thread state.
+     */
+    struct Logger
+    {
+        // The current log level:
+        std::atomic<int> level;
+        // The file descriptor where lines are written:
+        int outputFD = STDOUT_FILENO;
+        // Queued lines:
+        Slot slots[DaemonFramework::Log::queueLines];
+        // The queue position where the next line will be added:
+        alignas(64) std::atomic<size_t> enqueuePosition{0};
+        // The queue position of the next line to write:
+        alignas(64) std::atomic<size_t> dequeuePosition{0};
+        // Number of lines dropped because the queue was full:
+        std::atomic<uint64_t> droppedLines{0};
+        // Whether the writer thread is waiting for new lines:
+        std::atomic<bool> writerWaiting{false};
+        // Used to wait for new lines and to wake the writer thread:
+        std::mutex wakeLock;
+        std::condition_variable writerWake;
+        // Held while taking lines from the queue and writing them:
+        std::mutex outputLock;
+        // Combines queued lines into larger writes:
+        char writeBuffer[writeBufferSize];
+        // Ensures the writer thread is only started once:
+        std::once_flag writerStarted;
+        // Protects the list of free line streams:
+        std::mutex streamLock;
+        // Line streams left by exited threads, ready to be reused:
+        std::vector<LineStream*> freeStreams;
+    };
+
+    /**
+     * @brief  Returns a thread's line stream to the logger's free streams
+     *         when the thread exits.
+     */
+    class LineStreamRecycler
+    {
+    public:
+        LineStreamRecycler(LineStream*& lineStream) :
+            lineStream(lineStream) { }
+
+        ~LineStreamRecycler();
+
+    private:
+        // The thread's line stream pointer, cleared when the stream is freed:
+        LineStream*& lineStream;
+    };
+}
+
+
+/**
+ * @brief  Reads the initial log level from the environment.
+ */
+static DaemonFramework::Log::Level readLevel()
+{
+    using DaemonFramework::Log::Level;
+    const char* levelName = getenv(DaemonFramework::Log::envVar);
+    if (levelName != nullptr)
+    {
+        const char* names[] = { "off", "error", "debug", "verbose" };
+        for (int i = 0; i < 4; i++)
+        {
+            if (strcmp(levelName, names[i]) == 0)
+            {
+                return static_cast<Level>(i);
+            }
+        }
+    }
+#ifdef DF_VERBOSE
+    return Level::verbose;
+#else
+    return Level::debug;
+#endif
+}
+
+
+/**
+ * @brief  Gets the logger, creating it on first use.
+ *
+ *  The logger is never destroyed, so that lines logged while the process exits
+ * never use a destroyed queue. It is created in static storage rather than
+ * with operator new, which doesn't respect its queue positions' cache line
+ * alignment before C++17.
+ */
+static Logger& getLogger()
+{
+    static std::aligned_storage<sizeof(Logger), alignof(Logger)>::type storage;
+    static Logger* logger = []()
+    {
+        Logger* newLogger = new (&storage) Logger;
+        newLogger->level = static_cast<int>(readLevel());
+        for (size_t i = 0; i < DaemonFramework::Log::queueLines; i++)
+        {
+            newLogger->slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        atexit(DaemonFramework::Log::flush);
+        return newLogger;
+    }();
+    return *logger;
+}
+
+
+/**
+ * @brief  Checks if the queue holds any lines that are ready to be written.
+ */
+static bool linesQueued(Logger& logger)
+{
+    using DaemonFramework::Log::queueLines;
+    const size_t position
+            = logger.dequeuePosition.load(std::memory_order_relaxed);
+    return logger.slots[position & (queueLines - 1)].sequence.load(
+            std::memory_order_acquire) == position + 1;
+}
+
+
+/**
+ * @brief  Writes an entire buffer to a file descriptor.
+ */
+static void writeAll(const int fileDescriptor, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t written = write(fileDescriptor, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= (size_t) written;
+    }
+}
+
+
+/**
+ * @brief  Writes all queued lines to the output. This must only be called
+ *         while holding the output lock.
+ */
+static void writeQueuedLines(Logger& logger)
+{
+    using DaemonFramework::Log::queueLines;
+    size_t bufferedSize = 0;
+    const uint64_t dropped = logger.droppedLines.exchange(0);
+    if (dropped > 0)
+    {
+        bufferedSize = (size_t) snprintf(logger.writeBuffer,
+                DaemonFramework::Log::maxLineSize,
+                "DaemonFramework::Log: Dropped %llu lines, queue was full.\n",
+                (unsigned long long) dropped);
+    }
+    size_t position = logger.dequeuePosition.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot& slot = logger.slots[position & (queueLines - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+        {
+            break;
+        }
+        if (bufferedSize + slot.size > writeBufferSize)
+        {
+            writeAll(logger.outputFD, logger.writeBuffer, bufferedSize);
+            bufferedSize = 0;
+        }
+        memcpy(logger.writeBuffer + bufferedSize, slot.text, slot.size);
+        bufferedSize += slot.size;
+        slot.sequence.store(position + queueLines, std::memory_order_release);
+        position++;
+        logger.dequeuePosition.store(position, std::memory_order_relaxed);
+    }
+    writeAll(logger.outputFD, logger.writeBuffer, bufferedSize);
+}
+
+
+/**
+ * @brief  Writes queued lines until the process exits, waiting for new lines
+ *         whenever the queue is empty.
+ */
+static void runWriter()
+{
+    Logger& logger = getLogger();
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> outputGuard(logger.outputLock);
+            writeQueuedLines(logger);
+        }
+        std::unique_lock<std::mutex> wakeGuard(logger.wakeLock);
+        logger.writerWaiting.store(true);
+        // Make sure a thread adding a line either sees that the writer is
+        // waiting, or has its line found here:
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (linesQueued(logger))
+        {
+            logger.writerWaiting.store(false);
+            continue;
+        }
+        logger.writerWake.wait(wakeGuard, [&logger]()
+        {
+            return ! logger.writerWaiting.load();
+        });
+    }
+}
+
+
+/**
+ * @brief  Copies a finished line into the queue, and wakes the writer thread
+ *         if it is waiting.
+ */
+static void queueLine(const char* text, const size_t size)
+{
+    using DaemonFramework::Log::queueLines;
+    Logger& logger = getLogger();
+    std::call_once(logger.writerStarted, []()
+    {
+        std::thread(runWriter).detach();
+    });
+    size_t position = logger.enqueuePosition.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;)
+    {
+        slot = &logger.slots[position & (queueLines - 1)];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == position)
+        {
+            if (logger.enqueuePosition.compare_exchange_weak(position,
+                    position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (sequence < position)
+        {
+            // The queue is full:
+            logger.droppedLines.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = logger.enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+    memcpy(slot->text, text, size);
+    slot->size = size;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (logger.writerWaiting.load(std::memory_order_relaxed)
+            && logger.writerWaiting.exchange(false))
+    {
+        std::lock_guard<std::mutex> wakeGuard(logger.wakeLock);
+        logger.writerWake.notify_one();
+    }
+}
+
+
+// Returns the thread's line stream to the free streams.
+LineStreamRecycler::~LineStreamRecycler()
+{
+    Logger& logger = getLogger();
+    std::lock_guard<std::mutex> streamGuard(logger.streamLock);
+    logger.freeStreams.push_back(lineStream);
+    lineStream = nullptr;
+}
+
+
+/**
+ * @brief  Gets the calling thread's line stream, reusing a stream freed by an
+ *         exited thread if possible.
+ *
+ *  Line streams are never destroyed, so that lines may still be logged while
+ * threads and the process exit. Each thread's stream is freed for reuse when
+ * the thread exits. A stream taken after the thread's stream was freed is
+ * kept until the process exits.
+ */
+static LineStream& getLineStream()
+{
+    static thread_local LineStream* lineStream = nullptr;
+    if (lineStream == nullptr)
+    {
+        Logger& logger = getLogger();
+        std::unique_lock<std::mutex> streamGuard(logger.streamLock);
+        if (logger.freeStreams.empty())
+        {
+            streamGuard.unlock();
+            lineStream = new LineStream;
+        }
+        else
+        {
+            lineStream = logger.freeStreams.back();
+            logger.freeStreams.pop_back();
+            streamGuard.unlock();
+            lineStream->depth = 0;
+        }
+        static thread_local LineStreamRecycler recycler(lineStream);
+    }
+    return *lineStream;
+}
+
+
+// Gets the current log level.
+DaemonFramework::Log::Level DaemonFramework::Log::getLevel()
+{
+    return static_cast<Level>(
+            getLogger().level.load(std::memory_order_relaxed));
+}
+
+
+// Sets the current log level.
+void DaemonFramework::Log::setLevel(const Level level)
+{
+    getLogger().level.store(static_cast<int>(level),
+            std::memory_order_relaxed);
+}
+
+
+// Checks if lines at a particular log level will be written.
+bool DaemonFramework::Log::isEnabled(const Level level)
+{
+    return level != Level::off && static_cast<int>(level)
+            <= getLogger().level.load(std::memory_order_relaxed);
+}
+
+
+// Sets the file descriptor where log lines are written.
+void DaemonFramework::Log::setOutput(const int fileDescriptor)
+{
+    Logger& logger = getLogger();
+    std::lock_guard<std::mutex> outputGuard(logger.outputLock);
+    writeQueuedLines(logger);
+    logger.outputFD = fileDescriptor;
+}
+
+
+// Gets the calling thread's line stream, cleared and ready to format a new
+// line.
+std::ostream& DaemonFramework::Log::beginLine()
+{
+    LineStream& lineStream = getLineStream();
+    lineStream.depth++;
+    if (lineStream.depth > 1)
+    {
+        lineStream.discardBuffer.clear();
+        return lineStream.discardStream;
+    }
+    lineStream.buffer.clear();
+    lineStream.stream.clear();
+    return lineStream.stream;
+}
+
+
+// Queues the line formatted since the last beginLine() call.
+void DaemonFramework::Log::endLine()
+{
+    LineStream& lineStream = getLineStream();
+    lineStream.depth--;
+    if (lineStream.depth == 0)
+    {
+        const size_t size = lineStream.buffer.finishLine();
+        queueLine(lineStream.buffer.getText(), size);
+    }
+}
+
+
+// Immediately writes all queued lines, waiting until they have been written.
+void DaemonFramework::Log::flush()
+{
+    Logger& logger = getLogger();
+    std::lock_guard<std::mutex> outputGuard(logger.outputLock);
+    writeQueuedLines(logger);
+}
+
+
+// Checks whether the call site may write another line.
+bool DaemonFramework::Log::CallSite::allowLine()
+{
+    struct timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &currentTime);
+    const uint32_t second = (uint32_t) currentTime.tv_sec + 1;
+    uint32_t lastSecond = periodSecond.load(std::memory_order_relaxed);
+    if (lastSecond != second && periodSecond.compare_exchange_strong(
+                lastSecond, second, std::memory_order_relaxed))
+    {
+        periodLines.store(0, std::memory_order_relaxed);
+        const uint32_t suppressed
+                = suppressedLines.exchange(0, std::memory_order_relaxed);
+        if (suppressed > 0)
+        {
+            beginLine() << PROC_COLOR "DaemonFramework::Log: Suppressed "
+                    << suppressed << " lines from the next message's source."
+                    << PROC_RESET "";
+            endLine();
+        }
+    }
+    if (periodLines.fetch_add(1, std::memory_order_relaxed)
+            < siteLinesPerSecond)
+    {
+        return true;
+    }
+    suppressedLines.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+
+// Formats an error number's description when written to a stream.
+std::ostream& DaemonFramework::Log::operator<<(std::ostream& stream,
+        const ErrorText& error)
+{
+    char errorBuffer[128];
+    return stream << strerror_r(error.errorNum, errorBuffer,
+            sizeof(errorBuffer));
+}
+
+#endif
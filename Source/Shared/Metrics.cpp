@@ -0,0 +1,618 @@
+#if defined DF_METRICS_ENABLED && DF_METRICS_ENABLED
+#include "Metrics.h"
+#include "Debug.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef DF_LOGGING
+// Print the namespace name before all info/error messages:
+static const constexpr char* messagePrefix = "DaemonFramework::Metrics::";
+#endif
+
+// Milliseconds to wait for a socket client's request before responding:
+static const constexpr int requestTimeoutMS = 100;
+
+/**
+ * @brief  Holds the counter and histogram values updated by one thread.
+ */
+struct ThreadValues
+{
+    std::atomic<uint64_t> values[DaemonFramework::Metrics::maxValues];
+};
+
+/**
+ * @brief  Tracks all metrics and all thread values.
+ */
+struct MetricRegistry
+{
+    // Protects all other registry data:
+    std::mutex lock;
+    // All registered metrics, in registration order:
+    std::vector<DaemonFramework::Metrics::Metric*> metrics;
+    // Values in use by running threads:
+    std::vector<ThreadValues*> threadValues;
+    // Cleared values left by exited threads, ready to be reused:
+    std::vector<ThreadValues*> freeValues;
+    // Sums of the values exited threads added before their values were freed:
+    uint64_t retiredValues[DaemonFramework::Metrics::maxValues] = {};
+    // Whether metrics serving was started when the first values were created:
+    bool startedServing = false;
+    // Index of the next value a new metric may reserve:
+    size_t nextValue = 0;
+    // Path where metrics are saved, or the empty string:
+    std::string filePath;
+};
+
+
+/**
+ * @brief  Gets the metric registry.
+ *
+ *  The registry and all thread values are never destroyed, so that threads
+ * still updating metrics while the process exits never use destroyed values.
+ */
+static MetricRegistry& getRegistry()
+{
+    static MetricRegistry* registry = new MetricRegistry;
+    return *registry;
+}
+
+
+/**
+ * @brief  Gets the current CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t now()
+{
+    struct timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    return (uint64_t) currentTime.tv_sec * 1000000000ULL
+            + (uint64_t) currentTime.tv_nsec;
+}
+
+
+/**
+ * @brief  Gets the path used for a metrics output, if its environment
+ *         variable is set.
+ *
+ *  Variables are read with secure_getenv, so processes launched with setuid or
+ * file capabilities never write metrics to paths chosen by whoever ran them.
+ *
+ * @param envVar  The environment variable holding the path prefix.
+ *
+ * @param suffix  A suffix to add after the program name.
+ *
+ * @return        The output path, or the empty string if the variable is
+ *                unset.
+ */
+static std::string getOutputPath(const char* envVar, const char* suffix)
+{
+    const char* pathPrefix = secure_getenv(envVar);
+    if (pathPrefix == nullptr || pathPrefix[0] == '\0')
+    {
+        return std::string();
+    }
+    // Launch arguments might not start with the program name, so read the
+    // name from the executable link instead:
+    char executablePath[PATH_MAX];
+    const ssize_t pathSize = readlink("/proc/self/exe", executablePath,
+            sizeof(executablePath) - 1);
+    executablePath[std::max<ssize_t>(pathSize, 0)] = '\0';
+    const char* programName = strrchr(executablePath, '/');
+    programName = (programName == nullptr) ? program_invocation_short_name
+            : programName + 1;
+    return std::string(pathPrefix) + "." + programName + suffix;
+}
+
+
+/**
+ * @brief  Creates a Unix socket listening for metrics clients.
+ *
+ * @param path  The socket path. An existing socket at this path is only
+ *              replaced if it is owned by this process's user.
+ *
+ * @return      The listening socket, or -1 if it could not be created.
+ */
+static int createSocket(const std::string& path)
+{
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        DF_DBG(messagePrefix << __func__ << ": Socket path \"" << path
+                << "\" is too long.");
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    struct stat pathInfo;
+    if (lstat(path.c_str(), &pathInfo) == 0 && S_ISSOCK(pathInfo.st_mode)
+            && pathInfo.st_uid == geteuid())
+    {
+        unlink(path.c_str());
+    }
+    const int listenFD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFD == -1)
+    {
+        DF_PERROR(messagePrefix << __func__ << ": Failed to create socket");
+        return -1;
+    }
+    if (bind(listenFD, (struct sockaddr*) &address, sizeof(address)) == -1
+            || listen(listenFD, 8) == -1)
+    {
+        DF_PERROR(messagePrefix << __func__ << ": Failed to bind socket \""
+                << path << "\"");
+        close(listenFD);
+        return -1;
+    }
+    return listenFD;
+}
+
+
+/**
+ * @brief  Sends all metrics to a connected socket client.
+ *
+ *  If the client sends an HTTP GET request, metrics are sent as an HTTP
+ * response. Otherwise, only the metrics text is sent.
+ */
+static void sendMetrics(const int client)
+{
+    char request[1024];
+    ssize_t requestSize = 0;
+    struct pollfd clientPoll = { client, POLLIN, 0 };
+    if (poll(&clientPoll, 1, requestTimeoutMS) > 0)
+    {
+        requestSize = recv(client, request, sizeof(request), MSG_DONTWAIT);
+    }
+    std::string response = DaemonFramework::Metrics::getText();
+    if (requestSize >= 4 && memcmp(request, "GET ", 4) == 0)
+    {
+        response = "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(response.size())
+                + "\r\nConnection: close\r\n\r\n" + response;
+    }
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        const ssize_t sendSize = send(client, response.data() + sent,
+                response.size() - sent, MSG_NOSIGNAL);
+        if (sendSize == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        sent += (size_t) sendSize;
+    }
+}
+
+
+/**
+ * @brief  Serves metrics until the process exits.
+ *
+ * @param listenFD  The listening metrics socket, or -1 if not serving metrics
+ *                  through a socket.
+ *
+ * @param filePath  The path where metrics are periodically saved, or the
+ *                  empty string if not saving metrics to a file.
+ */
+static void serveMetrics(const int listenFD, const std::string filePath)
+{
+    using DaemonFramework::Metrics::fileUpdateSeconds;
+    const uint64_t fileUpdateNS = fileUpdateSeconds * 1000000000ULL;
+    uint64_t nextFileUpdate = now();
+    for (;;)
+    {
+        int timeoutMS = -1;
+        if (! filePath.empty())
+        {
+            const uint64_t currentTime = now();
+            if (currentTime >= nextFileUpdate)
+            {
+                DaemonFramework::Metrics::writeFile(filePath.c_str());
+                nextFileUpdate = currentTime + fileUpdateNS;
+            }
+            timeoutMS = (int) ((nextFileUpdate - currentTime) / 1000000) + 1;
+        }
+        // Poll ignores negative file descriptors, so this only waits for the
+        // next file update when there is no socket:
+        struct pollfd listenPoll = { listenFD, POLLIN, 0 };
+        if (poll(&listenPoll, 1, timeoutMS) > 0
+                && (listenPoll.revents & POLLIN))
+        {
+            const int client = accept4(listenFD, nullptr, nullptr,
+                    SOCK_CLOEXEC);
+            if (client != -1)
+            {
+                sendMetrics(client);
+                close(client);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief  Saves metrics to the metrics file when the process exits.
+ */
+static void writeFileOnExit()
+{
+    const std::string& filePath = getRegistry().filePath;
+    if (! filePath.empty())
+    {
+        DaemonFramework::Metrics::writeFile(filePath.c_str());
+    }
+}
+
+
+/**
+ * @brief  Starts serving metrics if either metrics environment variable is
+ *         set.
+ *
+ * @param registry  The metric registry, which must already be locked.
+ */
+static void startServing(MetricRegistry& registry)
+{
+    using namespace DaemonFramework::Metrics;
+    const std::string socketPath = getOutputPath(socketEnvVar, "");
+    registry.filePath = getOutputPath(fileEnvVar, ".prom");
+    const int listenFD = socketPath.empty() ? -1 : createSocket(socketPath);
+    if (listenFD == -1 && registry.filePath.empty())
+    {
+        return;
+    }
+    if (! registry.filePath.empty())
+    {
+        atexit(writeFileOnExit);
+    }
+    std::thread(serveMetrics, listenFD, registry.filePath).detach();
+}
+
+
+/**
+ * @brief  Adds a thread's values to the retired sums and frees them for reuse
+ *         when the thread exits.
+ */
+class ThreadValuesRecycler
+{
+public:
+    ThreadValuesRecycler(ThreadValues*& threadValues) :
+        threadValues(threadValues) { }
+
+    ~ThreadValuesRecycler()
+    {
+        MetricRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> registryLock(registry.lock);
+        for (size_t i = 0; i < DaemonFramework::Metrics::maxValues; i++)
+        {
+            registry.retiredValues[i] += threadValues->values[i].exchange(0,
+                    std::memory_order_relaxed);
+        }
+        registry.threadValues.erase(std::remove(registry.threadValues.begin(),
+                    registry.threadValues.end(), threadValues),
+                registry.threadValues.end());
+        registry.freeValues.push_back(threadValues);
+        threadValues = nullptr;
+    }
+
+private:
+    // The thread's values pointer, cleared when the values are freed:
+    ThreadValues*& threadValues;
+};
+
+
+/**
+ * @brief  Gets the calling thread's values, creating them or reusing values
+ *         freed by an exited thread on first use.
+ *
+ *  When creating the first thread values, this also starts serving metrics.
+ * Values taken after the thread's values were freed are kept until the process
+ * exits.
+ */
+static ThreadValues* getThreadValues()
+{
+    static thread_local ThreadValues* threadValues = nullptr;
+    if (threadValues == nullptr)
+    {
+        MetricRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> registryLock(registry.lock);
+        if (! registry.startedServing)
+        {
+            registry.startedServing = true;
+            startServing(registry);
+        }
+        if (registry.freeValues.empty())
+        {
+            threadValues = new ThreadValues;
+            for (std::atomic<uint64_t>& value : threadValues->values)
+            {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            threadValues = registry.freeValues.back();
+            registry.freeValues.pop_back();
+        }
+        registry.threadValues.push_back(threadValues);
+        static thread_local ThreadValuesRecycler recycler(threadValues);
+    }
+    return threadValues;
+}
+
+
+/**
+ * @brief  Formats a number for the exposition format.
+ */
+static std::string formatNumber(const double value)
+{
+    char numberText[32];
+    snprintf(numberText, sizeof(numberText), "%.15g", value);
+    return numberText;
+}
+
+
+// Registers the metric, reserving its per-thread values.
+DaemonFramework::Metrics::Metric::Metric(const Type type, const char* name,
+        const char* help, const char* labels, const size_t valueCount) :
+    type(type), name(name), help(help), labels(labels)
+{
+    MetricRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.lock);
+    if (registry.nextValue + valueCount <= maxValues)
+    {
+        valueIndex = registry.nextValue;
+        registry.nextValue += valueCount;
+    }
+    else
+    {
+        DF_DBG(messagePrefix << __func__ << ": No values left for metric "
+                << name << ", it will not be updated.");
+        valueIndex = maxValues;
+    }
+    registry.metrics.push_back(this);
+}
+
+
+// Unregisters the metric.
+DaemonFramework::Metrics::Metric::~Metric()
+{
+    MetricRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.lock);
+    registry.metrics.erase(std::remove(registry.metrics.begin(),
+                registry.metrics.end(), this), registry.metrics.end());
+}
+
+
+// Adds to one of the calling thread's values.
+void DaemonFramework::Metrics::Metric::addValue(const size_t offset,
+        const uint64_t amount)
+{
+    if (valueIndex == maxValues)
+    {
+        return;
+    }
+    // Only the calling thread changes its own values, so they don't need
+    // atomic read-modify-write operations:
+    std::atomic<uint64_t>& value
+            = getThreadValues()->values[valueIndex + offset];
+    value.store(value.load(std::memory_order_relaxed) + amount,
+            std::memory_order_relaxed);
+}
+
+
+// Gets the sum of one value from all threads. This must only be called while
+// the registry is locked.
+uint64_t DaemonFramework::Metrics::Metric::sumValue(const size_t offset) const
+{
+    if (valueIndex == maxValues)
+    {
+        return 0;
+    }
+    const MetricRegistry& registry = getRegistry();
+    uint64_t sum = registry.retiredValues[valueIndex + offset];
+    for (const ThreadValues* threadValues : registry.threadValues)
+    {
+        sum += threadValues->values[valueIndex + offset].load(
+                std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+
+// Appends a single sample line.
+void DaemonFramework::Metrics::Metric::appendSample(std::string& text,
+        const char* suffix, const std::string& extraLabel,
+        const double value) const
+{
+    text += name;
+    text += suffix;
+    const bool hasLabels = (labels != nullptr && labels[0] != '\0');
+    if (hasLabels || ! extraLabel.empty())
+    {
+        text += '{';
+        if (hasLabels)
+        {
+            text += labels;
+            if (! extraLabel.empty())
+            {
+                text += ',';
+            }
+        }
+        text += extraLabel;
+        text += '}';
+    }
+    text += ' ';
+    text += formatNumber(value);
+    text += '\n';
+}
+
+
+// Appends the metric's current value in the exposition format.
+void DaemonFramework::Metrics::Metric::appendText(std::string& text) const
+{
+    // Metrics aren't virtual, so that metrics destroyed while the process exits
+    // can't be read through a partially destroyed object:
+    switch (type)
+    {
+        case Type::counter:
+            static_cast<const Counter*>(this)->appendValues(text);
+            break;
+        case Type::gauge:
+            static_cast<const Gauge*>(this)->appendValues(text);
+            break;
+        case Type::histogram:
+            static_cast<const Histogram*>(this)->appendValues(text);
+    }
+}
+
+
+// Appends the counter's current value.
+void DaemonFramework::Metrics::Counter::appendValues(std::string& text) const
+{
+    appendSample(text, "", "", (double) sumValue(0));
+}
+
+
+// Appends the gauge's current value.
+void DaemonFramework::Metrics::Gauge::appendValues(std::string& text) const
+{
+    appendSample(text, "", "",
+            (double) value.load(std::memory_order_relaxed));
+}
+
+
+// Appends the histogram's cumulative bucket counts, sum, and count.
+void DaemonFramework::Metrics::Histogram::appendValues(std::string& text) const
+{
+    uint64_t count = 0;
+    uint64_t bound = firstBound;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+        count += sumValue(bucket);
+        appendSample(text, "_bucket",
+                "le=\"" + formatNumber(bound * unitScale) + "\"",
+                (double) count);
+        bound *= 4;
+    }
+    count += sumValue(bucketCount);
+    appendSample(text, "_bucket", "le=\"+Inf\"", (double) count);
+    appendSample(text, "_sum", "",
+            sumValue(bucketCount + 1) * unitScale);
+    appendSample(text, "_count", "", (double) count);
+}
+
+
+// Starts timing.
+DaemonFramework::Metrics::Timer::Timer(Histogram& histogram,
+        Counter* slowCounter, const uint64_t slowNS) :
+    histogram(histogram), slowCounter(slowCounter), slowNS(slowNS),
+    startNS(now()) { }
+
+
+// Observes the nanoseconds since the timer was created.
+DaemonFramework::Metrics::Timer::~Timer()
+{
+    const uint64_t durationNS = now() - startNS;
+    histogram.observe(durationNS);
+    if (slowCounter != nullptr && durationNS >= slowNS)
+    {
+        slowCounter->add();
+    }
+}
+
+
+// Formats all registered metrics in the Prometheus text exposition format.
+std::string DaemonFramework::Metrics::getText()
+{
+    static const char* typeNames[] = { "counter", "gauge", "histogram" };
+    std::string text;
+    MetricRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.lock);
+    const std::vector<Metric*>& metrics = registry.metrics;
+    for (size_t i = 0; i < metrics.size(); i++)
+    {
+        // Write each family once, when its first metric is found:
+        bool familyWritten = false;
+        for (size_t j = 0; j < i && ! familyWritten; j++)
+        {
+            familyWritten = (strcmp(metrics[j]->name, metrics[i]->name) == 0);
+        }
+        if (familyWritten)
+        {
+            continue;
+        }
+        text = text + "# HELP " + metrics[i]->name + " " + metrics[i]->help
+                + "\n# TYPE " + metrics[i]->name + " "
+                + typeNames[static_cast<int>(metrics[i]->type)] + "\n";
+        for (size_t j = i; j < metrics.size(); j++)
+        {
+            if (strcmp(metrics[j]->name, metrics[i]->name) == 0)
+            {
+                metrics[j]->appendText(text);
+            }
+        }
+    }
+    return text;
+}
+
+
+// Saves all metrics to a file, replacing it atomically.
+bool DaemonFramework::Metrics::writeFile(const char* path)
+{
+    const std::string text = getText();
+    // Only write to a new file, so that links at the temporary path can't
+    // redirect the write:
+    const std::string tempPath = std::string(path) + "."
+            + std::to_string(getpid()) + ".tmp";
+    int file = -1;
+    do
+    {
+        errno = 0;
+        file = open(tempPath.c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+    }
+    while (file == -1 && errno == EINTR);
+    if (file == -1)
+    {
+        DF_PERROR(messagePrefix << __func__ << ": Failed to open \""
+                << tempPath << "\"");
+        return false;
+    }
+    size_t written = 0;
+    while (written < text.size())
+    {
+        const ssize_t writeSize = write(file, text.data() + written,
+                text.size() - written);
+        if (writeSize == -1 && errno != EINTR)
+        {
+            break;
+        }
+        written += (writeSize > 0) ? (size_t) writeSize : 0;
+    }
+    close(file);
+    if (written < text.size() || rename(tempPath.c_str(), path) == -1)
+    {
+        DF_PERROR(messagePrefix << __func__ << ": Failed to save \"" << path
+                << "\"");
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -6,9 +6,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <cstdio>
-
-#ifdef DF_DEBUG
 #include <string>
+
+#ifdef DF_LOGGING
 // Print the application and namespace name before all info/error messages:
 static const constexpr char* messagePrefix = "DaemonFramework::Pipe::";
 #endif
@@ -22,11 +22,8 @@ bool DaemonFramework::Pipe::createPipe(const char* path, const mode_t mode)
     {
         if (errno != ENOENT)
         {
-#           ifdef DF_DEBUG
-            std::string error(messagePrefix);
-            error = error +  __func__ + ": Error when checking pipe path";
-            DF_PERROR(error.c_str());
-#           endif
+            DF_PERROR(messagePrefix << __func__
+                    << ": Error when checking pipe path");
             return false;
         }
     }
@@ -1,5 +1,6 @@
 #include "Pipe_Reader.h"
 #include "Pipe_Listener.h"
+#include "Trace.h"
 #include "Debug.h"
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -7,9 +8,11 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
 
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 // Print the application and class name before all info/error messages:
 static const constexpr char* messagePrefix 
         = "DaemonFramework::Pipe::Reader::";
@@ -19,7 +22,8 @@ static const constexpr char* messagePrefix
 // Configures how pipe data will be found and processed.
 DaemonFramework::Pipe::Reader::Reader
 (const char* path, const size_t bufferSize) :
-        InputReader(path), listener(nullptr), bufSize(bufferSize)
+        InputReader(path), listener(nullptr), bufSize(bufferSize),
+        createdNS(monotonicNS()), messageCount(0), byteCount(0)
 {
     if (path != nullptr)
     {
@@ -46,13 +50,27 @@ DaemonFramework::Pipe::Reader::~Reader()
 
 
 // Asynchronously opens the pipe for reading.
-void DaemonFramework::Pipe::Reader::openPipe(Listener* listener)
+std::shared_future<bool> DaemonFramework::Pipe::Reader::openPipe
+(Listener* listener, EventLoop* eventLoop)
 {
-    if (! getPath().empty())
+    if (getPath().empty())
+    {
+        return getInitResult();
+    }
+    if (eventLoop == nullptr)
     {
         this->listener = listener;
+        this->eventLoop = nullptr;
         startInitThread();
     }
+    else if (beginInit())
+    {
+        // A non-blocking open finishes immediately, so no thread is needed:
+        this->listener = listener;
+        this->eventLoop = eventLoop;
+        finishInit(startReading(eventLoop));
+    }
+    return getInitResult();
 }
 
 
@@ -62,15 +80,61 @@ void DaemonFramework::Pipe::Reader::closePipe()
     if (! getPath().empty())
     {
         cancelInit();
-        stopReading();
+        resetReader();
+        resetInit();
     }
 }
 
 
+// Checks if the pipe was opened and then closed, either because all writers
+// closed the pipe or because reading failed.
+bool DaemonFramework::Pipe::Reader::isClosed()
+{
+    const State readerState = getState();
+    return readerState == State::closed || readerState == State::failed;
+}
+
+
+// Sets whether each message read from the pipe starts with a TimestampHeader.
+void DaemonFramework::Pipe::Reader::setTimestamps(const bool useTimestamps)
+{
+    timestamps = useTimestamps;
+}
+
+
+// Gets the number of messages and bytes received since the reader was created.
+DaemonFramework::Pipe::Traffic DaemonFramework::Pipe::Reader::getTraffic()
+const
+{
+    Traffic traffic;
+    traffic.messages = messageCount.load(std::memory_order_relaxed);
+    traffic.bytes = byteCount.load(std::memory_order_relaxed);
+    traffic.elapsedNS = monotonicNS() - createdNS;
+    return traffic;
+}
+
+
+// Gets the distribution of read() sizes in bytes.
+const DaemonFramework::HdrHistogram&
+DaemonFramework::Pipe::Reader::getReadSizes() const
+{
+    return readSizes;
+}
+
+
+// Gets the distribution of nanoseconds between sending and receiving each
+// message.
+const DaemonFramework::HdrHistogram&
+DaemonFramework::Pipe::Reader::getLatencies() const
+{
+    return latencies;
+}
+
+
 // Called by the asynchronous init thread to open the pipe file for reading.
 bool DaemonFramework::Pipe::Reader::threadedInitAction()
 {
-    return startReading();
+    return startReading(eventLoop);
 }
 
 
@@ -81,8 +145,13 @@ int DaemonFramework::Pipe::Reader::openFile()
     {
         return 0;
     }
+    // Any partial message left by a previous writer is discarded:
+    headerBytes = 0;
+    messageBytesLeft = 0;
     errno = 0;
-    int pipeFileDescriptor = open(getPath().c_str(), O_RDONLY);
+    // Open without waiting for a writer, so opening never blocks. Until a
+    // writer opens the pipe, the pipe won't become readable:
+    int pipeFileDescriptor = open(getPath().c_str(), O_RDONLY | O_NONBLOCK);
     if (errno != 0)
     {
         DF_DBG(messagePrefix << __func__ 
@@ -103,6 +172,8 @@ int DaemonFramework::Pipe::Reader::openFile()
 // Processes new data from the pipe file.
 void DaemonFramework::Pipe::Reader::processInput(const int inputBytes)
 {
+    DF_TRACE("Pipe::Reader::processInput");
+    DF_TRACE_COUNTER("Pipe::Reader bytes received", inputBytes);
     if (listener == nullptr)
     {
         DF_DBG(messagePrefix << __func__ << ": No Listener, closing pipe.");
@@ -116,12 +187,60 @@ void DaemonFramework::Pipe::Reader::processInput(const int inputBytes)
                 << inputBytes << ", expected < " << bufSize);
         DF_ASSERT(inputBytes <= bufSize);
     }
+    readSizes.record(inputBytes);
+    if (timestamps)
+    {
+        processTimestamped(inputBytes);
+        return;
+    }
+    messageCount.fetch_add(1, std::memory_order_relaxed);
+    byteCount.fetch_add(inputBytes, std::memory_order_relaxed);
     DF_DBG_V(messagePrefix << __func__ << ": Passing " << inputBytes 
             << " bytes of data to Listener.");
     listener->processData(buffer, inputBytes);
 }
 
 
+// Splits timestamped pipe data into headers and message data, recording
+// message latency and passing message data to the Listener.
+void DaemonFramework::Pipe::Reader::processTimestamped(const size_t inputBytes)
+{
+    const uint64_t receivedNS = monotonicNS();
+    size_t offset = 0;
+    while (offset < inputBytes)
+    {
+        if (messageBytesLeft == 0)
+        {
+            // Headers may be split between reads, so copy into place:
+            const size_t headerCopySize = std::min(inputBytes - offset,
+                    sizeof(TimestampHeader) - headerBytes);
+            memcpy(reinterpret_cast<unsigned char*>(&header) + headerBytes,
+                    buffer + offset, headerCopySize);
+            headerBytes += headerCopySize;
+            offset += headerCopySize;
+            if (headerBytes < sizeof(TimestampHeader))
+            {
+                return;
+            }
+            headerBytes = 0;
+            messageBytesLeft = header.size;
+            latencies.record((receivedNS > header.sendNS)
+                    ? (receivedNS - header.sendNS) : 0);
+            messageCount.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        const size_t dataSize = (size_t) std::min<uint64_t>(
+                inputBytes - offset, messageBytesLeft);
+        messageBytesLeft -= dataSize;
+        byteCount.fetch_add(dataSize, std::memory_order_relaxed);
+        DF_DBG_V(messagePrefix << __func__ << ": Passing " << dataSize
+                << " bytes of data to Listener.");
+        listener->processData(buffer + offset, dataSize);
+        offset += dataSize;
+    }
+}
+
+
 // Gets the maximum size in bytes available within the object's pipe input
 // buffer.
 int DaemonFramework::Pipe::Reader::getBufferSize() const
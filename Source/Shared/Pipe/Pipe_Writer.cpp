@@ -1,14 +1,23 @@
 #include "Pipe_Writer.h"
+#include "EventLoop.h"
+#include "StartupProfile.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include "Debug.h"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <chrono>
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 // Print the application and class name before all info/error messages:
 static const constexpr char* messagePrefix = "DaemonFramework::Pipe::Writer::";
 #endif
@@ -17,9 +26,34 @@ static const constexpr char* messagePrefix = "DaemonFramework::Pipe::Writer::";
 // the pipe:
 static const constexpr int writeInitTimeout = 1;
 
+// Milliseconds to wait before first retrying a non-blocking open, and the
+// maximum retry delay when no reader opens the pipe. Writers waiting for a
+// reader wake at most once per retry, so the maximum delay keeps idle writers
+// from waking often:
+static const constexpr int minRetryDelayMS = 1;
+static const constexpr int maxRetryDelayMS = 1000;
+
+// Maximum retry delay on init threads, kept shorter than writeInitTimeout so
+// that sendData() always sees a retry while waiting for the pipe to open:
+static const constexpr int maxThreadRetryDelayMS = 500;
+
+// Pipe writes taking at least this many nanoseconds are counted as stalls:
+static const constexpr uint64_t writeStallNS = 1000000;
+
+DF_METRIC_COUNTER(messagesWritten, "df_pipe_messages_written_total",
+        "Messages written to pipes.");
+DF_METRIC_COUNTER(bytesWritten, "df_pipe_written_bytes_total",
+        "Bytes written to pipes.");
+DF_METRIC_COUNTER(writeFailures, "df_pipe_write_failures_total",
+        "Messages that could not be written to pipes.");
+DF_METRIC_COUNTER(writeStalls, "df_pipe_write_stalls_total",
+        "Pipe writes that blocked for at least one millisecond.");
+DF_METRIC_HISTOGRAM(writeDurations, "df_pipe_write_duration_seconds",
+        "Time spent in each pipe write.", 1000, 8, 1e-9);
+
 // Saves the named pipe's path, optionally opening it immediately.
 DaemonFramework::Pipe::Writer::Writer(const char* path, const bool openNow) :
-    pipePath(path)
+    pipePath(path), createdNS(monotonicNS()), messageCount(0), byteCount(0)
 {
     if (path != nullptr && openNow)
     {
@@ -39,6 +73,7 @@ DaemonFramework::Pipe::Writer::~Writer()
 bool DaemonFramework::Pipe::Writer::sendData
 (const unsigned char* data, const size_t size)
 {
+    DF_TRACE("Pipe::Writer::sendData");
     if (pipePath.empty())
     {
         DF_DBG_V(messagePrefix << __func__
@@ -50,12 +85,15 @@ bool DaemonFramework::Pipe::Writer::sendData
             << " bytes of data.");
     if (! finishedInit())
     {
-        const bool success = waitForInit(writeInitTimeout);
+        const bool success = (eventLoop != nullptr)
+                ? waitForOpen(writeInitTimeout * 1000)
+                : waitForInit(writeInitTimeout);
         if (! success && ! finishedInit())
         {
             DF_DBG(messagePrefix << __func__ << ": Writing failed, pipe \""
                     << pipePath 
                     << "\" failed to open within timeout period.");
+            DF_METRIC_ADD(writeFailures, 1);
             return false;
         }
     }
@@ -63,31 +101,83 @@ bool DaemonFramework::Pipe::Writer::sendData
     {
         DF_DBG(messagePrefix << __func__ << ": Writing failed, pipe \""
                 << pipePath << "\" did not open successfully.");
+        DF_METRIC_ADD(writeFailures, 1);
         return false;
     }
     std::lock_guard<std::mutex> pipeLock(lock);
     errno = 0;
-    if (write(pipeFile, data, size) == -1)
+    ssize_t writeSize;
+    const uint64_t writeStartNS = monotonicNS();
+    if (timestamps)
+    {
+        // Send the header and data in one call, so messages from multiple
+        // writers aren't interleaved:
+        TimestampHeader header = { writeStartNS, size };
+        struct iovec messageParts[2] =
+        {
+            { &header, sizeof(header) },
+            { const_cast<unsigned char*>(data), size }
+        };
+        writeSize = writev(pipeFile, messageParts, 2);
+    }
+    else
+    {
+        writeSize = write(pipeFile, data, size);
+    }
+    const uint64_t writeNS = monotonicNS() - writeStartNS;
+    writeTimes.record(writeNS);
+    DF_METRIC_OBSERVE(writeDurations, writeNS);
+    if (writeNS >= writeStallNS)
+    {
+        DF_METRIC_ADD(writeStalls, 1);
+    }
+    if (writeSize == -1)
     {
         DF_DBG(messagePrefix << __func__
             << ": Failed to write data to pipe file.");
         DF_PERROR("Write error type");
+        DF_METRIC_ADD(writeFailures, 1);
         return false;
     }
+    DF_TRACE_COUNTER("Pipe::Writer bytes sent", size);
+    DF_METRIC_ADD(messagesWritten, 1);
+    DF_METRIC_ADD(bytesWritten, size);
+    messageCount.fetch_add(1, std::memory_order_relaxed);
+    byteCount.fetch_add(size, std::memory_order_relaxed);
     return true;
 }
 
 
 // Asynchronously opens the pipe file for writing.
-void DaemonFramework::Pipe::Writer::openPipe()
+std::shared_future<bool> DaemonFramework::Pipe::Writer::openPipe
+(EventLoop* eventLoop)
 {
-    startInitThread();
+    if (eventLoop == nullptr)
+    {
+        startInitThread();
+        return getInitResult();
+    }
+    if (beginInit())
+    {
+        this->eventLoop = eventLoop;
+        {
+            std::lock_guard<std::mutex> retryLock(retryMutex);
+            retrying = true;
+            retryDelayMS = minRetryDelayMS;
+        }
+        if (! tryOpen() && ! scheduleRetry())
+        {
+            finishInit(false);
+        }
+    }
+    return getInitResult();
 }
 
 
 // Closes the pipe file.
 void DaemonFramework::Pipe::Writer::closePipe()
 {
+    cancelRetry();
     cancelInit();
     std::lock_guard<std::mutex> pipeLock(lock);
     DF_DBG_V(messagePrefix << __func__ << ": Closing pipe \"" << pipePath
@@ -108,29 +198,210 @@ void DaemonFramework::Pipe::Writer::closePipe()
     }
     DF_DBG_V(messagePrefix << __func__ << ": Closed pipe \"" << pipePath
             << "\"");
+    resetInit();
+    eventLoop = nullptr;
+}
+
+
+// Sets whether each message sent through the pipe starts with a
+// TimestampHeader.
+void DaemonFramework::Pipe::Writer::setTimestamps(const bool useTimestamps)
+{
+    timestamps = useTimestamps;
+}
+
+
+// Gets the number of messages and bytes sent since the writer was created.
+DaemonFramework::Pipe::Traffic DaemonFramework::Pipe::Writer::getTraffic()
+const
+{
+    Traffic traffic;
+    traffic.messages = messageCount.load(std::memory_order_relaxed);
+    traffic.bytes = byteCount.load(std::memory_order_relaxed);
+    traffic.elapsedNS = monotonicNS() - createdNS;
+    return traffic;
+}
+
+
+// Gets the distribution of nanoseconds spent blocked in each pipe write.
+const DaemonFramework::HdrHistogram&
+DaemonFramework::Pipe::Writer::getWriteTimes() const
+{
+    return writeTimes;
 }
 
 
 // Opens the pipe in preparation for writing data.
 bool DaemonFramework::Pipe::Writer::threadedInitAction()
 {
+    DF_DBG_V(messagePrefix << __func__ << ": Opening pipe \"" << pipePath 
+            << "\" for initial writing.");
+    // Retry without blocking until a reader opens the pipe, so that
+    // cancelling initialization never has to interrupt a blocked open call:
+    int delayMS = minRetryDelayMS;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> pipeLock(lock);
+            const OpenStatus status = openWithoutBlocking();
+            if (status != OpenStatus::noReader)
+            {
+                return status == OpenStatus::opened;
+            }
+        }
+        if (waitForCancel(delayMS))
+        {
+            DF_DBG_V(messagePrefix << __func__ << ": Cancelled opening pipe \""
+                    << pipePath << "\"");
+            return false;
+        }
+        delayMS = std::min(delayMS * 2, maxThreadRetryDelayMS);
+    }
+}
+
+
+// Tries to open the pipe without blocking.
+bool DaemonFramework::Pipe::Writer::tryOpen()
+{
+    DF_TRACE("Pipe::Writer::tryOpen");
     std::lock_guard<std::mutex> pipeLock(lock);
-    if (pipeFile == 0)
+    if (! startedInit() || finishedInit())
+    {
+        return true;
+    }
+    const OpenStatus status = openWithoutBlocking();
+    if (status == OpenStatus::noReader)
+    {
+        return false;
+    }
+    finishInit(status == OpenStatus::opened);
+    return true;
+}
+
+
+// Opens the pipe file if a reader has opened the pipe, without blocking.
+DaemonFramework::Pipe::Writer::OpenStatus
+DaemonFramework::Pipe::Writer::openWithoutBlocking()
+{
+    if (pipeFile != 0)
+    {
+        return OpenStatus::opened;
+    }
+    errno = 0;
+    const int openedFile = open(pipePath.c_str(), O_WRONLY | O_NONBLOCK);
+    if (openedFile == -1)
+    {
+        if (errno == ENXIO)
+        {
+            return OpenStatus::noReader;
+        }
+        DF_DBG(messagePrefix << __func__ << ": Failed to open pipe \""
+                << pipePath << "\"");
+        DF_PERROR("Pipe opening error");
+        return OpenStatus::failed;
+    }
+    // Only the open call should be non-blocking, writes should still wait if
+    // the pipe is full:
+    fcntl(openedFile, F_SETFL, fcntl(openedFile, F_GETFL) & ~O_NONBLOCK);
+    pipeFile = openedFile;
+    DF_DBG_V(messagePrefix << __func__ << ": Opened pipe \"" << pipePath
+            << "\"");
+    StartupProfile::record("pipe writer opened", pipePath.c_str());
+    return OpenStatus::opened;
+}
+
+
+// Schedules the next tryOpen() call on the EventLoop.
+bool DaemonFramework::Pipe::Writer::scheduleRetry()
+{
+    std::lock_guard<std::mutex> retryLock(retryMutex);
+    if (! retrying)
+    {
+        return false;
+    }
+    if (retryTimerFD == -1)
     {
-        DF_DBG_V(messagePrefix << __func__ << ": Opening pipe \"" << pipePath 
-                << "\" for initial writing.");
         errno = 0;
-        pipeFile = open(pipePath.c_str(), O_WRONLY); 
-        if (errno != 0)
+        retryTimerFD = timerfd_create(CLOCK_MONOTONIC,
+                TFD_CLOEXEC | TFD_NONBLOCK);
+        if (retryTimerFD == -1)
+        {
+            DF_DBG(messagePrefix << __func__
+                    << ": Failed to create retry timer:");
+            DF_PERROR(messagePrefix);
+            return false;
+        }
+        const int timerFD = retryTimerFD;
+        if (! eventLoop->addFD(timerFD, EPOLLIN,
+                [this, timerFD](const uint32_t events)
+                {
+                    uint64_t expirations;
+                    if (read(timerFD, &expirations, sizeof(expirations)) == -1)
+                    {
+                        return;
+                    }
+                    if (tryOpen())
+                    {
+                        cancelRetry();
+                    }
+                    else if (! scheduleRetry())
+                    {
+                        finishInit(false);
+                    }
+                }))
+        {
+            close(retryTimerFD);
+            retryTimerFD = -1;
+            return false;
+        }
+    }
+    struct itimerspec timerValue = {};
+    timerValue.it_value.tv_sec = retryDelayMS / 1000;
+    timerValue.it_value.tv_nsec = (retryDelayMS % 1000) * 1000000;
+    if (timerfd_settime(retryTimerFD, 0, &timerValue, nullptr) == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to set retry timer:");
+        DF_PERROR(messagePrefix);
+        return false;
+    }
+    retryDelayMS = std::min(retryDelayMS * 2, maxRetryDelayMS);
+    return true;
+}
+
+
+// Cancels any scheduled tryOpen() call, and closes the retry timer.
+void DaemonFramework::Pipe::Writer::cancelRetry()
+{
+    int timerFD;
+    {
+        std::lock_guard<std::mutex> retryLock(retryMutex);
+        retrying = false;
+        timerFD = retryTimerFD;
+        retryTimerFD = -1;
+    }
+    if (timerFD != -1)
+    {
+        // Waits for any retry that is running on the EventLoop to finish:
+        eventLoop->removeFD(timerFD);
+        close(timerFD);
+    }
+}
+
+
+// Waits for the pipe to open when opening through an EventLoop, retrying on
+// the calling thread so that this also works on the EventLoop's own thread.
+bool DaemonFramework::Pipe::Writer::waitForOpen(const int timeoutMS)
+{
+    using namespace std::chrono;
+    const steady_clock::time_point waitEnd = steady_clock::now()
+            + milliseconds(timeoutMS);
+    while (! tryOpen())
+    {
+        if (steady_clock::now() >= waitEnd)
         {
-            DF_DBG(messagePrefix << __func__ << ": Failed to open pipe \""
-                    << pipePath << "\"");
-            DF_PERROR("Pipe opening error");
-            pipeFile = 0;
             return false;
         }
-        DF_DBG_V(messagePrefix << __func__ << ": Opened pipe \"" << pipePath
-                << "\"");
+        usleep(minRetryDelayMS * 1000);
     }
     return true;
 }
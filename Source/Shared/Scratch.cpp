@@ -0,0 +1,59 @@
+#include "Scratch.h"
+#include <new>
+
+// The calling thread's scratch memory resource, or nullptr to use the heap:
+static thread_local DaemonFramework::MemoryResource* currentResource = nullptr;
+
+/**
+ * @brief  A memory resource that allocates directly from the heap.
+ */
+class HeapResource : public DaemonFramework::MemoryResource
+{
+private:
+    virtual void* do_allocate(size_t bytes, size_t) override
+    {
+        return ::operator new(bytes);
+    }
+
+    virtual void do_deallocate(void* memory, size_t, size_t) override
+    {
+        ::operator delete(memory);
+    }
+
+    virtual bool do_is_equal(const MemoryResource& other) const noexcept
+            override
+    {
+        return this == &other;
+    }
+};
+
+
+// Gets the memory resource used for scratch memory on the calling thread.
+DaemonFramework::MemoryResource* DaemonFramework::Scratch::getResource()
+{
+    return (currentResource == nullptr) ? heapResource() : currentResource;
+}
+
+
+// Gets a memory resource that allocates directly from the heap.
+DaemonFramework::MemoryResource* DaemonFramework::Scratch::heapResource()
+{
+    static HeapResource resource;
+    return &resource;
+}
+
+
+// Starts using an arena for scratch memory.
+DaemonFramework::Scratch::Scope::Scope(Arena& arena) :
+arena(arena), previousResource(currentResource)
+{
+    currentResource = &arena;
+}
+
+
+// Resets the arena, and restores the previous scratch resource.
+DaemonFramework::Scratch::Scope::~Scope()
+{
+    currentResource = previousResource;
+    arena.reset();
+}
@@ -0,0 +1,243 @@
+#include "StartupProfile.h"
+#include "Debug.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <mutex>
+
+#if defined DF_STARTUP_PROFILE_ENABLED && DF_STARTUP_PROFILE_ENABLED
+#ifdef DF_LOGGING
+// Print the namespace name before all info/error messages:
+static const constexpr char* messagePrefix
+    = "DaemonFramework::StartupProfile::";
+#endif
+
+// Maximum size in bytes of a single profile record:
+static const constexpr size_t maxRecordSize = 512;
+
+// Maximum number of records held before the profile file may be opened:
+static const constexpr size_t maxHeldRecords = 32;
+
+// Protects held records:
+static std::mutex heldRecordMutex;
+// Whether new records are held instead of written:
+static bool recordsHeld = false;
+// Records waiting to be written:
+static char heldRecords[maxHeldRecords][maxRecordSize];
+// The size in bytes of each held record:
+static size_t heldRecordSizes[maxHeldRecords];
+// The number of held records:
+static size_t heldRecordCount = 0;
+
+
+/**
+ * @brief  Gets the profile file path from the environment.
+ *
+ * @return  The profile path, or nullptr if profiling is disabled.
+ */
+static const char* getProfilePath()
+{
+    const char* profilePath
+            = secure_getenv(DaemonFramework::StartupProfile::envVar);
+    if (profilePath == nullptr || profilePath[0] == '\0')
+    {
+        return nullptr;
+    }
+    return profilePath;
+}
+
+
+/**
+ * @brief  Opens the profile file selected by the profile environment variable.
+ *
+ * @return  The open file descriptor, or -1 if profiling is disabled or the
+ *          file couldn't be opened.
+ */
+static int openProfile()
+{
+    const char* profilePath = getProfilePath();
+    if (profilePath == nullptr)
+    {
+        return -1;
+    }
+    errno = 0;
+    const int profileFD = open(profilePath,
+            O_WRONLY | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+            S_IRUSR | S_IWUSR);
+    if (profileFD == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to open profile \""
+                << profilePath << "\":");
+        DF_PERROR(messagePrefix);
+    }
+    return profileFD;
+}
+
+
+/**
+ * @brief  Gets the profile file descriptor, opening it on first use.
+ *
+ * @return  The profile file descriptor, or -1 if profiling is disabled.
+ */
+static int getProfileFD()
+{
+    static const int profileFD = openProfile();
+    return profileFD;
+}
+
+
+/**
+ * @brief  Appends a complete record to the profile file.
+ *
+ * @param profileFD   The open profile file descriptor.
+ *
+ * @param line        The record text.
+ *
+ * @param lineSize    The size of the record in bytes.
+ */
+static void writeRecord(const int profileFD, const char* line,
+        const size_t lineSize)
+{
+    // Records are appended with a single write, so records from separate
+    // processes and threads are never mixed together:
+    ssize_t writeSize;
+    do
+    {
+        writeSize = write(profileFD, line, lineSize);
+    }
+    while (writeSize == -1 && errno == EINTR);
+}
+
+
+// Checks if startup profiling is enabled.
+bool DaemonFramework::StartupProfile::isEnabled()
+{
+    return getProfileFD() != -1;
+}
+
+
+// Records that a startup phase finished, if profiling is enabled.
+void DaemonFramework::StartupProfile::record
+(const char* phase, const char* detail, const uint64_t timeNS)
+{
+    const uint64_t recordTime = (timeNS == 0) ? now() : timeNS;
+    // Held records are saved without opening the profile file:
+    std::unique_lock<std::mutex> heldLock(heldRecordMutex);
+    const bool holding = recordsHeld;
+    if (! holding)
+    {
+        heldLock.unlock();
+    }
+    if (holding ? (getProfilePath() == nullptr) : (getProfileFD() == -1))
+    {
+        return;
+    }
+    char line[maxRecordSize];
+    const int lineSize = snprintf(line, sizeof(line), "%llu %d %s%s%s\n",
+            (unsigned long long) recordTime,
+            (int) getpid(), phase, (detail == nullptr) ? "" : " ",
+            (detail == nullptr) ? "" : detail);
+    if (lineSize <= 0 || (size_t) lineSize >= sizeof(line))
+    {
+        DF_DBG(messagePrefix << __func__ << ": Skipping oversized record.");
+        return;
+    }
+    if (! holding)
+    {
+        writeRecord(getProfileFD(), line, lineSize);
+        return;
+    }
+    if (heldRecordCount == maxHeldRecords)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Too many held records, "
+                << "skipping \"" << phase << "\".");
+        return;
+    }
+    memcpy(heldRecords[heldRecordCount], line, lineSize);
+    heldRecordSizes[heldRecordCount] = lineSize;
+    heldRecordCount++;
+}
+
+
+// Records the times passed to a daemon through childStartVar and execVar, and
+// removes those variables from the environment.
+void DaemonFramework::StartupProfile::recordLaunchTimes()
+{
+    const char* childStartTime = secure_getenv(childStartVar);
+    if (childStartTime != nullptr)
+    {
+        record("daemon process started", nullptr,
+                strtoull(childStartTime, nullptr, 10));
+        unsetenv(childStartVar);
+    }
+    const char* execTime = secure_getenv(execVar);
+    if (execTime != nullptr)
+    {
+        record("file table cleaned", nullptr,
+                strtoull(execTime, nullptr, 10));
+        unsetenv(execVar);
+    }
+}
+
+
+// Holds all later records in memory without opening the profile file, until
+// releaseRecords() is called.
+void DaemonFramework::StartupProfile::holdRecords()
+{
+    std::lock_guard<std::mutex> heldLock(heldRecordMutex);
+    recordsHeld = true;
+}
+
+
+// Writes all held records to the profile file, and stops holding new records.
+void DaemonFramework::StartupProfile::releaseRecords()
+{
+    std::lock_guard<std::mutex> heldLock(heldRecordMutex);
+    if (! recordsHeld)
+    {
+        return;
+    }
+    recordsHeld = false;
+    const int profileFD = (heldRecordCount > 0) ? getProfileFD() : -1;
+    for (size_t i = 0; i < heldRecordCount && profileFD != -1; i++)
+    {
+        writeRecord(profileFD, heldRecords[i], heldRecordSizes[i]);
+    }
+    heldRecordCount = 0;
+}
+#endif
+
+
+// Gets the current time used for all profile records.
+uint64_t DaemonFramework::StartupProfile::now()
+{
+    struct timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    return (uint64_t) currentTime.tv_sec * 1000000000ULL
+            + (uint64_t) currentTime.tv_nsec;
+}
+
+
+// Prints a time value as a decimal number without a null terminator.
+size_t DaemonFramework::StartupProfile::printTime
+(char* buffer, uint64_t timeNS)
+{
+    char digits[maxTimeDigits];
+    size_t digitCount = 0;
+    do
+    {
+        digits[digitCount++] = '0' + (timeNS % 10);
+        timeNS /= 10;
+    }
+    while (timeNS > 0);
+    for (size_t i = 0; i < digitCount; i++)
+    {
+        buffer[i] = digits[digitCount - i - 1];
+    }
+    return digitCount;
+}
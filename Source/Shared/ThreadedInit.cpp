@@ -1,15 +1,15 @@
 #include "ThreadedInit.h"
+#include "InitExecutor.h"
 #include "Debug.h"
-#include <chrono>
 
-#ifdef DF_DEBUG
+#ifdef DF_LOGGING
 // Print the application and class name before all info/error messages:
 static const constexpr char* messagePrefix
     = "DaemonFramework::ThreadedInit::";
 #endif
 
 
-// Stops the init thread if it is still running on destruction.
+// Cancels initialization if it is still running on destruction.
 DaemonFramework::ThreadedInit::~ThreadedInit()
 {
     cancelInit();
@@ -40,112 +40,209 @@ bool DaemonFramework::ThreadedInit::successfulInit()
 }
 
 
-// Wait for the thread to finish initializing.
+// Wait for initialization to finish.
 bool DaemonFramework::ThreadedInit::waitForInit(const int timeout)
 {
-    std::unique_lock<std::mutex> lock(initMutex);
-    if (initFinished)
-    {
-        return true;
-    }
     if (timeout < 1)
     {
-        initCondition.wait(lock);
-        return true;
+        std::unique_lock<std::mutex> lock(initMutex);
+        initCondition.wait(lock, [this]()
+        {
+            return initFinished || ! initStarted;
+        });
+        return initFinished;
     }
-    using namespace std::chrono;
-    const seconds maxWait(timeout);
-    std::cv_status waitResult = initCondition.wait_for(lock, maxWait);
-    return waitResult != std::cv_status::timeout;
+    return waitForInitUntil(std::chrono::steady_clock::now()
+            + std::chrono::seconds(timeout));
+}
 
+
+// Wait for initialization to finish until a deadline passes.
+bool DaemonFramework::ThreadedInit::waitForInitUntil
+(const std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(initMutex);
+    initCondition.wait_until(lock, deadline, [this]()
+    {
+        return initFinished || ! initStarted;
+    });
+    return initFinished;
 }
 
 
-// If not already initialized or initializing, start the initialization thread
-// and run the initialization function.
+// Gets a handle that completes when initialization finishes.
+std::shared_future<bool> DaemonFramework::ThreadedInit::getInitResult()
+{
+    std::lock_guard<std::mutex> lock(initMutex);
+    return initResult;
+}
+
+
+// If not already initialized or initializing, run the initialization function
+// on a pooled init thread.
 void DaemonFramework::ThreadedInit::startInitThread()
 {
     std::lock_guard<std::mutex> lock(initMutex);
     if (! initStarted)
     {
         initStarted = true;
-        int initResult = pthread_create(&initThreadID, nullptr, threadAction,
-                this);
-        if (initResult != 0)
+        cancelRequested = false;
+        resetInitResult();
+        initRunning = InitExecutor::getInstance().run(
+                [this]() { runInitAction(); },
+                [this]() { finishInitAction(); });
+        if (! initRunning)
         {
-            DF_DBG(messagePrefix << __func__ 
-                    << ": Failed to start init thread.");
-            initFinished = true;
-            initSucceeded = false;
+            DF_DBG(messagePrefix << __func__
+                    << ": Failed to start init action.");
+            setInitResult(false);
         }
     }
 }
 
 
-// If still initializing, force the initialization thread to stop.
-void DaemonFramework::ThreadedInit::cancelInit()
+// If not already initialized or initializing, marks initialization as started
+// without starting a new thread.
+bool DaemonFramework::ThreadedInit::beginInit()
+{
+    std::lock_guard<std::mutex> lock(initMutex);
+    if (initStarted)
+    {
+        return false;
+    }
+    initStarted = true;
+    cancelRequested = false;
+    resetInitResult();
+    return true;
+}
+
+
+// Records the result of initialization started with beginInit(), and wakes all
+// threads waiting for initialization to finish.
+void DaemonFramework::ThreadedInit::finishInit(const bool succeeded)
 {
-    int cancelResult;
     {
         std::lock_guard<std::mutex> lock(initMutex);
-        if (! initStarted || initFinished || initThreadID == 0)
+        if (! initStarted || initFinished)
         {
             return;
         }
-        DF_DBG_V(messagePrefix << __func__ << ": Force-closing init thread.");
-        cancelResult = pthread_cancel(initThreadID);
+        setInitResult(succeeded);
     }
-    if (cancelResult != 0)
+    initCondition.notify_all();
+}
+
+
+// If still initializing, asks the initialization action to stop and waits for
+// it to return.
+void DaemonFramework::ThreadedInit::cancelInit()
+{
+    std::unique_lock<std::mutex> lock(initMutex);
+    if (! initStarted || initFinished)
     {
-        DF_DBG(messagePrefix << __func__ 
-                << ": Encountered an error when cancelling the init thread.");
-        if (cancelResult == ESRCH)
-        {
-            DF_DBG(messagePrefix << __func__ << ": Thread "
-                    << initThreadID << " not found.");
-        }
-        else
-        {
-            DF_DBG(messagePrefix << __func__
-                    << ": Unknown pthread_cancel error " << cancelResult);
-        }
+        return;
     }
-    errno = 0;
-    int joinResult = pthread_join(initThreadID, nullptr);
-    if (joinResult != 0)
+    DF_DBG_V(messagePrefix << __func__ << ": Cancelling initialization.");
+    cancelRequested = true;
+    initCondition.notify_all();
+    if (initRunning && ! pthread_equal(pthread_self(), initThreadID))
     {
-        DF_DBG(messagePrefix << __func__ 
-                << ": Encountered an error when joining the init thread.");
-        switch (joinResult)
-        {
-            case EDEADLK:
-                DF_DBG(messagePrefix << __func__ << ": Error EDEADLK");
-                break;
-            case EINVAL:
-                DF_DBG(messagePrefix << __func__ << ": Error EINVAL");
-                break;
-            case ESRCH:
-                DF_DBG(messagePrefix << __func__ << ": Error ESRCH");
-                break;
-            default:
-                DF_DBG(messagePrefix << __func__ << ": Unknown error "
-                        << joinResult);
-        }
+        initCondition.wait(lock, [this]() { return ! initRunning; });
+    }
+    if (! initFinished && ! initRunning)
+    {
+        // Initialization started without a thread, and never finished:
+        setInitResult(false);
+        initCondition.notify_all();
+    }
+}
+
+
+// Cancels initialization if running, and clears all initialization state so
+// that startInitThread() may run again.
+void DaemonFramework::ThreadedInit::resetInit()
+{
+    cancelInit();
+    std::lock_guard<std::mutex> lock(initMutex);
+    if (initRunning)
+    {
+        // Called from within the initialization action, which will finish
+        // after this returns:
+        return;
+    }
+    initStarted = false;
+    initFinished = false;
+    initSucceeded = false;
+    cancelRequested = false;
+    initResult = std::shared_future<bool>();
+    initCondition.notify_all();
+}
+
+
+// Checks if initialization was cancelled.
+bool DaemonFramework::ThreadedInit::initCancelled()
+{
+    std::lock_guard<std::mutex> lock(initMutex);
+    return cancelRequested;
+}
+
+
+// Waits until initialization is cancelled or a timeout period ends.
+bool DaemonFramework::ThreadedInit::waitForCancel(const int timeoutMS)
+{
+    std::unique_lock<std::mutex> lock(initMutex);
+    return initCondition.wait_for(lock, std::chrono::milliseconds(timeoutMS),
+            [this]() { return cancelRequested; });
+}
+
+
+// Runs the initialization action on a pooled init thread.
+void DaemonFramework::ThreadedInit::runInitAction()
+{
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        initThreadID = pthread_self();
+        actionResult = false;
+    }
+    if (! initCancelled())
+    {
+        DF_DBG_V(messagePrefix << __func__ << ": Init action running.");
+        const bool result = threadedInitAction();
+        std::lock_guard<std::mutex> lock(initMutex);
+        actionResult = result;
     }
 }
 
 
-//The main callback function that will run on the new thread.
-void* DaemonFramework::ThreadedInit::threadAction(void* threadInit)
+// Saves the initialization action's result once its pooled thread is ready
+// for new tasks, and wakes all threads waiting for initialization to finish.
+void DaemonFramework::ThreadedInit::finishInitAction()
 {
-    DF_DBG_V(messagePrefix << __func__ << ": Init thread running.");
-    ThreadedInit* threadInitObject = static_cast<ThreadedInit*>(threadInit);
-    const bool initResult = threadInitObject->threadedInitAction();
+    // Notify while locked, so this object can't be destroyed before this
+    // thread is done using it:
+    std::lock_guard<std::mutex> lock(initMutex);
+    initThreadID = 0;
+    initRunning = false;
+    if (! initFinished)
     {
-        std::lock_guard<std::mutex> lock(threadInitObject->initMutex);
-        threadInitObject->initFinished = true;
-        threadInitObject->initSucceeded = initResult;
+        setInitResult(actionResult);
     }
-    threadInitObject->initCondition.notify_all();
-    return nullptr;
+    initCondition.notify_all();
+}
+
+
+// Creates a new initialization result handle.
+void DaemonFramework::ThreadedInit::resetInitResult()
+{
+    initPromise = std::promise<bool>();
+    initResult = initPromise.get_future().share();
+}
+
+
+// Saves the initialization result, and completes the result handle.
+void DaemonFramework::ThreadedInit::setInitResult(const bool succeeded)
+{
+    initFinished = true;
+    initSucceeded = succeeded;
+    initPromise.set_value(succeeded);
 }
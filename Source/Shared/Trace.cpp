@@ -0,0 +1,317 @@
+#if defined DF_TRACE_ENABLED && DF_TRACE_ENABLED
+#include "Trace.h"
+#include "Debug.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef DF_LOGGING
+// Print the namespace name before all info/error messages:
+static const constexpr char* messagePrefix = "DaemonFramework::Trace::";
+#endif
+
+static_assert((DaemonFramework::Trace::bufferRecords
+            & (DaemonFramework::Trace::bufferRecords - 1)) == 0,
+        "Trace buffer size must be a power of two.");
+
+/**
+ * @brief  Holds the most recent trace records added by one thread.
+ */
+struct ThreadBuffer
+{
+    // The owning thread's ID:
+    pid_t threadID;
+    // The owning thread's name when the buffer was created:
+    char threadName[16];
+    // Total number of records ever added. Only the owning thread changes
+    // this, after writing each new record:
+    std::atomic<uint64_t> recordCount;
+    // Saved records, indexed by record number modulo bufferRecords:
+    DaemonFramework::Trace::Record
+            records[DaemonFramework::Trace::bufferRecords];
+};
+
+/**
+ * @brief  Tracks all thread buffers.
+ */
+struct BufferRegistry
+{
+    // Protects the buffer list:
+    std::mutex lock;
+    // All thread buffers ever created:
+    std::vector<ThreadBuffer*> buffers;
+    // Path where records are dumped on exit, or the empty string:
+    std::string exitPath;
+};
+
+
+/**
+ * @brief  Gets the buffer registry.
+ *
+ *  The registry and its buffers are never destroyed, so that threads still
+ * adding records while the process exits never use destroyed buffers.
+ */
+static BufferRegistry& getRegistry()
+{
+    static BufferRegistry* registry = new BufferRegistry;
+    return *registry;
+}
+
+
+/**
+ * @brief  Dumps all records to the exit path when the process exits.
+ */
+static void dumpOnExit()
+{
+    const std::string& exitPath = getRegistry().exitPath;
+    if (! exitPath.empty())
+    {
+        DaemonFramework::Trace::dump(exitPath.c_str());
+    }
+}
+
+
+/**
+ * @brief  Creates and registers a new buffer for the calling thread.
+ *
+ *  When creating the first buffer, this also schedules the exit dump if the
+ * trace environment variable is set.
+ *
+ * @return  The new buffer.
+ */
+static ThreadBuffer* createBuffer()
+{
+    ThreadBuffer* buffer = new ThreadBuffer;
+    buffer->threadID = (pid_t) syscall(SYS_gettid);
+    buffer->threadName[0] = '\0';
+    prctl(PR_GET_NAME, buffer->threadName);
+    buffer->threadName[sizeof(buffer->threadName) - 1] = '\0';
+    buffer->recordCount = 0;
+    BufferRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.lock);
+    if (registry.buffers.empty())
+    {
+        const char* tracePath
+                = secure_getenv(DaemonFramework::Trace::envVar);
+        if (tracePath != nullptr && tracePath[0] != '\0')
+        {
+            registry.exitPath = std::string(tracePath) + "."
+                    + std::to_string(getpid()) + ".json";
+            atexit(dumpOnExit);
+        }
+    }
+    registry.buffers.push_back(buffer);
+    return buffer;
+}
+
+
+/**
+ * @brief  Gets the calling thread's buffer, creating it on first use.
+ */
+static ThreadBuffer* getThreadBuffer()
+{
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        buffer = createBuffer();
+    }
+    return buffer;
+}
+
+
+/**
+ * @brief  Writes a time in nanoseconds as a number of microseconds.
+ */
+static void writeMicroseconds(std::ostream& output, const uint64_t timeNS)
+{
+    const unsigned int fraction = timeNS % 1000;
+    output << (timeNS / 1000) << '.' << (fraction / 100)
+            << ((fraction / 10) % 10) << (fraction % 10);
+}
+
+
+/**
+ * @brief  Writes a string as a JSON string value.
+ */
+static void writeString(std::ostream& output, const char* text)
+{
+    output << '"';
+    for (const char* character = text; *character != '\0'; character++)
+    {
+        if (*character == '"' || *character == '\\')
+        {
+            output << '\\' << *character;
+        }
+        else if ((unsigned char) *character >= ' ')
+        {
+            output << *character;
+        }
+    }
+    output << '"';
+}
+
+
+/**
+ * @brief  Writes a single record as a Chrome trace event.
+ */
+static void writeRecord(std::ostream& output,
+        const DaemonFramework::Trace::Record& record, const pid_t processID,
+        const pid_t threadID)
+{
+    using DaemonFramework::Trace::EventType;
+    output << ",\n{\"name\":";
+    writeString(output, record.name);
+    output << ",\"pid\":" << processID << ",\"tid\":" << threadID
+            << ",\"ts\":";
+    writeMicroseconds(output, record.startNS);
+    switch (record.type)
+    {
+        case EventType::duration:
+            output << ",\"ph\":\"X\",\"dur\":";
+            writeMicroseconds(output, record.durationNS);
+            output << "}";
+            break;
+        case EventType::instant:
+            output << ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"value\":"
+                    << record.value << "}}";
+            break;
+        case EventType::counter:
+            output << ",\"ph\":\"C\",\"args\":{\"value\":" << record.value
+                    << "}}";
+    }
+}
+
+
+// Adds a record to the calling thread's trace buffer.
+void DaemonFramework::Trace::addRecord(const char* name, const EventType type,
+        const uint64_t startNS, const uint64_t durationNS, const int64_t value)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    const uint64_t index = buffer->recordCount.load(std::memory_order_relaxed);
+    Record& record = buffer->records[index & (bufferRecords - 1)];
+    record.name = name;
+    record.startNS = startNS;
+    record.durationNS = durationNS;
+    record.value = value;
+    record.type = type;
+    buffer->recordCount.store(index + 1, std::memory_order_release);
+}
+
+
+/**
+ * @brief  Replaces a file with new text.
+ *
+ *  The text is written to a newly created temporary file, which is then
+ * renamed to replace the file, so links at either path can't redirect the
+ * write.
+ *
+ * @param path  The path of the file to replace.
+ *
+ * @param text  The new file contents.
+ *
+ * @return      Whether the file was replaced.
+ */
+static bool saveFile(const char* path, const std::string& text)
+{
+    const std::string tempPath = std::string(path) + "."
+            + std::to_string(getpid()) + ".tmp";
+    int file = -1;
+    do
+    {
+        errno = 0;
+        file = open(tempPath.c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+    }
+    while (file == -1 && errno == EINTR);
+    if (file == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to open \""
+                << tempPath << "\"");
+        return false;
+    }
+    size_t written = 0;
+    while (written < text.size())
+    {
+        const ssize_t writeSize = write(file, text.data() + written,
+                text.size() - written);
+        if (writeSize == -1 && errno != EINTR)
+        {
+            break;
+        }
+        written += (writeSize > 0) ? (size_t) writeSize : 0;
+    }
+    close(file);
+    if (written < text.size() || rename(tempPath.c_str(), path) == -1)
+    {
+        DF_DBG(messagePrefix << __func__ << ": Failed to save \"" << path
+                << "\"");
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+// Saves all buffered records from all threads as a Chrome trace event JSON
+// file.
+bool DaemonFramework::Trace::dump(const char* path)
+{
+    std::vector<ThreadBuffer*> buffers;
+    {
+        BufferRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> registryLock(registry.lock);
+        buffers = registry.buffers;
+    }
+    std::ostringstream output;
+    const pid_t processID = getpid();
+    output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+            << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << processID
+            << ",\"args\":{\"name\":";
+    writeString(output, program_invocation_short_name);
+    output << "}}";
+    std::vector<Record> records;
+    for (const ThreadBuffer* buffer : buffers)
+    {
+        output << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":"
+                << processID << ",\"tid\":" << buffer->threadID
+                << ",\"args\":{\"name\":";
+        writeString(output, buffer->threadName);
+        output << "}}";
+
+        const uint64_t endIndex
+                = buffer->recordCount.load(std::memory_order_acquire);
+        const uint64_t startIndex = (endIndex > bufferRecords)
+                ? (endIndex - bufferRecords) : 0;
+        records.clear();
+        for (uint64_t i = startIndex; i < endIndex; i++)
+        {
+            records.push_back(buffer->records[i & (bufferRecords - 1)]);
+        }
+        // The owner may have replaced the oldest copied records, and may be
+        // replacing one more record right now:
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t latestIndex
+                = buffer->recordCount.load(std::memory_order_relaxed);
+        const uint64_t validIndex = (latestIndex >= bufferRecords)
+                ? (latestIndex - bufferRecords + 1) : 0;
+        for (uint64_t i = std::max(startIndex, validIndex); i < endIndex; i++)
+        {
+            writeRecord(output, records[i - startIndex], processID,
+                    buffer->threadID);
+        }
+    }
+    output << "\n]}\n";
+    return saveFile(path, output.str());
+}
+
+#endif
@@ -19,18 +19,46 @@ DF_SHARED_FILE_PREFIX := $(DF_SHARED_PREFIX)File_
 DF_SHARED_FILE_OBJ := $(DF_SHARED_OBJ)File_
 
 DF_OBJECTS_SHARED_FILE := \
-  $(DF_SHARED_FILE_OBJ)Utils.o
+  $(DF_SHARED_FILE_OBJ)Utils.o \
+  $(DF_SHARED_FILE_OBJ)Identity.o
 
 DF_OBJECTS_SHARED := \
+  $(DF_SHARED_OBJ)Arena.o \
+  $(DF_SHARED_OBJ)EventLoop.o \
+  $(DF_SHARED_OBJ)HdrHistogram.o \
+  $(DF_SHARED_OBJ)InitExecutor.o \
   $(DF_SHARED_OBJ)InputReader.o \
+  $(DF_SHARED_OBJ)Log.o \
+  $(DF_SHARED_OBJ)Metrics.o \
+  $(DF_SHARED_OBJ)Scratch.o \
+  $(DF_SHARED_OBJ)StartupProfile.o \
   $(DF_SHARED_OBJ)ThreadedInit.o \
+  $(DF_SHARED_OBJ)Trace.o \
   $(DF_OBJECTS_SHARED_FILE) \
   $(DF_OBJECTS_SHARED_PIPE)
 
+$(DF_SHARED_OBJ)Arena.o: \
+	$(DF_SHARED_DIR)/Arena.cpp
+$(DF_SHARED_OBJ)EventLoop.o: \
+	$(DF_SHARED_DIR)/EventLoop.cpp
+$(DF_SHARED_OBJ)HdrHistogram.o: \
+	$(DF_SHARED_DIR)/HdrHistogram.cpp
+$(DF_SHARED_OBJ)InitExecutor.o: \
+	$(DF_SHARED_DIR)/InitExecutor.cpp
 $(DF_SHARED_OBJ)InputReader.o: \
 	$(DF_SHARED_DIR)/InputReader.cpp
+$(DF_SHARED_OBJ)Log.o: \
+	$(DF_SHARED_DIR)/Log.cpp
+$(DF_SHARED_OBJ)Metrics.o: \
+	$(DF_SHARED_DIR)/Metrics.cpp
+$(DF_SHARED_OBJ)Scratch.o: \
+	$(DF_SHARED_DIR)/Scratch.cpp
+$(DF_SHARED_OBJ)StartupProfile.o: \
+	$(DF_SHARED_DIR)/StartupProfile.cpp
 $(DF_SHARED_OBJ)ThreadedInit.o: \
 	$(DF_SHARED_DIR)/ThreadedInit.cpp
+$(DF_SHARED_OBJ)Trace.o: \
+	$(DF_SHARED_DIR)/Trace.cpp
 
 $(DF_SHARED_PIPE_OBJ)Pipe.o: \
 	$(DF_SHARED_PIPE_DIR)/Pipe.cpp
@@ -41,3 +69,5 @@ $(DF_SHARED_PIPE_OBJ)Writer.o: \
 
 $(DF_SHARED_FILE_OBJ)Utils.o: \
 	$(DF_SHARED_FILE_DIR)/File_Utils.cpp
+$(DF_SHARED_FILE_OBJ)Identity.o: \
+	$(DF_SHARED_FILE_DIR)/File_Identity.cpp
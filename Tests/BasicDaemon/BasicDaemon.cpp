@@ -3,8 +3,6 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
-#include <chrono>
-#include <ctime>
 #include <cassert>
 #include <unistd.h>
     
@@ -14,14 +12,15 @@ static const constexpr char* messagePrefix = "BasicDaemon: ";
 // Input buffer size:
 static const constexpr size_t bufSize = 128;
 
-// Daemon loop duration in nanoseconds:
-static const constexpr size_t loopNS = 10000;
+// Maximum milliseconds to wait for parent messages between loop actions:
+static const constexpr int loopTimeoutMS = 1000;
 
 // Message indicating that the daemon should exit:
 static const constexpr char* exitMessage = "exit";
 
-// Code indicating a normal exit due to an exit message:
-static const constexpr int exitMessageCode = 9;
+// Code indicating a normal exit due to an exit message, chosen to avoid
+// conflicting with DaemonFramework::ExitCode values:
+static const constexpr int exitMessageCode = 100;
 
 class BasicDaemon : public DaemonFramework::DaemonLoop
 {
@@ -55,22 +54,9 @@ private:
         {
             return exitMessageCode;
         }
-        typedef std::chrono::nanoseconds Nanoseconds;
-        typedef std::chrono::time_point<std::chrono::high_resolution_clock,
-                Nanoseconds> Time;
-        const Time loopStart = std::chrono::high_resolution_clock::now();
-        static const Nanoseconds loopDuration(loopNS);
-        struct timespec sleepTimer = {0, 0};
         // Do stuff here:
-        // Sleep until loop duration ends:
-        const Time loopEnd = std::chrono::high_resolution_clock::now();
-        Nanoseconds timePassed = loopEnd - loopStart;
-        if (timePassed < loopDuration)
-        {
-            Nanoseconds sleepTime = loopDuration - timePassed;
-            sleepTimer.tv_nsec = sleepTime.count();
-            nanosleep(&sleepTimer, nullptr);
-        }
+        // Sleep until the parent sends a message or the timeout ends:
+        waitForEvents(loopTimeoutMS);
         return 0;
     }
 
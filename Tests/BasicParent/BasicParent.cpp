@@ -93,6 +93,11 @@ int main(int argc, char** argv)
     }
     if (timeout > 0)
     {
+        // Start the timeout period once the daemon can handle messages:
+        if (! daemonController.waitUntilReady())
+        {
+            std::cerr << messagePrefix << "Daemon exited before ready.\n";
+        }
         sleep(timeout);
         static const char* exitMessage = "exit";
         static const size_t messageLength = 5;
@@ -0,0 +1,324 @@
+/**
+ * @file  BenchmarkDaemon.cpp
+ *
+ * @brief  A daemon used by benchmark parent programs to measure
+ *         DaemonFramework communication costs.
+ *
+ *  The daemon reads benchmark messages defined in BenchmarkProtocol.h, and
+ * replies to each complete message through its output pipe. Messages may be
+ * split across several reads, so the daemon tracks how much of the current
+ * message it has received. All messages are handled on the input pipe's
+ * thread, so the main loop only waits between security checks.
+ *
+ *  Benchmarks may select how the main loop waits for its next tick:
+ *
+ *   BenchmarkDaemon [--pacing <mode>] [--rate <Hz>] [--ticks <path>]
+ *
+ * - "sleep" (the default) sleeps for one tick period after each tick.
+ * - "absolute" sleeps until the next tick deadline, so time spent in the loop
+ *   doesn't delay later ticks.
+ * - "timerfd" blocks on a periodic timerfd.
+ * - "spin" busy-waits until the next tick deadline without yielding the CPU.
+ *
+ *  The default rate is 1000 Hz. If a ticks path is given, the daemon records
+ * the time of each tick, and writes its CPU time and all recorded tick times
+ * to that file when it exits.
+ */
+
+#include "DaemonLoop.h"
+#include "BenchmarkProtocol.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// Print the application name before all info/error output:
+static const constexpr char* messagePrefix = "BenchmarkDaemon: ";
+
+// Input buffer size, which limits the amount of data handled in each read:
+static const constexpr size_t bufSize = 64 * 1024;
+
+// Default main loop tick rate in Hz:
+static const constexpr long defaultRate = 1000;
+
+// Maximum number of tick times recorded:
+static const constexpr size_t maxTicks = 1000000;
+
+// Nanoseconds per second:
+static const constexpr uint64_t secondNS = 1000000000;
+
+/**
+ * @brief  Ways the main loop may wait for its next tick.
+ */
+enum class Pacing
+{
+    sleep,
+    absolute,
+    timerfd,
+    spin
+};
+
+/**
+ * @brief  Gets the current CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t nowNS()
+{
+    struct timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    return (uint64_t) currentTime.tv_sec * secondNS
+            + (uint64_t) currentTime.tv_nsec;
+}
+
+
+/**
+ * @brief  Converts a time in nanoseconds to a timespec structure.
+ */
+static struct timespec toTimespec(const uint64_t timeNS)
+{
+    struct timespec time;
+    time.tv_sec = timeNS / secondNS;
+    time.tv_nsec = timeNS % secondNS;
+    return time;
+}
+
+
+class BenchmarkDaemon : public DaemonFramework::DaemonLoop
+{
+public:
+    /**
+     * @brief  Prepares the daemon's main loop.
+     *
+     * @param pacing     How the loop waits for its next tick.
+     *
+     * @param rate       The target number of ticks per second.
+     *
+     * @param ticksPath  The path where tick times will be written, or the
+     *                   empty string if tick times shouldn't be recorded.
+     */
+    BenchmarkDaemon(const Pacing pacing, const long rate,
+            const std::string& ticksPath) :
+        DaemonFramework::DaemonLoop(bufSize), pacing(pacing),
+        periodNS(secondNS / rate), ticksPath(ticksPath)
+    {
+        if (! ticksPath.empty())
+        {
+            tickTimes.reserve(maxTicks);
+        }
+    }
+
+    virtual ~BenchmarkDaemon()
+    {
+        if (tickTimer != -1)
+        {
+            close(tickTimer);
+        }
+    }
+
+    /**
+     * @brief  Writes the daemon's CPU time in microseconds and all recorded
+     *         tick times, one value per line, if a ticks path was given.
+     */
+    void writeTicks() const
+    {
+        if (ticksPath.empty())
+        {
+            return;
+        }
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        const long long cpuUS = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+                * 1000000LL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+        std::ofstream ticksFile(ticksPath);
+        ticksFile << cpuUS << "\n";
+        for (const uint64_t tickTime : tickTimes)
+        {
+            ticksFile << tickTime << "\n";
+        }
+    }
+
+private:
+    virtual int initLoop() override
+    {
+        nextTickNS = nowNS() + periodNS;
+        if (pacing == Pacing::timerfd)
+        {
+            tickTimer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+            struct itimerspec timerSpec;
+            timerSpec.it_interval = toTimespec(periodNS);
+            timerSpec.it_value = toTimespec(periodNS);
+            if (tickTimer == -1
+                    || timerfd_settime(tickTimer, 0, &timerSpec, nullptr) == -1)
+            {
+                std::cerr << messagePrefix << "Failed to create tick timer.\n";
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    virtual int loopAction() override
+    {
+        switch (pacing)
+        {
+            case Pacing::sleep:
+            {
+                const struct timespec sleepTimer = toTimespec(periodNS);
+                nanosleep(&sleepTimer, nullptr);
+                break;
+            }
+            case Pacing::absolute:
+            {
+                const struct timespec deadline = toTimespec(nextTickNS);
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                        nullptr);
+                break;
+            }
+            case Pacing::timerfd:
+            {
+                uint64_t expirations;
+                if (read(tickTimer, &expirations, sizeof(expirations)) == -1)
+                {
+                    return 0;
+                }
+                break;
+            }
+            case Pacing::spin:
+                while (nowNS() < nextTickNS) { }
+        }
+        const uint64_t tickNS = nowNS();
+        if (! ticksPath.empty() && tickTimes.size() < maxTicks)
+        {
+            tickTimes.push_back(tickNS);
+        }
+        // Skip missed deadlines instead of running several ticks at once:
+        nextTickNS += periodNS;
+        if (nextTickNS <= tickNS)
+        {
+            nextTickNS = tickNS + periodNS;
+        }
+        return 0;
+    }
+
+    virtual void handleParentMessage(const unsigned char* messageData,
+            const size_t messageSize) override
+    {
+        using namespace BenchmarkProtocol;
+        size_t offset = 0;
+        while (offset < messageSize)
+        {
+            if (headerBytesRead < headerSize)
+            {
+                const size_t copySize = std::min(headerSize - headerBytesRead,
+                        messageSize - offset);
+                memcpy(headerBuffer + headerBytesRead, messageData + offset,
+                        copySize);
+                headerBytesRead += copySize;
+                offset += copySize;
+                if (headerBytesRead < headerSize)
+                {
+                    return;
+                }
+                memcpy(&header, headerBuffer, headerSize);
+                if ((header & configFlag) != 0)
+                {
+                    messageLength = std::max<size_t>(header & ~configFlag,
+                            headerSize);
+                    bytesRemaining = 0;
+                }
+                else
+                {
+                    bytesRemaining = messageLength - headerSize;
+                }
+            }
+            const size_t skipSize = std::min(bytesRemaining,
+                    messageSize - offset);
+            offset += skipSize;
+            bytesRemaining -= skipSize;
+            if (bytesRemaining == 0)
+            {
+                sendAck();
+            }
+        }
+    }
+
+    /**
+     * @brief  Acknowledges the current message, and prepares to read the next
+     *         message.
+     */
+    void sendAck()
+    {
+        using namespace std::chrono;
+        BenchmarkProtocol::Ack ack;
+        ack.header = header;
+        ack.receivedNS = duration_cast<nanoseconds>(
+                steady_clock::now().time_since_epoch()).count();
+        messageParent((const unsigned char*) &ack, sizeof(ack));
+        headerBytesRead = 0;
+    }
+
+    // The size of each normal message, including its header:
+    size_t messageLength = BenchmarkProtocol::headerSize;
+    // Holds the current message header as it is received:
+    unsigned char headerBuffer[BenchmarkProtocol::headerSize] = {0};
+    // Number of bytes of the current message header received so far:
+    size_t headerBytesRead = 0;
+    // The current message header:
+    uint64_t header = 0;
+    // Number of bytes of the current message that are still on the way:
+    size_t bytesRemaining = 0;
+
+    // How the main loop waits for its next tick:
+    const Pacing pacing;
+    // Nanoseconds between ticks:
+    const uint64_t periodNS;
+    // Path where tick times are written, or the empty string:
+    const std::string ticksPath;
+    // Time of the next tick deadline:
+    uint64_t nextTickNS = 0;
+    // Timer used for timerfd pacing:
+    int tickTimer = -1;
+    // Recorded tick times:
+    std::vector<uint64_t> tickTimes;
+};
+
+int main(int argc, char** argv)
+{
+    Pacing pacing = Pacing::sleep;
+    long rate = defaultRate;
+    std::string ticksPath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        if (option == "--pacing")
+        {
+            pacing = (value == "absolute") ? Pacing::absolute
+                    : (value == "timerfd") ? Pacing::timerfd
+                    : (value == "spin") ? Pacing::spin : Pacing::sleep;
+        }
+        else if (option == "--rate")
+        {
+            rate = std::max(1L, std::stol(value));
+        }
+        else if (option == "--ticks")
+        {
+            ticksPath = value;
+        }
+    }
+    BenchmarkDaemon daemon(pacing, rate, ticksPath);
+    const int result = daemon.runLoop();
+    daemon.writeTicks();
+    if (result != 0)
+    {
+        std::cerr << messagePrefix << "Daemon process " << (int) getpid()
+                << " exiting with code " << result << "\n";
+    }
+    return result;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file  BenchmarkOutput.h
+ *
+ * @brief  Summarizes benchmark measurements, and formats them as JSON records
+ *         for automated comparison.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace BenchmarkOutput
+{
+    /**
+     * @brief  Percentiles calculated from a set of measurements.
+     */
+    struct Percentiles
+    {
+        size_t count = 0;
+        double mean = 0;
+        double min = 0;
+        double p50 = 0;
+        double p90 = 0;
+        double p99 = 0;
+        double p999 = 0;
+        double max = 0;
+    };
+
+    /**
+     * @brief  Calculates percentiles from a set of measurements, using the
+     *         nearest-rank method.
+     *
+     * @param values  The measurements, in any order.
+     *
+     * @return        The calculated percentiles, or all zeroes if values is
+     *                empty.
+     */
+    inline Percentiles getPercentiles(std::vector<double> values)
+    {
+        Percentiles result;
+        if (values.empty())
+        {
+            return result;
+        }
+        std::sort(values.begin(), values.end());
+        const auto rank = [&values](const double percentile)
+        {
+            const size_t index = (size_t) std::ceil(percentile / 100.0
+                    * values.size());
+            return values[std::max<size_t>(index, 1) - 1];
+        };
+        double sum = 0;
+        for (const double value : values)
+        {
+            sum += value;
+        }
+        result.count = values.size();
+        result.mean = sum / values.size();
+        result.min = values.front();
+        result.p50 = rank(50);
+        result.p90 = rank(90);
+        result.p99 = rank(99);
+        result.p999 = rank(99.9);
+        result.max = values.back();
+        return result;
+    }
+
+    /**
+     * @brief  Builds a single-line JSON object, so that each benchmark result
+     *         may be printed as one line of JSON Lines output.
+     */
+    class JsonRecord
+    {
+    public:
+        /**
+         * @brief  Adds a string value.
+         */
+        JsonRecord& add(const std::string& name, const std::string& value)
+        {
+            std::string escaped;
+            for (const char c : value)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    escaped += '\\';
+                }
+                escaped += c;
+            }
+            return addRaw(name, '"' + escaped + '"');
+        }
+
+        /**
+         * @brief  Adds a string value.
+         */
+        JsonRecord& add(const std::string& name, const char* value)
+        {
+            return add(name, std::string(value));
+        }
+
+        /**
+         * @brief  Adds a numeric value.
+         */
+        JsonRecord& add(const std::string& name, const double value)
+        {
+            std::ostringstream valueStream;
+            valueStream << value;
+            return addRaw(name, std::isfinite(value) ? valueStream.str()
+                    : "null");
+        }
+
+        /**
+         * @brief  Adds an integer value.
+         */
+        JsonRecord& add(const std::string& name, const long long value)
+        {
+            return addRaw(name, std::to_string(value));
+        }
+
+        /**
+         * @brief  Adds an integer value.
+         */
+        JsonRecord& add(const std::string& name, const int value)
+        {
+            return add(name, (long long) value);
+        }
+
+        /**
+         * @brief  Adds an integer value.
+         */
+        JsonRecord& add(const std::string& name, const size_t value)
+        {
+            return addRaw(name, std::to_string(value));
+        }
+
+        /**
+         * @brief  Adds a boolean value.
+         */
+        JsonRecord& add(const std::string& name, const bool value)
+        {
+            return addRaw(name, value ? "true" : "false");
+        }
+
+        /**
+         * @brief  Adds each percentile as a separate value, using the given
+         *         prefix and suffix in each name.
+         */
+        JsonRecord& add(const std::string& prefix,
+                const Percentiles& percentiles, const std::string& suffix)
+        {
+            add(prefix + "_count", percentiles.count);
+            add(prefix + "_mean" + suffix, percentiles.mean);
+            add(prefix + "_min" + suffix, percentiles.min);
+            add(prefix + "_p50" + suffix, percentiles.p50);
+            add(prefix + "_p90" + suffix, percentiles.p90);
+            add(prefix + "_p99" + suffix, percentiles.p99);
+            add(prefix + "_p999" + suffix, percentiles.p999);
+            return add(prefix + "_max" + suffix, percentiles.max);
+        }
+
+        /**
+         * @brief  Gets the complete JSON object.
+         */
+        std::string toString() const
+        {
+            return '{' + fields + '}';
+        }
+
+    private:
+        JsonRecord& addRaw(const std::string& name, const std::string& value)
+        {
+            if (! fields.empty())
+            {
+                fields += ',';
+            }
+            fields += '"' + name + "\":" + value;
+            return *this;
+        }
+
+        std::string fields;
+    };
+}
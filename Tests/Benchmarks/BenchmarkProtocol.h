@@ -0,0 +1,46 @@
+/**
+ * @file  BenchmarkProtocol.h
+ *
+ * @brief  Defines the messages exchanged between benchmark parent programs
+ *         and the BenchmarkDaemon.
+ *
+ *  Each benchmark message starts with a 64-bit header. Normal messages store
+ * the steady_clock time in nanoseconds when the parent started sending the
+ * message, followed by padding that brings the message up to the current
+ * message size. Because std::chrono::steady_clock uses the system-wide
+ * CLOCK_MONOTONIC clock on Linux, times recorded by the parent and the daemon
+ * may be compared directly.
+ *
+ *  Configuration messages set the size of all following normal messages.
+ * Their header holds the message size combined with configFlag, and nothing
+ * else. Configuration messages must only be sent while no normal messages are
+ * waiting for acknowledgement.
+ *
+ *  The daemon replies to each message with an Ack once the entire message has
+ * been received.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace BenchmarkProtocol
+{
+    // Header bit that marks configuration messages:
+    static const constexpr uint64_t configFlag = 1ULL << 63;
+
+    // Size in bytes of each message header:
+    static const constexpr size_t headerSize = sizeof(uint64_t);
+
+    /**
+     * @brief  The reply sent by the daemon for each message it receives.
+     */
+    struct Ack
+    {
+        // The header of the acknowledged message:
+        uint64_t header;
+        // The daemon's steady_clock time in nanoseconds when the last byte of
+        // the message was received:
+        uint64_t receivedNS;
+    };
+}
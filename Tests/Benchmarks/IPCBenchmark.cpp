@@ -0,0 +1,527 @@
+/**
+ * @file  IPCBenchmark.cpp
+ *
+ * @brief  Measures the latency and throughput of messages sent between a
+ *         parent process and its daemon through DaemonFramework pipes.
+ *
+ *  Each message travels from DaemonControl::messageParent() through the
+ * daemon's input pipe to BenchmarkDaemon::handleParentMessage(), which replies
+ * through DaemonLoop::messageParent() and the daemon's output pipe to this
+ * program's Pipe::Listener::processData() function.
+ *
+ *  For each message, the benchmark records:
+ * - One-way latency: the time between starting to send the message and the
+ *   daemon receiving its last byte.
+ * - Round-trip latency: the time between starting to send the message and
+ *   receiving the daemon's reply.
+ *
+ *  Both processes read the same monotonic clock, so one-way times need no
+ * clock synchronization. Send times are recorded before waiting for other
+ * senders, so latency with several senders includes time spent waiting for
+ * access to the pipe.
+ *
+ *  Each combination of message size and sender count is measured in two
+ * modes. In latency mode, each sender waits for the reply to its last message
+ * before sending another. In throughput mode, each sender keeps several
+ * messages in flight, measuring sustained throughput.
+ *
+ *  Results are printed as a table, or as one JSON object per line when run
+ * with "--format json".
+ */
+
+#include "DaemonControl.h"
+#include "BenchmarkOutput.h"
+#include "BenchmarkProtocol.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if ! defined DF_DAEMON_PATH || ! defined DF_INPUT_PIPE_PATH \
+        || ! defined DF_OUTPUT_PIPE_PATH
+#error "IPCBenchmark requires the daemon and pipe paths from benchmarkPaths.mk"
+#endif
+
+// Print the application name before all info/error output:
+static const constexpr char* messagePrefix = "IPCBenchmark: ";
+
+// Default message sizes to measure, in bytes:
+static const std::vector<size_t> defaultSizes =
+{
+    8, 64, 512, 4 * 1024, 32 * 1024, 256 * 1024, 1024 * 1024
+};
+
+// Default numbers of concurrent senders to measure:
+static const std::vector<size_t> defaultSenders = { 1, 2, 4, 8 };
+
+// Default maximum number of messages each sender sends per measurement:
+static const constexpr size_t defaultMessages = 2000;
+
+// Default maximum megabytes sent by all senders per measurement:
+static const constexpr size_t defaultMaxMB = 256;
+
+// Minimum number of messages each sender sends per measurement:
+static const constexpr size_t minMessages = 20;
+
+// Default number of messages each sender keeps in flight in throughput mode:
+static const constexpr size_t defaultWindow = 16;
+
+// Number of unrecorded messages sent before each measurement:
+static const constexpr size_t warmupMessages = 20;
+
+// Milliseconds to wait for the daemon to start:
+static const constexpr int startTimeoutMS = 5000;
+
+// Seconds to wait for any single reply before giving up:
+static const constexpr int replyTimeoutSec = 30;
+
+// Number of replies the daemon output pipe reader may read at once:
+static const constexpr size_t ackBufferCount = 256;
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief  Gets the current steady_clock time in nanoseconds.
+ */
+static uint64_t nowNS()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * @brief  Options for a single measurement.
+ */
+struct RunConfig
+{
+    // Name of the measurement mode:
+    std::string mode;
+    // Size in bytes of each message:
+    size_t messageSize;
+    // Number of threads sending messages:
+    size_t senders;
+    // Number of messages each sender sends:
+    size_t messages;
+    // Number of messages each sender may have in flight:
+    size_t window;
+};
+
+
+/**
+ * @brief  Measurements from a single run.
+ */
+struct RunResults
+{
+    // Microseconds between sending and the daemon receiving each message:
+    std::vector<double> oneWayUS;
+    // Microseconds between sending each message and receiving its reply:
+    std::vector<double> roundTripUS;
+    // Seconds between sending the first message and receiving the last reply:
+    double seconds = 0;
+};
+
+
+/**
+ * @brief  Launches the BenchmarkDaemon, and measures message delivery to the
+ *         daemon and back.
+ */
+class IPCBenchmark : public DaemonFramework::Pipe::Listener
+{
+public:
+    IPCBenchmark() : controller(DF_DAEMON_PATH, DF_INPUT_PIPE_PATH,
+            DF_OUTPUT_PIPE_PATH,
+            ackBufferCount * sizeof(BenchmarkProtocol::Ack)) { }
+
+    virtual ~IPCBenchmark() { }
+
+    /**
+     * @brief  Launches the daemon, and waits for it to become ready.
+     *
+     * @return  Whether the daemon started successfully.
+     */
+    bool start()
+    {
+        controller.startDaemon({ DF_DAEMON_PATH }, this);
+        return controller.waitUntilReady(startTimeoutMS);
+    }
+
+    /**
+     * @brief  Stops the daemon.
+     */
+    void stop()
+    {
+        controller.stopDaemon();
+    }
+
+    /**
+     * @brief  Sends a set of messages to the daemon, and measures how long they
+     *         take to arrive.
+     *
+     * @param config   The measurement options.
+     *
+     * @param results  The object where measurements will be saved.
+     *
+     * @return         Whether all messages were acknowledged.
+     */
+    bool run(const RunConfig& config, RunResults& results)
+    {
+        if (! setMessageSize(config.messageSize))
+        {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ackMutex);
+            sendOrder.clear();
+            inFlight.assign(config.senders, 0);
+            oneWayUS.clear();
+            roundTripUS.clear();
+            oneWayUS.reserve(config.senders * config.messages);
+            roundTripUS.reserve(config.senders * config.messages);
+            failed = false;
+        }
+        const Clock::time_point startTime = Clock::now();
+        std::vector<std::thread> senderThreads;
+        for (size_t i = 0; i < config.senders; i++)
+        {
+            senderThreads.emplace_back([this, i, &config]()
+            {
+                sendMessages(i, config);
+            });
+        }
+        for (std::thread& senderThread : senderThreads)
+        {
+            senderThread.join();
+        }
+        std::unique_lock<std::mutex> lock(ackMutex);
+        const bool finished = ackCondition.wait_for(lock,
+                std::chrono::seconds(replyTimeoutSec),
+                [this]() { return sendOrder.empty(); });
+        results.seconds = std::chrono::duration<double>(Clock::now()
+                - startTime).count();
+        results.oneWayUS = oneWayUS;
+        results.roundTripUS = roundTripUS;
+        return finished && ! failed;
+    }
+
+private:
+    /**
+     * @brief  Sets the size of all following messages, and waits for the
+     *         daemon to acknowledge the change.
+     *
+     * @param messageSize  The new message size in bytes.
+     *
+     * @return             Whether the daemon acknowledged the new size.
+     */
+    bool setMessageSize(const size_t messageSize)
+    {
+        std::unique_lock<std::mutex> lock(ackMutex);
+        configAcked = false;
+        lock.unlock();
+        const uint64_t header = BenchmarkProtocol::configFlag | messageSize;
+        controller.messageParent((const unsigned char*) &header,
+                sizeof(header));
+        lock.lock();
+        return ackCondition.wait_for(lock,
+                std::chrono::seconds(replyTimeoutSec),
+                [this]() { return configAcked; });
+    }
+
+    /**
+     * @brief  Sends all of a single sender's messages.
+     *
+     * @param senderIndex  The index of the sending thread.
+     *
+     * @param config       The measurement options.
+     */
+    void sendMessages(const size_t senderIndex, const RunConfig& config)
+    {
+        std::vector<unsigned char> message(config.messageSize, 0);
+        for (size_t i = 0; i < config.messages; i++)
+        {
+            {
+                std::unique_lock<std::mutex> lock(ackMutex);
+                if (! ackCondition.wait_for(lock,
+                        std::chrono::seconds(replyTimeoutSec),
+                        [this, senderIndex, &config]()
+                        {
+                            return inFlight[senderIndex] < config.window;
+                        }))
+                {
+                    failed = true;
+                    return;
+                }
+                inFlight[senderIndex]++;
+            }
+            const uint64_t sendTime = nowNS();
+            memcpy(message.data(), &sendTime, sizeof(sendTime));
+            // Replies arrive in the order messages were written, so each
+            // message's sender is saved while holding the lock used to order
+            // the writes:
+            std::lock_guard<std::mutex> sendLock(sendMutex);
+            {
+                std::lock_guard<std::mutex> lock(ackMutex);
+                sendOrder.push_back(senderIndex);
+            }
+            controller.messageParent(message.data(), message.size());
+        }
+    }
+
+    /**
+     * @brief  Reads replies sent by the daemon.
+     *
+     * @param data  Reply data, which may include partial replies.
+     *
+     * @param size  Size in bytes of the reply data.
+     */
+    virtual void processData(const unsigned char* data, const size_t size)
+            override
+    {
+        const uint64_t receiveTime = nowNS();
+        size_t offset = 0;
+        while (offset < size)
+        {
+            const size_t copySize = std::min(sizeof(ackBuffer) - ackBytes,
+                    size - offset);
+            memcpy(ackBuffer + ackBytes, data + offset, copySize);
+            ackBytes += copySize;
+            offset += copySize;
+            if (ackBytes == sizeof(ackBuffer))
+            {
+                BenchmarkProtocol::Ack ack;
+                memcpy(&ack, ackBuffer, sizeof(ack));
+                handleAck(ack, receiveTime);
+                ackBytes = 0;
+            }
+        }
+    }
+
+    /**
+     * @brief  Records the measurements for an acknowledged message.
+     *
+     * @param ack          The daemon's reply.
+     *
+     * @param receiveTime  The time in nanoseconds when the reply was read.
+     */
+    void handleAck(const BenchmarkProtocol::Ack& ack,
+            const uint64_t receiveTime)
+    {
+        std::unique_lock<std::mutex> lock(ackMutex);
+        if ((ack.header & BenchmarkProtocol::configFlag) != 0)
+        {
+            configAcked = true;
+        }
+        else if (sendOrder.empty())
+        {
+            failed = true;
+        }
+        else
+        {
+            const size_t senderIndex = sendOrder.front();
+            sendOrder.pop_front();
+            inFlight[senderIndex]--;
+            oneWayUS.push_back((ack.receivedNS - ack.header) / 1000.0);
+            roundTripUS.push_back((receiveTime - ack.header) / 1000.0);
+        }
+        lock.unlock();
+        ackCondition.notify_all();
+    }
+
+    DaemonFramework::DaemonControl controller;
+    // Orders message writes from all senders:
+    std::mutex sendMutex;
+    // Protects all reply tracking data:
+    std::mutex ackMutex;
+    // Signals that a reply was received:
+    std::condition_variable ackCondition;
+    // Sender indices of all messages waiting for replies, in sending order:
+    std::deque<size_t> sendOrder;
+    // Number of messages each sender is waiting on:
+    std::vector<size_t> inFlight;
+    // Measurements saved for the current run:
+    std::vector<double> oneWayUS;
+    std::vector<double> roundTripUS;
+    // Whether the last message size change was acknowledged:
+    bool configAcked = false;
+    // Whether the current run failed:
+    bool failed = false;
+    // Holds partial replies:
+    unsigned char ackBuffer[sizeof(BenchmarkProtocol::Ack)] = {0};
+    // Number of bytes of the current reply saved in ackBuffer:
+    size_t ackBytes = 0;
+};
+
+
+/**
+ * @brief  Parses a comma-separated list of positive numbers.
+ */
+static std::vector<size_t> parseList(const std::string& listString)
+{
+    std::vector<size_t> values;
+    std::istringstream listStream(listString);
+    std::string value;
+    while (std::getline(listStream, value, ','))
+    {
+        const long long number = std::stoll(value);
+        if (number > 0)
+        {
+            values.push_back((size_t) number);
+        }
+    }
+    return values;
+}
+
+
+/**
+ * @brief  Prints the results of one measurement.
+ */
+static void printResults(const RunConfig& config, const RunResults& results,
+        const bool json)
+{
+    using namespace BenchmarkOutput;
+    const Percentiles oneWay = getPercentiles(results.oneWayUS);
+    const Percentiles roundTrip = getPercentiles(results.roundTripUS);
+    const double messageCount = results.roundTripUS.size();
+    const double messagesPerSec = messageCount / results.seconds;
+    const double mbPerSec = messagesPerSec * config.messageSize
+            / (1024.0 * 1024.0);
+    if (json)
+    {
+        JsonRecord record;
+        record.add("benchmark", "ipc")
+            .add("mode", config.mode)
+            .add("message_bytes", config.messageSize)
+            .add("senders", config.senders)
+            .add("window", config.window)
+            .add("one_way", oneWay, "_us")
+            .add("round_trip", roundTrip, "_us")
+            .add("seconds", results.seconds)
+            .add("messages_per_sec", messagesPerSec)
+            .add("mb_per_sec", mbPerSec);
+        std::cout << record.toString() << std::endl;
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(1)
+            << std::setw(10) << config.mode
+            << std::setw(9) << config.messageSize
+            << std::setw(8) << config.senders
+            << std::setw(8) << roundTrip.count
+            << std::setw(10) << oneWay.p50
+            << std::setw(10) << oneWay.p99
+            << std::setw(10) << roundTrip.p50
+            << std::setw(10) << roundTrip.p99
+            << std::setw(10) << roundTrip.p999
+            << std::setw(11) << messagesPerSec
+            << std::setw(9) << mbPerSec << std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes = defaultSizes;
+    std::vector<size_t> senderCounts = defaultSenders;
+    size_t maxMessages = defaultMessages;
+    size_t maxMB = defaultMaxMB;
+    size_t window = defaultWindow;
+    bool json = false;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option(argv[i]);
+        if (option == "--sizes")
+        {
+            sizes = parseList(argv[i + 1]);
+        }
+        else if (option == "--senders")
+        {
+            senderCounts = parseList(argv[i + 1]);
+        }
+        else if (option == "--messages")
+        {
+            maxMessages = std::stoul(argv[i + 1]);
+        }
+        else if (option == "--maxMB")
+        {
+            maxMB = std::stoul(argv[i + 1]);
+        }
+        else if (option == "--window")
+        {
+            window = std::stoul(argv[i + 1]);
+        }
+        else if (option == "--format")
+        {
+            json = (std::string(argv[i + 1]) == "json");
+        }
+    }
+    if (sizes.empty() || senderCounts.empty() || maxMessages < 1
+            || window < 1)
+    {
+        std::cerr << messagePrefix << "Invalid benchmark options.\n";
+        return 1;
+    }
+
+    IPCBenchmark benchmark;
+    if (! benchmark.start())
+    {
+        std::cerr << messagePrefix << "Failed to start " << DF_DAEMON_PATH
+                << "\n";
+        return 1;
+    }
+    if (! json)
+    {
+        std::cout << messagePrefix << "Latency in microseconds, "
+                << "throughput in messages and MB per second:\n"
+                << std::setw(10) << "mode" << std::setw(9) << "bytes"
+                << std::setw(8) << "senders" << std::setw(8) << "count"
+                << std::setw(10) << "1way p50" << std::setw(10) << "1way p99"
+                << std::setw(10) << "rt p50" << std::setw(10) << "rt p99"
+                << std::setw(10) << "rt p99.9" << std::setw(11) << "msg/s"
+                << std::setw(9) << "MB/s" << std::endl;
+    }
+    const std::vector<std::pair<std::string, size_t>> modes =
+    {
+        { "latency", 1 },
+        { "throughput", window }
+    };
+    for (const std::pair<std::string, size_t>& mode : modes)
+    {
+        for (const size_t messageSize : sizes)
+        {
+            for (const size_t senders : senderCounts)
+            {
+                RunConfig config;
+                config.mode = mode.first;
+                config.messageSize = std::max(messageSize,
+                        BenchmarkProtocol::headerSize);
+                config.senders = senders;
+                config.window = mode.second;
+                const size_t budget = (maxMB * 1024 * 1024)
+                        / (config.messageSize * senders);
+                config.messages = std::max(minMessages,
+                        std::min(maxMessages, budget));
+                RunConfig warmup = config;
+                warmup.senders = 1;
+                warmup.messages = warmupMessages;
+                RunResults results;
+                if (! benchmark.run(warmup, results)
+                        || ! benchmark.run(config, results))
+                {
+                    std::cerr << messagePrefix << config.mode << " run with "
+                            << config.messageSize << " byte messages and "
+                            << senders << " senders failed.\n";
+                    benchmark.stop();
+                    return 1;
+                }
+                printResults(config, results, json);
+            }
+        }
+    }
+    benchmark.stop();
+    return 0;
+}
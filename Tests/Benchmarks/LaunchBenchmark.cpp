@@ -0,0 +1,277 @@
+/**
+ * @file  LaunchBenchmark.cpp
+ *
+ * @brief  Measures how long DaemonControl takes to launch a daemon process
+ *         from a parent process holding many open file descriptors.
+ *
+ *  Each sample launches a minimal daemon executable, and measures both the
+ * time spent in DaemonControl::startDaemon() and the total time until the
+ * daemon exits. For comparison, the same measurements are taken using the
+ * original launch method, which walked /proc/<pid>/fd in the forked process
+ * and closed each file descriptor separately. DaemonControl launches are
+ * measured with each DaemonControl::LaunchMethod.
+ *
+ *  To simulate a large parent application, the benchmark may also map and
+ * touch a block of memory before launching, which increases the cost of
+ * copying the parent's page tables in fork().
+ */
+
+#include "DaemonControl.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Print the application name before all info/error output:
+static const constexpr char* messagePrefix = "LaunchBenchmark: ";
+
+// Executable launched as the daemon in each sample:
+static const constexpr char* daemonPath = "/bin/true";
+
+// Default number of open file descriptors held by the parent:
+static const constexpr int defaultOpenFiles = 4000;
+
+// Default number of launches measured for each launch method:
+static const constexpr int defaultSamples = 200;
+
+// Default size in megabytes of extra memory mapped by the parent:
+static const constexpr int defaultMappedMB = 512;
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief  Timing results from a set of daemon launches.
+ */
+struct LaunchTimes
+{
+    // Microseconds spent launching each daemon:
+    std::vector<double> launchUS;
+    // Microseconds between launching and collecting each daemon:
+    std::vector<double> totalUS;
+};
+
+
+/**
+ * @brief  Gets the number of microseconds that passed between two times.
+ */
+static double elapsedUS(const Clock::time_point start,
+        const Clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+
+/**
+ * @brief  Opens file descriptors until the process holds a given number of
+ *         open files.
+ *
+ * @param openFiles  The number of file descriptors to hold.
+ *
+ * @return           The number of file descriptors actually opened.
+ */
+static int openFiles(const int openFiles)
+{
+    struct rlimit fileLimit;
+    if (getrlimit(RLIMIT_NOFILE, &fileLimit) == 0
+            && fileLimit.rlim_cur < (rlim_t) openFiles + 16)
+    {
+        fileLimit.rlim_cur = std::min((rlim_t) openFiles + 16,
+                fileLimit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &fileLimit);
+    }
+    int opened = 0;
+    while (opened < openFiles && open("/dev/null", O_RDONLY) != -1)
+    {
+        opened++;
+    }
+    return opened;
+}
+
+
+/**
+ * @brief  Maps and writes to a block of memory, so that it is included in the
+ *         parent's page tables.
+ *
+ * @param megabytes  The size of the memory block to map.
+ *
+ * @return           Whether the memory was mapped.
+ */
+static bool mapMemory(const int megabytes)
+{
+    if (megabytes <= 0)
+    {
+        return true;
+    }
+    const size_t size = (size_t) megabytes * 1024 * 1024;
+    char* memory = (char*) mmap(nullptr, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < size; i += pageSize)
+    {
+        memory[i] = 1;
+    }
+    return true;
+}
+
+
+/**
+ * @brief  Launches a daemon using the original DaemonControl launch method.
+ *
+ * @return  The daemon process ID.
+ */
+static pid_t legacyLaunch()
+{
+    const pid_t processID = fork();
+    if (processID == 0)
+    {
+        const std::string fdPath = std::string("/proc/")
+                + std::to_string((int) getpid()) + "/fd";
+        const int fdDirFD = open(fdPath.c_str(), O_RDONLY | O_DIRECTORY);
+        DIR* fdDir = fdopendir(fdDirFD);
+        struct dirent* fdFileInfo;
+        while ((fdFileInfo = readdir(fdDir)) != nullptr)
+        {
+            const int fd = strtol(fdFileInfo->d_name, nullptr, 10);
+            if (fd > 2 && fd != fdDirFD)
+            {
+                close(fd);
+            }
+        }
+        closedir(fdDir);
+        std::vector<std::string> args = { daemonPath };
+        std::vector<const char*> cStrings;
+        for (std::string& arg : args)
+        {
+            cStrings.push_back(arg.c_str());
+        }
+        cStrings.push_back(nullptr);
+        execv(daemonPath, (char* const*) cStrings.data());
+        _exit(1);
+    }
+    return processID;
+}
+
+
+/**
+ * @brief  Measures launches using the original launch method.
+ */
+static LaunchTimes measureLegacy(const int samples)
+{
+    LaunchTimes times;
+    for (int i = 0; i < samples; i++)
+    {
+        const Clock::time_point start = Clock::now();
+        const pid_t processID = legacyLaunch();
+        const Clock::time_point launched = Clock::now();
+        int status;
+        waitpid(processID, &status, 0);
+        times.launchUS.push_back(elapsedUS(start, launched));
+        times.totalUS.push_back(elapsedUS(start, Clock::now()));
+    }
+    return times;
+}
+
+
+/**
+ * @brief  Measures launches using DaemonControl.
+ */
+static LaunchTimes measureDaemonControl(const int samples,
+        const DaemonFramework::DaemonControl::LaunchMethod launchMethod)
+{
+    LaunchTimes times;
+    DaemonFramework::EventLoop eventLoop;
+    DaemonFramework::DaemonControl controller(daemonPath, "", "", 0,
+            &eventLoop);
+    controller.setLaunchMethod(launchMethod);
+    const std::vector<std::string> args = { daemonPath };
+    for (int i = 0; i < samples; i++)
+    {
+        const Clock::time_point start = Clock::now();
+        controller.startDaemon(args);
+        const Clock::time_point launched = Clock::now();
+        controller.waitToExit();
+        times.launchUS.push_back(elapsedUS(start, launched));
+        times.totalUS.push_back(elapsedUS(start, Clock::now()));
+    }
+    return times;
+}
+
+
+/**
+ * @brief  Prints the median and 95th percentile of a set of measurements.
+ */
+static void printStats(const std::string& name, std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const double median = values[values.size() / 2];
+    const double p95 = values[(values.size() * 95) / 100];
+    std::cout << "  " << name << ": median " << median << " us, p95 " << p95
+            << " us\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    using DaemonFramework::DaemonControl;
+    int fileCount = defaultOpenFiles;
+    int samples = defaultSamples;
+    int mappedMB = defaultMappedMB;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option(argv[i]);
+        if (option == "--fds")
+        {
+            fileCount = std::stoi(argv[i + 1]);
+        }
+        else if (option == "--samples")
+        {
+            samples = std::stoi(argv[i + 1]);
+        }
+        else if (option == "--mapMB")
+        {
+            mappedMB = std::stoi(argv[i + 1]);
+        }
+    }
+    if (samples < 1)
+    {
+        std::cerr << messagePrefix << "Invalid sample count.\n";
+        return 1;
+    }
+    if (! mapMemory(mappedMB))
+    {
+        std::cerr << messagePrefix << "Failed to map " << mappedMB
+                << "MB of memory.\n";
+        return 1;
+    }
+    const int opened = openFiles(fileCount);
+    std::cout << messagePrefix << samples << " launches of " << daemonPath
+            << " with " << opened << " open file descriptors and "
+            << mappedMB << "MB of extra mapped memory:\n";
+    const LaunchTimes legacyTimes = measureLegacy(samples);
+    std::cout << " /proc/<pid>/fd walk:\n";
+    printStats("launch", legacyTimes.launchUS);
+    printStats("launch to exit", legacyTimes.totalUS);
+    const LaunchTimes forkTimes = measureDaemonControl(samples,
+            DaemonControl::LaunchMethod::fork);
+    std::cout << " DaemonControl, LaunchMethod::fork:\n";
+    printStats("launch", forkTimes.launchUS);
+    printStats("launch to exit", forkTimes.totalUS);
+    const LaunchTimes vforkTimes = measureDaemonControl(samples,
+            DaemonControl::LaunchMethod::vfork);
+    std::cout << " DaemonControl, LaunchMethod::vfork:\n";
+    printStats("launch", vforkTimes.launchUS);
+    printStats("launch to exit", vforkTimes.totalUS);
+    return 0;
+}
@@ -0,0 +1,546 @@
+/**
+ * @file  LoopBenchmark.cpp
+ *
+ * @brief  Measures how regularly a DaemonLoop's loopAction() runs, and how
+ *         quickly parent messages reach handleParentMessage(), while the host
+ *         is under CPU load.
+ *
+ *  DaemonLoop::runLoop() calls loopAction() again as soon as it returns, so
+ * each daemon decides how its loop waits between ticks. For each combination
+ * of target tick rate and BenchmarkDaemon pacing mode, the benchmark launches
+ * the daemon, sends it small messages at irregular intervals for a fixed
+ * period, and then stops it. The daemon writes the time of every tick and its
+ * own CPU time when it exits.
+ *
+ *  For each run, the benchmark reports:
+ * - Tick jitter: the difference between each interval between ticks and the
+ *   target tick period, as percentiles and as a histogram.
+ * - Wakeup latency: the time between the parent starting to send a message and
+ *   the daemon receiving it.
+ * - The average tick rate achieved, and the share of one CPU used by the
+ *   daemon.
+ *
+ *  CPU load is generated by child processes that busy-wait until the benchmark
+ * finishes. By default, one load process runs for each online CPU.
+ *
+ *  Results are printed as a table, or as one JSON object per line when run
+ * with "--format json".
+ */
+
+#include "DaemonControl.h"
+#include "BenchmarkOutput.h"
+#include "BenchmarkProtocol.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if ! defined DF_DAEMON_PATH || ! defined DF_INPUT_PIPE_PATH \
+        || ! defined DF_OUTPUT_PIPE_PATH
+#error "LoopBenchmark requires daemon and pipe paths from benchmarkPaths.mk"
+#endif
+
+// Print the application name before all info/error output:
+static const constexpr char* messagePrefix = "LoopBenchmark: ";
+
+// Default target tick rates to measure, in Hz:
+static const std::vector<size_t> defaultRates = { 100, 1000, 10000 };
+
+// Default BenchmarkDaemon pacing modes to measure:
+static const std::vector<std::string> defaultModes =
+{
+    "spin", "sleep", "absolute", "timerfd"
+};
+
+// Default number of seconds each run lasts:
+static const constexpr double defaultSeconds = 2;
+
+// Average milliseconds between messages sent to the daemon:
+static const constexpr int messageIntervalMS = 5;
+
+// Milliseconds to wait for the daemon to start:
+static const constexpr int startTimeoutMS = 5000;
+
+// Seconds to wait for any single reply before giving up:
+static const constexpr int replyTimeoutSec = 5;
+
+// Upper bounds of the tick jitter histogram buckets, in microseconds. Larger
+// values are counted in one extra bucket:
+static const std::vector<double> histogramBounds =
+{
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000
+};
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief  Gets the current steady_clock time in nanoseconds.
+ */
+static uint64_t nowNS()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * @brief  Options for a single run.
+ */
+struct RunConfig
+{
+    // BenchmarkDaemon pacing mode:
+    std::string mode;
+    // Target ticks per second:
+    size_t rate;
+    // Seconds the run lasts:
+    double seconds;
+    // Number of CPU load processes running:
+    size_t load;
+};
+
+
+/**
+ * @brief  Measurements from a single run.
+ */
+struct RunResults
+{
+    // Microseconds between each tick interval and the target period:
+    std::vector<double> jitterUS;
+    // Microseconds between sending and the daemon receiving each message:
+    std::vector<double> wakeupUS;
+    // Average ticks per second:
+    double achievedRate = 0;
+    // Daemon CPU time divided by the time between its first and last ticks:
+    double cpuShare = 0;
+};
+
+
+/**
+ * @brief  Launches the BenchmarkDaemon with each pacing mode, and measures its
+ *         loop timing and message latency.
+ */
+class LoopBenchmark : public DaemonFramework::Pipe::Listener
+{
+public:
+    LoopBenchmark(const std::string& ticksPath) :
+        controller(DF_DAEMON_PATH, DF_INPUT_PIPE_PATH, DF_OUTPUT_PIPE_PATH,
+                sizeof(BenchmarkProtocol::Ack)),
+        ticksPath(ticksPath) { }
+
+    virtual ~LoopBenchmark() { }
+
+    /**
+     * @brief  Runs the daemon with one pacing mode and tick rate.
+     *
+     * @param config   The run options.
+     *
+     * @param results  The object where measurements will be saved.
+     *
+     * @return         Whether the daemon ran and replied to every message.
+     */
+    bool run(const RunConfig& config, RunResults& results)
+    {
+        unlink(ticksPath.c_str());
+        controller.startDaemon({ DF_DAEMON_PATH, "--pacing", config.mode,
+                "--rate", std::to_string(config.rate), "--ticks", ticksPath },
+                this);
+        if (! controller.waitUntilReady(startTimeoutMS))
+        {
+            controller.stopDaemon();
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ackMutex);
+            ackBytes = 0;
+            wakeupUS.clear();
+        }
+        std::mt19937 random(config.rate);
+        std::uniform_int_distribution<int> intervalUS(0,
+                messageIntervalMS * 2000);
+        const Clock::time_point endTime = Clock::now()
+                + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(config.seconds));
+        bool replied = true;
+        size_t sent = 0;
+        while (replied && Clock::now() < endTime)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(
+                    intervalUS(random)));
+            const uint64_t sendTime = nowNS();
+            controller.messageParent((const unsigned char*) &sendTime,
+                    sizeof(sendTime));
+            sent++;
+            std::unique_lock<std::mutex> lock(ackMutex);
+            replied = ackCondition.wait_for(lock,
+                    std::chrono::seconds(replyTimeoutSec),
+                    [this, sent]() { return wakeupUS.size() == sent; });
+        }
+        controller.stopDaemon();
+        {
+            std::lock_guard<std::mutex> lock(ackMutex);
+            results.wakeupUS = wakeupUS;
+        }
+        return replied && readTicks(config, results);
+    }
+
+private:
+    /**
+     * @brief  Reads the tick times and CPU time saved by the daemon.
+     *
+     * @param config   The run options.
+     *
+     * @param results  The object where tick measurements will be saved.
+     *
+     * @return         Whether enough ticks were recorded to measure.
+     */
+    bool readTicks(const RunConfig& config, RunResults& results) const
+    {
+        std::ifstream ticksFile(ticksPath);
+        long long cpuUS = 0;
+        std::vector<uint64_t> ticks;
+        uint64_t tickTime;
+        if (! (ticksFile >> cpuUS))
+        {
+            return false;
+        }
+        while (ticksFile >> tickTime)
+        {
+            ticks.push_back(tickTime);
+        }
+        if (ticks.size() < 2)
+        {
+            return false;
+        }
+        const double periodUS = 1000000.0 / config.rate;
+        results.jitterUS.clear();
+        results.jitterUS.reserve(ticks.size() - 1);
+        for (size_t i = 1; i < ticks.size(); i++)
+        {
+            results.jitterUS.push_back(std::abs(
+                    (ticks[i] - ticks[i - 1]) / 1000.0 - periodUS));
+        }
+        const double tickSeconds = (ticks.back() - ticks.front()) / 1e9;
+        results.achievedRate = (ticks.size() - 1) / tickSeconds;
+        results.cpuShare = (cpuUS / 1e6) / tickSeconds;
+        return true;
+    }
+
+    /**
+     * @brief  Records the wakeup latency of each acknowledged message.
+     *
+     * @param data  Reply data, which may include partial replies.
+     *
+     * @param size  Size in bytes of the reply data.
+     */
+    virtual void processData(const unsigned char* data, const size_t size)
+            override
+    {
+        std::unique_lock<std::mutex> lock(ackMutex);
+        size_t offset = 0;
+        while (offset < size)
+        {
+            const size_t copySize = std::min(sizeof(ackBuffer) - ackBytes,
+                    size - offset);
+            memcpy(ackBuffer + ackBytes, data + offset, copySize);
+            ackBytes += copySize;
+            offset += copySize;
+            if (ackBytes == sizeof(ackBuffer))
+            {
+                BenchmarkProtocol::Ack ack;
+                memcpy(&ack, ackBuffer, sizeof(ack));
+                wakeupUS.push_back((ack.receivedNS - ack.header) / 1000.0);
+                ackBytes = 0;
+            }
+        }
+        lock.unlock();
+        ackCondition.notify_all();
+    }
+
+    DaemonFramework::DaemonControl controller;
+    // Path where the daemon writes its tick times:
+    const std::string ticksPath;
+    // Protects all reply tracking data:
+    std::mutex ackMutex;
+    // Signals that a reply was received:
+    std::condition_variable ackCondition;
+    // Wakeup latency of each message acknowledged during the current run:
+    std::vector<double> wakeupUS;
+    // Holds partial replies:
+    unsigned char ackBuffer[sizeof(BenchmarkProtocol::Ack)] = {0};
+    // Number of bytes of the current reply saved in ackBuffer:
+    size_t ackBytes = 0;
+};
+
+
+/**
+ * @brief  Counts values within each histogram bucket.
+ *
+ * @param values  The values to count.
+ *
+ * @return        The number of values in each bucket, with one extra bucket
+ *                for values beyond the last bound.
+ */
+static std::vector<size_t> getHistogram(const std::vector<double>& values)
+{
+    std::vector<size_t> counts(histogramBounds.size() + 1, 0);
+    for (const double value : values)
+    {
+        counts[std::lower_bound(histogramBounds.begin(),
+                histogramBounds.end(), value) - histogramBounds.begin()]++;
+    }
+    return counts;
+}
+
+
+/**
+ * @brief  Gets the name of a histogram bucket.
+ */
+static std::string getBucketName(const size_t bucket)
+{
+    std::ostringstream name;
+    if (bucket < histogramBounds.size())
+    {
+        name << "le_" << histogramBounds[bucket] << "us";
+    }
+    else
+    {
+        name << "gt_" << histogramBounds.back() << "us";
+    }
+    return name.str();
+}
+
+
+/**
+ * @brief  Prints the results of one run.
+ */
+static void printResults(const RunConfig& config, const RunResults& results,
+        const bool json)
+{
+    using namespace BenchmarkOutput;
+    const Percentiles jitter = getPercentiles(results.jitterUS);
+    const Percentiles wakeup = getPercentiles(results.wakeupUS);
+    const std::vector<size_t> histogram = getHistogram(results.jitterUS);
+    if (json)
+    {
+        JsonRecord record;
+        record.add("benchmark", "loop")
+            .add("mode", config.mode)
+            .add("target_hz", config.rate)
+            .add("load_processes", config.load)
+            .add("achieved_hz", results.achievedRate)
+            .add("cpu_share", results.cpuShare)
+            .add("jitter", jitter, "_us")
+            .add("wakeup", wakeup, "_us");
+        for (size_t i = 0; i < histogram.size(); i++)
+        {
+            record.add("jitter_" + getBucketName(i), histogram[i]);
+        }
+        std::cout << record.toString() << std::endl;
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(1)
+            << std::setw(10) << config.mode
+            << std::setw(8) << config.rate
+            << std::setw(10) << results.achievedRate
+            << std::setw(6) << std::setprecision(0)
+            << (results.cpuShare * 100) << "%" << std::setprecision(1)
+            << std::setw(10) << jitter.p50
+            << std::setw(10) << jitter.p99
+            << std::setw(10) << jitter.max
+            << std::setw(10) << wakeup.p50
+            << std::setw(10) << wakeup.p99
+            << std::setw(10) << wakeup.max << "\n"
+            << std::setw(18) << "jitter counts:";
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        if (histogram[i] > 0)
+        {
+            std::cout << " " << getBucketName(i) << "=" << histogram[i];
+        }
+    }
+    std::cout << std::endl;
+}
+
+
+/**
+ * @brief  Launches child processes that busy-wait until they are killed.
+ *
+ * @param count  The number of child processes to launch.
+ *
+ * @return       The IDs of all launched processes.
+ */
+static std::vector<pid_t> startLoad(const size_t count)
+{
+    const pid_t parentID = getpid();
+    std::vector<pid_t> children;
+    for (size_t i = 0; i < count; i++)
+    {
+        const pid_t childID = fork();
+        if (childID == -1)
+        {
+            std::cerr << messagePrefix << "Only launched " << children.size()
+                    << " of " << count << " load processes.\n";
+            break;
+        }
+        if (childID == 0)
+        {
+            // Don't outlive the benchmark if it is killed:
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parentID)
+            {
+                _exit(0);
+            }
+            volatile unsigned long counter = 0;
+            while (true)
+            {
+                counter = counter + 1;
+            }
+        }
+        children.push_back(childID);
+    }
+    return children;
+}
+
+
+/**
+ * @brief  Kills and collects child processes.
+ *
+ * @param children  The IDs of all processes to kill.
+ */
+static void stopLoad(const std::vector<pid_t>& children)
+{
+    for (const pid_t childID : children)
+    {
+        kill(childID, SIGKILL);
+    }
+    for (const pid_t childID : children)
+    {
+        waitpid(childID, nullptr, 0);
+    }
+}
+
+
+/**
+ * @brief  Splits a comma-separated list.
+ */
+static std::vector<std::string> parseList(const std::string& listString)
+{
+    std::vector<std::string> values;
+    std::istringstream listStream(listString);
+    std::string value;
+    while (std::getline(listStream, value, ','))
+    {
+        values.push_back(value);
+    }
+    return values;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> rates = defaultRates;
+    std::vector<std::string> modes = defaultModes;
+    double seconds = defaultSeconds;
+    long load = sysconf(_SC_NPROCESSORS_ONLN);
+    bool json = false;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option(argv[i]);
+        if (option == "--rates")
+        {
+            rates.clear();
+            for (const std::string& rate : parseList(argv[i + 1]))
+            {
+                rates.push_back(std::stoul(rate));
+            }
+        }
+        else if (option == "--modes")
+        {
+            modes = parseList(argv[i + 1]);
+        }
+        else if (option == "--seconds")
+        {
+            seconds = std::stod(argv[i + 1]);
+        }
+        else if (option == "--load")
+        {
+            load = std::stol(argv[i + 1]);
+        }
+        else if (option == "--format")
+        {
+            json = (std::string(argv[i + 1]) == "json");
+        }
+    }
+    if (rates.empty() || modes.empty() || seconds <= 0 || load < 0
+            || std::find(rates.begin(), rates.end(), 0) != rates.end())
+    {
+        std::cerr << messagePrefix << "Invalid benchmark options.\n";
+        return 1;
+    }
+
+    char ticksPath[] = "/tmp/LoopBenchmarkXXXXXX";
+    const int ticksFile = mkstemp(ticksPath);
+    if (ticksFile == -1)
+    {
+        std::cerr << messagePrefix << "Failed to create tick file.\n";
+        return 1;
+    }
+    close(ticksFile);
+
+    LoopBenchmark benchmark(ticksPath);
+    const std::vector<pid_t> loadProcesses = startLoad(load);
+    if (! json)
+    {
+        std::cout << messagePrefix << "Running with " << loadProcesses.size()
+                << " CPU load processes, times in microseconds:\n"
+                << std::setw(10) << "mode" << std::setw(8) << "Hz"
+                << std::setw(10) << "actual Hz" << std::setw(7) << "CPU"
+                << std::setw(10) << "jit p50" << std::setw(10) << "jit p99"
+                << std::setw(10) << "jit max" << std::setw(10) << "wake p50"
+                << std::setw(10) << "wake p99" << std::setw(10) << "wake max"
+                << std::endl;
+    }
+    bool succeeded = true;
+    for (const size_t rate : rates)
+    {
+        for (const std::string& mode : modes)
+        {
+            RunConfig config;
+            config.mode = mode;
+            config.rate = rate;
+            config.seconds = seconds;
+            config.load = loadProcesses.size();
+            RunResults results;
+            if (! benchmark.run(config, results))
+            {
+                std::cerr << messagePrefix << mode << " run at " << rate
+                        << " Hz failed.\n";
+                succeeded = false;
+                break;
+            }
+            printResults(config, results, json);
+        }
+        if (! succeeded)
+        {
+            break;
+        }
+    }
+    stopLoad(loadProcesses);
+    unlink(ticksPath);
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+/**
+ * @file  ProcessBenchmark.cpp
+ *
+ * @brief  Measures the cost of reading process information from /proc, and of
+ *         each Process::Security check run by daemons.
+ *
+ *  Process data measurements run in the benchmark process itself. Security
+ * checks run in a forked copy of the benchmark, so that the benchmark process
+ * is the checked parent process. The benchmark is built with its own path as
+ * both the expected daemon and parent executable path, so path checks pass
+ * when it runs from its build directory. Directory checks only pass if the
+ * build directory is secured, and the parent digest check always fails after
+ * hashing the parent executable, as the expected digest isn't a real digest.
+ * Each check's result is included in the output.
+ *
+ *  To measure how costs scale with the size of the process table, the
+ * benchmark may repeat all measurements while holding different numbers of
+ * sleeping child processes.
+ *
+ *  Results are printed as a table, or as one JSON object per line when run
+ * with "--format json".
+ */
+
+#include "Process_Data.h"
+#include "Process_Security.h"
+#include "Digest_SHA256.h"
+#include "BenchmarkOutput.h"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Print the application name before all info/error output:
+static const constexpr char* messagePrefix = "ProcessBenchmark: ";
+
+// Default number of samples measured for each operation:
+static const constexpr size_t defaultSamples = 200;
+
+// Default numbers of sleeping child processes held during measurements:
+static const std::vector<size_t> defaultChildCounts = { 0 };
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief  Options shared by all measurements.
+ */
+struct Options
+{
+    // Number of samples measured for each operation:
+    size_t samples = defaultSamples;
+    // Whether results are printed as JSON:
+    bool json = false;
+    // Number of sleeping child processes currently running:
+    size_t children = 0;
+    // Number of processes listed in /proc:
+    size_t processes = 0;
+};
+
+
+/**
+ * @brief  Prints the measurements of a single operation.
+ *
+ * @param options    The benchmark options.
+ *
+ * @param operation  The name of the measured operation.
+ *
+ * @param times      The operation's measurements in microseconds.
+ *
+ * @param passed     Whether the operation succeeded every time.
+ */
+static void printResults(const Options& options, const std::string& operation,
+        const std::vector<double>& times, const bool passed)
+{
+    using namespace BenchmarkOutput;
+    const Percentiles stats = getPercentiles(times);
+    if (options.json)
+    {
+        JsonRecord record;
+        record.add("benchmark", "process")
+            .add("operation", operation)
+            .add("children", options.children)
+            .add("processes", options.processes)
+            .add("passed", passed)
+            .add("time", stats, "_us");
+        std::cout << record.toString() << std::endl;
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(2)
+            << std::setw(28) << operation
+            << std::setw(10) << options.processes
+            << std::setw(11) << stats.p50
+            << std::setw(11) << stats.p90
+            << std::setw(11) << stats.p99
+            << std::setw(11) << stats.max
+            << std::setw(8) << (passed ? "yes" : "no") << std::endl;
+}
+
+
+/**
+ * @brief  Measures an operation repeatedly, and prints the results.
+ *
+ * @param options    The benchmark options.
+ *
+ * @param name       The name of the measured operation.
+ *
+ * @param operation  The operation to measure, returning whether it succeeded.
+ *
+ * @param setup      An optional function to run before each operation without
+ *                   being measured.
+ */
+static void measure(const Options& options, const std::string& name,
+        const std::function<bool()> operation,
+        const std::function<void()> setup = std::function<void()>())
+{
+    std::vector<double> times;
+    times.reserve(options.samples);
+    bool passed = true;
+    for (size_t i = 0; i < options.samples; i++)
+    {
+        if (setup)
+        {
+            setup();
+        }
+        const Clock::time_point start = Clock::now();
+        const bool succeeded = operation();
+        times.push_back(std::chrono::duration<double, std::micro>(
+                Clock::now() - start).count());
+        passed = passed && succeeded;
+    }
+    printResults(options, name, times, passed);
+}
+
+
+/**
+ * @brief  Measures process data operations within the benchmark process.
+ */
+static void measureProcessData(const Options& options)
+{
+    using namespace DaemonFramework::Process;
+    const pid_t processID = getpid();
+    const std::string statPath = "/proc/" + std::to_string(processID)
+            + "/stat";
+    const std::string exePath = "/proc/" + std::to_string(processID)
+            + "/exe";
+    measure(options, "stat read", [&statPath]()
+    {
+        char buffer[1024];
+        const int statFile = open(statPath.c_str(), O_RDONLY);
+        const bool succeeded = (read(statFile, buffer, sizeof(buffer)) > 0);
+        close(statFile);
+        return succeeded;
+    });
+    measure(options, "exe readlink", [&exePath]()
+    {
+        char buffer[PATH_MAX];
+        return readlink(exePath.c_str(), buffer, sizeof(buffer)) > 0;
+    });
+    measure(options, "Data construction", [processID]()
+    {
+        return Data(processID).isValid();
+    });
+    Data processData(processID);
+    measure(options, "Data::update", [&processData]()
+    {
+        processData.update();
+        return processData.isValid();
+    });
+    measure(options, "getAllPIDs", []()
+    {
+        return ! getAllPIDs().empty();
+    });
+    measure(options, "Data::getChildProcesses", [&processData, &options]()
+    {
+        return processData.getChildProcesses().size() >= options.children;
+    });
+}
+
+
+/**
+ * @brief  Measures each Security check. This must run in a child of the
+ *         benchmark process.
+ */
+static void measureSecurity(const Options& options)
+{
+    using DaemonFramework::Process::Security;
+    measure(options, "Security construction", []()
+    {
+        Security security;
+        return true;
+    });
+    Security security;
+    measure(options, "validDaemonPath", [&security]()
+    {
+        return security.validDaemonPath();
+    });
+    measure(options, "validParentPath", [&security]()
+    {
+        return security.validParentPath();
+    });
+    measure(options, "validParentDigest", [&security]()
+    {
+        return security.validParentDigest();
+    });
+    std::ifstream executableStream(DF_REQUIRED_PARENT_PATH, std::ios::binary);
+    const std::vector<unsigned char> executable(
+            (std::istreambuf_iterator<char>(executableStream)),
+            std::istreambuf_iterator<char>());
+    measure(options, "parent sha256 (uncached)", [&executable]()
+    {
+        DaemonFramework::Digest::sha256(executable.data(), executable.size());
+        return ! executable.empty();
+    });
+    measure(options, "parentProcessRunning", [&security]()
+    {
+        return security.parentProcessRunning();
+    });
+
+    // Directory checks cache secured directories, so first checks on new
+    // Security objects are measured separately:
+    std::unique_ptr<Security> uncached;
+    const std::function<void()> resetSecurity = [&uncached]()
+    {
+        uncached.reset(new Security);
+    };
+    measure(options, "daemonPathSecured (first)", [&uncached]()
+    {
+        return uncached->daemonPathSecured();
+    }, resetSecurity);
+    measure(options, "daemonPathSecured", [&security]()
+    {
+        return security.daemonPathSecured();
+    });
+    measure(options, "parentPathSecured (first)", [&uncached]()
+    {
+        return uncached->parentPathSecured();
+    }, resetSecurity);
+    measure(options, "parentPathSecured", [&security]()
+    {
+        return security.parentPathSecured();
+    });
+}
+
+
+/**
+ * @brief  Launches child processes that sleep until they are killed.
+ *
+ * @param count  The number of child processes to launch.
+ *
+ * @return       The IDs of all launched processes.
+ */
+static std::vector<pid_t> spawnChildren(const size_t count)
+{
+    const pid_t parentID = getpid();
+    std::vector<pid_t> children;
+    children.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const pid_t childID = fork();
+        if (childID == -1)
+        {
+            std::cerr << messagePrefix << "Only launched " << children.size()
+                    << " of " << count << " child processes.\n";
+            break;
+        }
+        if (childID == 0)
+        {
+            // Don't outlive the benchmark if it is killed:
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parentID)
+            {
+                _exit(0);
+            }
+            while (true)
+            {
+                pause();
+            }
+        }
+        children.push_back(childID);
+    }
+    return children;
+}
+
+
+/**
+ * @brief  Kills and collects child processes.
+ *
+ * @param children  The IDs of all processes to kill.
+ */
+static void killChildren(const std::vector<pid_t>& children)
+{
+    for (const pid_t childID : children)
+    {
+        kill(childID, SIGKILL);
+    }
+    for (const pid_t childID : children)
+    {
+        waitpid(childID, nullptr, 0);
+    }
+}
+
+
+/**
+ * @brief  Parses a comma-separated list of numbers.
+ */
+static std::vector<size_t> parseList(const std::string& listString)
+{
+    std::vector<size_t> values;
+    std::istringstream listStream(listString);
+    std::string value;
+    while (std::getline(listStream, value, ','))
+    {
+        values.push_back(std::stoul(value));
+    }
+    return values;
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    std::vector<size_t> childCounts = defaultChildCounts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option(argv[i]);
+        if (option == "--samples")
+        {
+            options.samples = std::stoul(argv[i + 1]);
+        }
+        else if (option == "--children")
+        {
+            childCounts = parseList(argv[i + 1]);
+        }
+        else if (option == "--format")
+        {
+            options.json = (std::string(argv[i + 1]) == "json");
+        }
+    }
+    if (options.samples < 1 || childCounts.empty())
+    {
+        std::cerr << messagePrefix << "Invalid benchmark options.\n";
+        return 1;
+    }
+    if (! options.json)
+    {
+        std::cout << messagePrefix << "Times in microseconds:\n"
+                << std::setw(28) << "operation"
+                << std::setw(10) << "processes"
+                << std::setw(11) << "p50" << std::setw(11) << "p90"
+                << std::setw(11) << "p99" << std::setw(11) << "max"
+                << std::setw(8) << "passed" << std::endl;
+    }
+    for (const size_t childCount : childCounts)
+    {
+        const std::vector<pid_t> children = spawnChildren(childCount);
+        options.children = children.size();
+        options.processes = DaemonFramework::Process::getAllPIDs().size();
+        measureProcessData(options);
+        std::cout.flush();
+        const pid_t checkerID = fork();
+        if (checkerID == 0)
+        {
+            measureSecurity(options);
+            std::cout.flush();
+            _exit(0);
+        }
+        int status = 0;
+        if (checkerID == -1 || waitpid(checkerID, &status, 0) == -1
+                || ! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << messagePrefix << "Security measurements failed.\n";
+            killChildren(children);
+            return 1;
+        }
+        killChildren(children);
+    }
+    return 0;
+}
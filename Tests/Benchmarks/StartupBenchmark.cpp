@@ -0,0 +1,473 @@
+/**
+ * @file  StartupBenchmark.cpp
+ *
+ * @brief  Measures how long a daemon takes to start, and breaks startup
+ *         latency down into separate phases.
+ *
+ *  Each sample launches the BenchmarkDaemon, waits for it to signal that it
+ * is ready, sends it a configuration message, and waits for the daemon's
+ * reply. The benchmark runs in one of two modes:
+ *
+ * - "timing" mode measures the time from starting the launch until the daemon
+ *   is ready, and until its first reply arrives. With "--evict 1", the daemon
+ *   executable is dropped from the page cache before each launch. This only
+ *   evicts the daemon executable itself, not shared libraries it loads.
+ *
+ * - "profile" mode enables StartupProfile records in the parent and daemon,
+ *   and reports the median and 90th percentile time when each phase finished,
+ *   measured from the start of each launch. Each phase is also listed with
+ *   the time between its median and the previous phase's median.
+ *
+ *  Profile records add a small cost to each phase, so startup times should be
+ * taken from timing mode. Results are printed as a table, or as one JSON
+ * object per line when run with "--format json". With "--history <path>",
+ * timing mode results are also appended to a JSON lines file with the current
+ * time, so that startup latency can be tracked across builds.
+ */
+
+#include "DaemonControl.h"
+#include "StartupProfile.h"
+#include "BenchmarkOutput.h"
+#include "BenchmarkProtocol.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if ! defined DF_DAEMON_PATH || ! defined DF_INPUT_PIPE_PATH \
+        || ! defined DF_OUTPUT_PIPE_PATH
+#error "StartupBenchmark requires daemon and pipe paths from benchmarkPaths.mk"
+#endif
+
+// Print the application name before all info/error output:
+static const constexpr char* messagePrefix = "StartupBenchmark: ";
+
+// Default number of daemon launches measured:
+static const constexpr size_t defaultSamples = 50;
+
+// Milliseconds to wait for the daemon to start:
+static const constexpr int startTimeoutMS = 5000;
+
+// Seconds to wait for the daemon's first reply:
+static const constexpr int replyTimeoutSec = 5;
+
+// Profile phase that marks the start of each launch:
+static const constexpr char* launchPhase = "launch started";
+
+// Profile phase recorded when the benchmark receives the first reply:
+static const constexpr char* replyPhase = "first reply received";
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief  Benchmark options.
+ */
+struct Options
+{
+    // Number of daemon launches to measure:
+    size_t samples = defaultSamples;
+    // Whether startup phases are profiled instead of timed:
+    bool profile = false;
+    // Whether the daemon executable is evicted from the page cache before
+    // each launch:
+    bool evict = false;
+    // Whether results are printed as JSON:
+    bool json = false;
+    // Optional path of a file where timing results are appended:
+    std::string historyPath;
+};
+
+
+/**
+ * @brief  Launches the BenchmarkDaemon, and waits for its first reply.
+ */
+class StartupBenchmark : public DaemonFramework::Pipe::Listener
+{
+public:
+    StartupBenchmark() : controller(DF_DAEMON_PATH, DF_INPUT_PIPE_PATH,
+            DF_OUTPUT_PIPE_PATH, sizeof(BenchmarkProtocol::Ack)) { }
+
+    virtual ~StartupBenchmark() { }
+
+    /**
+     * @brief  Launches the daemon and measures how long it takes to start,
+     *         then stops the daemon.
+     *
+     * @param readyUS  The variable where the time in microseconds until the
+     *                 daemon signalled that it was ready will be saved.
+     *
+     * @param replyUS  The variable where the time in microseconds until the
+     *                 daemon's first reply arrived will be saved.
+     *
+     * @return         Whether the daemon started and replied.
+     */
+    bool launch(double& readyUS, double& replyUS)
+    {
+        {
+            std::lock_guard<std::mutex> lock(replyMutex);
+            replied = false;
+            replyBytes = 0;
+        }
+        const Clock::time_point startTime = Clock::now();
+        controller.startDaemon({ DF_DAEMON_PATH }, this);
+        const bool ready = controller.waitUntilReady(startTimeoutMS);
+        readyUS = std::chrono::duration<double, std::micro>(Clock::now()
+                - startTime).count();
+        bool repliedInTime = false;
+        if (ready)
+        {
+            const uint64_t header = BenchmarkProtocol::configFlag
+                    | BenchmarkProtocol::headerSize;
+            controller.messageParent((const unsigned char*) &header,
+                    sizeof(header));
+            std::unique_lock<std::mutex> lock(replyMutex);
+            repliedInTime = replyCondition.wait_for(lock,
+                    std::chrono::seconds(replyTimeoutSec),
+                    [this]() { return replied; });
+            replyUS = std::chrono::duration<double, std::micro>(replyTime
+                    - startTime).count();
+        }
+        controller.stopDaemon();
+        return ready && repliedInTime;
+    }
+
+private:
+    /**
+     * @brief  Records when the daemon's first complete reply arrives.
+     *
+     * @param data  Reply data, which may include a partial reply.
+     *
+     * @param size  Size in bytes of the reply data.
+     */
+    virtual void processData(const unsigned char* data, const size_t size)
+            override
+    {
+        const Clock::time_point receiveTime = Clock::now();
+        std::unique_lock<std::mutex> lock(replyMutex);
+        replyBytes += size;
+        if (replied || replyBytes < sizeof(BenchmarkProtocol::Ack))
+        {
+            return;
+        }
+        DaemonFramework::StartupProfile::record(replyPhase);
+        replied = true;
+        replyTime = receiveTime;
+        lock.unlock();
+        replyCondition.notify_all();
+    }
+
+    DaemonFramework::DaemonControl controller;
+    // Protects all reply tracking data:
+    std::mutex replyMutex;
+    // Signals that the first reply was received:
+    std::condition_variable replyCondition;
+    // Whether the current daemon's first reply was received:
+    bool replied = false;
+    // Number of reply bytes received from the current daemon:
+    size_t replyBytes = 0;
+    // Time when the current daemon's first reply was received:
+    Clock::time_point replyTime;
+};
+
+
+/**
+ * @brief  Drops the daemon executable from the page cache, so that the next
+ *         launch must read it from disk.
+ */
+static void evictDaemon()
+{
+    const int daemonFile = open(DF_DAEMON_PATH, O_RDONLY);
+    if (daemonFile == -1)
+    {
+        return;
+    }
+    fdatasync(daemonFile);
+    posix_fadvise(daemonFile, 0, 0, POSIX_FADV_DONTNEED);
+    close(daemonFile);
+}
+
+
+/**
+ * @brief  Measures daemon startup time, and prints the results.
+ *
+ * @return  Whether all launches succeeded.
+ */
+static bool runTiming(StartupBenchmark& benchmark, const Options& options)
+{
+    using namespace BenchmarkOutput;
+    std::vector<double> readyTimes;
+    std::vector<double> replyTimes;
+    for (size_t i = 0; i < options.samples; i++)
+    {
+        if (options.evict)
+        {
+            evictDaemon();
+        }
+        double readyUS = 0;
+        double replyUS = 0;
+        if (! benchmark.launch(readyUS, replyUS))
+        {
+            std::cerr << messagePrefix << "Launch " << i << " failed.\n";
+            return false;
+        }
+        readyTimes.push_back(readyUS);
+        replyTimes.push_back(replyUS);
+    }
+    const Percentiles ready = getPercentiles(readyTimes);
+    const Percentiles reply = getPercentiles(replyTimes);
+    JsonRecord record;
+    record.add("benchmark", "startup")
+        .add("mode", "timing")
+        .add("evict", options.evict)
+        .add("ready", ready, "_us")
+        .add("first_reply", reply, "_us");
+    if (! options.historyPath.empty())
+    {
+        JsonRecord historyRecord = record;
+        historyRecord.add("timestamp", (long long) time(nullptr));
+        std::ofstream history(options.historyPath, std::ios::app);
+        history << historyRecord.toString() << std::endl;
+    }
+    if (options.json)
+    {
+        std::cout << record.toString() << std::endl;
+        return true;
+    }
+    std::cout << messagePrefix << "Startup times in microseconds"
+            << (options.evict ? " with the daemon evicted from the cache"
+            : "") << ":\n" << std::fixed << std::setprecision(1)
+            << std::setw(14) << "" << std::setw(10) << "p50"
+            << std::setw(10) << "p90" << std::setw(10) << "p99"
+            << std::setw(10) << "max" << "\n";
+    const std::vector<std::pair<std::string, Percentiles>> rows =
+    {
+        { "ready", ready },
+        { "first reply", reply }
+    };
+    for (const std::pair<std::string, Percentiles>& row : rows)
+    {
+        std::cout << std::setw(14) << row.first
+                << std::setw(10) << row.second.p50
+                << std::setw(10) << row.second.p90
+                << std::setw(10) << row.second.p99
+                << std::setw(10) << row.second.max << "\n";
+    }
+    std::cout.flush();
+    return true;
+}
+
+
+/**
+ * @brief  A single StartupProfile record.
+ */
+struct ProfileRecord
+{
+    // Time in nanoseconds when the phase finished:
+    uint64_t timeNS;
+    // The phase name, prefixed with the recording process:
+    std::string phase;
+};
+
+
+/**
+ * @brief  Reads all records from a startup profile.
+ *
+ * @param profilePath  The path to the profile file.
+ *
+ * @return             All records in the profile, sorted by time.
+ */
+static std::vector<ProfileRecord> readProfile(const std::string& profilePath)
+{
+    const pid_t parentID = getpid();
+    std::vector<ProfileRecord> records;
+    std::ifstream profile(profilePath);
+    std::string line;
+    while (std::getline(profile, line))
+    {
+        std::istringstream lineStream(line);
+        ProfileRecord record;
+        pid_t processID;
+        if (! (lineStream >> record.timeNS >> processID))
+        {
+            continue;
+        }
+        std::string phase;
+        std::getline(lineStream >> std::ws, phase);
+        record.phase = ((processID == parentID) ? "parent: " : "daemon: ")
+                + phase;
+        records.push_back(record);
+    }
+    std::stable_sort(records.begin(), records.end(),
+            [](const ProfileRecord& first, const ProfileRecord& second)
+            {
+                return first.timeNS < second.timeNS;
+            });
+    return records;
+}
+
+
+/**
+ * @brief  Profiles each phase of daemon startup, and prints the results.
+ *
+ * @return  Whether all launches succeeded.
+ */
+static bool runProfile(StartupBenchmark& benchmark, const Options& options)
+{
+    using namespace BenchmarkOutput;
+    for (size_t i = 0; i < options.samples; i++)
+    {
+        double readyUS = 0;
+        double replyUS = 0;
+        if (! benchmark.launch(readyUS, replyUS))
+        {
+            std::cerr << messagePrefix << "Launch " << i << " failed.\n";
+            return false;
+        }
+    }
+    const std::vector<ProfileRecord> records = readProfile(
+            getenv(DaemonFramework::StartupProfile::envVar));
+
+    // Find each phase's offset from the start of its launch. Records are only
+    // used from the first time each phase finishes within a launch:
+    const std::string launchName = std::string("parent: ") + launchPhase;
+    std::map<std::string, std::vector<double>> phaseOffsets;
+    std::map<std::string, bool> launchPhases;
+    uint64_t launchTime = 0;
+    for (const ProfileRecord& record : records)
+    {
+        if (record.phase == launchName)
+        {
+            launchTime = record.timeNS;
+            launchPhases.clear();
+        }
+        if (launchTime == 0 || launchPhases[record.phase])
+        {
+            continue;
+        }
+        launchPhases[record.phase] = true;
+        phaseOffsets[record.phase].push_back((record.timeNS - launchTime)
+                / 1000.0);
+    }
+
+    std::vector<std::pair<std::string, Percentiles>> phases;
+    for (const auto& phase : phaseOffsets)
+    {
+        phases.push_back({ phase.first, getPercentiles(phase.second) });
+    }
+    std::sort(phases.begin(), phases.end(),
+            [](const std::pair<std::string, Percentiles>& first,
+                const std::pair<std::string, Percentiles>& second)
+            {
+                return first.second.p50 < second.second.p50;
+            });
+    if (! options.json)
+    {
+        std::cout << messagePrefix << "Time since launch started when each "
+                << "phase finished, in microseconds:\n"
+                << std::setw(8) << "count" << std::setw(10) << "p50"
+                << std::setw(10) << "p90" << std::setw(10) << "delta"
+                << "  phase\n";
+    }
+    double lastOffset = 0;
+    for (const std::pair<std::string, Percentiles>& phase : phases)
+    {
+        const Percentiles& offset = phase.second;
+        const double delta = offset.p50 - lastOffset;
+        lastOffset = offset.p50;
+        if (options.json)
+        {
+            JsonRecord record;
+            record.add("benchmark", "startup")
+                .add("mode", "profile")
+                .add("phase", phase.first)
+                .add("count", offset.count)
+                .add("offset_p50_us", offset.p50)
+                .add("offset_p90_us", offset.p90)
+                .add("delta_us", delta);
+            std::cout << record.toString() << "\n";
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                << std::setw(8) << offset.count
+                << std::setw(10) << offset.p50
+                << std::setw(10) << offset.p90
+                << std::setw(10) << delta << "  " << phase.first << "\n";
+    }
+    std::cout.flush();
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        if (option == "--samples")
+        {
+            options.samples = std::stoul(value);
+        }
+        else if (option == "--mode")
+        {
+            options.profile = (value == "profile");
+        }
+        else if (option == "--evict")
+        {
+            options.evict = (value == "1");
+        }
+        else if (option == "--format")
+        {
+            options.json = (value == "json");
+        }
+        else if (option == "--history")
+        {
+            options.historyPath = value;
+        }
+    }
+    if (options.samples < 1)
+    {
+        std::cerr << messagePrefix << "Invalid benchmark options.\n";
+        return 1;
+    }
+
+    using DaemonFramework::StartupProfile::envVar;
+    char profilePath[] = "/tmp/StartupBenchmarkXXXXXX";
+    if (options.profile)
+    {
+        const int profileFile = mkstemp(profilePath);
+        if (profileFile == -1)
+        {
+            std::cerr << messagePrefix << "Failed to create profile file.\n";
+            return 1;
+        }
+        close(profileFile);
+        setenv(envVar, profilePath, 1);
+    }
+    else
+    {
+        unsetenv(envVar);
+    }
+
+    StartupBenchmark benchmark;
+    const bool succeeded = options.profile ? runProfile(benchmark, options)
+            : runTiming(benchmark, options);
+    if (options.profile)
+    {
+        unlink(profilePath);
+    }
+    return succeeded ? 0 : 1;
+}
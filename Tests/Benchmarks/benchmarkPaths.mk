@@ -0,0 +1,20 @@
+### DaemonFramework Benchmark Path Configuration ###
+#
+# Defines the daemon executable, pipe, and lock file paths shared by the
+# BenchmarkDaemon and the benchmark parent programs. Makefiles including this
+# file must define TEST_BUILD_DIR first.
+#
+# Benchmarks run the daemon from the build directory instead of an installed
+# secured directory, so directory security checks are disabled unless they are
+# explicitly enabled. Startup profiling is compiled in so that StartupBenchmark
+# can break down launch times.
+
+BENCHMARK_DAEMON_NAME:=BenchmarkDaemon
+
+DF_DAEMON_PATH?=$(TEST_BUILD_DIR)/$(BENCHMARK_DAEMON_NAME)
+DF_INPUT_PIPE_PATH?=$(TEST_BUILD_DIR)/.benchmarkInPipe
+DF_OUTPUT_PIPE_PATH?=$(TEST_BUILD_DIR)/.benchmarkOutPipe
+DF_LOCK_FILE_PATH?=$(TEST_BUILD_DIR)/.benchmarkLock
+DF_VERIFY_PATH_SECURITY?=0
+DF_VERIFY_PARENT_PATH_SECURITY?=0
+DF_STARTUP_PROFILE_ENABLED?=1
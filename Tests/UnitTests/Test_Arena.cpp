@@ -0,0 +1,158 @@
+#include "catch.hpp"
+#include "Arena.h"
+#include "Scratch.h"
+#include "PolicyLoop.h"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using namespace DaemonFramework;
+
+// Whether heap allocations on the calling thread should be counted:
+static thread_local bool countHeapAllocations = false;
+// Number of heap allocations counted:
+static thread_local int heapAllocations = 0;
+
+// Replace global allocation so the test can detect heap use:
+void* operator new(size_t size)
+{
+    if (countHeapAllocations)
+    {
+        heapAllocations++;
+    }
+    void* memory = std::malloc((size == 0) ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+// Requires a running parent, so each iteration updates parent process data:
+struct ParentSecurity : public Policy::NoSecurity
+{
+    static constexpr const bool requireRunningParent = true;
+};
+
+/**
+ * @brief  A loop that uses scratch memory in each loopAction() call, counting
+ *         heap allocations once it has run long enough to warm up.
+ */
+class ScratchLoop :
+        public PolicyLoop<Policy::NoPipes, ParentSecurity, Policy::NoTimeout>
+{
+public:
+    // Number of loopAction() calls made:
+    int actionCount = 0;
+
+private:
+    virtual int loopAction() override
+    {
+        actionCount++;
+        if (actionCount == warmupActions)
+        {
+            countHeapAllocations = true;
+        }
+        else if (actionCount == totalActions)
+        {
+            countHeapAllocations = false;
+            return 1;
+        }
+        Scratch::Vector<Scratch::String> lines;
+        for (int i = 0; i < 50; i++)
+        {
+            lines.emplace_back(100, 'a' + (i % 26));
+        }
+        return lines.size() == 50 ? 0 : 2;
+    }
+
+    static const constexpr int warmupActions = 10;
+    static const constexpr int totalActions = 100;
+};
+
+TEST_CASE("Arenas allocate aligned memory.", "[Arena]")
+{
+    INFO("Testing: Arena::allocate");
+    Arena arena(256);
+    arena.allocate(1, 1);
+    for (size_t alignment : { 2, 4, 8, 16, 32, 64 })
+    {
+        void* memory = arena.allocate(3, alignment);
+        REQUIRE(reinterpret_cast<uintptr_t>(memory) % alignment == 0);
+    }
+    REQUIRE(arena.getBlockAllocations() == 1);
+}
+
+TEST_CASE("Arenas reuse memory after reset.", "[Arena]")
+{
+    INFO("Testing: Arena::reset");
+    SECTION("Reset memory is allocated again.")
+    {
+        Arena arena;
+        void* first = arena.allocate(100);
+        arena.allocate(200);
+        REQUIRE(arena.getUsed() >= 300);
+        arena.reset();
+        REQUIRE(arena.getUsed() == 0);
+        REQUIRE(arena.allocate(100) == first);
+    }
+    SECTION("Growing arenas merge into one block on reset.")
+    {
+        Arena arena(64);
+        for (int i = 0; i < 20; i++)
+        {
+            arena.allocate(48);
+        }
+        const size_t grownAllocations = arena.getBlockAllocations();
+        REQUIRE(grownAllocations > 1);
+        arena.reset();
+        const size_t mergedAllocations = arena.getBlockAllocations();
+        REQUIRE(mergedAllocations == grownAllocations + 1);
+        for (int cycle = 0; cycle < 5; cycle++)
+        {
+            for (int i = 0; i < 20; i++)
+            {
+                arena.allocate(48);
+            }
+            arena.reset();
+        }
+        REQUIRE(arena.getBlockAllocations() == mergedAllocations);
+    }
+}
+
+TEST_CASE("Scratch scopes choose the thread's scratch memory.", "[Arena]")
+{
+    INFO("Testing: Scratch::Scope");
+    Arena outer;
+    Arena inner;
+    REQUIRE(Scratch::getResource() == Scratch::heapResource());
+    {
+        Scratch::Scope outerScope(outer);
+        REQUIRE(Scratch::getResource() == &outer);
+        {
+            Scratch::Scope innerScope(inner);
+            REQUIRE(Scratch::getResource() == &inner);
+            Scratch::String text(200, 'x');
+            REQUIRE(inner.getUsed() > 0);
+        }
+        REQUIRE(inner.getUsed() == 0);
+        REQUIRE(Scratch::getResource() == &outer);
+    }
+    REQUIRE(Scratch::getResource() == Scratch::heapResource());
+}
+
+TEST_CASE("Policy loops reach a steady state without heap allocations.",
+        "[Arena]")
+{
+    INFO("Testing: PolicyLoop scratch memory");
+    ScratchLoop loop;
+    heapAllocations = 0;
+    REQUIRE(loop.runLoop() == 1);
+    REQUIRE(loop.actionCount == 100);
+    REQUIRE(heapAllocations == 0);
+}
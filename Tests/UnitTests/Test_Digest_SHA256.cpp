@@ -0,0 +1,159 @@
+#include "catch.hpp"
+#include "Digest_SHA256.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief  Gets a SHA-256 digest from a hexadecimal string, failing the current
+ *         test if the string is invalid.
+ */
+static DaemonFramework::Digest::SHA256Value hexDigest(const char* hexString)
+{
+    DaemonFramework::Digest::SHA256Value digest;
+    REQUIRE(DaemonFramework::Digest::parseSHA256(hexString, digest));
+    return digest;
+}
+
+TEST_CASE("SHA-256 digests are calculated correctly." "[sha256]")
+{
+    INFO("Testing: Digest::sha256");
+    using namespace DaemonFramework::Digest;
+    REQUIRE(sha256(nullptr, 0) == hexDigest(
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    const std::string abc("abc");
+    REQUIRE(sha256((const unsigned char*) abc.data(), abc.size()) == hexDigest(
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    const std::string twoBlocks(
+            "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+    REQUIRE(sha256((const unsigned char*) twoBlocks.data(), twoBlocks.size())
+            == hexDigest("248d6a61d20638b8e5c026930c3e6039"
+                         "a33ce45964ff2167f6ecedd419db06c1"));
+    const std::string millionAs(1000000, 'a');
+    REQUIRE(sha256((const unsigned char*) millionAs.data(), millionAs.size())
+            == hexDigest("cdc76e5c9914fb9281a1c7e284d73e67"
+                         "f1809a48a497200e046d39ccc7112cd0"));
+}
+
+TEST_CASE("Portable SHA-256 digests are calculated correctly." "[sha256]")
+{
+    INFO("Testing: Digest::portableSHA256");
+    using namespace DaemonFramework::Digest;
+    REQUIRE(portableSHA256(nullptr, 0) == hexDigest(
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    const std::string abc("abc");
+    REQUIRE(portableSHA256((const unsigned char*) abc.data(), abc.size())
+            == hexDigest("ba7816bf8f01cfea414140de5dae2223"
+                         "b00361a396177a9cb410ff61f20015ad"));
+    const std::string millionAs(1000000, 'a');
+    REQUIRE(portableSHA256((const unsigned char*) millionAs.data(),
+                millionAs.size())
+            == hexDigest("cdc76e5c9914fb9281a1c7e284d73e67"
+                         "f1809a48a497200e046d39ccc7112cd0"));
+    // Both implementations should agree on every padding case:
+    std::string data;
+    for (int i = 0; i < 300; i++)
+    {
+        REQUIRE(portableSHA256((const unsigned char*) data.data(), data.size())
+                == sha256((const unsigned char*) data.data(), data.size()));
+        data += (char) (i * 37);
+    }
+}
+
+TEST_CASE("SHA-256 digest strings are parsed correctly." "[parseSHA256]")
+{
+    INFO("Testing: Digest::parseSHA256");
+    using namespace DaemonFramework::Digest;
+    SHA256Value digest;
+    REQUIRE(! parseSHA256(nullptr, digest));
+    REQUIRE(! parseSHA256("", digest));
+    REQUIRE(! parseSHA256("abc", digest));
+    REQUIRE(! parseSHA256(std::string(64, 'g').c_str(), digest));
+    REQUIRE(! parseSHA256(std::string(66, 'a').c_str(), digest));
+    REQUIRE(parseSHA256(std::string(64, 'F').c_str(), digest));
+    REQUIRE(digest == hexDigest(std::string(64, 'f').c_str()));
+}
+
+TEST_CASE("File digests are calculated correctly." "[fileSHA256]")
+{
+    INFO("Testing: Digest::fileSHA256");
+    using namespace DaemonFramework::Digest;
+    system("printf abc > digestTestFile");
+    int testFile = open("digestTestFile", O_RDONLY);
+    REQUIRE(testFile != -1);
+    SHA256Value digest;
+    REQUIRE(fileSHA256(testFile, digest, nullptr));
+    REQUIRE(digest == hexDigest(
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    // Repeated digests should still be correct:
+    REQUIRE(fileSHA256(testFile, digest, nullptr));
+    REQUIRE(digest == hexDigest(
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    close(testFile);
+    // Changed files should be hashed again:
+    system("printf abcd > digestTestFile");
+    testFile = open("digestTestFile", O_RDONLY);
+    REQUIRE(testFile != -1);
+    REQUIRE(fileSHA256(testFile, digest, nullptr));
+    REQUIRE(digest == hexDigest(
+            "88d4266fd4e6338d13b845fcf289579d209c897823b9217da3e161936f031589"));
+    close(testFile);
+    system("rm digestTestFile");
+}
+
+TEST_CASE("File digests are cached between processes." "[fileSHA256]")
+{
+    INFO("Testing: Digest::fileSHA256 digest caching");
+    using namespace DaemonFramework::Digest;
+    const char* cachePath = "digestTestCache";
+    const SHA256Value abcDigest = hexDigest(
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    unlink(cachePath);
+    system("printf abc > digestTestFile");
+    int testFile = open("digestTestFile", O_RDONLY);
+    REQUIRE(testFile != -1);
+    SHA256Value digest;
+    REQUIRE(fileSHA256(testFile, digest, cachePath));
+    REQUIRE(digest == abcDigest);
+    struct stat cacheStats;
+    if (geteuid() != 0)
+    {
+        // Only root may create trusted cache files:
+        REQUIRE(stat(cachePath, &cacheStats) == -1);
+        close(testFile);
+        system("rm digestTestFile");
+        return;
+    }
+    REQUIRE(stat(cachePath, &cacheStats) == 0);
+    REQUIRE((cacheStats.st_mode & 0777) == 0600);
+    // Change the cached digest, which is saved at the end of the cache file,
+    // to show when it is used:
+    const int cacheFile = open(cachePath, O_RDWR);
+    REQUIRE(cacheFile != -1);
+    const unsigned char changedByte = abcDigest.back() ^ 0xff;
+    REQUIRE(pwrite(cacheFile, &changedByte, 1, cacheStats.st_size - 1) == 1);
+    close(cacheFile);
+    REQUIRE(fileSHA256(testFile, digest, cachePath));
+    REQUIRE(digest != abcDigest);
+    REQUIRE(digest.back() == changedByte);
+    // Cache files that other users may modify should be ignored and replaced:
+    REQUIRE(chmod(cachePath, 0666) == 0);
+    REQUIRE(fileSHA256(testFile, digest, cachePath));
+    REQUIRE(digest == abcDigest);
+    REQUIRE(stat(cachePath, &cacheStats) == 0);
+    REQUIRE((cacheStats.st_mode & 0777) == 0600);
+    close(testFile);
+    // Changed files should be hashed again:
+    system("printf abcd > digestTestFile");
+    testFile = open("digestTestFile", O_RDONLY);
+    REQUIRE(testFile != -1);
+    REQUIRE(fileSHA256(testFile, digest, cachePath));
+    REQUIRE(digest == hexDigest(
+            "88d4266fd4e6338d13b845fcf289579d209c897823b9217da3e161936f031589"));
+    close(testFile);
+    system("rm digestTestFile");
+    unlink(cachePath);
+}
@@ -0,0 +1,91 @@
+#include "catch.hpp"
+#include "EventLoop.h"
+#include <atomic>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+
+TEST_CASE("Event handlers run when file descriptors are ready." "[EventLoop]")
+{
+    INFO("Testing: EventLoop::processEvents");
+    DaemonFramework::EventLoop loop;
+    REQUIRE(loop.isValid());
+    int testPipe[2];
+    REQUIRE(pipe(testPipe) == 0);
+    int handlerCalls = 0;
+    REQUIRE(loop.addFD(testPipe[0], EPOLLIN, [&](const uint32_t events)
+    {
+        char readBuffer;
+        REQUIRE((events & EPOLLIN) != 0);
+        REQUIRE(read(testPipe[0], &readBuffer, 1) == 1);
+        handlerCalls++;
+    }));
+    REQUIRE(loop.processEvents(0) == 0);
+    REQUIRE(write(testPipe[1], "x", 1) == 1);
+
+    // The loop's file descriptor should be usable in other poll loops:
+    struct pollfd loopPoll = { loop.getFD(), POLLIN, 0 };
+    REQUIRE(poll(&loopPoll, 1, 1000) == 1);
+    REQUIRE(loop.processEvents(0) == 1);
+    REQUIRE(handlerCalls == 1);
+
+    REQUIRE(loop.removeFD(testPipe[0]));
+    REQUIRE(! loop.removeFD(testPipe[0]));
+    REQUIRE(write(testPipe[1], "x", 1) == 1);
+    REQUIRE(loop.processEvents(0) == 0);
+    REQUIRE(handlerCalls == 1);
+    close(testPipe[0]);
+    close(testPipe[1]);
+}
+
+TEST_CASE("Event loop threads start and stop correctly." "[EventLoop]")
+{
+    INFO("Testing: EventLoop::startThread");
+    DaemonFramework::EventLoop loop;
+    REQUIRE(loop.startThread());
+    REQUIRE(loop.isThreadRunning());
+    REQUIRE(loop.startThread());
+    loop.stopThread();
+    REQUIRE(! loop.isThreadRunning());
+}
+
+TEST_CASE("Event loop threads stopped by handlers exit before restarting."
+        "[EventLoop]")
+{
+    INFO("Testing: EventLoop::stopThread within handlers");
+    DaemonFramework::EventLoop loop;
+    int testPipe[2];
+    REQUIRE(pipe(testPipe) == 0);
+    std::atomic_int handlerCalls(0);
+    std::atomic_bool restartedInHandler(false);
+    std::atomic_bool handlerFinished(false);
+    REQUIRE(loop.addFD(testPipe[0], EPOLLIN, [&](const uint32_t events)
+    {
+        char readBuffer;
+        if ((events & EPOLLIN) != 0 && read(testPipe[0], &readBuffer, 1) == 1)
+        {
+            loop.stopThread();
+            restartedInHandler = loop.startThread();
+            handlerCalls++;
+            // Keep the stopped thread busy, so a restart has to wait for it:
+            usleep(100000);
+            handlerFinished = true;
+        }
+    }));
+    REQUIRE(loop.startThread());
+    REQUIRE(write(testPipe[1], "x", 1) == 1);
+    while (handlerCalls == 0)
+    {
+        usleep(1000);
+    }
+    REQUIRE(! restartedInHandler);
+    REQUIRE(loop.startThread());
+    REQUIRE(handlerFinished);
+    REQUIRE(loop.isThreadRunning());
+    loop.stopThread();
+    REQUIRE(! loop.isThreadRunning());
+    REQUIRE(handlerCalls == 1);
+    loop.removeFD(testPipe[0]);
+    close(testPipe[0]);
+    close(testPipe[1]);
+}
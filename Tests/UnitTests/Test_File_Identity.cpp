@@ -0,0 +1,38 @@
+#include "catch.hpp"
+#include "File_Identity.h"
+#include <sys/stat.h>
+#include <cstdlib>
+
+TEST_CASE("File identities are compared correctly." "[Identity]")
+{
+    INFO("Testing: File::Identity");
+    using DaemonFramework::File::Identity;
+    const Identity invalid;
+    REQUIRE(! invalid.isValid());
+    REQUIRE(invalid != invalid);
+
+    struct stat fileStats;
+    REQUIRE(stat(MAKEFILE_PATH, &fileStats) == 0);
+    const Identity makefile(fileStats);
+    REQUIRE(makefile.isValid());
+    REQUIRE(makefile == Identity(fileStats));
+    REQUIRE(makefile != invalid);
+    REQUIRE(makefile.getSize() == fileStats.st_size);
+
+    system("echo 'first version' > identityTestFile");
+    REQUIRE(stat("identityTestFile", &fileStats) == 0);
+    const Identity firstVersion(fileStats);
+    REQUIRE(firstVersion != makefile);
+    REQUIRE(! firstVersion.sameFile(makefile));
+    system("echo 'modified version' >> identityTestFile");
+    REQUIRE(stat("identityTestFile", &fileStats) == 0);
+    const Identity modifiedVersion(fileStats);
+    REQUIRE(firstVersion.sameFile(modifiedVersion));
+    REQUIRE(firstVersion != modifiedVersion);
+    system("cp identityTestFile identityTestCopy");
+    system("mv identityTestCopy identityTestFile");
+    REQUIRE(stat("identityTestFile", &fileStats) == 0);
+    const Identity replacedVersion(fileStats);
+    REQUIRE(! replacedVersion.sameFile(modifiedVersion));
+    system("rm identityTestFile");
+}
@@ -0,0 +1,74 @@
+#include "catch.hpp"
+#include "HdrHistogram.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Histogram percentiles are within bucket precision." "[HdrHistogram]")
+{
+    INFO("Testing: HdrHistogram::record, HdrHistogram::getValueAtPercentile");
+    DaemonFramework::HdrHistogram histogram;
+    REQUIRE(histogram.getCount() == 0);
+    REQUIRE(histogram.getMin() == 0);
+    REQUIRE(histogram.getMax() == 0);
+    REQUIRE(histogram.getValueAtPercentile(50) == 0);
+
+    for (uint64_t value = 1; value <= 100000; value++)
+    {
+        histogram.record(value);
+    }
+    REQUIRE(histogram.getCount() == 100000);
+    REQUIRE(histogram.getMin() == 1);
+    REQUIRE(histogram.getMax() == 100000);
+    REQUIRE(histogram.getMean() == Approx(50000.5));
+    for (const double percentile : { 1.0, 50.0, 90.0, 99.0, 99.9 })
+    {
+        const double expected = percentile * 1000;
+        const double found = histogram.getValueAtPercentile(percentile);
+        REQUIRE(found >= expected);
+        REQUIRE(found <= expected * 1.04);
+    }
+    REQUIRE(histogram.getValueAtPercentile(100) == 100000);
+
+    // Small values are recorded exactly:
+    histogram.reset();
+    REQUIRE(histogram.getCount() == 0);
+    for (const uint64_t value : { 3, 3, 7, 31 })
+    {
+        histogram.record(value);
+    }
+    REQUIRE(histogram.getValueAtPercentile(50) == 3);
+    REQUIRE(histogram.getValueAtPercentile(75) == 7);
+    REQUIRE(histogram.getValueAtPercentile(100) == 31);
+
+    // Values beyond the supported range are kept in the last bucket:
+    histogram.record(UINT64_MAX);
+    REQUIRE(histogram.getMax() == UINT64_MAX);
+    REQUIRE(histogram.getValueAtPercentile(100) == UINT64_MAX);
+}
+
+TEST_CASE("Histogram values from each thread are combined." "[HdrHistogram]")
+{
+    INFO("Testing: HdrHistogram::record, HdrHistogram::getCount");
+    DaemonFramework::HdrHistogram histogram;
+    const int threadCount = 4;
+    const int threadValues = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&histogram, i]()
+        {
+            for (int value = 0; value < threadValues; value++)
+            {
+                histogram.record(value + i);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(histogram.getCount() == threadCount * threadValues);
+    REQUIRE(histogram.getMin() == 0);
+    REQUIRE(histogram.getMax() == threadValues + threadCount - 2);
+}
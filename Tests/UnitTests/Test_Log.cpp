@@ -0,0 +1,113 @@
+#include "catch.hpp"
+#include "Debug.h"
+#include "Log.h"
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifndef DF_LOGGING
+#error "Test_Log requires a debug build or DF_LOG_ENABLED"
+#endif
+
+using DaemonFramework::Log::Level;
+
+/**
+ * @brief  Runs a function while log lines are written to a temporary file,
+ *         and returns all lines written.
+ */
+template <typename LogAction>
+static std::vector<std::string> captureLines(LogAction logAction)
+{
+    char logPath[] = "/tmp/Test_LogXXXXXX";
+    const int logFile = mkstemp(logPath);
+    REQUIRE(logFile != -1);
+    DaemonFramework::Log::setOutput(logFile);
+    logAction();
+    DaemonFramework::Log::flush();
+    DaemonFramework::Log::setOutput(STDOUT_FILENO);
+    close(logFile);
+    std::ifstream logStream(logPath);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(logStream, line))
+    {
+        lines.push_back(line);
+    }
+    unlink(logPath);
+    return lines;
+}
+
+TEST_CASE("Log lines from each thread are written." "[Log]")
+{
+    INFO("Testing: Log::beginLine, Log::endLine, Log::flush");
+    const int threadCount = 4;
+    const int threadLines = 20;
+    const std::vector<std::string> lines = captureLines([]()
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([i]()
+            {
+                for (int line = 0; line < threadLines; line++)
+                {
+                    DaemonFramework::Log::beginLine() << "Test_Log " << i
+                            << " " << line;
+                    DaemonFramework::Log::endLine();
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    });
+    REQUIRE(lines.size() == threadCount * threadLines);
+    const std::set<std::string> uniqueLines(lines.begin(), lines.end());
+    REQUIRE(uniqueLines.size() == lines.size());
+    REQUIRE(uniqueLines.count("Test_Log 3 19") == 1);
+}
+
+TEST_CASE("Log levels and rate limits are applied." "[Log]")
+{
+    INFO("Testing: Log::setLevel, Log::CallSite::allowLine, DF_DBG");
+    const Level initialLevel = DaemonFramework::Log::getLevel();
+    DaemonFramework::Log::setLevel(Level::error);
+    const std::vector<std::string> hiddenLines = captureLines([]()
+    {
+        DF_DBG("Test_Log hidden line");
+    });
+    REQUIRE(hiddenLines.empty());
+
+    DaemonFramework::Log::setLevel(Level::debug);
+    const std::vector<std::string> errorLines = captureLines([]()
+    {
+        errno = ENOENT;
+        DF_DBG("Test_Log error line:");
+        DF_PERROR("Test_Log");
+        REQUIRE(errno == ENOENT);
+    });
+    REQUIRE(errorLines.size() == 2);
+    REQUIRE(errorLines[1].find("Test_Log: No such file or directory")
+            != std::string::npos);
+    DaemonFramework::Log::setLevel(initialLevel);
+
+    using DaemonFramework::Log::siteLinesPerSecond;
+    DaemonFramework::Log::CallSite callSite;
+    unsigned int allowedLines = 0;
+    for (unsigned int i = 0; i < siteLinesPerSecond * 3; i++)
+    {
+        if (callSite.allowLine())
+        {
+            allowedLines++;
+        }
+    }
+    // A new second may start while testing, allowing one more set of lines:
+    REQUIRE(allowedLines >= siteLinesPerSecond);
+    REQUIRE(allowedLines <= siteLinesPerSecond * 2);
+}
@@ -0,0 +1,161 @@
+#include "catch.hpp"
+#include "Metrics.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if ! defined DF_METRICS_ENABLED || ! DF_METRICS_ENABLED
+#error "Test_Metrics requires DF_METRICS_ENABLED"
+#endif
+
+DF_METRIC_COUNTER(testCounter, "df_test_events_total", "Test events.",
+        "source=\"test\"");
+DF_METRIC_COUNTER(otherCounter, "df_test_events_total", "Test events.",
+        "source=\"other\"");
+DF_METRIC_GAUGE(testGauge, "df_test_level", "Test level.");
+DF_METRIC_HISTOGRAM(testHistogram, "df_test_size_bytes", "Test sizes.", 4,
+        3);
+
+/**
+ * @brief  Gets the value of a single sample from formatted metrics text.
+ *
+ * @param text    Metrics in the exposition format.
+ *
+ * @param sample  The sample name and labels.
+ *
+ * @return        The sample value, or -1 if the sample was not found.
+ */
+static double getSample(const std::string& text, const std::string& sample)
+{
+    std::istringstream textStream(text);
+    std::string line;
+    while (std::getline(textStream, line))
+    {
+        if (line.compare(0, sample.size() + 1, sample + " ") == 0)
+        {
+            return std::stod(line.substr(sample.size() + 1));
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief  Counts the lines in a string that contain a substring.
+ */
+static int countLines(const std::string& text, const std::string& substring)
+{
+    std::istringstream textStream(text);
+    std::string line;
+    int count = 0;
+    while (std::getline(textStream, line))
+    {
+        if (line.find(substring) != std::string::npos)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+TEST_CASE("Metric values from each thread are combined." "[Metrics]")
+{
+    INFO("Testing: Metrics::Counter, Metrics::Gauge, Metrics::getText");
+    const std::string sample("df_test_events_total{source=\"test\"}");
+    const double initialCount = getSample(DaemonFramework::Metrics::getText(),
+            sample);
+    REQUIRE(initialCount >= 0);
+    const int threadCount = 4;
+    const int threadEvents = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([]()
+        {
+            for (int event = 0; event < threadEvents; event++)
+            {
+                DF_METRIC_ADD(testCounter, 1);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    DF_METRIC_ADD(otherCounter, 2);
+    DF_METRIC_SET(testGauge, -5);
+
+    const std::string text = DaemonFramework::Metrics::getText();
+    REQUIRE(getSample(text, sample)
+            == initialCount + threadCount * threadEvents);
+    REQUIRE(getSample(text, "df_test_events_total{source=\"other\"}") >= 2);
+    REQUIRE(getSample(text, "df_test_level") == -5);
+    REQUIRE(countLines(text, "# TYPE df_test_events_total counter") == 1);
+    REQUIRE(countLines(text, "# TYPE df_test_level gauge") == 1);
+}
+
+TEST_CASE("Metric values from exited threads are kept." "[Metrics]")
+{
+    INFO("Testing: Metrics::Counter, Metrics::getText");
+    const std::string sample("df_test_events_total{source=\"test\"}");
+    const double initialCount = getSample(DaemonFramework::Metrics::getText(),
+            sample);
+    REQUIRE(initialCount >= 0);
+    const int rounds = 20;
+    for (int round = 0; round < rounds; round++)
+    {
+        std::thread([]() { DF_METRIC_ADD(testCounter, 3); }).join();
+        REQUIRE(getSample(DaemonFramework::Metrics::getText(), sample)
+                == initialCount + (round + 1) * 3);
+    }
+}
+
+TEST_CASE("Histogram buckets are cumulative." "[Metrics]")
+{
+    INFO("Testing: Metrics::Histogram, Metrics::writeFile");
+    const std::string countSample("df_test_size_bytes_count");
+    const double initialCount = getSample(DaemonFramework::Metrics::getText(),
+            countSample);
+    REQUIRE(initialCount >= 0);
+    // Bucket bounds are 4, 16, and 64:
+    for (const uint64_t size : { 1, 4, 5, 64, 65, 1000 })
+    {
+        DF_METRIC_OBSERVE(testHistogram, size);
+    }
+
+    char metricsPath[] = "/tmp/Test_MetricsXXXXXX";
+    const int metricsFile = mkstemp(metricsPath);
+    REQUIRE(metricsFile != -1);
+    close(metricsFile);
+    // Links at the temporary file path must not redirect the write:
+    const std::string tempPath = std::string(metricsPath) + "."
+            + std::to_string(getpid()) + ".tmp";
+    REQUIRE(symlink(metricsPath, tempPath.c_str()) == 0);
+    REQUIRE(! DaemonFramework::Metrics::writeFile(metricsPath));
+    struct stat metricsStats;
+    REQUIRE(stat(metricsPath, &metricsStats) == 0);
+    REQUIRE(metricsStats.st_size == 0);
+    unlink(tempPath.c_str());
+    REQUIRE(DaemonFramework::Metrics::writeFile(metricsPath));
+    std::ifstream metricsStream(metricsPath);
+    std::stringstream textStream;
+    textStream << metricsStream.rdbuf();
+    unlink(metricsPath);
+    const std::string text = textStream.str();
+
+    REQUIRE(countLines(text, "# TYPE df_test_size_bytes histogram") == 1);
+    if (initialCount == 0)
+    {
+        REQUIRE(getSample(text, "df_test_size_bytes_bucket{le=\"4\"}") == 2);
+        REQUIRE(getSample(text, "df_test_size_bytes_bucket{le=\"16\"}") == 3);
+        REQUIRE(getSample(text, "df_test_size_bytes_bucket{le=\"64\"}") == 4);
+        REQUIRE(getSample(text, "df_test_size_bytes_bucket{le=\"+Inf\"}")
+                == 6);
+        REQUIRE(getSample(text, "df_test_size_bytes_sum") == 1139);
+    }
+    REQUIRE(getSample(text, countSample) == initialCount + 6);
+}
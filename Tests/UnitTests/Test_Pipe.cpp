@@ -0,0 +1,168 @@
+#include "catch.hpp"
+#include "EventLoop.h"
+#include "Pipe_Reader.h"
+#include "Pipe_Writer.h"
+#include "Pipe_Listener.h"
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+
+// Saves all data read from a pipe:
+class TestListener : public DaemonFramework::Pipe::Listener
+{
+public:
+    std::string received;
+private:
+    virtual void processData(const unsigned char* data, const size_t size)
+        override
+    {
+        received.append((const char*) data, size);
+    }
+};
+
+// Gets a unique path for a test pipe:
+static std::string testPipePath()
+{
+    return std::string("/tmp/DaemonFrameworkTestPipe")
+            + std::to_string((int) getpid());
+}
+
+// Checks if a pipe open handle has completed:
+static bool isComplete(const std::shared_future<bool>& openResult)
+{
+    return openResult.wait_for(std::chrono::seconds(0))
+            == std::future_status::ready;
+}
+
+TEST_CASE("Pipes open through an event loop without blocking." "[Pipe]")
+{
+    INFO("Testing: Pipe::Reader::openPipe, Pipe::Writer::openPipe");
+    const std::string path = testPipePath();
+    unlink(path.c_str());
+    REQUIRE(mkfifo(path.c_str(), S_IRUSR | S_IWUSR) == 0);
+    DaemonFramework::EventLoop loop;
+    TestListener listener;
+    {
+        DaemonFramework::Pipe::Writer writer(path.c_str());
+        DaemonFramework::Pipe::Reader reader(path.c_str(), 64);
+
+        // The writer can't finish opening until a reader opens the pipe:
+        std::shared_future<bool> writerOpened = writer.openPipe(&loop);
+        REQUIRE(writerOpened.valid());
+        loop.processEvents(20);
+        REQUIRE(! isComplete(writerOpened));
+
+        // The reader opens immediately:
+        std::shared_future<bool> readerOpened = reader.openPipe(&listener,
+                &loop);
+        REQUIRE(isComplete(readerOpened));
+        REQUIRE(readerOpened.get());
+
+        for (int i = 0; i < 100 && ! isComplete(writerOpened); i++)
+        {
+            loop.processEvents(100);
+        }
+        REQUIRE(isComplete(writerOpened));
+        REQUIRE(writerOpened.get());
+
+        REQUIRE(writer.sendData((const unsigned char*) "test", 4));
+        REQUIRE(loop.processEvents(1000) == 1);
+        REQUIRE(listener.received == "test");
+
+        // Closing the writer closes the reader:
+        writer.closePipe();
+        REQUIRE(loop.processEvents(1000) == 1);
+        REQUIRE(reader.isClosed());
+    }
+    unlink(path.c_str());
+}
+
+TEST_CASE("Closing a pipe cancels opening it." "[Pipe]")
+{
+    INFO("Testing: Pipe::Writer::closePipe");
+    const std::string path = testPipePath();
+    unlink(path.c_str());
+    REQUIRE(mkfifo(path.c_str(), S_IRUSR | S_IWUSR) == 0);
+    DaemonFramework::EventLoop loop;
+    {
+        DaemonFramework::Pipe::Writer writer(path.c_str());
+        std::shared_future<bool> writerOpened = writer.openPipe(&loop);
+        loop.processEvents(20);
+        REQUIRE(! isComplete(writerOpened));
+        writer.closePipe();
+        REQUIRE(isComplete(writerOpened));
+        REQUIRE(! writerOpened.get());
+        REQUIRE(! writer.sendData((const unsigned char*) "test", 4));
+
+        // Writers opening on init threads are also cancelled without waiting
+        // for a reader:
+        writerOpened = writer.openPipe();
+        REQUIRE(! writer.waitForInitUntil(std::chrono::steady_clock::now()
+                    + std::chrono::milliseconds(20)));
+        writer.closePipe();
+        REQUIRE(isComplete(writerOpened));
+        REQUIRE(! writerOpened.get());
+    }
+    unlink(path.c_str());
+}
+
+TEST_CASE("Timestamped pipe messages record traffic and latency." "[Pipe]")
+{
+    INFO("Testing: Pipe::Reader::setTimestamps, Pipe::Reader::getLatencies,"
+            " Pipe::Writer::getTraffic");
+    const std::string path = testPipePath();
+    unlink(path.c_str());
+    REQUIRE(mkfifo(path.c_str(), S_IRUSR | S_IWUSR) == 0);
+    DaemonFramework::EventLoop loop;
+    TestListener listener;
+    {
+        DaemonFramework::Pipe::Writer writer(path.c_str());
+        // Use a buffer smaller than a TimestampHeader, so that headers are
+        // split between reads:
+        DaemonFramework::Pipe::Reader reader(path.c_str(), 5);
+        writer.setTimestamps(true);
+        reader.setTimestamps(true);
+        std::shared_future<bool> writerOpened = writer.openPipe(&loop);
+        REQUIRE(reader.openPipe(&listener, &loop).get());
+        for (int i = 0; i < 100 && ! isComplete(writerOpened); i++)
+        {
+            loop.processEvents(100);
+        }
+        REQUIRE(writerOpened.get());
+
+        const std::string messages[] = { "first", "", "third message" };
+        std::string expected;
+        for (const std::string& message : messages)
+        {
+            REQUIRE(writer.sendData((const unsigned char*) message.data(),
+                        message.size()));
+            expected += message;
+        }
+        const size_t sentBytes = expected.size()
+                + 3 * sizeof(DaemonFramework::Pipe::TimestampHeader);
+        for (int i = 0; i < 100 && listener.received.size() < expected.size();
+                i++)
+        {
+            loop.processEvents(100);
+        }
+        REQUIRE(listener.received == expected);
+
+        const DaemonFramework::Pipe::Traffic sent = writer.getTraffic();
+        REQUIRE(sent.messages == 3);
+        REQUIRE(sent.bytes == expected.size());
+        REQUIRE(writer.getWriteTimes().getCount() == 3);
+
+        const DaemonFramework::Pipe::Traffic received = reader.getTraffic();
+        REQUIRE(received.messages == 3);
+        REQUIRE(received.bytes == expected.size());
+        REQUIRE(received.elapsedNS > 0);
+        REQUIRE(received.bytesPerSecond() > 0);
+        REQUIRE(reader.getLatencies().getCount() == 3);
+        REQUIRE(reader.getLatencies().getMax() > 0);
+        REQUIRE(reader.getReadSizes().getMax() <= 5);
+        REQUIRE(reader.getReadSizes().getMean()
+                * reader.getReadSizes().getCount() == Approx(sentBytes));
+    }
+    unlink(path.c_str());
+}
@@ -0,0 +1,176 @@
+#include "catch.hpp"
+#include "PolicyLoop.h"
+#include "Process_Security.h"
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+using namespace DaemonFramework;
+
+// Path used by the lock file test:
+static const constexpr char* testLockPath = "PolicyLoopTest.lock";
+
+// Exits if the daemon executable isn't at a nonexistent path:
+struct MissingDaemonSecurity : public Policy::NoSecurity
+{
+    static constexpr const char* daemonPath()
+    {
+        return "/nonexistent/PolicyLoopTest";
+    }
+};
+
+// Exits if the parent executable doesn't match an invalid digest:
+struct InvalidDigestSecurity : public Policy::NoSecurity
+{
+    static constexpr const char* parentDigest() { return "not a digest"; }
+};
+
+// Exits if another process holds the test lock file:
+struct LockSecurity : public Policy::NoSecurity
+{
+    static constexpr const char* lockFilePath() { return testLockPath; }
+};
+
+/**
+ * @brief  A loop with no pipes that counts its loopAction() calls.
+ */
+template <class SecurityPolicy, class TimeoutPolicy = Policy::NoTimeout>
+class CountingLoop :
+        public PolicyLoop<Policy::NoPipes, SecurityPolicy, TimeoutPolicy>
+{
+public:
+    /**
+     * @brief  Sets how the loop ends.
+     *
+     * @param actionLimit  The number of loopAction() calls to make before
+     *                     returning resultCode, or zero to wait for events
+     *                     until the loop times out.
+     *
+     * @param resultCode   The code loopAction() returns to end the loop.
+     *
+     * @param initResult   The code initLoop() returns.
+     */
+    CountingLoop(const int actionLimit, const int resultCode,
+            const int initResult = 0) : actionLimit(actionLimit),
+    resultCode(resultCode), initResult(initResult) { }
+
+    // Number of loopAction() calls made:
+    int actionCount = 0;
+
+private:
+    virtual int initLoop() override
+    {
+        return initResult;
+    }
+
+    virtual int loopAction() override
+    {
+        actionCount++;
+        if (actionLimit == 0)
+        {
+            this->waitForEvents(100);
+            return 0;
+        }
+        return (actionCount >= actionLimit) ? resultCode : 0;
+    }
+
+    const int actionLimit;
+    const int resultCode;
+    const int initResult;
+};
+
+TEST_CASE("Policy loops run until loopAction returns nonzero.",
+        "[PolicyLoop]")
+{
+    INFO("Testing: PolicyLoop::runLoop");
+    SECTION("The loop returns the loopAction result.")
+    {
+        CountingLoop<Policy::NoSecurity> loop(5, 42);
+        REQUIRE(loop.runLoop() == 42);
+        REQUIRE(loop.actionCount == 5);
+    }
+    SECTION("A failed initLoop cancels the loop.")
+    {
+        CountingLoop<Policy::NoSecurity> loop(5, 42, 7);
+        REQUIRE(loop.runLoop() == 7);
+        REQUIRE(loop.actionCount == 0);
+    }
+}
+
+TEST_CASE("Timeout policies end policy loops.", "[PolicyLoop]")
+{
+    INFO("Testing: Policy::Timeout");
+    using namespace std::chrono;
+    CountingLoop<Policy::NoSecurity, Policy::Timeout<1>> loop(0, 0);
+    const steady_clock::time_point startTime = steady_clock::now();
+    REQUIRE(loop.runLoop() == static_cast<int>(ExitCode::success));
+    const milliseconds runtime
+            = duration_cast<milliseconds>(steady_clock::now() - startTime);
+    REQUIRE(runtime.count() >= 1000);
+    REQUIRE(runtime.count() < 2000);
+    // Waiting for events shouldn't poll the loop repeatedly:
+    REQUIRE(loop.actionCount <= 11);
+}
+
+TEST_CASE("Security policies choose which checks policy loops run.",
+        "[PolicyLoop]")
+{
+    INFO("Testing: PolicyLoop security checks");
+    SECTION("Checks are skipped when disabled.")
+    {
+        CountingLoop<Policy::NoSecurity> loop(1, 3);
+        REQUIRE(loop.runLoop() == 3);
+    }
+    SECTION("Enabled daemon path checks run.")
+    {
+        CountingLoop<MissingDaemonSecurity> loop(1, 3);
+        REQUIRE(loop.runLoop() == static_cast<int>(ExitCode::badDaemonPath));
+        REQUIRE(loop.actionCount == 0);
+    }
+    SECTION("Enabled parent digest checks run.")
+    {
+        CountingLoop<InvalidDigestSecurity> loop(1, 3);
+        REQUIRE(loop.runLoop()
+                == static_cast<int>(ExitCode::badParentDigest));
+        REQUIRE(loop.actionCount == 0);
+    }
+    SECTION("Lock files prevent running more than one instance.")
+    {
+        const int lockFD = open(testLockPath, O_CREAT | O_RDWR, 0600);
+        REQUIRE(lockFD != -1);
+        REQUIRE(flock(lockFD, LOCK_EX | LOCK_NB) == 0);
+        {
+            CountingLoop<LockSecurity> loop(1, 3);
+            REQUIRE(loop.runLoop()
+                    == static_cast<int>(ExitCode::daemonAlreadyRunning));
+        }
+        flock(lockFD, LOCK_UN);
+        {
+            CountingLoop<LockSecurity> loop(1, 3);
+            REQUIRE(loop.runLoop() == 3);
+        }
+        close(lockFD);
+        unlink(testLockPath);
+    }
+}
+
+TEST_CASE("Process security uses expected paths set on construction.",
+        "[PolicyLoop]")
+{
+    INFO("Testing: Process::Security::validParentPath");
+    char parentPath[4096] = {};
+    const std::string parentLink = "/proc/" + std::to_string(getppid())
+            + "/exe";
+    REQUIRE(readlink(parentLink.c_str(), parentPath, sizeof(parentPath) - 1)
+            > 0);
+    Process::Security expectedParent(nullptr, parentPath, nullptr,
+            nullptr);
+    REQUIRE(expectedParent.validParentPath());
+    REQUIRE(! expectedParent.validDaemonPath());
+    REQUIRE(! expectedParent.validParentDigest());
+    Process::Security otherParent(nullptr, "/nonexistent/parent", nullptr,
+            nullptr);
+    REQUIRE(! otherParent.validParentPath());
+}
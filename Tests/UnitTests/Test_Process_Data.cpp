@@ -0,0 +1,58 @@
+#include "catch.hpp"
+#include "Process_Data.h"
+#include <algorithm>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using DaemonFramework::Process::Data;
+
+TEST_CASE("All process IDs are listed." "[Process_Data]")
+{
+    INFO("Testing: Process::getAllPIDs");
+    const std::vector<int> processIDs = DaemonFramework::Process::getAllPIDs();
+    REQUIRE(std::find(processIDs.begin(), processIDs.end(), getpid())
+            != processIDs.end());
+    REQUIRE(std::find(processIDs.begin(), processIDs.end(), getppid())
+            != processIDs.end());
+}
+
+TEST_CASE("Child processes are found, newest first." "[Process_Data]")
+{
+    INFO("Testing: Process::Data::getChildProcesses");
+    std::vector<pid_t> children;
+    for (int i = 0; i < 3; i++)
+    {
+        const pid_t childID = fork();
+        if (childID == 0)
+        {
+            pause();
+            _exit(0);
+        }
+        REQUIRE(childID > 0);
+        children.push_back(childID);
+    }
+    Data processData(getpid());
+    const std::vector<Data> childData = processData.getChildProcesses();
+    for (const pid_t childID : children)
+    {
+        kill(childID, SIGKILL);
+        waitpid(childID, nullptr, 0);
+    }
+    std::vector<pid_t> foundIDs;
+    for (const Data& child : childData)
+    {
+        REQUIRE(child.getParentId() == getpid());
+        foundIDs.push_back(child.getProcessId());
+    }
+    for (const pid_t childID : children)
+    {
+        REQUIRE(std::find(foundIDs.begin(), foundIDs.end(), childID)
+                != foundIDs.end());
+    }
+    for (size_t i = 1; i < childData.size(); i++)
+    {
+        REQUIRE(childData[i - 1].getStartTime()
+                >= childData[i].getStartTime());
+    }
+}
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+#include "RestartPolicy.h"
+
+using DaemonFramework::ExitCode;
+using DaemonFramework::RestartPolicy;
+
+TEST_CASE("Restart rules are selected by exit code." "[RestartPolicy]")
+{
+    INFO("Testing: RestartPolicy::getAction");
+    RestartPolicy policy;
+    REQUIRE(policy.getAction(static_cast<int>(ExitCode::badDaemonPath), false)
+            == RestartPolicy::Action::stop);
+    REQUIRE(policy.getAction(static_cast<int>(ExitCode::success), false)
+            == RestartPolicy::Action::stop);
+    REQUIRE(policy.getAction(static_cast<int>(ExitCode::daemonParentEnded),
+                false) == RestartPolicy::Action::restart);
+    REQUIRE(policy.getAction(100, false) == RestartPolicy::Action::restart);
+    REQUIRE(policy.getAction(0, true) == RestartPolicy::Action::restart);
+
+    policy.setExitAction(100, RestartPolicy::Action::stop);
+    policy.setCrashAction(RestartPolicy::Action::stop);
+    policy.setDefaultAction(RestartPolicy::Action::stop);
+    policy.setExitAction(ExitCode::success, RestartPolicy::Action::restart);
+    REQUIRE(policy.getAction(100, false) == RestartPolicy::Action::stop);
+    REQUIRE(policy.getAction(101, false) == RestartPolicy::Action::stop);
+    REQUIRE(policy.getAction(0, true) == RestartPolicy::Action::stop);
+    REQUIRE(policy.getAction(0, false) == RestartPolicy::Action::restart);
+}
+
+TEST_CASE("Restart delays back off exponentially with jitter."
+        "[RestartPolicy]")
+{
+    INFO("Testing: RestartPolicy::getRestartDelay");
+    RestartPolicy policy;
+    policy.setBackoff(100, 1000, 2.0);
+    policy.setJitter(0.0);
+    REQUIRE(policy.getRestartDelay(0, 0.9) == 100);
+    REQUIRE(policy.getRestartDelay(1, 0.9) == 200);
+    REQUIRE(policy.getRestartDelay(3, 0.9) == 800);
+    REQUIRE(policy.getRestartDelay(4, 0.9) == 1000);
+    REQUIRE(policy.getRestartDelay(1000, 0.9) == 1000);
+
+    policy.setJitter(0.5);
+    REQUIRE(policy.getRestartDelay(1, 0.0) == 100);
+    REQUIRE(policy.getRestartDelay(1, 0.5) == 200);
+    REQUIRE(policy.getRestartDelay(1, 1.0) == 300);
+    // Jitter never exceeds the maximum delay:
+    REQUIRE(policy.getRestartDelay(10, 1.0) == 1000);
+}
@@ -0,0 +1,127 @@
+#include "catch.hpp"
+#include "ThreadedInit.h"
+#include "InitExecutor.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Runs a test initialization action, optionally waiting until cancelled:
+class TestInit : public DaemonFramework::ThreadedInit
+{
+public:
+    TestInit(const bool waitForCancel) : waitUntilCancelled(waitForCancel) { }
+
+    virtual ~TestInit()
+    {
+        cancelInit();
+    }
+
+    void start()
+    {
+        startInitThread();
+    }
+
+    void cancel()
+    {
+        cancelInit();
+    }
+
+    void reset()
+    {
+        resetInit();
+    }
+
+private:
+    virtual bool threadedInitAction() override
+    {
+        if (waitUntilCancelled)
+        {
+            while (! waitForCancel(1000)) { }
+            return false;
+        }
+        return true;
+    }
+
+    const bool waitUntilCancelled;
+};
+
+TEST_CASE("Init actions reuse pooled threads." "[ThreadedInit]")
+{
+    INFO("Testing: ThreadedInit::startInitThread");
+    DaemonFramework::InitExecutor& executor
+            = DaemonFramework::InitExecutor::getInstance();
+    TestInit init(false);
+    init.start();
+    REQUIRE(init.waitForInit());
+    REQUIRE(init.successfulInit());
+    REQUIRE(init.getInitResult().get());
+    const unsigned int threadCount = executor.getThreadCount();
+    REQUIRE(threadCount > 0);
+    for (int i = 0; i < 20; i++)
+    {
+        init.reset();
+        REQUIRE(! init.startedInit());
+        init.start();
+        REQUIRE(init.waitForInit());
+        REQUIRE(init.successfulInit());
+    }
+    REQUIRE(executor.getThreadCount() == threadCount);
+}
+
+TEST_CASE("Init actions are cancelled cooperatively." "[ThreadedInit]")
+{
+    INFO("Testing: ThreadedInit::cancelInit, ThreadedInit::waitForInitUntil");
+    using namespace std::chrono;
+    TestInit init(true);
+    init.start();
+    std::shared_future<bool> initResult = init.getInitResult();
+    REQUIRE(initResult.valid());
+
+    const steady_clock::time_point waitStart = steady_clock::now();
+    REQUIRE(! init.waitForInitUntil(waitStart + milliseconds(50)));
+    REQUIRE(steady_clock::now() - waitStart >= milliseconds(50));
+    REQUIRE(! init.finishedInit());
+
+    const steady_clock::time_point cancelStart = steady_clock::now();
+    init.cancel();
+    REQUIRE(steady_clock::now() - cancelStart < milliseconds(500));
+    REQUIRE(init.finishedInit());
+    REQUIRE(! init.successfulInit());
+    REQUIRE(initResult.wait_for(seconds(0)) == std::future_status::ready);
+    REQUIRE(! initResult.get());
+}
+
+TEST_CASE("Init tasks are queued when the pool is full." "[ThreadedInit]")
+{
+    INFO("Testing: InitExecutor::run");
+    using namespace DaemonFramework;
+    InitExecutor& executor = InitExecutor::getInstance();
+    const unsigned int taskCount = InitExecutor::maxThreads + 4;
+    std::mutex testMutex;
+    std::condition_variable testCondition;
+    unsigned int tasksStarted = 0;
+    unsigned int tasksFinished = 0;
+    bool releaseTasks = false;
+    for (unsigned int i = 0; i < taskCount; i++)
+    {
+        REQUIRE(executor.run([&]()
+        {
+            std::unique_lock<std::mutex> lock(testMutex);
+            tasksStarted++;
+            testCondition.notify_all();
+            testCondition.wait(lock, [&]() { return releaseTasks; });
+            tasksFinished++;
+            testCondition.notify_all();
+        }));
+    }
+    std::unique_lock<std::mutex> lock(testMutex);
+    testCondition.wait_for(lock, std::chrono::seconds(1), [&]()
+            { return tasksStarted == InitExecutor::maxThreads; });
+    REQUIRE(tasksStarted == InitExecutor::maxThreads);
+    REQUIRE(executor.getThreadCount() == InitExecutor::maxThreads);
+    releaseTasks = true;
+    testCondition.notify_all();
+    REQUIRE(testCondition.wait_for(lock, std::chrono::seconds(1), [&]()
+            { return tasksFinished == taskCount; }));
+    REQUIRE(executor.getThreadCount() == InitExecutor::maxThreads);
+}
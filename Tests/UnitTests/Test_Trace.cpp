@@ -0,0 +1,128 @@
+#include "catch.hpp"
+#include "Trace.h"
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if ! defined DF_TRACE_ENABLED || ! DF_TRACE_ENABLED
+#error "Test_Trace requires DF_TRACE_ENABLED"
+#endif
+
+/**
+ * @brief  Dumps all trace records, and returns each dumped event line that
+ *         contains a specific event name.
+ */
+static std::vector<std::string> dumpEvents(const std::string& name)
+{
+    char tracePath[] = "/tmp/Test_TraceXXXXXX";
+    const int traceFile = mkstemp(tracePath);
+    REQUIRE(traceFile != -1);
+    close(traceFile);
+    REQUIRE(DF_TRACE_DUMP(tracePath));
+    std::ifstream traceStream(tracePath);
+    std::vector<std::string> events;
+    std::string line;
+    const std::string nameField = "{\"name\":\"" + name + "\",";
+    while (std::getline(traceStream, line))
+    {
+        if (line.find(nameField) != std::string::npos)
+        {
+            events.push_back(line);
+        }
+    }
+    unlink(tracePath);
+    return events;
+}
+
+/**
+ * @brief  Gets the value of a numeric field within a dumped event line.
+ */
+static long long getField(const std::string& event, const std::string& field)
+{
+    const std::string fieldStart = "\"" + field + "\":";
+    const size_t fieldIndex = event.find(fieldStart);
+    REQUIRE(fieldIndex != std::string::npos);
+    return std::stoll(event.substr(fieldIndex + fieldStart.size()));
+}
+
+TEST_CASE("Trace events from each thread are dumped." "[Trace]")
+{
+    INFO("Testing: Trace::addRecord, Trace::dump");
+    {
+        DF_TRACE("Test_Trace scope");
+        DF_TRACE_EVENT("Test_Trace event", 1);
+    }
+    std::thread eventThread([]()
+    {
+        DF_TRACE_EVENT("Test_Trace event", 2);
+    });
+    eventThread.join();
+
+    const std::vector<std::string> scopes = dumpEvents("Test_Trace scope");
+    REQUIRE(scopes.size() == 1);
+    REQUIRE(scopes[0].find("\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(getField(scopes[0], "pid") == getpid());
+
+    const std::vector<std::string> events = dumpEvents("Test_Trace event");
+    REQUIRE(events.size() == 2);
+    std::set<long long> threadIDs;
+    std::set<long long> values;
+    for (const std::string& event : events)
+    {
+        REQUIRE(event.find("\"ph\":\"i\"") != std::string::npos);
+        threadIDs.insert(getField(event, "tid"));
+        values.insert(getField(event, "value"));
+    }
+    REQUIRE(threadIDs.size() == 2);
+    REQUIRE(values == std::set<long long>({ 1, 2 }));
+}
+
+TEST_CASE("Trace buffers keep only the newest records." "[Trace]")
+{
+    INFO("Testing: Trace::addRecord, Trace::dump");
+    using DaemonFramework::Trace::bufferRecords;
+    const size_t extraRecords = 10;
+    std::thread counterThread([extraRecords]()
+    {
+        for (size_t i = 0; i < bufferRecords + extraRecords; i++)
+        {
+            DF_TRACE_COUNTER("Test_Trace counter", i);
+        }
+    });
+    counterThread.join();
+    const std::vector<std::string> counters
+            = dumpEvents("Test_Trace counter");
+    // The oldest buffered record is left out, as it might have been in the
+    // process of being replaced:
+    REQUIRE(counters.size() == bufferRecords - 1);
+    for (size_t i = 0; i < counters.size(); i++)
+    {
+        REQUIRE(counters[i].find("\"ph\":\"C\"") != std::string::npos);
+        REQUIRE(getField(counters[i], "value")
+                == (long long) (i + extraRecords + 1));
+    }
+}
+
+TEST_CASE("Trace dumps don't follow links." "[Trace]")
+{
+    INFO("Testing: Trace::dump");
+    DF_TRACE_COUNTER("Test_Trace link counter", 1);
+    char tracePath[] = "/tmp/Test_TraceXXXXXX";
+    const int traceFile = mkstemp(tracePath);
+    REQUIRE(traceFile != -1);
+    close(traceFile);
+    const std::string tempPath = std::string(tracePath) + "."
+            + std::to_string(getpid()) + ".tmp";
+    REQUIRE(symlink(tracePath, tempPath.c_str()) == 0);
+    REQUIRE(! DF_TRACE_DUMP(tracePath));
+    struct stat traceStats;
+    REQUIRE(stat(tracePath, &traceStats) == 0);
+    REQUIRE(traceStats.st_size == 0);
+    unlink(tempPath.c_str());
+    unlink(tracePath);
+}
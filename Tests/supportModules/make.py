@@ -14,6 +14,7 @@ class VarNames:
     def __init__(self):
         self._daemonPath       = 'DF_DAEMON_PATH'
         self._parentPath       = 'DF_REQUIRED_PARENT_PATH'
+        self._parentDigest     = 'DF_REQUIRED_PARENT_DIGEST'
         self._inPipePath       = 'DF_INPUT_PIPE_PATH'
         self._outPipePath      = 'DF_OUTPUT_PIPE_PATH'
         self._lockPath         = 'DF_LOCK_FILE_PATH'
@@ -36,6 +37,14 @@ class VarNames:
     @property
     def parentPath(self):
         return self._parentPath
+    """
+    Return the daemon parent executable digest variable name.
+    If defined, the daemon will only run if launched by an executable with this
+    SHA-256 digest.
+    """
+    @property
+    def parentDigest(self):
+        return self._parentDigest
     """Return the daemon input pipe file path variable name."""
     @property
     def inPipePath(self):
@@ -89,6 +98,8 @@ daemonPath      -- The path where the daemon will be installed.
                    (default: paths.daemonSecureExePath)
 parentPath      -- The required path to the daemon's parent application.
                    (default: paths.parentSecureExePath)
+parentDigest    -- The required SHA-256 digest of the daemon's parent
+                   application, as a hexadecimal string. (default: None)
 inPipePath      -- The daemon's input pipe path.
                    (default: paths.inPipePath)
 outPipePath     -- The daemon's output pipe path.
@@ -117,6 +128,7 @@ timeout         -- Seconds before the daemon exits, or False to disable timeout.
 """
 def getBuildArgs(daemonPath = paths.daemonSecureExePath, \
                          parentPath = paths.parentSecureExePath, \
+                         parentDigest = None, \
                          inPipePath = paths.inPipePath, \
                          outPipePath = paths.outPipePath, \
                          lockPath = paths.lockPath, \
@@ -137,6 +149,7 @@ def getBuildArgs(daemonPath = paths.daemonSecureExePath, \
                                             else 'Release')]
     stringArgs = [(daemonPath, varNames.daemonPath), \
                   (parentPath, varNames.parentPath), \
+                  (parentDigest, varNames.parentDigest), \
                   (inPipePath, varNames.inPipePath), \
                   (outPipePath, varNames.outPipePath), \
                   (lockPath, varNames.lockPath)]
@@ -290,6 +303,30 @@ outFile     -- A file where test output from stdout and stderr will be sent.
 def cleanUnitTests(outFile = subprocess.DEVNULL):
     cleanTarget(paths.unitTestDir, outFile)
 
+"""
+Attempts to build benchmark programs in Release mode, returning whether all
+requested benchmarks were built.
+
+Keyword Arguments:
+benchmarks  -- The names of the benchmark executables that must be built.
+
+makeArgs    -- Extra command line arguments to pass to the `make` process.
+               (default: [])
+
+outFile     -- A file where test output from stdout and stderr will be sent.
+               The default subprocess.DEVNULL value discards all output.
+"""
+def buildBenchmarks(benchmarks, makeArgs = [], outFile = subprocess.DEVNULL):
+    os.chdir(paths.benchmarkDir)
+    for benchmark in benchmarks:
+        if os.path.isfile(paths.benchmarkBuildPath(benchmark)):
+            os.remove(paths.benchmarkBuildPath(benchmark))
+    subprocess.call(['make', 'CONFIG=Release', varNames.configMode \
+                     + '=Release'] + makeArgs, stdout = outFile, \
+                    stderr = outFile)
+    return all(os.path.isfile(paths.benchmarkBuildPath(benchmark)) \
+               for benchmark in benchmarks)
+
 """
 Attempts to build the BasicDaemon, returning whether the build succeeded.
 
@@ -9,6 +9,7 @@ class TestPaths:
         self._unitTest    = 'DaemonTest'
         self._tempLog     = 'tempLog.txt'
         self._failureLog  = 'failureLog.txt'
+        self._baselines   = 'performanceBaselines.json'
         self._inPipeFile  = '.inPipe'
         self._outPipeFile = '.outPipe'
         self._lockFile    = '.lock'
@@ -24,6 +25,7 @@ class TestPaths:
         self._buildDir       = os.path.join(self._testDir, 'build')
         self._basicDaemonDir = os.path.join(self._testDir, 'BasicDaemon')
         self._basicParentDir = os.path.join(self._testDir, 'BasicParent')
+        self._benchmarkDir   = os.path.join(self._testDir, 'Benchmarks')
 
     # Directory paths:
     """Return the path to the main project directory. """
@@ -62,6 +64,10 @@ class TestPaths:
     @property
     def basicParentDir(self):
         return self._basicParentDir
+    """Return the path to the benchmark source directory."""
+    @property
+    def benchmarkDir(self):
+        return self._benchmarkDir
 
     # File names:
     """Return the name of the test daemon application file."""
@@ -84,6 +90,10 @@ class TestPaths:
     @property
     def failureLog(self):
         return self._failureLog
+    """Return the name of the performance baseline file."""
+    @property
+    def baselines(self):
+        return self._baselines
     """Return the name of the daemon's input pipe file."""
     @property
     def inPipeFile(self):
@@ -131,6 +141,19 @@ class TestPaths:
     @property
     def parentSecureExePath(self):
         return os.path.join(self.secureExeDir, self.parent)
+
+    # Benchmark paths:
+    """
+    Return the path where a benchmark is found after compilation.
+    Keyword Arguments:
+    benchmark -- The name of the benchmark executable.
+    """
+    def benchmarkBuildPath(self, benchmark):
+        return os.path.join(self.buildDir, benchmark)
+    """Return the path to the stored performance baseline file."""
+    @property
+    def baselinePath(self):
+        return os.path.join(self.benchmarkDir, self.baselines)
     """Return the path where the daemon's input pipe file will be created."""
     @property
     def inPipePath(self):
@@ -0,0 +1,123 @@
+"""
+Reads CPU time and context switch counts of running processes from /proc.
+"""
+import os
+
+"""Resource use counted for a single thread."""
+class ThreadStats:
+    def __init__(self, name, cpuSeconds, voluntarySwitches, \
+                 involuntarySwitches):
+        self._name                = name
+        self._cpuSeconds          = cpuSeconds
+        self._voluntarySwitches   = voluntarySwitches
+        self._involuntarySwitches = involuntarySwitches
+    """Return the thread's name."""
+    @property
+    def name(self):
+        return self._name
+    """Return the CPU time used by the thread, in seconds."""
+    @property
+    def cpuSeconds(self):
+        return self._cpuSeconds
+    """Return the number of times the thread blocked, usually to wait."""
+    @property
+    def voluntarySwitches(self):
+        return self._voluntarySwitches
+    """Return the number of times the thread was preempted."""
+    @property
+    def involuntarySwitches(self):
+        return self._involuntarySwitches
+    """Return the total number of times the thread stopped running."""
+    @property
+    def wakeups(self):
+        return self._voluntarySwitches + self._involuntarySwitches
+    """
+    Return the resources used since an earlier reading.
+    Keyword Arguments:
+    earlier -- An earlier ThreadStats reading of the same thread, or None if
+               the thread started after the earlier reading.
+    """
+    def since(self, earlier):
+        if earlier is None:
+            return self
+        return ThreadStats(self.name, self.cpuSeconds - earlier.cpuSeconds, \
+                           self.voluntarySwitches - earlier.voluntarySwitches, \
+                           self.involuntarySwitches \
+                           - earlier.involuntarySwitches)
+
+"""
+Finds the ID of a running process launched from a specific executable.
+Keyword Arguments:
+execPath -- The full path to the process executable.
+Returns the process ID, or None if no matching process is running.
+"""
+def findProcess(execPath):
+    for processDir in os.listdir('/proc'):
+        if not processDir.isdigit():
+            continue
+        try:
+            if os.readlink(os.path.join('/proc', processDir, 'exe')) \
+                    == execPath:
+                return int(processDir)
+        except OSError:
+            continue
+    return None
+
+"""
+Reads the CPU time used by a process or thread.
+Keyword Arguments:
+statDir -- The /proc directory of the process or thread.
+Returns the CPU time in seconds.
+"""
+def readCPUSeconds(statDir):
+    # schedstat counts nanoseconds when available, stat only counts clock
+    # ticks:
+    try:
+        with open(os.path.join(statDir, 'schedstat'), 'r') as schedFile:
+            return int(schedFile.read().split()[0]) / 1e9
+    except (OSError, IndexError, ValueError):
+        pass
+    with open(os.path.join(statDir, 'stat'), 'r') as statFile:
+        stat = statFile.read()
+    # Skip the process name, which may contain spaces. The remaining fields
+    # start with the third field, and utime and stime are fields 14 and 15:
+    fields = stat[stat.rindex(')') + 2:].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+"""
+Reads resource use for each thread in a process.
+Keyword Arguments:
+processID -- The ID of a running process.
+Returns a dictionary of ThreadStats, keyed by thread ID. Threads that exit
+while reading are left out.
+"""
+def readThreadStats(processID):
+    taskDir = os.path.join('/proc', str(processID), 'task')
+    threads = {}
+    for threadID in os.listdir(taskDir):
+        threadDir = os.path.join(taskDir, threadID)
+        try:
+            values = {}
+            with open(os.path.join(threadDir, 'status'), 'r') as statusFile:
+                for line in statusFile:
+                    name, _, value = line.partition(':')
+                    values[name] = value.strip()
+            threads[int(threadID)] = ThreadStats(values['Name'], \
+                    readCPUSeconds(threadDir), \
+                    int(values['voluntary_ctxt_switches']), \
+                    int(values['nonvoluntary_ctxt_switches']))
+        except (OSError, KeyError, ValueError):
+            continue
+    return threads
+
+"""
+Gets the resources each thread used between two readings.
+Keyword Arguments:
+earlier -- A readThreadStats() result.
+later   -- A later readThreadStats() result from the same process.
+Returns a dictionary of ThreadStats, keyed by thread ID, for all threads still
+running at the later reading.
+"""
+def threadUsage(earlier, later):
+    return { threadID : stats.since(earlier.get(threadID)) \
+             for threadID, stats in later.items() }
@@ -6,13 +6,14 @@ import os
 """Holds the values of a test's command line arguments."""
 class Values():
     def __init__(self, verbose, debugBuild, printHelp, timeout, untilFailure, \
-                 logBuildArgs):
+                 logBuildArgs, updateBaselines):
         self._verbose      = verbose
         self._debugBuild   = debugBuild
         self._printHelp    = printHelp
         self._timeout      = timeout
         self._untilFailure = untilFailure
         self._logBuildArgs = logBuildArgs
+        self._updateBaselines = updateBaselines
     """Return whether the test should print verbose output messages."""
     @property
     def useVerbose(self):
@@ -37,6 +38,10 @@ class Values():
     @property
     def logBuildArgs(self):
         return self._logBuildArgs
+    """Return whether performance tests should save results as baselines."""
+    @property
+    def updateBaselines(self):
+        return self._updateBaselines
 
 """Read command line arguments and returns them as a TestArgs object."""
 def read():
@@ -46,6 +51,7 @@ def read():
     timeout      = None
     untilFailure = False
     logBuildArgs = None
+    updateBaselines = False
     import sys
     for arg in sys.argv[1:]:
         if arg == '-v' or arg == '--verbose':
@@ -60,6 +66,8 @@ def read():
             untilFailure = True
         elif arg == '-l' or arg == '--log-build-args':
             logBuildArgs = True
+        elif arg == '-b' or arg == '--update-baselines':
+            updateBaselines = True
         elif arg[:3] == '-t=':
             timeout = int(arg[3:])
         elif arg[:11] == '--timeout=':
@@ -69,7 +77,7 @@ def read():
     if logBuildArgs is None:
         logBuildArgs = False
     return Values(verbose, debug, printHelp, timeout, untilFailure, \
-                  logBuildArgs)
+                  logBuildArgs, updateBaselines)
 
 """
 Prints help text describing the purpose of a test and all available command
@@ -95,6 +103,8 @@ def printHelp(testName, testDescription):
           + 'Stop after the first failed test.')
     print('\t-l, --log-build-args: ' \
           + 'Include makefile build arguments in failure logs.')
+    print('\t-b, --update-baselines: ' \
+          + 'Save performance test results as new baselines.')
     print('\t-h, --help:  Print this help text and exit.')
     import sys
     sys.exit('')
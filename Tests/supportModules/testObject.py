@@ -64,8 +64,34 @@ class Test:
                             shell = True)
             subprocess.call('sudo chmod "o-w" ' + paths.secureExeDir, \
                             shell = True)
+        self._checkSecureAncestors()
         os.chdir(paths.projectDir)
     """
+    Checks that every directory above the secured test directory may only be
+    modified by root, as daemons check the entire path. Prints a warning listing
+    each insecure directory if any are found.
+    """
+    def _checkSecureAncestors(self):
+        insecureDirs = []
+        dirPath = os.path.dirname(os.path.realpath(paths.secureExeDir))
+        while True:
+            dirStats = os.stat(dirPath)
+            if dirStats.st_uid != 0 or dirStats.st_gid != 0 \
+                    or (dirStats.st_mode & 0o002) != 0:
+                insecureDirs.append(dirPath)
+            parentPath = os.path.dirname(dirPath)
+            if parentPath == dirPath:
+                break
+            dirPath = parentPath
+        if insecureDirs:
+            self._eraseTempLine()
+            print(Fore.YELLOW + '  Warning: Secured daemon tests will fail, '
+                  + 'because these parent directories of\n  '
+                  + paths.secureExeDir + '\n  are not exclusively owned and '
+                  + 'writable by root:' + Style.RESET_ALL)
+            for dirPath in insecureDirs:
+                print('    ' + dirPath)
+    """
     Returns either a log file opened for appending, or /dev/null if not logging.
     Keyword Arguments:
     logOutput  -- Whether logs should be saved.
@@ -82,6 +108,13 @@ class Test:
         print('  Test ' + str(self._testIndex + 1) + ': ' + line)
         self._tempLinePrinted = True
     """
+    Prints a temporary status line describing the current test action.
+    Keyword Arguments:
+    line -- The line of text to print.
+    """
+    def printStatus(self, line):
+        self._printTempLine(line)
+    """
     Erases temporary output from the console.
     """
     def _eraseTempLine(self):
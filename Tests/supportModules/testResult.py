@@ -14,6 +14,13 @@ class InitCode(Enum):
     parentRunFailure = 56,
     parentRunSuccess = 57,
     daemonRunSuccess = 58
+    benchmarkBuildFailure = 59
+    benchmarkRunFailure = 60
+    performanceRegression = 61
+    performanceAcceptable = 62
+    idleMeasureFailure = 63
+    idleBudgetExceeded = 64
+    idleWithinBudget = 65
 
 """
 Represents an exit code returned by a daemon.
@@ -30,6 +37,7 @@ class ExitCode(Enum):
     daemonParentEnded = 6
     fdCleanupFailed = 7
     daemonExecFailed = 8
+    badParentDigest = 9
 
 """
 Return a string describing an ExitCode or InitCode.
@@ -56,6 +64,8 @@ def resultCodeDescription(resultCode):
                     'Failed to clear open file table before launching daemon.',
             ExitCode.daemonExecFailed: \
                     'Failed to run BasicDaemon executable.',
+            ExitCode.badParentDigest: \
+                    'BasicParent did not match the required digest.',
             InitCode.daemonBuildFailure: \
                     'Failed to build BasicDaemon program.',
             InitCode.daemonInstallFailure: \
@@ -73,7 +83,21 @@ def resultCodeDescription(resultCode):
             InitCode.parentRunSuccess: \
                     'Successfully started BasicParent.',
             InitCode.daemonRunSuccess: \
-                    'Successfully started BasicDaemon.'
+                    'Successfully started BasicDaemon.',
+            InitCode.benchmarkBuildFailure: \
+                    'Failed to build benchmark programs.',
+            InitCode.benchmarkRunFailure: \
+                    'Benchmark failed to run or produced no results.',
+            InitCode.performanceRegression: \
+                    'Measured performance exceeded its baseline tolerance.',
+            InitCode.performanceAcceptable: \
+                    'Measured performance was within its baseline tolerance.',
+            InitCode.idleMeasureFailure: \
+                    'Failed to measure idle BasicParent/BasicDaemon use.',
+            InitCode.idleBudgetExceeded: \
+                    'Idle resource use exceeded its budget.',
+            InitCode.idleWithinBudget: \
+                    'Idle resource use was within its budget.'
     }
     if resultCode in titleDict:
         return titleDict[resultCode]
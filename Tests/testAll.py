@@ -2,7 +2,8 @@
 """Runs all DaemonFramework tests."""
 
 from testModules import basicBuild, daemonPathChecking, parentPathChecking, \
-                        singleRunningDaemon
+                        parentDigestChecking, singleRunningDaemon, \
+                        idleUsage, performance
 from supportModules import testArgs, make, pathConstants
 import sys, subprocess
 
@@ -22,7 +23,8 @@ else:
 
 print("Running python tests:")
 testModules = [basicBuild, daemonPathChecking, parentPathChecking, \
-               singleRunningDaemon]
+               parentDigestChecking, singleRunningDaemon, idleUsage, \
+               performance]
 testObjects = []
 testCount = 0
 testsPassed = 0
@@ -0,0 +1,189 @@
+"""
+Tests that an idle BasicParent and BasicDaemon stay within CPU time and wakeup
+budgets.
+
+The test launches the parent and daemon, leaves them idle, and reads the CPU
+time and the voluntary and involuntary context switches of every thread in
+both processes from /proc. Each context switch is counted as a wakeup, as an
+idle thread only switches out again after something wakes it.
+
+The idle period defaults to idleSeconds, and may be changed with the
+--timeout option.
+"""
+
+import sys, os, subprocess, time
+moduleDir = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(moduleDir, os.pardir))
+from supportModules import make, pathConstants, testObject, testArgs, \
+                           testResult, processStats
+from supportModules.testResult import InitCode, Result
+from supportModules.pathConstants import paths
+from supportModules.testObject import Test
+
+# Default number of seconds to measure the idle processes:
+idleSeconds = 5
+
+# Seconds to wait after the daemon starts before measuring:
+settleSeconds = 1
+
+# Maximum share of one CPU each idle process may use, as a percentage:
+maxCPUPercent = 0.1
+
+# Maximum wakeups per second, summed over all threads of each idle process:
+maxWakeupsPerSecond = 10
+
+"""
+Resource use measured for one idle process.
+"""
+class IdleUsage:
+    def __init__(self, threads, seconds):
+        self._threads = threads
+        self._seconds = seconds
+    """Return the share of one CPU used by the process, as a percentage."""
+    @property
+    def cpuPercent(self):
+        return 100 * sum(thread.cpuSeconds for thread \
+                         in self._threads.values()) / self._seconds
+    """Return the average number of wakeups per second."""
+    @property
+    def wakeupsPerSecond(self):
+        return sum(thread.wakeups for thread in self._threads.values()) \
+               / self._seconds
+    """
+    Writes the resources used by each thread to a log file.
+    Keyword Arguments:
+    title   -- A title to print before the thread list.
+    logFile -- The file where thread resource use will be written.
+    """
+    def log(self, title, logFile):
+        logFile.write(title + ' idle resource use over ' \
+                      + '{:.2f} seconds:\n'.format(self._seconds))
+        for threadID, thread in sorted(self._threads.items()):
+            logFile.write('  thread {} ({}): {:.3f} ms CPU, '.format( \
+                          threadID, thread.name, thread.cpuSeconds * 1000) \
+                          + '{} voluntary and {} involuntary switches\n' \
+                          .format(thread.voluntarySwitches, \
+                                  thread.involuntarySwitches))
+
+"""
+Runs BasicParent until BasicDaemon is idle, and measures both processes.
+Keyword Arguments:
+seconds -- The number of seconds to measure.
+outFile -- A file where test output will be sent.
+Returns IdleUsage objects for the parent and daemon, or None for both if
+measuring failed.
+"""
+def measureIdleUsage(seconds, outFile):
+    runSeconds = settleSeconds + seconds + 1
+    try:
+        parentProcess = subprocess.Popen([paths.parentSecureExePath, \
+                                          '--timeout', str(runSeconds)], \
+                                         stdout = outFile, stderr = outFile)
+    except OSError as e:
+        outFile.write('Failed to run BasicParent: ' + str(e) + '\n')
+        return None, None
+    parentUsage = None
+    daemonUsage = None
+    try:
+        daemonID = None
+        waitEnd = time.monotonic() + settleSeconds
+        while daemonID is None and time.monotonic() < waitEnd:
+            time.sleep(0.01)
+            daemonID = processStats.findProcess(paths.daemonSecureExePath)
+        if daemonID is None:
+            outFile.write('BasicDaemon did not start.\n')
+        else:
+            time.sleep(settleSeconds)
+            parentStart = processStats.readThreadStats(parentProcess.pid)
+            daemonStart = processStats.readThreadStats(daemonID)
+            startTime = time.monotonic()
+            time.sleep(seconds)
+            parentEnd = processStats.readThreadStats(parentProcess.pid)
+            daemonEnd = processStats.readThreadStats(daemonID)
+            elapsed = time.monotonic() - startTime
+            parentUsage = IdleUsage(processStats.threadUsage(parentStart, \
+                                                             parentEnd), \
+                                    elapsed)
+            daemonUsage = IdleUsage(processStats.threadUsage(daemonStart, \
+                                                             daemonEnd), \
+                                    elapsed)
+    except OSError as e:
+        outFile.write('Failed to read process resource use: ' + str(e) + '\n')
+    try:
+        parentProcess.wait(timeout = runSeconds + 5)
+    except subprocess.TimeoutExpired:
+        parentProcess.kill()
+        parentProcess.wait()
+    return parentUsage, daemonUsage
+
+"""
+Tests that idle parent and daemon processes stay within resource budgets.
+Keyword Arguments:
+testArgs -- A testArgs.Values argument object.
+"""
+def getTests(testArgs):
+    title = 'Idle resource use tests:'
+    testCount = 4
+    def testFunction(tests):
+        seconds = idleSeconds if testArgs.timeout is None \
+                  else testArgs.timeout
+
+        """
+        Checks a measurement against its budget.
+        Keyword Arguments:
+        value       -- The measured value, or an InitCode if measuring failed.
+        budget      -- The largest acceptable value.
+        description -- The description to print with the test results.
+        """
+        def checkBudget(value, budget, description):
+            resultCode = value
+            if not isinstance(value, InitCode):
+                resultCode = InitCode.idleWithinBudget if value < budget \
+                             else InitCode.idleBudgetExceeded
+                description += ' Measured {:.3f}, budget {}.'.format(value, \
+                                                                    budget)
+            tests.checkResult(Result(resultCode, InitCode.idleWithinBudget), \
+                              description)
+
+        # The daemon runs until its parent exits, instead of using a timeout:
+        buildArgs = make.getBuildArgs(debugBuild = testArgs.debugBuild, \
+                                      verbose = testArgs.useVerbose, \
+                                      timeout = 0)
+        initResult = tests.parentBuildInstall(buildArgs)
+        if initResult == InitCode.parentInitSuccess:
+            buildArgs = make.getBuildArgs(debugBuild = testArgs.debugBuild, \
+                                          verbose = testArgs.useVerbose, \
+                                          timeout = 0)
+            initResult = tests.daemonBuildInstall(buildArgs)
+        usage = [initResult, initResult]
+        if initResult == InitCode.daemonInitSuccess:
+            tests.printStatus('Measuring idle resource use for ' \
+                              + str(seconds) + ' seconds:')
+            with open(paths.tempLogPath, 'a') as outFile:
+                usage = measureIdleUsage(seconds, outFile)
+                for processUsage, name in zip(usage, [paths.parent, \
+                                                      paths.daemon]):
+                    if processUsage is not None:
+                        processUsage.log(name, outFile)
+            usage = [InitCode.idleMeasureFailure if processUsage is None \
+                     else processUsage for processUsage in usage]
+
+        for processUsage, name in zip(usage, [paths.parent, paths.daemon]):
+            failed = isinstance(processUsage, InitCode)
+            checkBudget(processUsage if failed else processUsage.cpuPercent, \
+                        maxCPUPercent, \
+                        'Checking idle ' + name + ' CPU use (% of one CPU).')
+            checkBudget(processUsage if failed \
+                        else processUsage.wakeupsPerSecond, \
+                        maxWakeupsPerSecond, \
+                        'Checking idle ' + name + ' wakeups per second.')
+    return Test(title, testFunction, testCount, testArgs)
+
+# Run this file's tests alone if executing this module as a script:
+if __name__ == '__main__':
+    args = testArgs.read()
+    if args.printHelp:
+        testArgs.printHelp('idleUsage.py', \
+                           'Check that idle BasicParent and BasicDaemon ' \
+                           + 'processes stay within CPU and wakeup budgets.')
+    getTests(args).runAll()
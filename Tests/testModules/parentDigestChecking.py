@@ -0,0 +1,61 @@
+"""
+Tests that the daemon correctly handles parent executable digest verification.
+"""
+
+import sys, os, hashlib
+moduleDir = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(moduleDir, os.pardir))
+from supportModules import make, pathConstants, testObject, testArgs, \
+                           testResult
+from supportModules.testResult import InitCode, ExitCode, Result
+from supportModules.pathConstants import paths
+from supportModules.testObject import Test
+
+"""
+Return the SHA-256 digest of a file as a hexadecimal string.
+Keyword Arguments:
+filePath -- The path to the file to hash.
+"""
+def fileDigest(filePath):
+    with open(filePath, 'rb') as hashedFile:
+        return hashlib.sha256(hashedFile.read()).hexdigest()
+
+"""
+Tests that the parent digest verification option functions appropriately.
+Keyword Arguments:
+testArgs -- A testArgs.Values argument object.
+"""
+def getTests(testArgs):
+    title = 'Parent digest validation tests:'
+    testCount = 3
+    def testFunction(tests):
+        buildArgs = make.getBuildArgs(testArgs = testArgs)
+        result = tests.parentBuildInstall(buildArgs)
+        builtParentCorrectly = result == InitCode.parentInitSuccess
+        parentDigest = None
+        if builtParentCorrectly:
+            parentDigest = fileDigest(paths.parentSecureExePath)
+        wrongDigest = '0' * 64
+        testDefs = [('Correct parent digest.', parentDigest, \
+                     ExitCode.success), \
+                    ('Incorrect parent digest.', wrongDigest, \
+                     ExitCode.badParentDigest), \
+                    ('Invalid digest format.', 'notAValidDigest', \
+                     ExitCode.badParentDigest)]
+        for description, digest, expectedResult in testDefs:
+            if builtParentCorrectly:
+                daemonArgs = make.getBuildArgs(parentDigest = digest, \
+                                               testArgs = testArgs)
+                result = tests.daemonBuildInstall(daemonArgs)
+                if result == InitCode.daemonInitSuccess:
+                    result = tests.execTest(paths.parentSecureExePath)
+            tests.checkResult(Result(result, expectedResult), description)
+    return Test(title, testFunction, testCount, testArgs)
+
+# Run this file's tests alone if executing this module as a script:
+if __name__ == '__main__':
+    args = testArgs.read()
+    if args.printHelp:
+        testArgs.printHelp('parentDigestChecking.py', \
+                           "Test DaemonFramework's parent digest validation.")
+    getTests(args).runAll()
@@ -0,0 +1,245 @@
+"""
+Tests that DaemonFramework performance hasn't regressed, by running benchmarks
+in Release mode and comparing their results against stored baselines.
+
+Baselines are saved in Tests/Benchmarks/performanceBaselines.json. Each
+measurement has a baseline value, a relative tolerance, and an absolute slack
+value. A measurement fails if it is greater than:
+    baseline * (1 + tolerance) + slack
+
+Benchmark results depend on the host, so baselines should be recorded on the
+machine that runs the tests. Running with --update-baselines saves the
+measured values as the new baselines, keeping existing tolerances.
+"""
+
+import sys, os, subprocess, json, time
+moduleDir = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(moduleDir, os.pardir))
+from supportModules import make, pathConstants, testObject, testArgs, \
+                           testResult, processStats
+from supportModules.testResult import InitCode, Result
+from supportModules.pathConstants import paths
+from supportModules.testObject import Test
+
+# Benchmarks that must be built before running performance tests:
+benchmarkNames = ['StartupBenchmark', 'IPCBenchmark']
+
+# Maximum seconds to wait for a benchmark to finish:
+benchmarkTimeout = 120
+
+# Seconds to wait for BasicDaemon to start before measuring idle CPU use:
+idleStartupSeconds = 1
+
+# Seconds spent measuring BasicDaemon idle CPU use:
+idleMeasureSeconds = 3
+
+"""
+Runs a benchmark with JSON output, returning a list of result records.
+Keyword Arguments:
+name    -- The benchmark executable name.
+argList -- Extra arguments to pass to the benchmark.
+outFile -- A file where benchmark error output will be sent.
+Returns an empty list if the benchmark failed.
+"""
+def runBenchmark(name, argList, outFile):
+    execArgs = [paths.benchmarkBuildPath(name), '--format', 'json'] + argList
+    try:
+        process = subprocess.run(execArgs, stdout = subprocess.PIPE, \
+                                 stderr = outFile, timeout = benchmarkTimeout)
+    except (OSError, subprocess.TimeoutExpired) as e:
+        outFile.write(name + ': ' + str(e) + '\n')
+        return []
+    if process.returncode != 0:
+        outFile.write(name + ': exited with code ' \
+                      + str(process.returncode) + '\n')
+        return []
+    records = []
+    for line in process.stdout.decode('utf-8').splitlines():
+        try:
+            records.append(json.loads(line))
+        except ValueError:
+            outFile.write(name + ': ' + line + '\n')
+    return records
+
+"""
+Finds the first record with a set of matching values.
+Keyword Arguments:
+records -- A list of benchmark result records.
+values  -- A dictionary of values the record must contain.
+Returns the matching record, or None if no record matches.
+"""
+def findRecord(records, values):
+    for record in records:
+        if all(record.get(key) == value for key, value in values.items()):
+            return record
+    return None
+
+"""
+Reads the total CPU time used by all threads of a process.
+Keyword Arguments:
+processID -- The ID of a running process.
+Returns the process CPU time in seconds.
+"""
+def readCPUSeconds(processID):
+    return sum(thread.cpuSeconds for thread \
+               in processStats.readThreadStats(processID).values())
+
+"""
+Runs BasicParent, and measures the CPU use of BasicDaemon while it waits
+for messages.
+Keyword Arguments:
+outFile -- A file where test output will be sent.
+Returns the percentage of one CPU used by BasicDaemon, or None if measuring
+failed.
+"""
+def measureIdleCPU(outFile):
+    runSeconds = idleStartupSeconds + idleMeasureSeconds + 1
+    try:
+        parentProcess = subprocess.Popen([paths.parentSecureExePath, \
+                                          '--timeout', str(runSeconds)], \
+                                         stdout = outFile, stderr = outFile)
+    except OSError as e:
+        outFile.write('Failed to run BasicParent: ' + str(e) + '\n')
+        return None
+    cpuPercent = None
+    try:
+        daemonID = None
+        waitEnd = time.monotonic() + idleStartupSeconds
+        while daemonID is None and time.monotonic() < waitEnd:
+            time.sleep(0.01)
+            daemonID = processStats.findProcess(paths.daemonSecureExePath)
+        if daemonID is None:
+            outFile.write('BasicDaemon did not start.\n')
+        else:
+            time.sleep(idleStartupSeconds)
+            startCPU = readCPUSeconds(daemonID)
+            startTime = time.monotonic()
+            time.sleep(idleMeasureSeconds)
+            cpuSeconds = readCPUSeconds(daemonID) - startCPU
+            cpuPercent = 100 * cpuSeconds / (time.monotonic() - startTime)
+    except OSError as e:
+        outFile.write('Failed to read BasicDaemon CPU time: ' + str(e) + '\n')
+    try:
+        parentProcess.wait(timeout = runSeconds + 5)
+    except subprocess.TimeoutExpired:
+        parentProcess.kill()
+        parentProcess.wait()
+    return cpuPercent
+
+"""
+Tests that performance measurements stay within their baseline tolerances.
+Keyword Arguments:
+testArgs -- A testArgs.Values argument object.
+"""
+def getTests(testArgs):
+    title = 'Performance regression tests:'
+    testCount = 4
+    def testFunction(tests):
+        with open(paths.baselinePath, 'r') as baselineFile:
+            baselines = json.load(baselineFile)
+
+        """
+        Compares a measurement against its stored baseline.
+        Keyword Arguments:
+        group       -- The baseline group name.
+        name        -- The measurement name within the group.
+        value       -- The measured value, or an InitCode if measuring failed.
+        description -- The description to print with the test results.
+        """
+        def checkMeasurement(group, name, value, description):
+            baseline = baselines[group][name]
+            if isinstance(value, InitCode):
+                tests.checkResult(Result(value, \
+                                         InitCode.performanceAcceptable), \
+                                  description)
+                return
+            if testArgs.updateBaselines:
+                baseline['baseline'] = round(value, 2)
+            limit = baseline['baseline'] * (1 + baseline['tolerance']) \
+                    + baseline['slack']
+            resultCode = InitCode.performanceAcceptable if value <= limit \
+                         else InitCode.performanceRegression
+            description += ' Measured {:.2f}, baseline {:.2f}, limit {:.2f}.' \
+                           .format(value, baseline['baseline'], limit)
+            tests.checkResult(Result(resultCode, \
+                                     InitCode.performanceAcceptable), \
+                              description)
+
+        """
+        Gets a value from a benchmark record.
+        Keyword Arguments:
+        record    -- A benchmark result record, or None if the benchmark
+                     failed.
+        valueName -- The name of the value to read.
+        Returns the value, or an InitCode if the value isn't available.
+        """
+        def readValue(record, valueName):
+            if not benchmarksBuilt:
+                return InitCode.benchmarkBuildFailure
+            if record is None or record.get(valueName) is None:
+                return InitCode.benchmarkRunFailure
+            return record[valueName]
+
+        makeArgs = ['VERBOSE=1'] if testArgs.useVerbose else []
+        with open(paths.tempLogPath, 'a') as outFile:
+            tests.printStatus('Building benchmarks:')
+            benchmarksBuilt = make.buildBenchmarks(benchmarkNames, makeArgs, \
+                                                   outFile)
+        startupRecord = None
+        ipcRecord = None
+        if benchmarksBuilt:
+            with open(paths.tempLogPath, 'a') as outFile:
+                tests.printStatus('Running StartupBenchmark:')
+                startupRecord = findRecord(runBenchmark('StartupBenchmark', \
+                        ['--mode', 'timing', '--samples', '50'], outFile), \
+                        { 'mode' : 'timing' })
+                tests.printStatus('Running IPCBenchmark:')
+                ipcRecord = findRecord(runBenchmark('IPCBenchmark', \
+                        ['--sizes', '64', '--senders', '1', \
+                         '--messages', '5000'], outFile), \
+                        { 'mode' : 'latency' })
+
+        checkMeasurement('startup', 'ready_p50_us', \
+                         readValue(startupRecord, 'ready_p50_us'), \
+                         'Checking median daemon startup latency (us).')
+        checkMeasurement('startup', 'first_reply_p50_us', \
+                         readValue(startupRecord, 'first_reply_p50_us'), \
+                         'Checking median time to first daemon reply (us).')
+        checkMeasurement('ipc', 'round_trip_p50_us', \
+                         readValue(ipcRecord, 'round_trip_p50_us'), \
+                         'Checking median 64 byte IPC round trip (us).')
+
+        # Measure idle CPU use with a Release build of BasicDaemon that runs
+        # until its parent exits:
+        buildArgs = make.getBuildArgs(debugBuild = False, timeout = 0, \
+                                      verbose = testArgs.useVerbose)
+        idleResult = tests.parentBuildInstall(buildArgs)
+        if idleResult == InitCode.parentInitSuccess:
+            buildArgs = make.getBuildArgs(debugBuild = False, timeout = 0, \
+                                          verbose = testArgs.useVerbose)
+            idleResult = tests.daemonBuildInstall(buildArgs)
+        if idleResult == InitCode.daemonInitSuccess:
+            tests.printStatus('Measuring BasicDaemon idle CPU use:')
+            with open(paths.tempLogPath, 'a') as outFile:
+                idleResult = measureIdleCPU(outFile)
+            if idleResult is None:
+                idleResult = InitCode.benchmarkRunFailure
+        checkMeasurement('idle', 'daemon_cpu_percent', idleResult, \
+                         'Checking BasicDaemon idle CPU use (% of one CPU).')
+
+        if testArgs.updateBaselines:
+            with open(paths.baselinePath, 'w') as baselineFile:
+                json.dump(baselines, baselineFile, indent = 4, \
+                          sort_keys = True)
+                baselineFile.write('\n')
+            print('  Saved new baselines to ' + paths.baselinePath)
+    return Test(title, testFunction, testCount, testArgs)
+
+# Run this file's tests alone if executing this module as a script:
+if __name__ == '__main__':
+    args = testArgs.read()
+    if args.printHelp:
+        testArgs.printHelp('performance.py', \
+                           'Compare DaemonFramework benchmark results ' \
+                           + 'against stored performance baselines.')
+    getTests(args).runAll()